@@ -29,25 +29,41 @@ FOUNDATION_EXPORT double GLTFVersionNumber;
 FOUNDATION_EXPORT const unsigned char GLTFVersionString[];
 
 #import <GLTF/GLTFAccessor.h>
+#import <GLTF/GLTFAnimatedBounds.h>
 #import <GLTF/GLTFAnimation.h>
+#import <GLTF/GLTFAnimationMixer.h>
 #import <GLTF/GLTFAsset.h>
+#import <GLTF/GLTFAssetWriter.h>
 #import <GLTF/GLTFBinaryChunk.h>
 #import <GLTF/GLTFBuffer.h>
 #import <GLTF/GLTFBufferAllocator.h>
 #import <GLTF/GLTFBufferView.h>
 #import <GLTF/GLTFCamera.h>
 #import <GLTF/GLTFDefaultBufferAllocator.h>
+#import <GLTF/GLTFDrawCommandRecorder.h>
+#import <GLTF/GLTFDrawSortKey.h>
 #import <GLTF/GLTFEnums.h>
 #import <GLTF/GLTFExtensionNames.h>
+#import <GLTF/GLTFFrustumCuller.h>
 #import <GLTF/GLTFImage.h>
 #import <GLTF/GLTFKHRLight.h>
 #import <GLTF/GLTFMaterial.h>
 #import <GLTF/GLTFMesh.h>
+#import <GLTF/GLTFMeshlet.h>
+#import <GLTF/GLTFMeshSimplifier.h>
+#import <GLTF/GLTFMorphTargetEvaluator.h>
 #import <GLTF/GLTFNode.h>
 #import <GLTF/GLTFObject.h>
+#import <GLTF/GLTFOcclusionBuffer.h>
 #import <GLTF/GLTFScene.h>
+#import <GLTF/GLTFSceneBVH.h>
+#import <GLTF/GLTFSceneInstance.h>
 #import <GLTF/GLTFSkin.h>
+#import <GLTF/GLTFSkinPalette.h>
+#import <GLTF/GLTFSkinningEvaluator.h>
 #import <GLTF/GLTFTexture.h>
 #import <GLTF/GLTFTextureSampler.h>
+#import <GLTF/GLTFTransformStore.h>
+#import <GLTF/GLTFTriangleBVH.h>
 #import <GLTF/GLTFVertexDescriptor.h>
 #import <GLTF/GLTFUtilities.h>
@@ -21,3 +21,4 @@ extern NSString *const GLTFExtensionKHRLights;
 extern NSString *const GLTFExtensionKHRMaterialsUnlit;
 extern NSString *const GLTFExtensionKHRTextureTransform;
 extern NSString *const GLTFExtensionEXTPBRAttributes;
+extern NSString *const GLTFExtensionMSFTLOD;
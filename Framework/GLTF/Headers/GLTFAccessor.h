@@ -34,7 +34,21 @@ typedef struct {
 @property (nonatomic, assign) GLTFDataDimension dimension;
 @property (nonatomic, assign) NSInteger offset;
 @property (nonatomic, assign) NSInteger count;
+@property (nonatomic, assign) BOOL normalized;
 @property (nonatomic, assign) GLTFValueRange valueRange;
+
+// Pointer to the first element of the accessor, or NULL if it has no backing buffer
+@property (nonatomic, readonly) const void * _Nullable contents;
+// Distance in bytes between consecutive elements; honors the buffer view's stride if present
+@property (nonatomic, readonly) NSInteger elementStride;
+@property (nonatomic, readonly) NSInteger componentCount;
+
+// Copies all elements into a tightly packed array of `count * componentCount` floats,
+// converting (and, if the accessor is normalized, rescaling) integer components
+- (void)getFloatValues:(float *)values;
+
+// Copies all elements into a tightly packed array of `count * componentCount` integers
+- (void)getUnsignedIntValues:(uint32_t *)values;
 @end
 
 NS_ASSUME_NONNULL_END
@@ -0,0 +1,46 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+#import "GLTFUtilities.h"
+
+@import Foundation;
+@import simd;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class GLTFMesh, GLTFSkin;
+
+// Conservative bounds of a mesh that follow its skeleton and morph targets. At creation the vertices influenced by
+// each joint are boxed in bind space, and each morph target's position deltas are boxed; a pose is then bounded by
+// transforming the joint boxes by the joint matrices, widened by the weighted delta boxes, in time proportional
+// to the number of joints and targets rather than vertices. Vertices no joint influences are bounded where they are.
+@interface GLTFAnimatedBounds : NSObject
+
+- (instancetype)initWithMesh:(GLTFMesh *)mesh skin:(GLTFSkin * _Nullable)skin;
+
+@property (nonatomic, readonly, assign) NSInteger jointCount;
+@property (nonatomic, readonly, assign) NSInteger targetCount;
+
+// Bounds in the mesh node's space for joint matrices such as GLTFSkinPalette's, or in bind pose if jointMatrices
+// is NULL. Weights may be NULL if no targets are active.
+- (GLTFBoundingBox)boundsWithJointMatrices:(const simd_float4x4 * _Nullable)jointMatrices
+                                jointCount:(NSInteger)jointCount
+                        morphTargetWeights:(const float * _Nullable)weights
+                                     count:(NSInteger)weightCount;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -16,16 +16,99 @@
 
 #import "GLTFObject.h"
 #import "GLTFEnums.h"
+#import "GLTFUtilities.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
-@class GLTFNode, GLTFAccessor;
+@class GLTFNode, GLTFAccessor, GLTFAnimationSampler, GLTFSceneInstance;
+
+typedef NS_OPTIONS(uint8_t, GLTFAnimationPoseChannels) {
+    GLTFAnimationPoseChannelTranslation = 1 << 0,
+    GLTFAnimationPoseChannelRotation    = 1 << 1,
+    GLTFAnimationPoseChannelScale       = 1 << 2,
+    GLTFAnimationPoseChannelWeights     = 1 << 3,
+};
+
+// Caller-owned pose arrays indexed by the transform index of an instance's nodes, for code that combines
+// several clips itself. Sampling sets a node's channel bits for each path it writes and leaves the rest alone.
+typedef struct {
+    simd_float3 *translations;
+    GLTFQuaternion *rotations;
+    simd_float3 *scales;
+    GLTFAnimationPoseChannels *channels;
+    // Optional; a node's weights start at morphTargetWeightOffsets[index] and end at the next node's offset
+    float * _Nullable morphTargetWeights;
+    const NSInteger * _Nullable morphTargetWeightOffsets;
+} GLTFAnimationPose;
+
+// How far compressed channels may stray from their source keyframes, per path
+typedef struct {
+    float translation; // scene units
+    float rotation;    // radians
+    float scale;       // scale factor units
+    float weight;      // morph target weight units
+} GLTFAnimationCompressionTolerances;
+
+// Totals over the channels of a compressed clip. Errors are the worst found at the source keyframes: in scene
+// units for translations and scales, radians for rotations and weight units for morph targets.
+@interface GLTFAnimationCompressionReport : NSObject
+@property (nonatomic, readonly, assign) NSUInteger sourceByteCount;
+@property (nonatomic, readonly, assign) NSUInteger compressedByteCount;
+@property (nonatomic, readonly, assign) double compressionRatio; // source bytes per compressed byte
+@property (nonatomic, readonly, assign) NSUInteger sourceKeyFrameCount;
+@property (nonatomic, readonly, assign) NSUInteger retainedKeyFrameCount;
+@property (nonatomic, readonly, assign) float maximumTranslationError;
+@property (nonatomic, readonly, assign) float maximumRotationError;
+@property (nonatomic, readonly, assign) float maximumScaleError;
+@property (nonatomic, readonly, assign) float maximumWeightError;
+// Sums the sizes and keeps the worst errors, e.g. to summarize every clip of a library
++ (instancetype)reportCombiningReports:(NSArray<GLTFAnimationCompressionReport *> *)reports;
+@end
 
 @interface GLTFAnimation : GLTFObject
 @property (nonatomic, copy) NSArray *channels;
-@property (nonatomic, copy) NSDictionary *samplers;
+@property (nonatomic, copy) NSArray<GLTFAnimationSampler *> *samplers;
+// Span of the keyframes of all channels. Cached, along with each channel's keyframe pointers,
+// until the channels or samplers are replaced or -setNeedsCompile is called.
+@property (nonatomic, readonly, assign) NSTimeInterval startTime;
+@property (nonatomic, readonly, assign) NSTimeInterval endTime;
+@property (nonatomic, readonly, assign) NSTimeInterval duration;
+
+// When positive, every channel is resampled at this many frames per second as it is compiled, so that sampling
+// is a direct index and one interpolation rather than a keyframe search and a cubic or spherical interpolation.
+// Costs bakedByteCount bytes: roughly duration * rate * (floats per value) * 4 per channel.
+@property (nonatomic, assign) double bakedFrameRate;
+@property (nonatomic, readonly, assign) NSUInteger bakedByteCount;
+
+// When any tolerance is positive, compilation drops keyframes of the paths with positive tolerances that
+// interpolating their neighbors reproduces within tolerance, then stores rotations in 48 bits (smallest three)
+// and translations and scales as 16-bit fractions of each channel's range. Values are decoded as they are
+// sampled. Paths with a tolerance of zero, and cubic spline channels unless the clip is also baked, are left alone.
+@property (nonatomic, assign) GLTFAnimationCompressionTolerances compressionTolerances;
+@property (nonatomic, readonly, nullable) GLTFAnimationCompressionReport *compressionReport;
+
+// Call after retargeting a channel or changing a sampler's accessors in place
+- (void)setNeedsCompile;
 
+// Poses the target nodes; times outside a channel's keyframes hold its first or last value.
+// Honors each sampler's interpolation mode, including the tangents of cubic splines.
 - (void)runAtTime:(NSTimeInterval)time;
+
+// Poses one instance of the scene the target nodes belong to, leaving the nodes themselves untouched.
+// Channels are evaluated in batches grouped by path, with rotations interpolated four at a time by a
+// close approximation of slerp. Different instances may be run concurrently; a single instance must not be.
+- (void)runAtTime:(NSTimeInterval)time instance:(GLTFSceneInstance *)instance;
+
+// Samples the clip as -runAtTime:instance: would, but into the pose instead of the instance's transform store.
+// The instance only supplies the node indexing and keyframe cursors.
+- (void)sampleAtTime:(NSTimeInterval)time instance:(GLTFSceneInstance *)instance intoPose:(GLTFAnimationPose *)pose;
+
+// Runs animations[i] at times[i] on instances[i] for every i, spreading the instances across all cores, then
+// brings each instance's world transforms up to date. An instance may appear in several runs; its runs are
+// applied in the order given.
++ (void)runAnimations:(NSArray<GLTFAnimation *> *)animations
+              atTimes:(const NSTimeInterval *)times
+            instances:(NSArray<GLTFSceneInstance *> *)instances;
 @end
 
 @interface GLTFAnimationSampler : GLTFObject
@@ -36,7 +119,8 @@ NS_ASSUME_NONNULL_BEGIN
 
 @interface GLTFAnimationChannel : NSObject
 @property (nonatomic, weak) GLTFNode *targetNode;
-@property (nonatomic, weak) NSString *targetPath;
+@property (nonatomic, copy) NSString *targetPath;
+@property (nonatomic, readonly, assign) GLTFAnimationPath path; // parsed from targetPath
 @property (nonatomic, weak) GLTFAnimationSampler *sampler;
 @property (nonatomic, readonly, assign) NSTimeInterval duration;
 @property (nonatomic, readonly, assign) NSTimeInterval startTime;
@@ -0,0 +1,72 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+#import "GLTFUtilities.h"
+
+@import Foundation;
+@import simd;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class GLTFAnimation, GLTFNode, GLTFSceneInstance;
+
+typedef NS_ENUM(NSInteger, GLTFAnimationBlendMode) {
+    // Averaged with the other blended layers by weight; nodes whose total weight is below one
+    // make up the difference from their rest pose
+    GLTFAnimationBlendModeBlend,
+    // Applied on top of the blended result as a difference from the rest pose, scaled by weight
+    GLTFAnimationBlendModeAdditive,
+};
+
+@interface GLTFAnimationMixerLayer : NSObject
+
+@property (nonatomic, readonly, strong) GLTFAnimation *animation;
+@property (nonatomic, assign) NSTimeInterval time;
+@property (nonatomic, assign) float weight;
+@property (nonatomic, assign) GLTFAnimationBlendMode blendMode;
+
+// Scales the layer's weight per node. Layers start unmasked, i.e. with a mask weight of one everywhere.
+- (void)setMaskWeight:(float)weight forNode:(GLTFNode *)node;
+// Restricts the layer to the node and its descendants, e.g. to play a clip on the upper body only
+- (void)setMaskToSubtreeOfNode:(GLTFNode *)node;
+- (void)removeMask;
+
+@end
+
+// Combines any number of clips into one pose of a scene instance: blended layers are averaged by weight
+// (rotations by accumulating sign-aligned quaternions and normalizing once), then additive layers are applied
+// in order. All of the work happens in the mixer's own pose buffers; the instance is written once at the end.
+@interface GLTFAnimationMixer : NSObject
+
+- (instancetype)initWithSceneInstance:(GLTFSceneInstance *)instance;
+
+@property (nonatomic, readonly, strong) GLTFSceneInstance *instance;
+@property (nonatomic, readonly, copy) NSArray<GLTFAnimationMixerLayer *> *layers;
+
+- (GLTFAnimationMixerLayer *)addLayerWithAnimation:(GLTFAnimation *)animation;
+- (void)removeLayer:(GLTFAnimationMixerLayer *)layer;
+
+// Samples every layer with a nonzero weight and writes the combined pose to the instance. Channels animated
+// only by additive layers are offset from the rest pose, so evaluating twice at the same times gives the same pose.
+// Nodes no layer animates keep whatever pose the instance already had.
+- (void)evaluate;
+
+// Copies the most recently evaluated pose onto the scene's nodes, for code that reads them directly
+- (void)writePoseToNodes;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -32,6 +32,24 @@ NS_ASSUME_NONNULL_BEGIN
 - (void)assetWithURL:(NSURL *)assetURL didFailToLoadWithError:(NSError *)error;
 @end
 
+typedef struct {
+    NSInteger mergedAccessorCount;
+    NSInteger mergedImageCount;
+    NSInteger mergedSamplerCount;
+    NSInteger mergedTextureCount;
+    NSInteger mergedMaterialCount;
+    NSInteger removedAccessorCount; // Unreferenced objects removed, not counting merged duplicates
+    NSInteger removedBufferViewCount;
+    NSInteger removedBufferCount;
+    NSInteger removedImageCount;
+    NSInteger removedSamplerCount;
+    NSInteger removedTextureCount;
+    NSInteger removedMaterialCount;
+    NSInteger removedMeshCount;
+    NSInteger duplicateByteCount; // Accessor and image bytes that are no longer referenced more than once
+    NSInteger reclaimedBufferByteCount; // Total length of the buffers released
+} GLTFAssetCompactionStatistics;
+
 @interface GLTFAsset : NSObject
 
 @property (nonatomic, readonly, strong) NSArray<GLTFScene *> *scenes;
@@ -61,6 +79,21 @@ NS_ASSUME_NONNULL_BEGIN
 
 - (void)addCamera:(GLTFCamera *)camera;
 
+// Partitions every triangle submesh in the asset into meshlets, processing submeshes concurrently
+- (void)buildMeshletsWithMaxVertexCount:(NSInteger)maxVertexCount maxTriangleCount:(NSInteger)maxTriangleCount;
+
+// Builds up to `levelCount` simplified levels for each triangle submesh that doesn't have them yet.
+// Each level targets `reductionFactor` times the triangles of the one before it, and stops early
+// once the relative simplification error, accumulated from the full-detail submesh, would exceed `maxError`.
+// Submeshes are simplified concurrently.
+- (void)buildLevelsOfDetailWithCount:(NSInteger)levelCount reductionFactor:(float)reductionFactor maxError:(float)maxError;
+
+// Merges accessors, images, samplers, textures and materials with identical contents, then releases
+// every accessor, buffer view, buffer, image, sampler, texture, material and mesh that is no longer
+// referenced. Should be called before handing the asset to a renderer, since renderers cache
+// resources by object identifier.
+- (GLTFAssetCompactionStatistics)removeUnusedAndDuplicateObjects;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -0,0 +1,38 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+@import Foundation;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class GLTFAsset;
+
+// Serializes an asset as a self-contained binary glTF (GLB) file. All accessor and image data is
+// packed into a single binary chunk whose contents begin on a 16-byte file offset, and every buffer
+// view starts on a 16-byte boundary within it. Accessors are written densely (sparse accessors are
+// expanded), 8-bit indices are widened to 16 bits, and images are embedded rather than referenced by
+// URI, so loading the result never requires realigning, densifying or widening data.
+@interface GLTFAssetWriter : NSObject
+
+- (instancetype)initWithAsset:(GLTFAsset *)asset;
+
+- (NSData * _Nullable)binaryDataWithError:(NSError **)error;
+
+- (BOOL)writeBinaryToURL:(NSURL *)url error:(NSError **)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,117 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFEnums.h"
+
+@import Foundation;
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM(NSInteger, GLTFDrawCullMode) {
+    GLTFDrawCullModeNone,
+    GLTFDrawCullModeFront,
+    GLTFDrawCullModeBack,
+};
+
+typedef NS_ENUM(NSInteger, GLTFDrawWinding) {
+    GLTFDrawWindingClockwise,
+    GLTFDrawWindingCounterClockwise,
+};
+
+typedef NS_ENUM(NSInteger, GLTFDrawCommandType) {
+    GLTFDrawCommandTypeSetPipelineState,
+    GLTFDrawCommandTypeSetDepthStencilState,
+    GLTFDrawCommandTypeSetCullMode,
+    GLTFDrawCommandTypeSetFrontFacingWinding,
+    GLTFDrawCommandTypeSetVertexBuffer,
+    GLTFDrawCommandTypeSetVertexBufferOffset,
+    GLTFDrawCommandTypeSetVertexBytes,
+    GLTFDrawCommandTypeSetFragmentBytes,
+    GLTFDrawCommandTypeSetFragmentTexture,
+    GLTFDrawCommandTypeSetFragmentSamplerState,
+    GLTFDrawCommandTypeDraw,
+    GLTFDrawCommandTypeDrawIndexed,
+    GLTFDrawCommandTypePushDebugGroup,
+    GLTFDrawCommandTypePopDebugGroup,
+};
+
+extern const NSInteger GLTFDrawCommandTypeCount;
+
+// Slots whose bindings are tracked; binds to higher indices are always kept
+extern const NSUInteger GLTFDrawCommandMaxBufferCount;
+extern const NSUInteger GLTFDrawCommandMaxTextureCount;
+extern const NSUInteger GLTFDrawCommandMaxSamplerCount;
+
+// The subset of a render command encoder needed to draw glTF submeshes. Pipelines, depth-stencil states, buffers,
+// textures and samplers are whatever objects the implementation uses for them; index types are
+// GLTFDataTypeUShort or GLTFDataTypeUInt.
+@protocol GLTFDrawCommandBackend <NSObject>
+- (void)setPipelineState:(id)pipelineState;
+- (void)setDepthStencilState:(id)depthStencilState;
+- (void)setCullMode:(GLTFDrawCullMode)cullMode;
+- (void)setFrontFacingWinding:(GLTFDrawWinding)winding;
+- (void)setVertexBuffer:(id _Nullable)buffer offset:(NSUInteger)offset atIndex:(NSUInteger)index;
+- (void)setVertexBufferOffset:(NSUInteger)offset atIndex:(NSUInteger)index;
+- (void)setVertexBytes:(const void *)bytes length:(NSUInteger)length atIndex:(NSUInteger)index;
+- (void)setFragmentBytes:(const void *)bytes length:(NSUInteger)length atIndex:(NSUInteger)index;
+- (void)setFragmentTexture:(id _Nullable)texture atIndex:(NSUInteger)index;
+- (void)setFragmentSamplerState:(id _Nullable)samplerState atIndex:(NSUInteger)index;
+- (void)drawPrimitives:(GLTFPrimitiveType)primitiveType vertexStart:(NSUInteger)vertexStart vertexCount:(NSUInteger)vertexCount;
+- (void)drawIndexedPrimitives:(GLTFPrimitiveType)primitiveType
+                   indexCount:(NSUInteger)indexCount
+                    indexType:(GLTFDataType)indexType
+                  indexBuffer:(id)indexBuffer
+            indexBufferOffset:(NSUInteger)indexBufferOffset;
+- (void)pushDebugGroup:(NSString *)name;
+- (void)popDebugGroup;
+@end
+
+typedef struct {
+    NSInteger commandCount;          // commands recorded, including draws
+    NSInteger drawCount;
+    NSInteger redundantCommandCount; // binds and state changes dropped because they were already in effect
+} GLTFDrawCommandStatistics;
+
+// Records draws into a compact command stream, keeping track of what is bound so that commands which wouldn't
+// change anything are dropped, then replays the stream into another backend. Bytes passed to set*Bytes are
+// copied, and are only dropped when they match the bytes last set at the same index. The recorder doesn't retain
+// the objects it's given, which must stay alive until it has been replayed.
+@interface GLTFDrawCommandRecorder : NSObject <GLTFDrawCommandBackend>
+
+@property (nonatomic, readonly) GLTFDrawCommandStatistics statistics;
+
+// Sends the recorded commands to the backend, in order. The stream is kept, and can be replayed again.
+- (void)replayWithBackend:(id<GLTFDrawCommandBackend>)backend;
+
+// Empties the stream and forgets what is bound; call before recording for a new encoder
+- (void)reset;
+
+@end
+
+// Counts the commands it receives and otherwise does nothing, for measuring the cost of recording and replaying
+// draws, and the state changes they lead to, without a GPU
+@interface GLTFNullDrawCommandBackend : NSObject <GLTFDrawCommandBackend>
+
+@property (nonatomic, readonly) NSInteger commandCount;
+
+- (NSInteger)countOfCommandsOfType:(GLTFDrawCommandType)commandType;
+
+- (void)reset;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,40 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+@import Foundation;
+
+NS_ASSUME_NONNULL_BEGIN
+
+// Draws are ordered by sorting 64-bit keys that pack everything the order depends on, most significant first.
+//
+// Both kinds of key have the same fields: a 16-bit pipeline index, a 20-bit material index and 28 bits of view depth.
+// Opaque keys put them in that order, so that draws sharing a pipeline and then a material are adjacent, and within
+// those, nearer draws come first to cut overdraw. Transparent keys lead with the view depth, inverted so that farther
+// draws come first, followed by the pipeline and material indices as tie-breakers. Indices wider than their fields
+// are truncated, which only costs batching. View depth is the distance in front of the camera; negative depths sort
+// as zero in opaque keys.
+extern uint64_t GLTFOpaqueDrawSortKey(uint32_t pipelineIndex, uint32_t materialIndex, float viewDepth);
+
+extern uint64_t GLTFTransparentDrawSortKey(uint32_t pipelineIndex, uint32_t materialIndex, float viewDepth);
+
+// Sorts keys in ascending order, moving values along with them. The sort is stable, so draws with equal keys keep
+// the order they were added in. Passes over bytes that are the same in every key are skipped. The scratch arrays
+// must each have room for count elements.
+extern void GLTFRadixSortDrawKeys(uint64_t *keys, uint32_t *values, NSInteger count,
+                                  uint64_t *scratchKeys, uint32_t *scratchValues);
+
+NS_ASSUME_NONNULL_END
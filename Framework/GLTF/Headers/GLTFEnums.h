@@ -176,3 +176,11 @@ typedef NS_ENUM(NSInteger, GLTFInterpolationMode) {
     GLTFInterpolationModeLinear,
     GLTFInterpolationModeCubic,
 };
+
+typedef NS_ENUM(NSInteger, GLTFAnimationPath) {
+    GLTFAnimationPathUnknown,
+    GLTFAnimationPathTranslation,
+    GLTFAnimationPathRotation,
+    GLTFAnimationPathScale,
+    GLTFAnimationPathWeights,
+};
@@ -0,0 +1,59 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFUtilities.h"
+
+@import Foundation;
+@import simd;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class GLTFNode, GLTFSceneBVH;
+
+// Decides which submeshes of a scene, or of one instance of it, lie inside a view frustum. The scene's bounding
+// volume hierarchy is culled once up front and then answers for each of its submeshes, as well as for whole subtrees
+// of nodes; submeshes outside it, such as those of MSFT_lod alternatives, are tested against their own bounds.
+@interface GLTFFrustumCuller : NSObject
+
+@property (nonatomic, readonly, assign) GLTFFrustum frustum;
+
+// Accumulated since the last -beginWithFrustum:. Every leaf of a hierarchy is counted when it's culled; other
+// submeshes as they're asked about.
+@property (nonatomic, readonly, assign) GLTFCullingStatistics statistics;
+
+// Starts over with a new frustum and resets the statistics
+- (void)beginWithFrustum:(GLTFFrustum)frustum;
+
+// Refits and culls the hierarchy, which answers the questions below until the next call. Passing nil leaves every
+// submesh to be tested on its own and every subtree to be visited.
+- (void)cullWithBoundingVolumeHierarchy:(GLTFSceneBVH * _Nullable)bvh;
+
+// NO if the node is in the culled hierarchy and none of its submeshes, nor those of its descendants, is visible, so
+// that a traversal can skip its subtree. Nodes with MSFT_lod alternatives are always visited, since their
+// alternatives aren't in the hierarchy.
+- (BOOL)isSubtreeOfNodeVisible:(GLTFNode *)node;
+
+// Whether the node's submesh at the index is in the frustum. The bounds, in the space of the model matrix, are only
+// tested if the node isn't in the culled hierarchy.
+- (BOOL)isSubmeshAtIndex:(NSInteger)submeshIndex
+                  ofNode:(GLTFNode *)node
+  visibleWithLocalBounds:(GLTFBoundingBox)localBounds
+             modelMatrix:(simd_float4x4)modelMatrix;
+
+@end
+
+NS_ASSUME_NONNULL_END
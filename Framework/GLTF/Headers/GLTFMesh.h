@@ -19,11 +19,14 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
-@class GLTFAccessor, GLTFVertexDescriptor, GLTFSubmesh, GLTFMaterial;
+@class GLTFAccessor, GLTFVertexDescriptor, GLTFSubmesh, GLTFMaterial, GLTFMeshletSet, GLTFLevelOfDetail, GLTFTriangleBVH;
 
 @interface GLTFMesh : GLTFObject
 @property (nonatomic, copy) NSArray<GLTFSubmesh *> *submeshes;
 @property (nonatomic, copy) NSArray<NSNumber *> *defaultMorphTargetWeights;
+// The same weights, stored packed
+@property (nonatomic, readonly, assign) NSInteger defaultMorphTargetWeightCount;
+@property (nonatomic, readonly) const float * _Nullable defaultMorphTargetWeightValues;
 @end
 
 @interface GLTFMorphTarget : GLTFObject
@@ -36,8 +39,13 @@ NS_ASSUME_NONNULL_BEGIN
 @property (nonatomic, weak) GLTFMaterial *material;
 @property (nonatomic, assign) GLTFPrimitiveType primitiveType;
 @property (nonatomic, copy) NSArray<GLTFMorphTarget *> *morphTargets;
+@property (nonatomic, strong) GLTFMeshletSet * _Nullable meshlets;
+// Simplified index ranges over the same vertices, in order of decreasing detail
+@property (nonatomic, copy) NSArray<GLTFLevelOfDetail *> *levelsOfDetail;
 
 @property (nonatomic, readonly) GLTFVertexDescriptor *vertexDescriptor;
+// For ray casts; built on first use, nil unless the submesh is made of triangles
+@property (nonatomic, readonly, strong) GLTFTriangleBVH * _Nullable triangleBVH;
 @end
 
 NS_ASSUME_NONNULL_END
@@ -0,0 +1,47 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFObject.h"
+
+@import Foundation;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class GLTFAccessor;
+
+/// Reduces a triangle list by collapsing edges in order of increasing quadric error, without
+/// introducing new vertices. Vertices on open boundaries and attribute seams are never moved.
+/// `targetError` is relative to the extent of the mesh (e.g. 0.01 is 1% of its largest dimension).
+/// Triangles with any index not less than `vertexCount` are dropped before simplifying.
+/// Writes at most `indexCount` indices to `destination` and returns the number written; if
+/// `resultError` is non-NULL, it receives the largest relative error introduced by any collapse.
+extern size_t GLTFSimplifyTriangles(uint32_t *destination, const uint32_t *indices, size_t indexCount,
+                                    const float *positions, size_t vertexCount,
+                                    size_t targetIndexCount, float targetError, float * _Nullable resultError);
+
+/// The largest dimension of the positions' bounding box, which relative errors are measured against.
+extern float GLTFSimplifierExtent(const float *positions, size_t vertexCount);
+
+/// A reduced-detail version of a submesh that shares the submesh's vertex buffers.
+@interface GLTFLevelOfDetail : NSObject
+@property (nonatomic, strong) GLTFAccessor *indexAccessor;
+// Upper bound on the geometric deviation from the full-detail submesh, in the submesh's local units.
+// Errors accumulate along a submesh's levels, so they never decrease with decreasing detail.
+@property (nonatomic, assign) float error;
+@end
+
+NS_ASSUME_NONNULL_END
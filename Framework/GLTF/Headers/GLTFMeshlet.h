@@ -0,0 +1,71 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFUtilities.h"
+
+@import Foundation;
+@import simd;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class GLTFSubmesh;
+
+extern const NSInteger GLTFMeshletDefaultMaxVertexCount;
+extern const NSInteger GLTFMeshletDefaultMaxTriangleCount;
+
+typedef struct {
+    uint32_t vertexOffset;   // first entry in the set's vertex index list
+    uint32_t triangleOffset; // first entry in the set's triangle index list (three entries per triangle)
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+    GLTFBoundingSphere bounds;
+    simd_float3 coneApex;
+    simd_float3 coneAxis;
+    float coneCutoff;        // sine of the cone's half-angle; 1 if the cluster can't be backface culled
+} GLTFMeshlet;
+
+/// A partition of a triangle submesh into small clusters, each of which references at most
+/// `maxVertexCount` vertices and `maxTriangleCount` triangles. Vertex indices refer to the
+/// submesh's vertex buffers; triangle indices are local to each meshlet.
+@interface GLTFMeshletSet : NSObject
+
+@property (nonatomic, readonly) NSInteger maxVertexCount;
+@property (nonatomic, readonly) NSInteger maxTriangleCount;
+@property (nonatomic, readonly) NSInteger meshletCount;
+@property (nonatomic, readonly) const GLTFMeshlet *meshlets;
+@property (nonatomic, readonly) NSInteger vertexIndexCount;
+@property (nonatomic, readonly) const uint32_t *vertexIndices;
+@property (nonatomic, readonly) NSInteger triangleIndexCount;
+@property (nonatomic, readonly) const uint8_t *triangleIndices;
+
+// Returns nil if the submesh isn't an indexed or non-indexed triangle list with float3 positions
+- (instancetype _Nullable)initWithSubmesh:(GLTFSubmesh *)submesh
+                           maxVertexCount:(NSInteger)maxVertexCount
+                         maxTriangleCount:(NSInteger)maxTriangleCount;
+
+// For caching generated meshlets offline; the format is only valid for the architecture that wrote it
+- (instancetype _Nullable)initWithSerializedData:(NSData *)data;
+- (NSData *)serializedData;
+
+@end
+
+// Writes the indices of meshlets that survive frustum and normal cone culling into `visibleIndices`,
+// returning the number written. The frustum and camera position are in world space.
+extern NSInteger GLTFMeshletCull(const GLTFMeshlet *meshlets, NSInteger meshletCount, simd_float4x4 modelMatrix,
+                                 const GLTFFrustum *frustum, simd_float3 cameraPosition, uint32_t *visibleIndices);
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,51 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+@import Foundation;
+@import simd;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class GLTFSubmesh;
+
+// Blends a submesh's morph targets on the CPU, for headless processing and for renderers that can't morph on the
+// GPU. Each target's position, normal and tangent deltas are repacked once, interleaved, and only for the vertices
+// the target actually moves, so evaluation skips targets with zero weight and touches few vertices per target.
+@interface GLTFMorphTargetEvaluator : NSObject
+
+- (instancetype)initWithSubmesh:(GLTFSubmesh *)submesh;
+
+@property (nonatomic, readonly, strong) GLTFSubmesh *submesh;
+@property (nonatomic, readonly, assign) NSInteger vertexCount;
+@property (nonatomic, readonly, assign) NSInteger targetCount;
+// NO if the submesh's attribute is missing, or has fewer elements than there are positions
+@property (nonatomic, readonly, assign) BOOL hasNormals;
+@property (nonatomic, readonly, assign) BOOL hasTangents;
+// Vertices moved by at least one target, summed over targets; at most targetCount * vertexCount
+@property (nonatomic, readonly, assign) NSInteger deltaCount;
+
+// Writes the submesh's attributes with weights[i] of target i applied, for the first count targets. Normals and
+// tangent directions are renormalized; tangent handedness is kept. Pass NULL for attributes you don't need, or
+// that the submesh doesn't have.
+- (void)evaluateWithWeights:(const float *)weights
+                      count:(NSInteger)count
+                  positions:(simd_float3 * _Nullable)positions
+                    normals:(simd_float3 * _Nullable)normals
+                   tangents:(simd_float4 * _Nullable)tangents;
+
+@end
+
+NS_ASSUME_NONNULL_END
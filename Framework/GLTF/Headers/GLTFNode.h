@@ -22,7 +22,7 @@ NS_ASSUME_NONNULL_BEGIN
 
 @import simd;
 
-@class GLTFCamera, GLTFSkin, GLTFMesh;
+@class GLTFCamera, GLTFSkin, GLTFMesh, GLTFTransformStore, GLTFAnimatedBounds, GLTFRayHit, GLTFSceneInstance;
 @class GLTFKHRLight;
 
 @interface GLTFNode : GLTFObject <GLTFNodeVisitable>
@@ -30,20 +30,49 @@ NS_ASSUME_NONNULL_BEGIN
 @property (nonatomic, weak) GLTFKHRLight * _Nullable light;
 @property (nonatomic, weak) GLTFNode * _Nullable parent;
 @property (nonatomic, copy) NSArray<GLTFNode *> *children;
+// Access to children without copying the array, for use in hot loops
+@property (nonatomic, readonly, assign) NSUInteger childCount;
 @property (nonatomic, weak) GLTFSkin * _Nullable skin;
 @property (nonatomic, copy) NSString * _Nullable jointName;
 @property (nonatomic, weak) GLTFMesh * _Nullable mesh;
 @property (nonatomic, copy) NSArray<NSNumber *> *morphTargetWeights;
+// The same weights, stored packed; setting the same number of weights again reuses the storage
+@property (nonatomic, readonly, assign) NSInteger morphTargetWeightCount;
+@property (nonatomic, readonly) const float * _Nullable morphTargetWeightValues;
 @property (nonatomic, assign) GLTFQuaternion rotationQuaternion;
 @property (nonatomic, assign) simd_float3 scale;
 @property (nonatomic, assign) simd_float3 translation;
 @property (nonatomic, assign) simd_float4x4 localTransform;
+// Safe to read from several threads at once, as long as no transform or hierarchy is being changed meanwhile.
+// Nodes bound to a transform store bring it up to date first, if needed, under the store's lock.
 @property (nonatomic, readonly, assign) simd_float4x4 globalTransform;
-@property (nonatomic, readonly, assign) GLTFBoundingBox approximateBounds; // axis-aligned; in local coordinates
+// Axis-aligned, in local coordinates, and covering the current pose of skinned and morphed meshes
+@property (nonatomic, readonly, assign) GLTFBoundingBox approximateBounds;
+// YES if the node's mesh is skinned or has morph targets, so that its bounds depend on its pose
+@property (nonatomic, readonly, assign) BOOL hasDeformableMesh;
+// Bounds of this node's mesh that follow its skin and morph weights; built on first use, nil without a mesh
+@property (nonatomic, readonly, strong) GLTFAnimatedBounds * _Nullable animatedBounds;
+// Lower-detail alternatives to this node (MSFT_lod), in order of decreasing detail
+@property (nonatomic, copy) NSArray<GLTFNode *> *levelOfDetailNodes;
+// Minimum fraction of the viewport height this node and each of its alternatives should cover to be drawn
+@property (nonatomic, copy) NSArray<NSNumber *> *levelOfDetailScreenCoverages;
+// The store this node's transforms are mirrored in, if its scene has one, and the node's index within it
+@property (nonatomic, readonly, weak) GLTFTransformStore * _Nullable transformStore;
+@property (nonatomic, readonly, assign) NSInteger transformIndex;
 
+- (GLTFNode *)childAtIndex:(NSUInteger)index;
+- (void)setMorphTargetWeightValues:(const float * _Nullable)weights count:(NSInteger)count;
+// Bounds of the node's own mesh in its local coordinates. Deformable meshes are bounded by their animated bounds
+// as posed by the instance or, without one, by the nodes themselves; others by their position accessors' ranges.
+- (GLTFBoundingBox)meshBoundsForInstance:(GLTFSceneInstance * _Nullable)instance;
 - (void)addChildNode:(GLTFNode *)node;
 - (void)removeFromParent;
 
+// Find the closest (or any) triangle of this node and its descendants that the world-space ray hits. Each mesh is
+// tested on its own; scenes answer the same question through their bounding volume hierarchy.
+- (GLTFRayHit * _Nullable)closestHitForRay:(GLTFRay)ray maximumDistance:(float)maximumDistance;
+- (GLTFRayHit * _Nullable)anyHitForRay:(GLTFRay)ray maximumDistance:(float)maximumDistance;
+
 @end
 
 NS_ASSUME_NONNULL_END
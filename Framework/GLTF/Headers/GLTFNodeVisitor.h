@@ -21,13 +21,22 @@ NS_ASSUME_NONNULL_BEGIN
 @class GLTFNode;
 
 typedef NS_ENUM(NSInteger, GLTFVisitationStrategy) {
-    GLTFVisitationStrategyDepthFirst
+    GLTFVisitationStrategyDepthFirst, // pre-order: parents before their children
+    GLTFVisitationStrategyDepthFirstPostOrder, // children before their parents
+    GLTFVisitationStrategyBreadthFirst, // level by level
+    // Pre-order within each subtree, but independent subtrees are visited in parallel, so the visitor must be thread-safe
+    GLTFVisitationStrategyConcurrent,
 };
 
+// Setting *stop to NO skips the node's children; it has no effect in post-order, where they have already been visited.
+// Visitors must not add or remove nodes in the hierarchy being traversed.
 typedef void (^GLTFNodeVisitor)(GLTFNode *node, int depth, BOOL *stop);
 
 @protocol GLTFNodeVisitable <NSObject>
 - (void)acceptVisitor:(GLTFNodeVisitor)visitor strategy:(GLTFVisitationStrategy)strategy;
 @end
 
+// Traverses the hierarchies rooted at each of the nodes without allocating per node
+extern void GLTFVisitNodes(NSArray<GLTFNode *> *nodes, GLTFNodeVisitor visitor, GLTFVisitationStrategy strategy);
+
 NS_ASSUME_NONNULL_END
@@ -0,0 +1,63 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFUtilities.h"
+
+@import Foundation;
+@import simd;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class GLTFSubmesh;
+
+// A small software depth buffer for occlusion culling. Large nearby meshes are rasterized into it on the CPU, and
+// the bounds of everything else are tested against it before anything is drawn. Depths are clip-space z / w as
+// produced by a Metal-style projection (0 near, 1 far). The buffer is split into tiles that are rasterized in
+// parallel; each pixel keeps the nearest occluder depth, so the result doesn't depend on thread timing. A coarse
+// level holding the farthest depth of each 8x8 block lets most boxes be rejected without visiting their pixels.
+@interface GLTFOcclusionBuffer : NSObject
+
+- (instancetype)initWithWidth:(NSInteger)width height:(NSInteger)height;
+
+@property (nonatomic, readonly) NSInteger width;
+@property (nonatomic, readonly) NSInteger height;
+
+// Empties the buffer and the occluder list and sets the view-projection used until the next call
+- (void)beginFrameWithViewProjectionMatrix:(simd_float4x4)viewProjection;
+
+// Queue an occluder's triangles. Submeshes are simplified to their coarsest level of detail, if they have levels,
+// and their triangles are cached for later frames. Positions are three floats per vertex, three vertices per
+// triangle. Triangles crossing the near plane are left out, which can only let more through.
+- (void)addOccluderSubmesh:(GLTFSubmesh *)submesh modelMatrix:(simd_float4x4)modelMatrix;
+- (void)addOccluderTriangles:(const simd_float3 *)positions triangleCount:(NSInteger)triangleCount modelMatrix:(simd_float4x4)modelMatrix;
+
+// Rasterizes the queued occluders; call once after adding them and before testing
+- (void)rasterizeOccluders;
+
+@property (nonatomic, readonly) NSInteger occluderTriangleCount;
+
+// NO only if the box is certainly hidden behind the occluders or entirely off-screen. Boxes level with an occluder,
+// such as the occluder's own bounds, count as visible.
+- (BOOL)isBoundingBoxVisible:(GLTFBoundingBox)bounds modelMatrix:(simd_float4x4)modelMatrix;
+
+// Row-major, top row first, as of the last rasterization
+@property (nonatomic, readonly) const float *depthValues;
+@property (nonatomic, readonly) NSInteger depthRowStride;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -22,14 +22,29 @@ NS_ASSUME_NONNULL_BEGIN
 
 @class GLTFNode;
 @class GLTFKHRLight;
+@class GLTFRayHit;
+@class GLTFSceneBVH;
+@class GLTFTransformStore;
 
 @interface GLTFScene : GLTFObject <GLTFNodeVisitable>
 @property (nonatomic, copy) NSArray<GLTFNode *> *nodes;
 @property (nonatomic, weak) GLTFKHRLight * _Nullable ambientLight;
+// Answered from the bounding volume hierarchy once the scene has a transform store, and by visiting every node
+// otherwise
 @property (nonatomic, readonly, assign) GLTFBoundingBox approximateBounds;
+// Optional flattened transform hierarchy, created with -[GLTFTransformStore initWithScene:]
+@property (nonatomic, strong) GLTFTransformStore * _Nullable transformStore;
+// World bounds of the scene's submeshes over its transform store, or nil while it has none. Created on first use
+// and refitted by approximateBounds.
+@property (nonatomic, readonly, strong) GLTFSceneBVH * _Nullable boundingVolumeHierarchy;
 
 - (void)addNode:(GLTFNode *)node;
 
+// Find the closest (or any) triangle the world-space ray hits, through the refitted bounding volume hierarchy once
+// the scene has a transform store and by testing each root node's subtree otherwise
+- (GLTFRayHit * _Nullable)closestHitForRay:(GLTFRay)ray maximumDistance:(float)maximumDistance;
+- (GLTFRayHit * _Nullable)anyHitForRay:(GLTFRay)ray maximumDistance:(float)maximumDistance;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -0,0 +1,91 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFUtilities.h"
+
+@import Foundation;
+@import simd;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class GLTFNode, GLTFRayHit, GLTFScene, GLTFSceneInstance, GLTFSubmesh, GLTFTransformStore;
+
+typedef BOOL (^GLTFSceneBVHBoundsTest)(GLTFBoundingBox bounds);
+typedef void (^GLTFSceneBVHLeafVisitor)(GLTFNode *node, GLTFSubmesh *submesh, GLTFBoundingBox bounds, BOOL *stop);
+
+// A bounding volume hierarchy over the world-space bounds of every submesh of a scene, or of one instance of it.
+// It is built once from the flattened transforms of a transform store and afterwards only refitted: leaves whose
+// node moved get new bounds and only their ancestors are updated, so scenes with mostly static nodes cost little
+// per frame. Culling, picking and camera framing can all share it.
+@interface GLTFSceneBVH : NSObject
+
+// Uses the scene's transform store, which the caller must have created; the scene is left as it is
+- (instancetype)initWithScene:(GLTFScene *)scene;
+
+// Uses the instance's transform store and root transform
+- (instancetype)initWithSceneInstance:(GLTFSceneInstance *)instance;
+
+@property (nonatomic, readonly, strong) GLTFTransformStore *transformStore;
+
+// One leaf per submesh of every mesh node in the store
+@property (nonatomic, readonly) NSInteger leafCount;
+@property (nonatomic, readonly) NSInteger nodeCount;
+
+// Bounds of the whole scene as of the last refit
+@property (nonatomic, readonly, assign) GLTFBoundingBox bounds;
+
+// Brings the world bounds up to date with the transform store, rebuilding the tree if the hierarchy changed
+- (void)refit;
+
+// Builds the tree from scratch. Refitting keeps the tree's shape, which loosens it as nodes travel, so rebuild
+// after large movements.
+- (void)rebuild;
+
+// Replaces the local bounds of every submesh of the node until the next rebuild, e.g. with the bounds of a
+// skin palette for a mesh that is animated. Applied on the next refit.
+- (void)setLocalBounds:(GLTFBoundingBox)bounds forNode:(GLTFNode *)node;
+
+// Visits every leaf whose world bounds pass the test, skipping subtrees whose bounds fail it, so the test must
+// pass any box that contains a box it would pass
+- (void)enumerateLeavesPassingTest:(GLTFSceneBVHBoundsTest)test usingVisitor:(GLTFSceneBVHLeafVisitor)visitor;
+
+// Sets visibility[i] for every leaf i, skipping subtrees outside the frustum and not testing any further inside
+// subtrees the frustum contains. Visibility must have room for leafCount entries.
+- (GLTFCullingStatistics)cullWithFrustum:(GLTFFrustum)frustum visibility:(bool *)visibility;
+
+// Sets subtreeVisibility[i] for every transform index i whose node or any of its descendants has a leaf marked in
+// visibility, as filled by -cullWithFrustum:visibility:, so traversals of the scene can skip whole subtrees. Entries
+// already set on input stay set and mark their ancestors too. subtreeVisibility must have room for the store's nodes.
+- (void)getSubtreeVisibility:(bool *)subtreeVisibility fromLeafVisibility:(const bool *)visibility;
+
+// The leaf of the node's submesh at the index, for looking up its visibility, or -1 if the node isn't in the tree
+- (NSInteger)leafIndexForNode:(GLTFNode *)node submeshIndex:(NSInteger)submeshIndex;
+
+// Ray casts against the world bounds as of the last refit, and then against the triangles of the submeshes the ray
+// reaches. They can run on several threads at once, as long as none of them overlaps a refit or rebuild.
+- (GLTFRayHit * _Nullable)closestHitForRay:(GLTFRay)ray maximumDistance:(float)maximumDistance;
+// Returns whichever hit closer than maximumDistance is found first, for occlusion and line-of-sight tests
+- (GLTFRayHit * _Nullable)anyHitForRay:(GLTFRay)ray maximumDistance:(float)maximumDistance;
+// Casts the rays in parallel and calls the block once per ray, from any thread, with that ray's closest hit
+- (void)closestHitsForRays:(const GLTFRay *)rays
+                     count:(NSInteger)count
+           maximumDistance:(float)maximumDistance
+                usingBlock:(void (^)(NSInteger rayIndex, GLTFRayHit * _Nullable hit))block;
+
+@end
+
+NS_ASSUME_NONNULL_END
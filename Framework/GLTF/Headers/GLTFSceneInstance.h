@@ -0,0 +1,55 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+#import "GLTFUtilities.h"
+
+@import Foundation;
+@import simd;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class GLTFNode, GLTFScene, GLTFSceneBVH, GLTFTransformStore;
+
+// The pose of one copy of a scene: local and world transforms of every node, plus morph target weights.
+// The scene, its nodes and the asset's buffers are only read, so any number of instances can share them,
+// and separate instances can be animated and updated on separate threads.
+@interface GLTFSceneInstance : NSObject
+
+- (instancetype)initWithScene:(GLTFScene *)scene;
+
+@property (nonatomic, readonly, strong) GLTFScene *scene;
+
+// An unbound store over the scene's hierarchy that holds this instance's transforms
+@property (nonatomic, readonly, strong) GLTFTransformStore *transformStore;
+
+// Places the whole instance in the world; applied above the scene's root nodes
+@property (nonatomic, assign) simd_float4x4 rootTransform;
+
+// World bounds of the instance's submeshes, created on first use. Call -refit on it after posing the instance.
+@property (nonatomic, readonly, strong) GLTFSceneBVH *boundingVolumeHierarchy;
+
+// Brings the transform store up to date and returns the node's world transform, including the root transform.
+// Nodes outside the scene's hierarchy answer their own global transform.
+- (simd_float4x4)worldTransformForNode:(GLTFNode *)node;
+
+// Morph target weights of the node at a transform index, initialized from the node or, failing that, its mesh.
+// Returns NULL (and a count of zero) for nodes without morph targets.
+- (NSInteger)morphTargetWeightCountAtIndex:(NSInteger)index;
+- (float * _Nullable)morphTargetWeightsAtIndex:(NSInteger)index;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,62 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+#import "GLTFUtilities.h"
+
+@import Foundation;
+@import simd;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class GLTFNode, GLTFSceneInstance, GLTFSkin;
+
+// jointMatrices[i] = inverse(meshTransform) * jointTransforms[i] * inverseBindMatrices[i] for each joint, where the
+// transforms are world transforms. A NULL inverseBindMatrices stands for identity matrices.
+extern void GLTFComputeJointMatrices(simd_float4x4 meshTransform,
+                                     const simd_float4x4 *jointTransforms,
+                                     const simd_float4x4 * _Nullable inverseBindMatrices,
+                                     NSInteger jointCount,
+                                     simd_float4x4 *jointMatrices);
+
+// The joint matrices of a skinned mesh node as posed by a scene instance, or by the nodes themselves when there
+// is no instance. They are shared by every submesh of the node and only recomputed by -update when the mesh
+// node or one of the joints has moved since the previous update.
+@interface GLTFSkinPalette : NSObject
+
+- (instancetype)initWithSkin:(GLTFSkin *)skin meshNode:(GLTFNode *)meshNode instance:(GLTFSceneInstance * _Nullable)instance;
+
+@property (nonatomic, readonly, strong) GLTFSkin *skin;
+@property (nonatomic, readonly, weak) GLTFNode *meshNode;
+@property (nonatomic, readonly, weak) GLTFSceneInstance *instance;
+
+@property (nonatomic, readonly, assign) NSInteger jointCount;
+
+// Current as of the last call to -update
+@property (nonatomic, readonly) const simd_float4x4 *jointMatrices;
+
+// Incremented each time -update changes the joint matrices
+@property (nonatomic, readonly, assign) NSUInteger version;
+
+// Gathers the world transforms of the mesh node and joints; returns YES if the joint matrices had to be recomputed
+- (BOOL)update;
+
+// Bounds of the posed mesh in the mesh node's space, from its animated bounds, the joint matrices as of the last
+// update and the current morph target weights
+@property (nonatomic, readonly, assign) GLTFBoundingBox bounds;
+
+@end
+
+NS_ASSUME_NONNULL_END
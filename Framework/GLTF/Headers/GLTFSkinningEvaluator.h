@@ -0,0 +1,77 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+@import Foundation;
+@import simd;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class GLTFSubmesh;
+
+// Vertices to skin, with influenceCount (4 or 8) joint indices and weights per vertex
+typedef struct {
+    const uint16_t *joints;
+    const float *weights;
+    int influenceCount;
+    const simd_float3 *positions;
+    const simd_float3 * _Nullable normals;
+    const simd_float4 * _Nullable tangents; // w (handedness) is passed through
+} GLTFSkinningVertices;
+
+// Linear blend skinning of vertices [start, start + count), matching the vertex shader: each vertex is transformed
+// by the weighted sum of its joints' matrices. Influences naming joints at or past jointCount are ignored. Normals
+// and tangents are renormalized. Outputs may be NULL to skip them; they are indexed like the inputs. Vertices are
+// skinned four at a time, one per SIMD lane.
+extern void GLTFSkinVertices(const GLTFSkinningVertices *vertices, NSInteger start, NSInteger count,
+                             const simd_float4x4 *jointMatrices, NSInteger jointCount,
+                             simd_float3 * _Nullable positions,
+                             simd_float3 * _Nullable normals,
+                             simd_float4 * _Nullable tangents);
+
+// Skins a submesh on the CPU, for producing posed geometry without a GPU (collision meshes, thumbnails, exports).
+// The submesh's JOINTS_0/WEIGHTS_0 and, if present, JOINTS_1/WEIGHTS_1 attributes are unpacked once; large meshes
+// are split across cores.
+@interface GLTFSkinningEvaluator : NSObject
+
+- (instancetype)initWithSubmesh:(GLTFSubmesh *)submesh;
+
+@property (nonatomic, readonly, strong) GLTFSubmesh *submesh;
+@property (nonatomic, readonly, assign) NSInteger vertexCount;
+@property (nonatomic, readonly, assign) int influenceCount; // 4 or 8; 0 if the submesh isn't skinned
+@property (nonatomic, readonly, assign) BOOL hasNormals;
+@property (nonatomic, readonly, assign) BOOL hasTangents;
+
+// Skins the submesh's own attributes with the given palette (e.g. GLTFSkinPalette's jointMatrices, which yields
+// positions in the mesh node's space). Pass NULL for outputs you don't need.
+- (void)skinWithJointMatrices:(const simd_float4x4 *)jointMatrices
+                   jointCount:(NSInteger)jointCount
+                    positions:(simd_float3 * _Nullable)positions
+                      normals:(simd_float3 * _Nullable)normals
+                     tangents:(simd_float4 * _Nullable)tangents;
+
+// As above, but starting from other attributes with the submesh's layout, such as the output of a morph evaluator
+- (void)skinPositions:(const simd_float3 *)sourcePositions
+              normals:(const simd_float3 * _Nullable)sourceNormals
+             tangents:(const simd_float4 * _Nullable)sourceTangents
+    withJointMatrices:(const simd_float4x4 *)jointMatrices
+           jointCount:(NSInteger)jointCount
+          toPositions:(simd_float3 * _Nullable)positions
+              normals:(simd_float3 * _Nullable)normals
+             tangents:(simd_float4 * _Nullable)tangents;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,83 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+#import "GLTFUtilities.h"
+
+@import Foundation;
+@import simd;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class GLTFNode, GLTFScene;
+
+// A flattened copy of a scene's node transforms, stored as parallel arrays in parent-before-child order
+// so that every world transform can be brought up to date in one linear pass. Nodes bound to a store
+// forward their transform setters to it and answer `globalTransform` from it, so repeated queries
+// (e.g. once per joint per skinned submesh) no longer walk the parent chain.
+@interface GLTFTransformStore : NSObject
+
+// Flattens every node reachable from the scene's root nodes and binds them to the new store
+- (instancetype)initWithScene:(GLTFScene *)scene;
+
+// An unbound store copies the nodes' transforms when it flattens the hierarchy and is otherwise independent
+// of them: node setters don't reach it and it never answers for `globalTransform`. Several unbound stores
+// can therefore hold different poses of one scene. They aren't told about hierarchy changes, so call
+// -setNeedsRebuild after editing the scene, which also resets their transforms to the nodes' own.
+- (instancetype)initWithScene:(GLTFScene *)scene bindingNodes:(BOOL)bindNodes;
+
+@property (nonatomic, readonly, assign) BOOL bindsNodes;
+
+@property (nonatomic, readonly) NSInteger nodeCount;
+
+// Nodes in parent-before-child order. A node's position in this array is its transform index.
+@property (nonatomic, readonly) NSArray<GLTFNode *> *nodes;
+
+// Transform index of the node, or -1 if it isn't in the store
+- (NSInteger)indexOfNode:(GLTFNode *)node;
+
+// Index of each node's parent, or -1 for root nodes; always less than the index of the node itself
+@property (nonatomic, readonly) const int32_t *parentIndices;
+
+@property (nonatomic, readonly) const simd_float3 *translations;
+@property (nonatomic, readonly) const GLTFQuaternion *rotations;
+@property (nonatomic, readonly) const simd_float3 *scales;
+
+// Both only current as of the last call to -updateWorldTransforms
+@property (nonatomic, readonly) const simd_float4x4 *localTransforms;
+@property (nonatomic, readonly) const simd_float4x4 *worldTransforms;
+
+// Recomputes local transforms whose TRS changed and world transforms of changed nodes and their descendants.
+// Returns at once if nothing changed. Bound nodes call this from `globalTransform`, so it may run on several
+// threads at once; it locks while updating. Setters and -setNeedsRebuild don't lock and must not overlap with
+// any reads: make changes on one thread, then read world transforms from as many as needed.
+- (void)updateWorldTransforms;
+
+// Called when nodes are added, removed or reparented. The hierarchy is flattened again on the next update.
+- (void)setNeedsRebuild;
+
+- (void)setTranslation:(simd_float3)translation atIndex:(NSInteger)index;
+- (void)setRotation:(GLTFQuaternion)rotation atIndex:(NSInteger)index;
+- (void)setScale:(simd_float3)scale atIndex:(NSInteger)index;
+- (void)setLocalTransform:(simd_float4x4)localTransform atIndex:(NSInteger)index;
+
+// Batched forms of the setters above, for writing many channels of a pose at once
+- (void)setTranslations:(const simd_float3 *)translations atIndices:(const int32_t *)indices count:(NSInteger)count;
+- (void)setRotations:(const GLTFQuaternion *)rotations atIndices:(const int32_t *)indices count:(NSInteger)count;
+- (void)setScales:(const simd_float3 *)scales atIndices:(const int32_t *)indices count:(NSInteger)count;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,68 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFUtilities.h"
+
+@import Foundation;
+@import simd;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class GLTFNode, GLTFSubmesh;
+
+typedef struct {
+    NSInteger triangleIndex; // In primitive order, so for strips and fans the n-th triangle they assemble
+    simd_uint3 vertexIndices;
+    simd_float3 barycentricCoordinates; // Weights of the three vertices at the hit point
+    float distance;
+} GLTFTriangleHit;
+
+// A bounding volume hierarchy over the triangles of a submesh, in the submesh's own space. Leaves hold four
+// triangles each, laid out so that a ray is tested against all four at once. Positions are read once from the
+// POSITION accessor, so skinned and morphed meshes are hit in their bind pose.
+@interface GLTFTriangleBVH : NSObject
+
+// Returns nil for submeshes without triangles or without three-component positions
+- (instancetype _Nullable)initWithSubmesh:(GLTFSubmesh *)submesh;
+
+@property (nonatomic, readonly) NSInteger triangleCount;
+@property (nonatomic, readonly) GLTFBoundingBox bounds;
+
+// Looks for the closest triangle the ray hits from either side at a distance in [0, maximumDistance], or with
+// anyHit, for whichever such triangle is found first. Safe to call from several threads at once.
+- (BOOL)intersectRay:(GLTFRay)ray maximumDistance:(float)maximumDistance anyHit:(BOOL)anyHit hit:(GLTFTriangleHit * _Nullable)hit;
+
+@end
+
+// A triangle of a scene hit by a ray
+@interface GLTFRayHit : NSObject
+
+- (instancetype)initWithNode:(GLTFNode *)node submesh:(GLTFSubmesh *)submesh ray:(GLTFRay)ray triangleHit:(GLTFTriangleHit)triangleHit;
+
+@property (nonatomic, readonly, strong) GLTFNode *node;
+@property (nonatomic, readonly, strong) GLTFSubmesh *submesh;
+@property (nonatomic, readonly, assign) NSInteger triangleIndex;
+@property (nonatomic, readonly, assign) simd_uint3 vertexIndices;
+@property (nonatomic, readonly, assign) simd_float3 barycentricCoordinates;
+// Along the ray that was cast, in multiples of its direction
+@property (nonatomic, readonly, assign) float distance;
+// Where the ray that was cast meets the triangle
+@property (nonatomic, readonly, assign) simd_float3 position;
+
+@end
+
+NS_ASSUME_NONNULL_END
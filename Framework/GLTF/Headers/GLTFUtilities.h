@@ -45,6 +45,33 @@ typedef struct {
     float radius;
 } GLTFBoundingSphere;
 
+// Planes are stored as (normal, distance) with normals pointing into the frustum,
+// in the order left, right, bottom, top, near, far.
+typedef struct {
+    simd_float4 planes[6];
+} GLTFFrustum;
+
+typedef NS_ENUM(NSInteger, GLTFFrustumContainment) {
+    GLTFFrustumContainmentOutside,
+    GLTFFrustumContainmentIntersecting,
+    GLTFFrustumContainmentInside,
+};
+
+// Bounds tested against a frustum, and how many of the things they bound were found visible or culled
+typedef struct {
+    NSInteger testedBoundsCount;
+    NSInteger visibleCount;
+    NSInteger culledCount;
+    NSInteger occludedCount; // Of those culled, how many were hidden behind occluders
+} GLTFCullingStatistics;
+
+// Points origin + t * direction for t >= 0. Hit distances are values of t, which transforming a ray preserves, so
+// they are in world units only when the world-space direction has unit length.
+typedef struct {
+    simd_float3 origin;
+    simd_float3 direction;
+} GLTFRay;
+
 extern bool GLTFBoundingBoxIsEmpty(GLTFBoundingBox b);
 
 extern GLTFBoundingBox *GLTFBoundingBoxUnion(GLTFBoundingBox *a, GLTFBoundingBox b);
@@ -53,6 +80,24 @@ extern void GLTFBoundingBoxTransform(GLTFBoundingBox *b, simd_float4x4 transform
 
 extern GLTFBoundingSphere GLTFBoundingSphereFromBox(const GLTFBoundingBox b);
 
+extern GLTFBoundingSphere GLTFBoundingSphereTransform(GLTFBoundingSphere s, simd_float4x4 transform);
+
+// Extracts the frustum planes of a view-projection matrix in Metal clip space (0 <= z <= w)
+extern GLTFFrustum GLTFFrustumFromViewProjectionMatrix(simd_float4x4 viewProjection);
+
+extern bool GLTFFrustumIntersectsSphere(const GLTFFrustum *frustum, GLTFBoundingSphere s);
+
+// Tests the box against the planes whose bits (1 << plane index) are set in planeMask, and clears the bits of the
+// planes it lies entirely inside of, so that boxes nested in it can skip them. Start from GLTFFrustumAllPlanesMask.
+extern GLTFFrustumContainment GLTFFrustumContainsBox(const GLTFFrustum *frustum, GLTFBoundingBox b, uint32_t *planeMask);
+
+extern const uint32_t GLTFFrustumAllPlanesMask;
+
+extern GLTFRay GLTFRayTransform(GLTFRay ray, simd_float4x4 transform);
+
+// Returns whether the ray passes through the box for some t in [0, maximumDistance], and if so where it enters it
+extern bool GLTFRayIntersectsBox(GLTFRay ray, GLTFBoundingBox b, float maximumDistance, float * _Nullable entryDistance);
+
 extern GLTFQuaternion GLTFQuaternionFromEulerAngles(float pitch, float yaw, float roll);
 
 extern simd_float4x4 GLTFMatrixFromUniformScale(float);
@@ -81,6 +126,11 @@ extern size_t GLTFSizeOfComponentTypeWithDimension(GLTFDataType baseType, GLTFDa
 
 extern NSInteger GLTFComponentCountForDimension(GLTFDataDimension dimension);
 
+// Conversions between boxed numbers and packed floats; values must have room for numbers.count floats
+extern void GLTFGetFloatsFromNumbers(NSArray<NSNumber *> *numbers, float *values);
+
+extern NSArray<NSNumber *> *GLTFNumbersFromFloats(const float * _Nullable values, NSInteger count);
+
 extern BOOL GLTFDataTypeComponentsAreFloats(GLTFDataType type);
 
 extern simd_float2 GLTFVectorFloat2FromArray(NSArray *array);
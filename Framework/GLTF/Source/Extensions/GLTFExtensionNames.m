@@ -21,3 +21,4 @@ NSString *const GLTFExtensionKHRLights = @"KHR_lights";
 NSString *const GLTFExtensionKHRMaterialsUnlit = @"KHR_materials_unlit";
 NSString *const GLTFExtensionKHRTextureTransform = @"KHR_texture_transform";
 NSString *const GLTFExtensionEXTPBRAttributes = @"EXT_pbr_attributes";
+NSString *const GLTFExtensionMSFTLOD = @"MSFT_lod";
@@ -15,6 +15,38 @@
 //
 
 #import "GLTFAccessor.h"
+#import "GLTFBufferView.h"
+#import "GLTFBuffer.h"
+#import "GLTFUtilities.h"
+
+static float GLTFNormalizedComponentValue(const void *component, GLTFDataType type, BOOL normalized) {
+    switch (type) {
+        case GLTFDataTypeChar: {
+            int8_t v = *(const int8_t *)component;
+            return normalized ? fmaxf(v / 127.0f, -1.0f) : v;
+        }
+        case GLTFDataTypeUChar: {
+            uint8_t v = *(const uint8_t *)component;
+            return normalized ? v / 255.0f : v;
+        }
+        case GLTFDataTypeShort: {
+            int16_t v = *(const int16_t *)component;
+            return normalized ? fmaxf(v / 32767.0f, -1.0f) : v;
+        }
+        case GLTFDataTypeUShort: {
+            uint16_t v = *(const uint16_t *)component;
+            return normalized ? v / 65535.0f : v;
+        }
+        case GLTFDataTypeInt:
+            return *(const int32_t *)component;
+        case GLTFDataTypeUInt:
+            return *(const uint32_t *)component;
+        case GLTFDataTypeFloat:
+            return *(const float *)component;
+        default:
+            return 0;
+    }
+}
 
 @implementation GLTFAccessor
 
@@ -23,4 +55,88 @@
             (int)self.count, (int)self.componentType, (int)self.dimension, (int)self.offset, self.bufferView];
 }
 
+- (const void *)contents {
+    GLTFBufferView *bufferView = self.bufferView;
+    if (bufferView.buffer == nil) {
+        return NULL;
+    }
+    return bufferView.buffer.contents + bufferView.offset + self.offset;
+}
+
+- (NSInteger)elementStride {
+    NSInteger stride = self.bufferView.stride;
+    if (stride > 0) {
+        return stride;
+    }
+    return GLTFSizeOfComponentTypeWithDimension(self.componentType, self.dimension);
+}
+
+- (NSInteger)componentCount {
+    return GLTFComponentCountForDimension(self.dimension);
+}
+
+- (void)getFloatValues:(float *)values {
+    const void *contents = self.contents;
+    NSInteger count = self.count;
+    NSInteger componentCount = self.componentCount;
+    if (contents == NULL) {
+        memset(values, 0, sizeof(float) * count * componentCount);
+        return;
+    }
+
+    NSInteger stride = self.elementStride;
+    GLTFDataType componentType = self.componentType;
+    if (componentType == GLTFDataTypeFloat && stride == sizeof(float) * componentCount) {
+        memcpy(values, contents, sizeof(float) * count * componentCount);
+        return;
+    }
+
+    size_t componentSize = GLTFSizeOfDataType(componentType);
+    BOOL normalized = self.normalized;
+    for (NSInteger i = 0; i < count; ++i) {
+        const uint8_t *element = (const uint8_t *)contents + i * stride;
+        for (NSInteger c = 0; c < componentCount; ++c) {
+            values[i * componentCount + c] = GLTFNormalizedComponentValue(element + c * componentSize, componentType, normalized);
+        }
+    }
+}
+
+- (void)getUnsignedIntValues:(uint32_t *)values {
+    const void *contents = self.contents;
+    NSInteger count = self.count;
+    NSInteger componentCount = self.componentCount;
+    if (contents == NULL) {
+        memset(values, 0, sizeof(uint32_t) * count * componentCount);
+        return;
+    }
+    
+    NSInteger stride = self.elementStride;
+    for (NSInteger i = 0; i < count; ++i) {
+        const uint8_t *element = (const uint8_t *)contents + i * stride;
+        for (NSInteger c = 0; c < componentCount; ++c) {
+            uint32_t value = 0;
+            switch (self.componentType) {
+                case GLTFDataTypeUChar:
+                case GLTFDataTypeChar:
+                    value = ((const uint8_t *)element)[c];
+                    break;
+                case GLTFDataTypeUShort:
+                case GLTFDataTypeShort:
+                    value = ((const uint16_t *)element)[c];
+                    break;
+                case GLTFDataTypeUInt:
+                case GLTFDataTypeInt:
+                    value = ((const uint32_t *)element)[c];
+                    break;
+                case GLTFDataTypeFloat:
+                    value = (uint32_t)((const float *)element)[c];
+                    break;
+                default:
+                    break;
+            }
+            values[i * componentCount + c] = value;
+        }
+    }
+}
+
 @end
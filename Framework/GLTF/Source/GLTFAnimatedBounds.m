@@ -0,0 +1,200 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+#import "GLTFAnimatedBounds.h"
+#import "GLTFAccessor.h"
+#import "GLTFMesh.h"
+#import "GLTFSkin.h"
+#import "GLTFVertexDescriptor.h"
+
+@interface GLTFAnimatedBounds () {
+    // Empty boxes have a minimum greater than their maximum
+    simd_float3 _staticMinimum, _staticMaximum;
+    // Vertices no joint moves: those of submeshes without joints, and those whose influences are all zero or name
+    // joints the skin doesn't have. They stay where they are in the mesh node's space.
+    simd_float3 _unskinnedMinimum, _unskinnedMaximum;
+    simd_float3 *_jointMinimums, *_jointMaximums;
+    simd_float3 *_targetMinimums, *_targetMaximums;
+}
+@end
+
+@implementation GLTFAnimatedBounds
+
+- (instancetype)initWithMesh:(GLTFMesh *)mesh skin:(GLTFSkin *)skin {
+    if ((self = [super init])) {
+        _jointCount = skin.jointNodes.count;
+        for (GLTFSubmesh *submesh in mesh.submeshes) {
+            _targetCount = MAX(_targetCount, (NSInteger)submesh.morphTargets.count);
+        }
+        
+        _staticMinimum = (simd_float3)FLT_MAX;
+        _staticMaximum = (simd_float3)-FLT_MAX;
+        _unskinnedMinimum = (simd_float3)FLT_MAX;
+        _unskinnedMaximum = (simd_float3)-FLT_MAX;
+        _jointMinimums = malloc(sizeof(simd_float3) * MAX(_jointCount, 1));
+        _jointMaximums = malloc(sizeof(simd_float3) * MAX(_jointCount, 1));
+        for (NSInteger j = 0; j < _jointCount; ++j) {
+            _jointMinimums[j] = (simd_float3)FLT_MAX;
+            _jointMaximums[j] = (simd_float3)-FLT_MAX;
+        }
+        // Vertices a target doesn't move have a zero delta, so every delta box contains the origin
+        _targetMinimums = calloc(MAX(_targetCount, 1), sizeof(simd_float3));
+        _targetMaximums = calloc(MAX(_targetCount, 1), sizeof(simd_float3));
+        
+        for (GLTFSubmesh *submesh in mesh.submeshes) {
+            [self addSubmesh:submesh];
+        }
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_jointMinimums);
+    free(_jointMaximums);
+    free(_targetMinimums);
+    free(_targetMaximums);
+}
+
+- (void)addSubmesh:(GLTFSubmesh *)submesh {
+    NSDictionary<NSString *, GLTFAccessor *> *accessors = submesh.accessorsForAttributes;
+    GLTFAccessor *positionAccessor = accessors[GLTFAttributeSemanticPosition];
+    NSInteger vertexCount = positionAccessor.count;
+    if (vertexCount == 0 || positionAccessor.componentCount != 3) {
+        return;
+    }
+    float *positions = malloc(sizeof(float) * 3 * vertexCount);
+    [positionAccessor getFloatValues:positions];
+    
+    for (NSInteger v = 0; v < vertexCount; ++v) {
+        simd_float3 position = { positions[v * 3 + 0], positions[v * 3 + 1], positions[v * 3 + 2] };
+        _staticMinimum = simd_min(_staticMinimum, position);
+        _staticMaximum = simd_max(_staticMaximum, position);
+    }
+    
+    // A skinned vertex is a weighted average of its joints' transforms of it, so it lies within the union of the
+    // boxes of the joints that influence it, each transformed by that joint's matrix
+    BOOL *skinned = calloc(vertexCount, sizeof(BOOL));
+    NSString *jointSemantics[2] = { GLTFAttributeSemanticJoints0, GLTFAttributeSemanticJoints1 };
+    NSString *weightSemantics[2] = { GLTFAttributeSemanticWeights0, GLTFAttributeSemanticWeights1 };
+    for (int s = 0; s < 2 && _jointCount > 0; ++s) {
+        GLTFAccessor *jointAccessor = accessors[jointSemantics[s]];
+        GLTFAccessor *weightAccessor = accessors[weightSemantics[s]];
+        if (jointAccessor.count < vertexCount || weightAccessor.count < vertexCount ||
+            jointAccessor.componentCount != 4 || weightAccessor.componentCount != 4)
+        {
+            break;
+        }
+        uint32_t *joints = malloc(sizeof(uint32_t) * 4 * jointAccessor.count);
+        float *weights = malloc(sizeof(float) * 4 * weightAccessor.count);
+        [jointAccessor getUnsignedIntValues:joints];
+        [weightAccessor getFloatValues:weights];
+        for (NSInteger v = 0; v < vertexCount; ++v) {
+            simd_float3 position = { positions[v * 3 + 0], positions[v * 3 + 1], positions[v * 3 + 2] };
+            for (int i = 0; i < 4; ++i) {
+                uint32_t joint = joints[v * 4 + i];
+                if (weights[v * 4 + i] == 0 || joint >= _jointCount) {
+                    continue;
+                }
+                _jointMinimums[joint] = simd_min(_jointMinimums[joint], position);
+                _jointMaximums[joint] = simd_max(_jointMaximums[joint], position);
+                skinned[v] = YES;
+            }
+        }
+        free(joints);
+        free(weights);
+    }
+    for (NSInteger v = 0; v < vertexCount; ++v) {
+        if (!skinned[v]) {
+            simd_float3 position = { positions[v * 3 + 0], positions[v * 3 + 1], positions[v * 3 + 2] };
+            _unskinnedMinimum = simd_min(_unskinnedMinimum, position);
+            _unskinnedMaximum = simd_max(_unskinnedMaximum, position);
+        }
+    }
+    free(skinned);
+    free(positions);
+    
+    NSArray<GLTFMorphTarget *> *morphTargets = submesh.morphTargets;
+    for (NSInteger t = 0; t < morphTargets.count; ++t) {
+        GLTFAccessor *deltaAccessor = morphTargets[t].accessorsForAttributes[GLTFAttributeSemanticPosition];
+        if (deltaAccessor.count < vertexCount || deltaAccessor.componentCount != 3) {
+            continue;
+        }
+        float *deltas = malloc(sizeof(float) * 3 * deltaAccessor.count);
+        [deltaAccessor getFloatValues:deltas];
+        for (NSInteger v = 0; v < vertexCount; ++v) {
+            simd_float3 delta = { deltas[v * 3 + 0], deltas[v * 3 + 1], deltas[v * 3 + 2] };
+            _targetMinimums[t] = simd_min(_targetMinimums[t], delta);
+            _targetMaximums[t] = simd_max(_targetMaximums[t], delta);
+        }
+        free(deltas);
+    }
+}
+
+- (GLTFBoundingBox)boundsWithJointMatrices:(const simd_float4x4 *)jointMatrices
+                                jointCount:(NSInteger)jointCount
+                        morphTargetWeights:(const float *)weights
+                                     count:(NSInteger)weightCount
+{
+    // How far morphing can move any vertex, per axis
+    simd_float3 morphMinimum = 0, morphMaximum = 0;
+    NSInteger targetCount = (weights != NULL) ? MIN(weightCount, _targetCount) : 0;
+    for (NSInteger t = 0; t < targetCount; ++t) {
+        float weight = weights[t];
+        if (weight > 0) {
+            morphMinimum += weight * _targetMinimums[t];
+            morphMaximum += weight * _targetMaximums[t];
+        } else if (weight < 0) {
+            morphMinimum += weight * _targetMaximums[t];
+            morphMaximum += weight * _targetMinimums[t];
+        }
+    }
+    
+    GLTFBoundingBox bounds = { 0 };
+    if (jointMatrices == NULL || _jointCount == 0) {
+        if (simd_all(_staticMinimum <= _staticMaximum)) {
+            bounds.minPoint = _staticMinimum + morphMinimum;
+            bounds.maxPoint = _staticMaximum + morphMaximum;
+        }
+        return bounds;
+    }
+    
+    simd_float3 minimum = FLT_MAX, maximum = -FLT_MAX;
+    if (simd_all(_unskinnedMinimum <= _unskinnedMaximum)) {
+        minimum = _unskinnedMinimum + morphMinimum;
+        maximum = _unskinnedMaximum + morphMaximum;
+    }
+    NSInteger boundedJointCount = MIN(jointCount, _jointCount);
+    for (NSInteger j = 0; j < boundedJointCount; ++j) {
+        if (!simd_all(_jointMinimums[j] <= _jointMaximums[j])) {
+            continue;
+        }
+        GLTFBoundingBox jointBounds = { _jointMinimums[j] + morphMinimum, _jointMaximums[j] + morphMaximum };
+        GLTFBoundingBoxTransform(&jointBounds, jointMatrices[j]);
+        minimum = simd_min(minimum, jointBounds.minPoint);
+        maximum = simd_max(maximum, jointBounds.maxPoint);
+    }
+    if (simd_all(minimum <= maximum)) {
+        bounds.minPoint = minimum;
+        bounds.maxPoint = maximum;
+    } else if (simd_all(_staticMinimum <= _staticMaximum)) {
+        // Only joints past the end of the palette hold vertices; the bind pose is better than hiding the mesh
+        bounds.minPoint = _staticMinimum + morphMinimum;
+        bounds.maxPoint = _staticMaximum + morphMaximum;
+    }
+    return bounds;
+}
+
+@end
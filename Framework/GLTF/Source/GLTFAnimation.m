@@ -19,6 +19,10 @@
 #import "GLTFBufferView.h"
 #import "GLTFBuffer.h"
 #import "GLTFNode.h"
+#import "GLTFSceneInstance.h"
+#import "GLTFTransformStore.h"
+
+#include <stdatomic.h>
 
 @implementation GLTFAnimationSampler
 
@@ -46,6 +50,21 @@
     return [NSString stringWithFormat:@"%@ target: %@; path: %@; sampler: %@", super.description, self.targetNode, self.targetPath, self.sampler];
 }
 
+- (void)setTargetPath:(NSString *)targetPath {
+    _targetPath = [targetPath copy];
+    if ([targetPath isEqualToString:@"translation"]) {
+        _path = GLTFAnimationPathTranslation;
+    } else if ([targetPath isEqualToString:@"rotation"]) {
+        _path = GLTFAnimationPathRotation;
+    } else if ([targetPath isEqualToString:@"scale"]) {
+        _path = GLTFAnimationPathScale;
+    } else if ([targetPath isEqualToString:@"weights"]) {
+        _path = GLTFAnimationPathWeights;
+    } else {
+        _path = GLTFAnimationPathUnknown;
+    }
+}
+
 - (NSTimeInterval)startTime {
     GLTFAnimationSampler *sampler = self.sampler;
     const float *timeValues = sampler.inputValues;
@@ -67,106 +86,1049 @@
 
 @end
 
-@implementation GLTFAnimation
+typedef NS_ENUM(uint8_t, GLTFAnimationQuantization) {
+    GLTFAnimationQuantizationNone,
+    GLTFAnimationQuantizationSmallestThree, // rotations in 48 bits: the index of the largest component and 15 bits for each of the others
+    GLTFAnimationQuantizationRange,         // vectors as 16-bit fractions of the channel's bounding range
+};
 
-- (NSString *)description {
-    return [NSString stringWithFormat:@"%@ channels: %@", super.description, self.channels];
+// A channel resolved down to raw keyframe pointers, so sampling needs no message sends or string comparisons
+typedef struct {
+    __unsafe_unretained GLTFAnimationChannel *channel; // retained by the animation's channel array
+    const float *timeValues;
+    const float *outputValues;
+    int keyFrameCount;
+    int valueCount; // floats per value
+    int keyFrameStride; // floats per keyframe; three values (in-tangent, value, out-tangent) for cubic splines
+    int valueOffset; // floats from the start of a keyframe to its value
+    GLTFAnimationPath path;
+    GLTFInterpolationMode interpolationMode;
+    int cursor; // interval found by the previous evaluation when posing nodes directly
+    // Set once the track has been resampled at a uniform rate, which replaces the keyframes above
+    float bakedStartTime;
+    float bakedFrameRate;
+    // Set once the track has been compressed; keyFrameCount then counts the retained keyframes
+    GLTFAnimationQuantization quantization;
+    uint16_t *quantizedValues; // three per keyframe
+    simd_float3 quantizationMinimum;
+    simd_float3 quantizationStep;
+    // Buffers owned by the track rather than by the asset: baked or compressed times and values
+    float *ownedTimeValues;
+    float *ownedValues;
+} GLTFAnimationTrack;
+
+// Where a track lands in one scene instance, and that instance's own cursor into the track
+typedef struct {
+    int32_t nodeIndex;
+    int32_t cursor;
+} GLTFAnimationTrackBinding;
+
+typedef struct {
+    NSUInteger compileCount; // the compilation the bindings were made against
+    GLTFAnimationTrackBinding bindings[];
+} GLTFAnimationInstanceState;
+
+// Tracks of one path are evaluated this many at a time when posing instances
+#define GLTFAnimationBatchWidth 8
+
+@interface GLTFSceneInstance (GLTFAnimationState)
+- (NSMutableData *)_animationStateForKey:(id)key;
+@end
+
+// Finds the keyframe interval containing time. Forward playback almost always lands in the same interval as
+// the previous evaluation or the one after it; anything else (seeks, looping, reverse playback) binary searches.
+static void GLTFAnimationTrackLocate(const GLTFAnimationTrack *track, float time, int *cursor,
+                                     int *previousKeyFrame, int *nextKeyFrame, float *frameProgress)
+{
+    int lastKeyFrame = track->keyFrameCount - 1;
+    
+    // Baked frames are evenly spaced, so there is nothing to search for
+    if (track->bakedFrameRate > 0) {
+        float frame = simd_clamp((time - track->bakedStartTime) * track->bakedFrameRate, 0.0f, (float)lastKeyFrame);
+        int keyFrame = (int)frame;
+        *previousKeyFrame = keyFrame;
+        *nextKeyFrame = MIN(keyFrame + 1, lastKeyFrame);
+        *frameProgress = (keyFrame < lastKeyFrame) ? frame - keyFrame : 0;
+        return;
+    }
+    
+    const float *timeValues = track->timeValues;
+    if (lastKeyFrame == 0 || !(time > timeValues[0])) {
+        *previousKeyFrame = *nextKeyFrame = 0;
+        *frameProgress = 0;
+        return;
+    }
+    if (time >= timeValues[lastKeyFrame]) {
+        *previousKeyFrame = *nextKeyFrame = lastKeyFrame;
+        *frameProgress = 0;
+        return;
+    }
+    
+    // From here on timeValues[0] < time < timeValues[lastKeyFrame]
+    int keyFrame = *cursor;
+    BOOL found = NO;
+    if (keyFrame >= 0 && keyFrame < lastKeyFrame && timeValues[keyFrame] <= time) {
+        if (time < timeValues[keyFrame + 1]) {
+            found = YES;
+        } else if (time < timeValues[keyFrame + 2]) {
+            // keyFrame + 1 < lastKeyFrame here, since time lies before the last keyframe
+            ++keyFrame;
+            found = YES;
+        }
+    }
+    if (!found) {
+        int low = 0, high = lastKeyFrame;
+        while (high - low > 1) {
+            int middle = (low + high) / 2;
+            if (timeValues[middle] <= time) {
+                low = middle;
+            } else {
+                high = middle;
+            }
+        }
+        keyFrame = low;
+    }
+    *cursor = keyFrame;
+    
+    *previousKeyFrame = keyFrame;
+    *nextKeyFrame = keyFrame + 1;
+    *frameProgress = (time - timeValues[keyFrame]) / (timeValues[keyFrame + 1] - timeValues[keyFrame]);
 }
 
-- (void)runAtTime:(NSTimeInterval)time {
-    for (GLTFAnimationChannel *channel in self.channels) {
-        GLTFNode *target = channel.targetNode;
-        NSString *path = channel.targetPath;
-        GLTFAnimationSampler *sampler = channel.sampler;
+static simd_float3 GLTFAnimationLoadFloat3(const float *values) {
+    return (simd_float3){ values[0], values[1], values[2] };
+}
+
+static GLTFQuaternion GLTFAnimationLoadQuaternion(const float *values) {
+    return simd_quaternion(values[0], values[1], values[2], values[3]);
+}
+
+static const float *GLTFAnimationTrackValues(const GLTFAnimationTrack *track, int keyFrame) {
+    return track->outputValues + keyFrame * track->keyFrameStride + track->valueOffset;
+}
+
+static simd_float4 GLTFAnimationLoadFloat4(const float *values) {
+    simd_float4 value;
+    memcpy(&value, values, sizeof(value));
+    return value;
+}
+
+// Largest magnitude a quaternion component can have without being the largest of the four
+#define GLTFAnimationSmallestThreeRange 0.70710678f
+
+static void GLTFAnimationEncodeSmallestThree(simd_float4 rotation, uint16_t *encoded) {
+    rotation = simd_normalize(rotation);
+    simd_float4 magnitudes = simd_abs(rotation);
+    int largest = 0;
+    for (int i = 1; i < 4; ++i) {
+        if (magnitudes[i] > magnitudes[largest]) {
+            largest = i;
+        }
+    }
+    // q and -q are the same rotation, so the largest component can always be made positive and left implicit
+    if (rotation[largest] < 0) {
+        rotation = -rotation;
+    }
+    uint64_t bits = (uint64_t)largest << 45;
+    int shift = 30;
+    for (int i = 0; i < 4; ++i) {
+        if (i == largest) {
+            continue;
+        }
+        float fraction = simd_clamp(rotation[i] / (2 * GLTFAnimationSmallestThreeRange) + 0.5f, 0.0f, 1.0f);
+        bits |= (uint64_t)lrintf(fraction * 32767.0f) << shift;
+        shift -= 15;
+    }
+    encoded[0] = (uint16_t)bits;
+    encoded[1] = (uint16_t)(bits >> 16);
+    encoded[2] = (uint16_t)(bits >> 32);
+}
+
+static void GLTFAnimationDecodeSmallestThree(const uint16_t *encoded, float *values) {
+    uint64_t bits = (uint64_t)encoded[0] | ((uint64_t)encoded[1] << 16) | ((uint64_t)encoded[2] << 32);
+    int largest = (int)(bits >> 45) & 3;
+    float lengthSquared = 0;
+    int shift = 30;
+    for (int i = 0; i < 4; ++i) {
+        if (i == largest) {
+            continue;
+        }
+        float fraction = ((bits >> shift) & 0x7FFF) / 32767.0f;
+        values[i] = (fraction - 0.5f) * (2 * GLTFAnimationSmallestThreeRange);
+        lengthSquared += values[i] * values[i];
+        shift -= 15;
+    }
+    values[largest] = sqrtf(MAX(1 - lengthSquared, 0.0f));
+}
+
+static void GLTFAnimationTrackDecodeValues(const GLTFAnimationTrack *track, int keyFrame, float *values) {
+    const uint16_t *encoded = track->quantizedValues + keyFrame * 3;
+    if (track->quantization == GLTFAnimationQuantizationSmallestThree) {
+        GLTFAnimationDecodeSmallestThree(encoded, values);
+    } else {
+        for (int i = 0; i < 3; ++i) {
+            values[i] = track->quantizationMinimum[i] + encoded[i] * track->quantizationStep[i];
+        }
+    }
+}
+
+// Tracks that the batched paths can interpolate straight out of their keyframe arrays
+static bool GLTFAnimationTrackIsDirectLinear(const GLTFAnimationTrack *track) {
+    return track->interpolationMode == GLTFInterpolationModeLinear && track->quantization == GLTFAnimationQuantizationNone;
+}
+
+// Cubic Hermite interpolation between p0 and p1 with tangents m0 and m1 (already scaled by the keyframe
+// interval), four components at a time
+static void GLTFAnimationInterpolateHermite(const float *p0, const float *m0, const float *p1, const float *m1,
+                                            float t, int count, float *results)
+{
+    float t2 = t * t, t3 = t2 * t;
+    float h00 = 2 * t3 - 3 * t2 + 1;
+    float h10 = t3 - 2 * t2 + t;
+    float h01 = -2 * t3 + 3 * t2;
+    float h11 = t3 - t2;
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        simd_float4 result = h00 * GLTFAnimationLoadFloat4(p0 + i) + h10 * GLTFAnimationLoadFloat4(m0 + i) +
+                             h01 * GLTFAnimationLoadFloat4(p1 + i) + h11 * GLTFAnimationLoadFloat4(m1 + i);
+        memcpy(results + i, &result, sizeof(result));
+    }
+    for (; i < count; ++i) {
+        results[i] = h00 * p0[i] + h10 * m0[i] + h01 * p1[i] + h11 * m1[i];
+    }
+}
+
+// Interpolates count pairs of quaternions, transposed four at a time so that each SIMD lane holds one pair.
+// Instead of slerp's inverse cosine and sines, the interpolation parameter is warped by a small polynomial in
+// the cosine of the angle between the pair before a normalized lerp (the "onlerp" approximation), which
+// follows slerp closely enough that the difference is invisible in animation.
+static void GLTFAnimationInterpolateQuaternions(const simd_float4 *from, const simd_float4 *to, const float *progress,
+                                                int count, GLTFQuaternion *results)
+{
+    for (int base = 0; base < count; base += 4) {
+        int laneCount = MIN(4, count - base);
+        // Unused lanes interpolate identity to identity, which keeps them finite
+        simd_float4 ax = 0, ay = 0, az = 0, aw = 1;
+        simd_float4 bx = 0, by = 0, bz = 0, bw = 1;
+        simd_float4 t = 0;
+        for (int lane = 0; lane < laneCount; ++lane) {
+            simd_float4 a = from[base + lane], b = to[base + lane];
+            ax[lane] = a.x; ay[lane] = a.y; az[lane] = a.z; aw[lane] = a.w;
+            bx[lane] = b.x; by[lane] = b.y; bz[lane] = b.z; bw[lane] = b.w;
+            t[lane] = progress[base + lane];
+        }
         
-        int keyFrameCount = sampler.keyFrameCount;
+        simd_float4 cosine = ax * bx + ay * by + az * bz + aw * bw;
+        // Take the shorter of the two arcs between the pair
+        simd_float4 sign = simd_select((simd_float4)1, (simd_float4)-1, cosine < 0);
+        simd_float4 d = simd_abs(cosine);
+        simd_float4 A = 1.0904f + d * (-3.2452f + d * (3.55645f - d * 1.43519f));
+        simd_float4 B = 0.848013f + d * (-1.06021f + d * 0.215638f);
+        simd_float4 k = A * (t - 0.5f) * (t - 0.5f) + B;
+        simd_float4 warpedT = t + t * (t - 0.5f) * (t - 1) * k;
         
-        const float *timeValues = sampler.inputValues;
+        simd_float4 wa = 1 - warpedT, wb = warpedT * sign;
+        simd_float4 rx = wa * ax + wb * bx;
+        simd_float4 ry = wa * ay + wb * by;
+        simd_float4 rz = wa * az + wb * bz;
+        simd_float4 rw = wa * aw + wb * bw;
+        simd_float4 inverseLength = simd_rsqrt(rx * rx + ry * ry + rz * rz + rw * rw);
+        rx *= inverseLength;
+        ry *= inverseLength;
+        rz *= inverseLength;
+        rw *= inverseLength;
         
-        float minTime = timeValues[0];
-        float maxTime = timeValues[keyFrameCount - 1];
+        for (int lane = 0; lane < laneCount; ++lane) {
+            results[base + lane] = simd_quaternion(rx[lane], ry[lane], rz[lane], rw[lane]);
+        }
+    }
+}
+
+static void GLTFAnimationInterpolateValues(GLTFAnimationPath path, const float *previousValues, const float *nextValues,
+                                           float progress, int valueCount, float *values)
+{
+    switch (path) {
+        case GLTFAnimationPathRotation: {
+            GLTFQuaternion previousRotation = GLTFAnimationLoadQuaternion(previousValues);
+            GLTFQuaternion nextRotation = GLTFAnimationLoadQuaternion(nextValues);
+            simd_float4 rotation = simd_slerp(previousRotation, nextRotation, progress).vector;
+            memcpy(values, &rotation, sizeof(float) * 4);
+            break;
+        }
+        case GLTFAnimationPathTranslation:
+        case GLTFAnimationPathScale: {
+            simd_float3 previousValue = GLTFAnimationLoadFloat3(previousValues);
+            simd_float3 nextValue = GLTFAnimationLoadFloat3(nextValues);
+            simd_float3 value = simd_mix(previousValue, nextValue, (simd_float3)progress);
+            values[0] = value.x;
+            values[1] = value.y;
+            values[2] = value.z;
+            break;
+        }
+        case GLTFAnimationPathWeights:
+            for (int i = 0; i < valueCount; ++i) {
+                values[i] = ((1 - progress) * previousValues[i]) + (progress * nextValues[i]);
+            }
+            break;
+        case GLTFAnimationPathUnknown:
+            break;
+    }
+}
+
+// Writes the track's value at time to values: a quaternion (as x, y, z, w) for rotations, a vector for
+// translations and scales, and valueCount weights for morph targets
+static void GLTFAnimationTrackSample(const GLTFAnimationTrack *track, float time, int *cursor, float *values) {
+    int previousKeyFrame, nextKeyFrame;
+    float frameProgress;
+    GLTFAnimationTrackLocate(track, time, cursor, &previousKeyFrame, &nextKeyFrame, &frameProgress);
+    
+    int valueCount = track->valueCount;
+    const float *previousValues, *nextValues;
+    float decodedValues[8];
+    if (track->quantization != GLTFAnimationQuantizationNone) {
+        GLTFAnimationTrackDecodeValues(track, previousKeyFrame, decodedValues);
+        GLTFAnimationTrackDecodeValues(track, nextKeyFrame, decodedValues + 4);
+        previousValues = decodedValues;
+        nextValues = decodedValues + 4;
+    } else {
+        previousValues = GLTFAnimationTrackValues(track, previousKeyFrame);
+        nextValues = GLTFAnimationTrackValues(track, nextKeyFrame);
+    }
+    
+    switch (track->interpolationMode) {
+        case GLTFInterpolationModeStep:
+            memcpy(values, previousValues, sizeof(float) * valueCount);
+            return;
+        case GLTFInterpolationModeCubic: {
+            float timeDelta = track->timeValues[nextKeyFrame] - track->timeValues[previousKeyFrame];
+            const float *outTangents = previousValues + valueCount;
+            const float *inTangents = nextValues - valueCount;
+            float scaledTangents[2 * valueCount];
+            for (int i = 0; i < valueCount; ++i) {
+                scaledTangents[i] = timeDelta * outTangents[i];
+                scaledTangents[valueCount + i] = timeDelta * inTangents[i];
+            }
+            GLTFAnimationInterpolateHermite(previousValues, scaledTangents, nextValues, scaledTangents + valueCount,
+                                            frameProgress, valueCount, values);
+            if (track->path == GLTFAnimationPathRotation) {
+                simd_float4 rotation = simd_normalize(GLTFAnimationLoadFloat4(values));
+                memcpy(values, &rotation, sizeof(rotation));
+            }
+            return;
+        }
+        case GLTFInterpolationModeLinear:
+            break;
+    }
+    
+    GLTFAnimationInterpolateValues(track->path, previousValues, nextValues, frameProgress, valueCount, values);
+}
+
+// Resamples the track at a uniform rate. Step tracks keep stepping; everything else becomes linear, which
+// between closely spaced samples of a cubic or slerped curve is indistinguishable from the original.
+static size_t GLTFAnimationTrackBake(GLTFAnimationTrack *track, float frameRate) {
+    float startTime = track->timeValues[0];
+    float endTime = track->timeValues[track->keyFrameCount - 1];
+    float duration = endTime - startTime;
+    int frameCount = (int)ceilf(duration * frameRate) + 1;
+    // Stretch the rate slightly so that the last frame lands exactly on the last keyframe
+    if (frameCount > 1 && duration > 0) {
+        frameRate = (frameCount - 1) / duration;
+    }
+    int valueCount = track->valueCount;
+    float *bakedValues = malloc(sizeof(float) * valueCount * frameCount);
+    
+    int cursor = 0;
+    for (int frame = 0; frame < frameCount; ++frame) {
+        float time = MIN(startTime + frame / frameRate, endTime);
+        GLTFAnimationTrackSample(track, time, &cursor, bakedValues + frame * valueCount);
+    }
+    
+    track->ownedValues = bakedValues;
+    track->bakedStartTime = startTime;
+    track->bakedFrameRate = frameRate;
+    track->outputValues = bakedValues;
+    track->keyFrameCount = frameCount;
+    track->keyFrameStride = valueCount;
+    track->valueOffset = 0;
+    if (track->interpolationMode != GLTFInterpolationModeStep) {
+        track->interpolationMode = GLTFInterpolationModeLinear;
+    }
+    return sizeof(float) * valueCount * frameCount;
+}
+
+static float GLTFAnimationTrackKeyFrameTime(const GLTFAnimationTrack *track, int keyFrame) {
+    if (track->bakedFrameRate > 0) {
+        return track->bakedStartTime + keyFrame / track->bakedFrameRate;
+    }
+    return track->timeValues[keyFrame];
+}
+
+// How far apart two values of a path are: the distance between vectors, the largest difference between weights,
+// and for rotations the angle between them, which bounds how far they move a point one unit from the pivot
+static float GLTFAnimationValueError(GLTFAnimationPath path, const float *values, const float *otherValues, int valueCount) {
+    switch (path) {
+        case GLTFAnimationPathRotation: {
+            float cosHalfAngle = fabsf(simd_dot(simd_normalize(GLTFAnimationLoadFloat4(values)),
+                                                simd_normalize(GLTFAnimationLoadFloat4(otherValues))));
+            return 2 * acosf(MIN(cosHalfAngle, 1.0f));
+        }
+        case GLTFAnimationPathTranslation:
+        case GLTFAnimationPathScale:
+            return simd_distance(GLTFAnimationLoadFloat3(values), GLTFAnimationLoadFloat3(otherValues));
+        case GLTFAnimationPathWeights: {
+            float error = 0;
+            for (int i = 0; i < valueCount; ++i) {
+                error = MAX(error, fabsf(values[i] - otherValues[i]));
+            }
+            return error;
+        }
+        case GLTFAnimationPathUnknown:
+            break;
+    }
+    return 0;
+}
+
+// Marks the keyframes to keep so that interpolating across the dropped ones stays within tolerance of them.
+// Greedy: each run of dropped keyframes is extended until one of them would fall out of tolerance.
+static int GLTFAnimationTrackSelectKeyFrames(const GLTFAnimationTrack *track, const float *times, float tolerance, bool *keep) {
+    int keyFrameCount = track->keyFrameCount;
+    int valueCount = track->valueCount;
+    BOOL isStep = (track->interpolationMode == GLTFInterpolationModeStep);
+    float interpolatedValues[valueCount];
+    
+    memset(keep, 0, sizeof(bool) * keyFrameCount);
+    keep[0] = keep[keyFrameCount - 1] = true;
+    int keptCount = (keyFrameCount > 1) ? 2 : 1;
+    int anchor = 0;
+    for (int candidate = 2; candidate < keyFrameCount; ++candidate) {
+        const float *anchorValues = GLTFAnimationTrackValues(track, anchor);
+        const float *candidateValues = GLTFAnimationTrackValues(track, candidate);
+        float timeSpan = times[candidate] - times[anchor];
+        bool fits = true;
+        for (int k = anchor + 1; fits && k < candidate; ++k) {
+            float progress = (!isStep && timeSpan > 0) ? (times[k] - times[anchor]) / timeSpan : 0;
+            GLTFAnimationInterpolateValues(track->path, anchorValues, candidateValues, progress, valueCount, interpolatedValues);
+            fits = GLTFAnimationValueError(track->path, interpolatedValues, GLTFAnimationTrackValues(track, k), valueCount) <= tolerance;
+        }
+        if (!fits) {
+            anchor = candidate - 1;
+            keep[anchor] = true;
+            ++keptCount;
+        }
+    }
+    return keptCount;
+}
+
+typedef struct {
+    size_t compressedByteCount;
+    NSUInteger retainedKeyFrameCount;
+    float maximumErrors[GLTFAnimationPathWeights + 1]; // by path
+} GLTFAnimationCompressionTotals;
+
+// Drops keyframes within tolerance and quantizes what is left, then measures the result against the original
+// keyframes. Only linear and step tracks are compressed; cubic splines must be baked first.
+static void GLTFAnimationTrackCompress(GLTFAnimationTrack *track, float tolerance, GLTFAnimationCompressionTotals *totals) {
+    int keyFrameCount = track->keyFrameCount;
+    int valueCount = track->valueCount;
+    
+    float *times = malloc(sizeof(float) * keyFrameCount);
+    for (int k = 0; k < keyFrameCount; ++k) {
+        times[k] = GLTFAnimationTrackKeyFrameTime(track, k);
+    }
+    bool *keep = malloc(sizeof(bool) * keyFrameCount);
+    int keptCount = GLTFAnimationTrackSelectKeyFrames(track, times, tolerance, keep);
+    
+    GLTFAnimationTrack compressed = *track;
+    compressed.keyFrameCount = keptCount;
+    compressed.bakedFrameRate = 0;
+    compressed.cursor = 0;
+    compressed.ownedTimeValues = malloc(sizeof(float) * keptCount);
+    compressed.timeValues = compressed.ownedTimeValues;
+    for (int k = 0, kept = 0; k < keyFrameCount; ++k) {
+        if (keep[k]) {
+            compressed.ownedTimeValues[kept++] = times[k];
+        }
+    }
+    
+    if (track->path == GLTFAnimationPathRotation && valueCount == 4) {
+        compressed.quantization = GLTFAnimationQuantizationSmallestThree;
+    } else if ((track->path == GLTFAnimationPathTranslation || track->path == GLTFAnimationPathScale) && valueCount == 3) {
+        compressed.quantization = GLTFAnimationQuantizationRange;
+    } else {
+        compressed.quantization = GLTFAnimationQuantizationNone;
+    }
+    
+    size_t valueByteCount;
+    if (compressed.quantization == GLTFAnimationQuantizationNone) {
+        compressed.ownedValues = malloc(sizeof(float) * valueCount * keptCount);
+        for (int k = 0, kept = 0; k < keyFrameCount; ++k) {
+            if (keep[k]) {
+                memcpy(compressed.ownedValues + (kept++) * valueCount, GLTFAnimationTrackValues(track, k), sizeof(float) * valueCount);
+            }
+        }
+        compressed.outputValues = compressed.ownedValues;
+        compressed.keyFrameStride = valueCount;
+        compressed.valueOffset = 0;
+        valueByteCount = sizeof(float) * valueCount * keptCount;
+    } else {
+        compressed.ownedValues = NULL;
+        compressed.outputValues = NULL;
+        compressed.quantizedValues = malloc(sizeof(uint16_t) * 3 * keptCount);
+        if (compressed.quantization == GLTFAnimationQuantizationRange) {
+            simd_float3 minimum = (simd_float3)FLT_MAX, maximum = (simd_float3)-FLT_MAX;
+            for (int k = 0; k < keyFrameCount; ++k) {
+                if (keep[k]) {
+                    simd_float3 value = GLTFAnimationLoadFloat3(GLTFAnimationTrackValues(track, k));
+                    minimum = simd_min(minimum, value);
+                    maximum = simd_max(maximum, value);
+                }
+            }
+            compressed.quantizationMinimum = minimum;
+            compressed.quantizationStep = (maximum - minimum) / 65535.0f;
+        }
+        for (int k = 0, kept = 0; k < keyFrameCount; ++k) {
+            if (!keep[k]) {
+                continue;
+            }
+            const float *values = GLTFAnimationTrackValues(track, k);
+            uint16_t *encoded = compressed.quantizedValues + (kept++) * 3;
+            if (compressed.quantization == GLTFAnimationQuantizationSmallestThree) {
+                GLTFAnimationEncodeSmallestThree(GLTFAnimationLoadFloat4(values), encoded);
+            } else {
+                simd_float3 step = compressed.quantizationStep;
+                for (int i = 0; i < 3; ++i) {
+                    float fraction = (step[i] > 0) ? (values[i] - compressed.quantizationMinimum[i]) / step[i] : 0;
+                    encoded[i] = (uint16_t)lrintf(simd_clamp(fraction, 0.0f, 65535.0f));
+                }
+            }
+        }
+        valueByteCount = sizeof(uint16_t) * 3 * keptCount;
+        if (compressed.quantization == GLTFAnimationQuantizationRange) {
+            valueByteCount += sizeof(simd_float3) * 2;
+        }
+    }
+    
+    // Worst case over the original keyframes, including the quantization error of the retained ones
+    int sampledValueCapacity = MAX(valueCount, 4);
+    float sampledValues[sampledValueCapacity];
+    int cursor = 0;
+    for (int k = 0; k < keyFrameCount; ++k) {
+        GLTFAnimationTrackSample(&compressed, times[k], &cursor, sampledValues);
+        float error = GLTFAnimationValueError(track->path, sampledValues, GLTFAnimationTrackValues(track, k), valueCount);
+        totals->maximumErrors[track->path] = MAX(totals->maximumErrors[track->path], error);
+    }
+    totals->compressedByteCount += sizeof(float) * keptCount + valueByteCount;
+    totals->retainedKeyFrameCount += keptCount;
+    
+    free(track->ownedTimeValues);
+    free(track->ownedValues);
+    free(keep);
+    free(times);
+    *track = compressed;
+}
+
+static void GLTFAnimationFreeTracks(GLTFAnimationTrack *tracks, NSInteger trackCount) {
+    for (NSInteger t = 0; t < trackCount; ++t) {
+        free(tracks[t].ownedTimeValues);
+        free(tracks[t].ownedValues);
+        free(tracks[t].quantizedValues);
+    }
+    free(tracks);
+}
 
-        if (time < minTime || time > maxTime) {
+@interface GLTFAnimationCompressionReport ()
+@property (nonatomic, assign) NSUInteger sourceByteCount;
+@property (nonatomic, assign) NSUInteger compressedByteCount;
+@property (nonatomic, assign) NSUInteger sourceKeyFrameCount;
+@property (nonatomic, assign) NSUInteger retainedKeyFrameCount;
+@property (nonatomic, assign) float maximumTranslationError;
+@property (nonatomic, assign) float maximumRotationError;
+@property (nonatomic, assign) float maximumScaleError;
+@property (nonatomic, assign) float maximumWeightError;
+@end
+
+@implementation GLTFAnimationCompressionReport
+
++ (instancetype)reportCombiningReports:(NSArray<GLTFAnimationCompressionReport *> *)reports {
+    GLTFAnimationCompressionReport *combined = [GLTFAnimationCompressionReport new];
+    for (GLTFAnimationCompressionReport *report in reports) {
+        combined.sourceByteCount += report.sourceByteCount;
+        combined.compressedByteCount += report.compressedByteCount;
+        combined.sourceKeyFrameCount += report.sourceKeyFrameCount;
+        combined.retainedKeyFrameCount += report.retainedKeyFrameCount;
+        combined.maximumTranslationError = MAX(combined.maximumTranslationError, report.maximumTranslationError);
+        combined.maximumRotationError = MAX(combined.maximumRotationError, report.maximumRotationError);
+        combined.maximumScaleError = MAX(combined.maximumScaleError, report.maximumScaleError);
+        combined.maximumWeightError = MAX(combined.maximumWeightError, report.maximumWeightError);
+    }
+    return combined;
+}
+
+- (double)compressionRatio {
+    return (_compressedByteCount > 0) ? (double)_sourceByteCount / _compressedByteCount : 1;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"%@ bytes: %lu -> %lu (%.2f:1); keyframes: %lu -> %lu; maximum error: translation %g, rotation %g rad, scale %g, weight %g",
+            super.description, (unsigned long)_sourceByteCount, (unsigned long)_compressedByteCount, self.compressionRatio,
+            (unsigned long)_sourceKeyFrameCount, (unsigned long)_retainedKeyFrameCount,
+            _maximumTranslationError, _maximumRotationError, _maximumScaleError, _maximumWeightError];
+}
+
+@end
+
+@interface GLTFAnimation () {
+    GLTFAnimationTrack *_tracks;
+    NSInteger _trackCount;
+    NSRange _trackRanges[GLTFAnimationPathWeights + 1]; // tracks are grouped by path
+    NSUInteger _compileCount;
+    NSTimeInterval _startTime;
+    NSTimeInterval _endTime;
+    NSUInteger _bakedByteCount;
+    GLTFAnimationCompressionReport *_compressionReport;
+    atomic_bool _compiled;
+}
+@end
+
+@implementation GLTFAnimation
+
+- (void)dealloc {
+    GLTFAnimationFreeTracks(_tracks, _trackCount);
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"%@ channels: %@", super.description, self.channels];
+}
+
+- (void)setChannels:(NSArray *)channels {
+    _channels = [channels copy];
+    [self setNeedsCompile];
+}
+
+- (void)setSamplers:(NSArray<GLTFAnimationSampler *> *)samplers {
+    _samplers = [samplers copy];
+    [self setNeedsCompile];
+}
+
+- (void)setNeedsCompile {
+    atomic_store_explicit(&_compiled, false, memory_order_release);
+}
+
+- (void)setBakedFrameRate:(double)bakedFrameRate {
+    _bakedFrameRate = MAX(bakedFrameRate, 0);
+    [self setNeedsCompile];
+}
+
+- (NSUInteger)bakedByteCount {
+    [self compileIfNeeded];
+    return _bakedByteCount;
+}
+
+- (void)setCompressionTolerances:(GLTFAnimationCompressionTolerances)compressionTolerances {
+    _compressionTolerances = (GLTFAnimationCompressionTolerances){
+        .translation = MAX(compressionTolerances.translation, 0),
+        .rotation = MAX(compressionTolerances.rotation, 0),
+        .scale = MAX(compressionTolerances.scale, 0),
+        .weight = MAX(compressionTolerances.weight, 0),
+    };
+    [self setNeedsCompile];
+}
+
+- (GLTFAnimationCompressionReport *)compressionReport {
+    [self compileIfNeeded];
+    return _compressionReport;
+}
+
+- (NSTimeInterval)startTime {
+    [self compileIfNeeded];
+    return _startTime;
+}
+
+- (NSTimeInterval)endTime {
+    [self compileIfNeeded];
+    return _endTime;
+}
+
+- (NSTimeInterval)duration {
+    [self compileIfNeeded];
+    return _endTime - _startTime;
+}
+
+// Instances may be animated from several threads at once, so the first of them to get here compiles for all
+- (void)compileIfNeeded {
+    if (atomic_load_explicit(&_compiled, memory_order_acquire)) {
+        return;
+    }
+    @synchronized (self) {
+        if (atomic_load_explicit(&_compiled, memory_order_acquire)) {
+            return;
+        }
+        [self compile];
+        atomic_store_explicit(&_compiled, true, memory_order_release);
+    }
+}
+
+- (void)compile {
+    GLTFAnimationFreeTracks(_tracks, _trackCount);
+    _tracks = calloc(MAX(_channels.count, 1), sizeof(GLTFAnimationTrack));
+    _trackCount = 0;
+    ++_compileCount;
+    
+    float startTime = FLT_MAX, endTime = -FLT_MAX;
+    for (GLTFAnimationChannel *channel in _channels) {
+        GLTFAnimationSampler *sampler = channel.sampler;
+        GLTFAccessor *inputAccessor = sampler.inputAccessor;
+        GLTFAccessor *outputAccessor = sampler.outputAccessor;
+        if (channel.path == GLTFAnimationPathUnknown || inputAccessor.contents == NULL || outputAccessor.contents == NULL ||
+            inputAccessor.count == 0)
+        {
             continue;
         }
         
-        int previousKeyFrame = 0, nextKeyFrame = 1;
-        while (timeValues[nextKeyFrame] < time) {
-            ++previousKeyFrame;
-            ++nextKeyFrame;
+        NSInteger outputComponentCount = GLTFComponentCountForDimension(outputAccessor.dimension);
+        if (inputAccessor.componentType != GLTFDataTypeFloat || outputAccessor.componentType != GLTFDataTypeFloat ||
+            inputAccessor.elementStride != sizeof(float) || outputAccessor.elementStride != outputComponentCount * sizeof(float))
+        {
+            static dispatch_once_t floatSamplersNonce;
+            dispatch_once(&floatSamplersNonce, ^{
+                NSLog(@"WARNING: Only tightly packed float accessors are supported for animation samplers. This will only be reported once.");
+            });
+            continue;
         }
         
-        if (previousKeyFrame >= keyFrameCount) {
-            previousKeyFrame = 0;
+        int keyFrameCount = (int)inputAccessor.count;
+        int keyFrameStride = (int)(outputAccessor.count * outputComponentCount / keyFrameCount);
+        BOOL isCubic = (sampler.interpolationMode == GLTFInterpolationModeCubic);
+        int valueCount = isCubic ? keyFrameStride / 3 : keyFrameStride;
+        int requiredValueCount = (channel.path == GLTFAnimationPathRotation) ? 4 : (channel.path == GLTFAnimationPathWeights) ? 1 : 3;
+        if (valueCount < requiredValueCount) {
+            NSLog(@"WARNING: Animation sampler output has too few values for its %@ channel; skipping", channel.targetPath);
+            continue;
         }
         
-        if (nextKeyFrame >= keyFrameCount) {
-            nextKeyFrame = 0;
+        GLTFAnimationTrack *track = &_tracks[_trackCount++];
+        track->channel = channel;
+        track->timeValues = inputAccessor.contents;
+        track->outputValues = outputAccessor.contents;
+        track->keyFrameCount = keyFrameCount;
+        track->valueCount = valueCount;
+        track->keyFrameStride = keyFrameStride;
+        track->valueOffset = isCubic ? valueCount : 0;
+        track->path = channel.path;
+        track->interpolationMode = sampler.interpolationMode;
+        track->cursor = 0;
+        
+        startTime = MIN(startTime, track->timeValues[0]);
+        endTime = MAX(endTime, track->timeValues[keyFrameCount - 1]);
+    }
+    
+    // Group the tracks by path, keeping channel order within each group so that later channels still win
+    GLTFAnimationTrack *groupedTracks = calloc(MAX(_trackCount, 1), sizeof(GLTFAnimationTrack));
+    NSInteger groupedTrackCount = 0;
+    for (GLTFAnimationPath path = GLTFAnimationPathUnknown; path <= GLTFAnimationPathWeights; ++path) {
+        _trackRanges[path].location = groupedTrackCount;
+        for (NSInteger t = 0; t < _trackCount; ++t) {
+            if (_tracks[t].path == path) {
+                groupedTracks[groupedTrackCount++] = _tracks[t];
+            }
+        }
+        _trackRanges[path].length = groupedTrackCount - _trackRanges[path].location;
+    }
+    free(_tracks);
+    _tracks = groupedTracks;
+    
+    size_t sourceByteCount = 0;
+    NSUInteger sourceKeyFrameCount = 0;
+    for (NSInteger t = 0; t < _trackCount; ++t) {
+        sourceByteCount += sizeof(float) * _tracks[t].keyFrameCount * (1 + _tracks[t].keyFrameStride);
+        sourceKeyFrameCount += _tracks[t].keyFrameCount;
+    }
+    
+    _bakedByteCount = 0;
+    if (_bakedFrameRate > 0) {
+        for (NSInteger t = 0; t < _trackCount; ++t) {
+            if (_tracks[t].keyFrameCount > 1) {
+                _bakedByteCount += GLTFAnimationTrackBake(&_tracks[t], _bakedFrameRate);
+            }
+        }
+    }
+    
+    _compressionReport = nil;
+    float tolerances[GLTFAnimationPathWeights + 1] = { 0 }; // by path
+    tolerances[GLTFAnimationPathTranslation] = _compressionTolerances.translation;
+    tolerances[GLTFAnimationPathRotation] = _compressionTolerances.rotation;
+    tolerances[GLTFAnimationPathScale] = _compressionTolerances.scale;
+    tolerances[GLTFAnimationPathWeights] = _compressionTolerances.weight;
+    if (tolerances[GLTFAnimationPathTranslation] > 0 || tolerances[GLTFAnimationPathRotation] > 0 ||
+        tolerances[GLTFAnimationPathScale] > 0 || tolerances[GLTFAnimationPathWeights] > 0)
+    {
+        GLTFAnimationCompressionTotals totals = { 0 };
+        for (NSInteger t = 0; t < _trackCount; ++t) {
+            GLTFAnimationTrack *track = &_tracks[t];
+            if (track->interpolationMode == GLTFInterpolationModeCubic || tolerances[track->path] == 0) {
+                // Unbaked cubic splines and paths without a tolerance are left as they are, and counted as such
+                totals.compressedByteCount += sizeof(float) * track->keyFrameCount * (1 + track->keyFrameStride);
+                totals.retainedKeyFrameCount += track->keyFrameCount;
+                continue;
+            }
+            if (track->ownedValues != NULL) {
+                _bakedByteCount -= sizeof(float) * track->keyFrameCount * track->valueCount;
+            }
+            GLTFAnimationTrackCompress(track, tolerances[track->path], &totals);
+        }
+        _compressionReport = [GLTFAnimationCompressionReport new];
+        _compressionReport.sourceByteCount = sourceByteCount;
+        _compressionReport.compressedByteCount = totals.compressedByteCount;
+        _compressionReport.sourceKeyFrameCount = sourceKeyFrameCount;
+        _compressionReport.retainedKeyFrameCount = totals.retainedKeyFrameCount;
+        _compressionReport.maximumTranslationError = totals.maximumErrors[GLTFAnimationPathTranslation];
+        _compressionReport.maximumRotationError = totals.maximumErrors[GLTFAnimationPathRotation];
+        _compressionReport.maximumScaleError = totals.maximumErrors[GLTFAnimationPathScale];
+        _compressionReport.maximumWeightError = totals.maximumErrors[GLTFAnimationPathWeights];
+    }
+    
+    if (_trackCount == 0) {
+        startTime = endTime = 0;
+    }
+    _startTime = startTime;
+    _endTime = endTime;
+}
+
+- (void)runAtTime:(NSTimeInterval)time {
+    [self compileIfNeeded];
+    
+    for (NSInteger t = 0; t < _trackCount; ++t) {
+        GLTFAnimationTrack *track = &_tracks[t];
+        GLTFNode *target = track->channel.targetNode;
+        if (target == nil) {
+            continue;
         }
         
-        float frameTimeDelta = timeValues[nextKeyFrame] - timeValues[previousKeyFrame];
-        float timeWithinFrame = time - timeValues[previousKeyFrame];
-        float frameProgress = timeWithinFrame / frameTimeDelta;
+        int valueCapacity = MAX(track->valueCount, 4);
+        float values[valueCapacity];
+        GLTFAnimationTrackSample(track, time, &track->cursor, values);
         
-        if ([path isEqualToString:@"rotation"]) {
-            if(sampler.outputAccessor.componentType != GLTFDataTypeFloat) {
-                static dispatch_once_t floatRotationsNonce;
-                dispatch_once(&floatRotationsNonce, ^{
-                    NSLog(@"WARNING: Only float accessors are supported for rotation animations. This will only be reported once.");
-                });
-            }
-            const GLTFQuaternion *rotationValues = sampler.outputValues;
-            
-            GLTFQuaternion previousRotation = rotationValues[previousKeyFrame];
-            GLTFQuaternion nextRotation = rotationValues[nextKeyFrame];
-            GLTFQuaternion interpRotation = simd_slerp(previousRotation, nextRotation, frameProgress);
-
-            target.rotationQuaternion = interpRotation;
-        } else if ([path isEqualToString:@"translation"]) {
-            const GLTFVector3 *translationValues = sampler.outputValues;
-            
-            GLTFVector3 previousTranslation = translationValues[previousKeyFrame];
-            GLTFVector3 nextTranslation = translationValues[nextKeyFrame];
-            
-            GLTFVector3 interpTranslation = (GLTFVector3) {
-                ((1 - frameProgress) * previousTranslation.x) + (frameProgress * nextTranslation.x),
-                ((1 - frameProgress) * previousTranslation.y) + (frameProgress * nextTranslation.y),
-                ((1 - frameProgress) * previousTranslation.z) + (frameProgress * nextTranslation.z)
-            };
-
-            target.translation = (simd_float3){ interpTranslation.x, interpTranslation.y, interpTranslation.z };
-        } else if ([path isEqualToString:@"scale"]) {
-            const float *scaleValues = sampler.outputValues;
-            
-            float previousScale = scaleValues[previousKeyFrame];
-            float nextScale = scaleValues[nextKeyFrame];
-            
-            float interpScale = ((1 - frameProgress) * previousScale) + (frameProgress * nextScale);
-            
-            target.scale = (simd_float3)interpScale;
-        } else if ([path isEqualToString:@"weights"]) {
-            if(sampler.outputAccessor.componentType != GLTFDataTypeFloat) {
-                static dispatch_once_t floatWeightsNonce;
-                dispatch_once(&floatWeightsNonce, ^{
-                    NSLog(@"WARNING: Only scalar float accessors are supported for weight animations. This will only be reported once.");
-                });
-            }
-            const float *weightValues = sampler.outputValues;
-            
-            long weightCount = sampler.outputAccessor.count / keyFrameCount;
-            
-            const float *previousWeights = weightValues + (previousKeyFrame * weightCount);
-            const float *nextWeights = weightValues + (nextKeyFrame * weightCount);
-            
-            NSMutableArray *interpWeights = [NSMutableArray array];
-            for (int i = 0; i < weightCount; ++i) {
-                float interpWeight = ((1 - frameProgress) * previousWeights[i]) + (frameProgress * nextWeights[i]);
-                [interpWeights addObject:@(interpWeight)];
-            }
-
-            target.morphTargetWeights = [interpWeights copy];
+        switch (track->path) {
+            case GLTFAnimationPathRotation:
+                target.rotationQuaternion = GLTFAnimationLoadQuaternion(values);
+                break;
+            case GLTFAnimationPathTranslation:
+                target.translation = GLTFAnimationLoadFloat3(values);
+                break;
+            case GLTFAnimationPathScale:
+                target.scale = GLTFAnimationLoadFloat3(values);
+                break;
+            case GLTFAnimationPathWeights:
+                [target setMorphTargetWeightValues:values count:track->valueCount];
+                break;
+            case GLTFAnimationPathUnknown:
+                break;
         }
     }
 }
 
+- (GLTFAnimationTrackBinding *)bindingsForInstance:(GLTFSceneInstance *)instance {
+    NSMutableData *stateData = [instance _animationStateForKey:self];
+    GLTFAnimationInstanceState *state = stateData.mutableBytes;
+    if (stateData.length > 0 && state->compileCount == _compileCount) {
+        return state->bindings;
+    }
+    
+    stateData.length = sizeof(GLTFAnimationInstanceState) + sizeof(GLTFAnimationTrackBinding) * _trackCount;
+    state = stateData.mutableBytes;
+    state->compileCount = _compileCount;
+    GLTFTransformStore *transformStore = instance.transformStore;
+    for (NSInteger t = 0; t < _trackCount; ++t) {
+        GLTFNode *target = _tracks[t].channel.targetNode;
+        state->bindings[t].nodeIndex = (target != nil) ? (int32_t)[transformStore indexOfNode:target] : -1;
+        state->bindings[t].cursor = 0;
+    }
+    return state->bindings;
+}
+
+- (void)runAtTime:(NSTimeInterval)time instance:(GLTFSceneInstance *)instance {
+    [self evaluateAtTime:time instance:instance pose:NULL];
+}
+
+- (void)sampleAtTime:(NSTimeInterval)time instance:(GLTFSceneInstance *)instance intoPose:(GLTFAnimationPose *)pose {
+    [self evaluateAtTime:time instance:instance pose:pose];
+}
+
+// Writes to the pose if there is one, and to the instance otherwise
+- (void)evaluateAtTime:(NSTimeInterval)time instance:(GLTFSceneInstance *)instance pose:(GLTFAnimationPose *)pose {
+    [self compileIfNeeded];
+    
+    GLTFAnimationTrackBinding *bindings = [self bindingsForInstance:instance];
+    GLTFTransformStore *transformStore = instance.transformStore;
+    
+    // Each group of tracks is interpolated a batch at a time and handed to the store in one call per batch
+    GLTFAnimationPath vectorPaths[] = { GLTFAnimationPathTranslation, GLTFAnimationPathScale };
+    for (int p = 0; p < 2; ++p) {
+        GLTFAnimationPath path = vectorPaths[p];
+        NSRange range = _trackRanges[path];
+        for (NSUInteger base = range.location; base < NSMaxRange(range); base += GLTFAnimationBatchWidth) {
+            NSUInteger end = MIN(base + GLTFAnimationBatchWidth, NSMaxRange(range));
+            simd_float3 values[GLTFAnimationBatchWidth];
+            int32_t indices[GLTFAnimationBatchWidth];
+            int count = 0;
+            for (NSUInteger t = base; t < end; ++t) {
+                const GLTFAnimationTrack *track = &_tracks[t];
+                GLTFAnimationTrackBinding *binding = &bindings[t];
+                if (binding->nodeIndex < 0) {
+                    continue;
+                }
+                if (GLTFAnimationTrackIsDirectLinear(track)) {
+                    int previousKeyFrame, nextKeyFrame;
+                    float frameProgress;
+                    GLTFAnimationTrackLocate(track, time, &binding->cursor, &previousKeyFrame, &nextKeyFrame, &frameProgress);
+                    simd_float3 previousValue = GLTFAnimationLoadFloat3(GLTFAnimationTrackValues(track, previousKeyFrame));
+                    simd_float3 nextValue = GLTFAnimationLoadFloat3(GLTFAnimationTrackValues(track, nextKeyFrame));
+                    values[count] = simd_mix(previousValue, nextValue, (simd_float3)frameProgress);
+                } else {
+                    float sampledValues[3];
+                    GLTFAnimationTrackSample(track, time, &binding->cursor, sampledValues);
+                    values[count] = GLTFAnimationLoadFloat3(sampledValues);
+                }
+                indices[count] = binding->nodeIndex;
+                ++count;
+            }
+            if (pose != NULL) {
+                simd_float3 *poseValues = (path == GLTFAnimationPathTranslation) ? pose->translations : pose->scales;
+                GLTFAnimationPoseChannels channel = (path == GLTFAnimationPathTranslation) ? GLTFAnimationPoseChannelTranslation
+                                                                                             : GLTFAnimationPoseChannelScale;
+                for (int i = 0; i < count; ++i) {
+                    poseValues[indices[i]] = values[i];
+                    pose->channels[indices[i]] |= channel;
+                }
+            } else if (path == GLTFAnimationPathTranslation) {
+                [transformStore setTranslations:values atIndices:indices count:count];
+            } else {
+                [transformStore setScales:values atIndices:indices count:count];
+            }
+        }
+    }
+    
+    NSRange rotationRange = _trackRanges[GLTFAnimationPathRotation];
+    for (NSUInteger base = rotationRange.location; base < NSMaxRange(rotationRange); base += GLTFAnimationBatchWidth) {
+        NSUInteger end = MIN(base + GLTFAnimationBatchWidth, NSMaxRange(rotationRange));
+        simd_float4 previousValues[GLTFAnimationBatchWidth], nextValues[GLTFAnimationBatchWidth];
+        float progress[GLTFAnimationBatchWidth];
+        int32_t indices[GLTFAnimationBatchWidth];
+        int count = 0;
+        for (NSUInteger t = base; t < end; ++t) {
+            const GLTFAnimationTrack *track = &_tracks[t];
+            GLTFAnimationTrackBinding *binding = &bindings[t];
+            if (binding->nodeIndex < 0) {
+                continue;
+            }
+            if (GLTFAnimationTrackIsDirectLinear(track)) {
+                int previousKeyFrame, nextKeyFrame;
+                GLTFAnimationTrackLocate(track, time, &binding->cursor, &previousKeyFrame, &nextKeyFrame, &progress[count]);
+                previousValues[count] = GLTFAnimationLoadQuaternion(GLTFAnimationTrackValues(track, previousKeyFrame)).vector;
+                nextValues[count] = GLTFAnimationLoadQuaternion(GLTFAnimationTrackValues(track, nextKeyFrame)).vector;
+            } else {
+                // Step, cubic and compressed values are final already; interpolating a value with itself passes it through
+                float sampledValues[4];
+                GLTFAnimationTrackSample(track, time, &binding->cursor, sampledValues);
+                previousValues[count] = nextValues[count] = GLTFAnimationLoadFloat4(sampledValues);
+                progress[count] = 0;
+            }
+            indices[count] = binding->nodeIndex;
+            ++count;
+        }
+        GLTFQuaternion rotations[GLTFAnimationBatchWidth];
+        GLTFAnimationInterpolateQuaternions(previousValues, nextValues, progress, count, rotations);
+        if (pose != NULL) {
+            for (int i = 0; i < count; ++i) {
+                pose->rotations[indices[i]] = rotations[i];
+                pose->channels[indices[i]] |= GLTFAnimationPoseChannelRotation;
+            }
+        } else {
+            [transformStore setRotations:rotations atIndices:indices count:count];
+        }
+    }
+    
+    NSRange weightsRange = _trackRanges[GLTFAnimationPathWeights];
+    for (NSUInteger t = weightsRange.location; t < NSMaxRange(weightsRange); ++t) {
+        const GLTFAnimationTrack *track = &_tracks[t];
+        GLTFAnimationTrackBinding *binding = &bindings[t];
+        if (binding->nodeIndex < 0) {
+            continue;
+        }
+        float *weights = NULL;
+        NSInteger weightCount = 0;
+        if (pose != NULL) {
+            if (pose->morphTargetWeights != NULL && pose->morphTargetWeightOffsets != NULL) {
+                NSInteger offset = pose->morphTargetWeightOffsets[binding->nodeIndex];
+                weights = pose->morphTargetWeights + offset;
+                weightCount = pose->morphTargetWeightOffsets[binding->nodeIndex + 1] - offset;
+            }
+        } else {
+            weights = [instance morphTargetWeightsAtIndex:binding->nodeIndex];
+            weightCount = [instance morphTargetWeightCountAtIndex:binding->nodeIndex];
+        }
+        weightCount = MIN(weightCount, track->valueCount);
+        if (weights == NULL || weightCount == 0) {
+            continue;
+        }
+        float values[track->valueCount];
+        GLTFAnimationTrackSample(track, time, &binding->cursor, values);
+        memcpy(weights, values, sizeof(float) * weightCount);
+        if (pose != NULL) {
+            pose->channels[binding->nodeIndex] |= GLTFAnimationPoseChannelWeights;
+        }
+    }
+}
+
++ (void)runAnimations:(NSArray<GLTFAnimation *> *)animations
+              atTimes:(const NSTimeInterval *)times
+            instances:(NSArray<GLTFSceneInstance *> *)instances
+{
+    NSInteger runCount = MIN(animations.count, instances.count);
+    if (runCount == 0) {
+        return;
+    }
+    
+    for (GLTFAnimation *animation in animations) {
+        [animation compileIfNeeded];
+    }
+    
+    // Order the runs by instance, keeping the caller's order within an instance, so that each instance's runs
+    // are contiguous and no two threads ever write to the same pose
+    NSInteger *order = malloc(sizeof(NSInteger) * runCount);
+    for (NSInteger i = 0; i < runCount; ++i) {
+        order[i] = i;
+    }
+    qsort_b(order, runCount, sizeof(NSInteger), ^int(const void *a, const void *b) {
+        NSInteger i = *(const NSInteger *)a, j = *(const NSInteger *)b;
+        uintptr_t instanceA = (uintptr_t)(__bridge void *)instances[i], instanceB = (uintptr_t)(__bridge void *)instances[j];
+        if (instanceA != instanceB) {
+            return (instanceA < instanceB) ? -1 : 1;
+        }
+        return (i < j) ? -1 : (i > j) ? 1 : 0;
+    });
+    
+    NSMutableData *groupStartData = [NSMutableData data];
+    for (NSInteger i = 0; i < runCount; ++i) {
+        if (i == 0 || instances[order[i]] != instances[order[i - 1]]) {
+            [groupStartData appendBytes:&i length:sizeof(i)];
+        }
+    }
+    [groupStartData appendBytes:&runCount length:sizeof(runCount)];
+    const NSInteger *groupStarts = groupStartData.bytes;
+    size_t groupCount = groupStartData.length / sizeof(NSInteger) - 1;
+    
+    // dispatch_apply balances the groups across the cores dynamically, so a few instances with
+    // heavy clips don't hold up the rest
+    dispatch_apply(groupCount, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t g) {
+        GLTFSceneInstance *instance = instances[order[groupStarts[g]]];
+        for (NSInteger r = groupStarts[g]; r < groupStarts[g + 1]; ++r) {
+            [animations[order[r]] runAtTime:times[order[r]] instance:instance];
+        }
+        [instance.transformStore updateWorldTransforms];
+    });
+    
+    free(order);
+}
+
 @end
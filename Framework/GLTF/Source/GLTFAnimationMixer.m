@@ -0,0 +1,499 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+#import "GLTFAnimationMixer.h"
+#import "GLTFAnimation.h"
+#import "GLTFMesh.h"
+#import "GLTFNode.h"
+#import "GLTFSceneInstance.h"
+#import "GLTFTransformStore.h"
+
+@interface GLTFAnimationMixerLayer ()
+@property (nonatomic, weak) GLTFAnimationMixer *mixer;
+@property (nonatomic, strong) NSMapTable<GLTFNode *, NSNumber *> *maskWeightsForNodes;
+@property (nonatomic, weak) GLTFNode *maskSubtreeRoot;
+// One weight per transform index, or nil if unmasked; rebuilt when the mask or the mixer's layout changes
+@property (nonatomic, strong) NSMutableData *resolvedMaskWeights;
+@property (nonatomic, assign) NSUInteger resolvedLayoutGeneration;
+- (instancetype)initWithAnimation:(GLTFAnimation *)animation mixer:(GLTFAnimationMixer *)mixer;
+- (const float *)maskWeights;
+@end
+
+@interface GLTFAnimationMixer () {
+    NSInteger _nodeCount;
+    NSInteger *_morphTargetWeightOffsets;
+    
+    simd_float3 *_restTranslations;
+    GLTFQuaternion *_restRotations;
+    simd_float3 *_restScales;
+    float *_restMorphTargetWeights;
+    
+    // Where each layer is sampled
+    simd_float3 *_sampleTranslations;
+    GLTFQuaternion *_sampleRotations;
+    simd_float3 *_sampleScales;
+    float *_sampleMorphTargetWeights;
+    GLTFAnimationPoseChannels *_sampleChannels;
+    
+    // Weighted sums over blended layers; the lanes of the weight sums are translation, rotation, scale and morph weights
+    simd_float3 *_blendTranslations;
+    simd_float4 *_blendRotations;
+    simd_float3 *_blendScales;
+    float *_blendMorphTargetWeights;
+    simd_float4 *_blendWeightSums;
+    
+    simd_float3 *_resultTranslations;
+    GLTFQuaternion *_resultRotations;
+    simd_float3 *_resultScales;
+    float *_resultMorphTargetWeights;
+    GLTFAnimationPoseChannels *_resultChannels;
+    
+    int32_t *_writeIndices;
+}
+@property (nonatomic, strong) NSMutableArray<GLTFAnimationMixerLayer *> *mutableLayers;
+@property (nonatomic, strong) NSArray<GLTFNode *> *layoutNodes;
+@property (nonatomic, assign) NSUInteger layoutGeneration;
+- (void)layOutIfNeeded;
+@end
+
+@implementation GLTFAnimationMixerLayer
+
+- (instancetype)initWithAnimation:(GLTFAnimation *)animation mixer:(GLTFAnimationMixer *)mixer {
+    if ((self = [super init])) {
+        _animation = animation;
+        _mixer = mixer;
+        _weight = 1;
+        _blendMode = GLTFAnimationBlendModeBlend;
+    }
+    return self;
+}
+
+- (void)setMaskWeight:(float)weight forNode:(GLTFNode *)node {
+    if (_maskWeightsForNodes == nil) {
+        _maskWeightsForNodes = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPointerPersonality
+                                                     valueOptions:NSPointerFunctionsStrongMemory];
+    }
+    [_maskWeightsForNodes setObject:@(weight) forKey:node];
+    _resolvedMaskWeights = nil;
+}
+
+- (void)setMaskToSubtreeOfNode:(GLTFNode *)node {
+    _maskSubtreeRoot = node;
+    _resolvedMaskWeights = nil;
+}
+
+- (void)removeMask {
+    _maskWeightsForNodes = nil;
+    _maskSubtreeRoot = nil;
+    _resolvedMaskWeights = nil;
+}
+
+- (const float *)maskWeights {
+    GLTFAnimationMixer *mixer = self.mixer;
+    if (_maskWeightsForNodes.count == 0 && _maskSubtreeRoot == nil) {
+        return NULL;
+    }
+    if (_resolvedMaskWeights != nil && _resolvedLayoutGeneration == mixer.layoutGeneration) {
+        return _resolvedMaskWeights.bytes;
+    }
+    
+    GLTFTransformStore *transformStore = mixer.instance.transformStore;
+    NSInteger nodeCount = transformStore.nodeCount;
+    NSMutableData *maskData = [NSMutableData dataWithLength:sizeof(float) * nodeCount];
+    float *mask = maskData.mutableBytes;
+    
+    NSInteger subtreeRootIndex = (_maskSubtreeRoot != nil) ? [transformStore indexOfNode:_maskSubtreeRoot] : -1;
+    if (_maskSubtreeRoot == nil) {
+        for (NSInteger i = 0; i < nodeCount; ++i) {
+            mask[i] = 1;
+        }
+    } else if (subtreeRootIndex >= 0) {
+        // Parents precede their children, so each node can inherit membership from its parent in one pass
+        const int32_t *parentIndices = transformStore.parentIndices;
+        for (NSInteger i = subtreeRootIndex; i < nodeCount; ++i) {
+            int32_t parentIndex = parentIndices[i];
+            mask[i] = (i == subtreeRootIndex || (parentIndex >= 0 && mask[parentIndex] > 0)) ? 1 : 0;
+        }
+    }
+    
+    for (GLTFNode *node in _maskWeightsForNodes) {
+        NSInteger index = [transformStore indexOfNode:node];
+        if (index >= 0) {
+            mask[index] = [_maskWeightsForNodes objectForKey:node].floatValue;
+        }
+    }
+    
+    _resolvedMaskWeights = maskData;
+    _resolvedLayoutGeneration = mixer.layoutGeneration;
+    return mask;
+}
+
+@end
+
+@implementation GLTFAnimationMixer
+
+- (instancetype)initWithSceneInstance:(GLTFSceneInstance *)instance {
+    if ((self = [super init])) {
+        _instance = instance;
+        _mutableLayers = [NSMutableArray array];
+        [self layOutIfNeeded];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [self freeStorage];
+}
+
+- (void)freeStorage {
+    free(_morphTargetWeightOffsets);
+    free(_restTranslations);
+    free(_restRotations);
+    free(_restScales);
+    free(_restMorphTargetWeights);
+    free(_sampleTranslations);
+    free(_sampleRotations);
+    free(_sampleScales);
+    free(_sampleMorphTargetWeights);
+    free(_sampleChannels);
+    free(_blendTranslations);
+    free(_blendRotations);
+    free(_blendScales);
+    free(_blendMorphTargetWeights);
+    free(_blendWeightSums);
+    free(_resultTranslations);
+    free(_resultRotations);
+    free(_resultScales);
+    free(_resultMorphTargetWeights);
+    free(_resultChannels);
+    free(_writeIndices);
+}
+
+- (NSArray<GLTFAnimationMixerLayer *> *)layers {
+    return [_mutableLayers copy];
+}
+
+- (GLTFAnimationMixerLayer *)addLayerWithAnimation:(GLTFAnimation *)animation {
+    GLTFAnimationMixerLayer *layer = [[GLTFAnimationMixerLayer alloc] initWithAnimation:animation mixer:self];
+    [_mutableLayers addObject:layer];
+    return layer;
+}
+
+- (void)removeLayer:(GLTFAnimationMixerLayer *)layer {
+    [_mutableLayers removeObjectIdenticalTo:layer];
+}
+
+- (void)layOutIfNeeded {
+    GLTFSceneInstance *instance = _instance;
+    NSArray<GLTFNode *> *nodes = instance.transformStore.nodes;
+    if (nodes == _layoutNodes) {
+        return;
+    }
+    _layoutNodes = nodes;
+    ++_layoutGeneration;
+    
+    [self freeStorage];
+    
+    NSInteger nodeCount = nodes.count;
+    _nodeCount = nodeCount;
+    _morphTargetWeightOffsets = malloc(sizeof(NSInteger) * (nodeCount + 1));
+    NSInteger weightCount = 0;
+    for (NSInteger i = 0; i < nodeCount; ++i) {
+        _morphTargetWeightOffsets[i] = weightCount;
+        weightCount += [instance morphTargetWeightCountAtIndex:i];
+    }
+    _morphTargetWeightOffsets[nodeCount] = weightCount;
+    
+    size_t n = MAX(nodeCount, 1), w = MAX(weightCount, 1);
+    _restTranslations = malloc(sizeof(simd_float3) * n);
+    _restRotations = malloc(sizeof(GLTFQuaternion) * n);
+    _restScales = malloc(sizeof(simd_float3) * n);
+    _restMorphTargetWeights = calloc(w, sizeof(float));
+    _sampleTranslations = malloc(sizeof(simd_float3) * n);
+    _sampleRotations = malloc(sizeof(GLTFQuaternion) * n);
+    _sampleScales = malloc(sizeof(simd_float3) * n);
+    _sampleMorphTargetWeights = malloc(sizeof(float) * w);
+    _sampleChannels = malloc(sizeof(GLTFAnimationPoseChannels) * n);
+    _blendTranslations = malloc(sizeof(simd_float3) * n);
+    _blendRotations = malloc(sizeof(simd_float4) * n);
+    _blendScales = malloc(sizeof(simd_float3) * n);
+    _blendMorphTargetWeights = malloc(sizeof(float) * w);
+    _blendWeightSums = malloc(sizeof(simd_float4) * n);
+    _resultTranslations = malloc(sizeof(simd_float3) * n);
+    _resultRotations = malloc(sizeof(GLTFQuaternion) * n);
+    _resultScales = malloc(sizeof(simd_float3) * n);
+    _resultMorphTargetWeights = malloc(sizeof(float) * w);
+    _resultChannels = calloc(n, sizeof(GLTFAnimationPoseChannels));
+    _writeIndices = malloc(sizeof(int32_t) * n);
+    
+    // The rest pose is the pose the asset was authored in, not whatever the instance holds now
+    for (NSInteger i = 0; i < nodeCount; ++i) {
+        GLTFNode *node = nodes[i];
+        _restTranslations[i] = node.translation;
+        _restRotations[i] = node.rotationQuaternion;
+        _restScales[i] = node.scale;
+        const float *weights = node.morphTargetWeightValues;
+        NSInteger weightCount = node.morphTargetWeightCount;
+        if (weightCount == 0) {
+            weights = node.mesh.defaultMorphTargetWeightValues;
+            weightCount = node.mesh.defaultMorphTargetWeightCount;
+        }
+        NSInteger nodeWeightCount = MIN(weightCount, _morphTargetWeightOffsets[i + 1] - _morphTargetWeightOffsets[i]);
+        if (nodeWeightCount > 0) {
+            memcpy(_restMorphTargetWeights + _morphTargetWeightOffsets[i], weights, sizeof(float) * nodeWeightCount);
+        }
+    }
+}
+
+- (GLTFAnimationPose)samplePose {
+    return (GLTFAnimationPose){
+        .translations = _sampleTranslations,
+        .rotations = _sampleRotations,
+        .scales = _sampleScales,
+        .channels = _sampleChannels,
+        .morphTargetWeights = _sampleMorphTargetWeights,
+        .morphTargetWeightOffsets = _morphTargetWeightOffsets,
+    };
+}
+
+- (BOOL)sampleLayer:(GLTFAnimationMixerLayer *)layer {
+    if (layer.weight == 0) {
+        return NO;
+    }
+    memset(_sampleChannels, 0, sizeof(GLTFAnimationPoseChannels) * _nodeCount);
+    // A weights track with fewer values per key than the node has targets only writes the leading weights,
+    // so the rest hold their rest values rather than whatever an earlier layer left behind
+    memcpy(_sampleMorphTargetWeights, _restMorphTargetWeights, sizeof(float) * _morphTargetWeightOffsets[_nodeCount]);
+    GLTFAnimationPose pose = [self samplePose];
+    [layer.animation sampleAtTime:layer.time instance:_instance intoPose:&pose];
+    return YES;
+}
+
+- (void)accumulateBlendedLayer:(GLTFAnimationMixerLayer *)layer {
+    const float *mask = [layer maskWeights];
+    float layerWeight = layer.weight;
+    for (NSInteger i = 0; i < _nodeCount; ++i) {
+        GLTFAnimationPoseChannels channels = _sampleChannels[i];
+        float weight = layerWeight * (mask ? mask[i] : 1);
+        if (channels == 0 || weight == 0) {
+            continue;
+        }
+        _resultChannels[i] |= channels;
+        
+        simd_float4 weightSums = _blendWeightSums[i];
+        if (channels & GLTFAnimationPoseChannelTranslation) {
+            _blendTranslations[i] += weight * _sampleTranslations[i];
+            weightSums.x += weight;
+        }
+        if (channels & GLTFAnimationPoseChannelRotation) {
+            // q and -q are the same rotation; keep every contribution in the hemisphere of the running sum
+            simd_float4 rotation = _sampleRotations[i].vector;
+            if (simd_dot(rotation, _blendRotations[i]) < 0) {
+                rotation = -rotation;
+            }
+            _blendRotations[i] += weight * rotation;
+            weightSums.y += weight;
+        }
+        if (channels & GLTFAnimationPoseChannelScale) {
+            _blendScales[i] += weight * _sampleScales[i];
+            weightSums.z += weight;
+        }
+        if (channels & GLTFAnimationPoseChannelWeights) {
+            for (NSInteger k = _morphTargetWeightOffsets[i]; k < _morphTargetWeightOffsets[i + 1]; ++k) {
+                _blendMorphTargetWeights[k] += weight * _sampleMorphTargetWeights[k];
+            }
+            weightSums.w += weight;
+        }
+        _blendWeightSums[i] = weightSums;
+    }
+}
+
+// Turns the weighted sums into values, topping up nodes whose total weight falls short of one with their rest pose
+- (void)resolveBlendedLayers {
+    for (NSInteger i = 0; i < _nodeCount; ++i) {
+        GLTFAnimationPoseChannels channels = _resultChannels[i];
+        if (channels == 0) {
+            continue;
+        }
+        simd_float4 weightSums = _blendWeightSums[i];
+        simd_float4 restShortfall = simd_max(1 - weightSums, (simd_float4)0);
+        simd_float4 normalization = 1 / simd_max(weightSums, (simd_float4)1);
+        
+        if (channels & GLTFAnimationPoseChannelTranslation) {
+            _resultTranslations[i] = (_blendTranslations[i] + restShortfall.x * _restTranslations[i]) * normalization.x;
+        }
+        if (channels & GLTFAnimationPoseChannelRotation) {
+            simd_float4 rest = _restRotations[i].vector;
+            if (simd_dot(rest, _blendRotations[i]) < 0) {
+                rest = -rest;
+            }
+            simd_float4 rotation = _blendRotations[i] + restShortfall.y * rest;
+            float lengthSquared = simd_length_squared(rotation);
+            _resultRotations[i] = (lengthSquared > 1e-12f) ? simd_quaternion(rotation * simd_rsqrt(lengthSquared)) : _restRotations[i];
+        }
+        if (channels & GLTFAnimationPoseChannelScale) {
+            _resultScales[i] = (_blendScales[i] + restShortfall.z * _restScales[i]) * normalization.z;
+        }
+        if (channels & GLTFAnimationPoseChannelWeights) {
+            for (NSInteger k = _morphTargetWeightOffsets[i]; k < _morphTargetWeightOffsets[i + 1]; ++k) {
+                _resultMorphTargetWeights[k] = (_blendMorphTargetWeights[k] + restShortfall.w * _restMorphTargetWeights[k]) * normalization.w;
+            }
+        }
+    }
+}
+
+- (void)applyAdditiveLayer:(GLTFAnimationMixerLayer *)layer {
+    const float *mask = [layer maskWeights];
+    float layerWeight = layer.weight;
+    simd_float4 identity = simd_make_float4(0, 0, 0, 1);
+    for (NSInteger i = 0; i < _nodeCount; ++i) {
+        GLTFAnimationPoseChannels channels = _sampleChannels[i];
+        float weight = layerWeight * (mask ? mask[i] : 1);
+        if (channels == 0 || weight == 0) {
+            continue;
+        }
+        _resultChannels[i] |= channels;
+        
+        if (channels & GLTFAnimationPoseChannelTranslation) {
+            _resultTranslations[i] += weight * (_sampleTranslations[i] - _restTranslations[i]);
+        }
+        if (channels & GLTFAnimationPoseChannelRotation) {
+            GLTFQuaternion delta = simd_mul(_sampleRotations[i], simd_inverse(_restRotations[i]));
+            simd_float4 deltaVector = (delta.vector.w < 0) ? -delta.vector : delta.vector;
+            simd_float4 partial = simd_mix(identity, deltaVector, (simd_float4)weight);
+            GLTFQuaternion weightedDelta = simd_quaternion(partial * simd_rsqrt(simd_length_squared(partial)));
+            _resultRotations[i] = simd_mul(weightedDelta, _resultRotations[i]);
+        }
+        if (channels & GLTFAnimationPoseChannelScale) {
+            simd_float3 rest = _restScales[i];
+            simd_float3 ratio = simd_select(_sampleScales[i] / rest, (simd_float3)1, simd_abs(rest) < 1e-6f);
+            _resultScales[i] *= simd_mix((simd_float3)1, ratio, (simd_float3)weight);
+        }
+        if (channels & GLTFAnimationPoseChannelWeights) {
+            for (NSInteger k = _morphTargetWeightOffsets[i]; k < _morphTargetWeightOffsets[i + 1]; ++k) {
+                _resultMorphTargetWeights[k] += weight * (_sampleMorphTargetWeights[k] - _restMorphTargetWeights[k]);
+            }
+        }
+    }
+}
+
+- (void)evaluate {
+    [self layOutIfNeeded];
+    
+    GLTFSceneInstance *instance = _instance;
+    GLTFTransformStore *transformStore = instance.transformStore;
+    NSInteger nodeCount = _nodeCount;
+    NSInteger weightCount = _morphTargetWeightOffsets[nodeCount];
+    
+    memset(_blendTranslations, 0, sizeof(simd_float3) * nodeCount);
+    memset(_blendRotations, 0, sizeof(simd_float4) * nodeCount);
+    memset(_blendScales, 0, sizeof(simd_float3) * nodeCount);
+    memset(_blendMorphTargetWeights, 0, sizeof(float) * weightCount);
+    memset(_blendWeightSums, 0, sizeof(simd_float4) * nodeCount);
+    memset(_resultChannels, 0, sizeof(GLTFAnimationPoseChannels) * nodeCount);
+    
+    // Channels that end up animated by additive layers alone start from the rest pose. Starting from the
+    // instance's pose would stack each evaluation's offsets on top of the previous evaluation's output.
+    memcpy(_resultTranslations, _restTranslations, sizeof(simd_float3) * nodeCount);
+    memcpy(_resultRotations, _restRotations, sizeof(GLTFQuaternion) * nodeCount);
+    memcpy(_resultScales, _restScales, sizeof(simd_float3) * nodeCount);
+    memcpy(_resultMorphTargetWeights, _restMorphTargetWeights, sizeof(float) * weightCount);
+    
+    for (GLTFAnimationMixerLayer *layer in _mutableLayers) {
+        if (layer.blendMode == GLTFAnimationBlendModeBlend && [self sampleLayer:layer]) {
+            [self accumulateBlendedLayer:layer];
+        }
+    }
+    [self resolveBlendedLayers];
+    
+    for (GLTFAnimationMixerLayer *layer in _mutableLayers) {
+        if (layer.blendMode == GLTFAnimationBlendModeAdditive && [self sampleLayer:layer]) {
+            [self applyAdditiveLayer:layer];
+        }
+    }
+    
+    // Write back only what some layer animated, gathering each channel into the sample buffers, which are free again
+    GLTFAnimationPoseChannels writeChannels[] = {
+        GLTFAnimationPoseChannelTranslation, GLTFAnimationPoseChannelRotation, GLTFAnimationPoseChannelScale
+    };
+    for (int c = 0; c < 3; ++c) {
+        NSInteger count = 0;
+        for (NSInteger i = 0; i < nodeCount; ++i) {
+            if (!(_resultChannels[i] & writeChannels[c])) {
+                continue;
+            }
+            switch (writeChannels[c]) {
+                case GLTFAnimationPoseChannelTranslation:
+                    _sampleTranslations[count] = _resultTranslations[i];
+                    break;
+                case GLTFAnimationPoseChannelRotation:
+                    _sampleRotations[count] = _resultRotations[i];
+                    break;
+                default:
+                    _sampleScales[count] = _resultScales[i];
+                    break;
+            }
+            _writeIndices[count++] = (int32_t)i;
+        }
+        switch (writeChannels[c]) {
+            case GLTFAnimationPoseChannelTranslation:
+                [transformStore setTranslations:_sampleTranslations atIndices:_writeIndices count:count];
+                break;
+            case GLTFAnimationPoseChannelRotation:
+                [transformStore setRotations:_sampleRotations atIndices:_writeIndices count:count];
+                break;
+            default:
+                [transformStore setScales:_sampleScales atIndices:_writeIndices count:count];
+                break;
+        }
+    }
+    for (NSInteger i = 0; i < nodeCount; ++i) {
+        float *weights = [instance morphTargetWeightsAtIndex:i];
+        if ((_resultChannels[i] & GLTFAnimationPoseChannelWeights) && weights != NULL) {
+            memcpy(weights, _resultMorphTargetWeights + _morphTargetWeightOffsets[i],
+                   sizeof(float) * (_morphTargetWeightOffsets[i + 1] - _morphTargetWeightOffsets[i]));
+        }
+    }
+}
+
+- (void)writePoseToNodes {
+    [self layOutIfNeeded];
+    
+    GLTFSceneInstance *instance = _instance;
+    GLTFTransformStore *transformStore = instance.transformStore;
+    for (NSInteger i = 0; i < _nodeCount; ++i) {
+        GLTFAnimationPoseChannels channels = _resultChannels[i];
+        if (channels == 0) {
+            continue;
+        }
+        GLTFNode *node = _layoutNodes[i];
+        if (channels & GLTFAnimationPoseChannelTranslation) {
+            node.translation = transformStore.translations[i];
+        }
+        if (channels & GLTFAnimationPoseChannelRotation) {
+            node.rotationQuaternion = transformStore.rotations[i];
+        }
+        if (channels & GLTFAnimationPoseChannelScale) {
+            node.scale = transformStore.scales[i];
+        }
+        if (channels & GLTFAnimationPoseChannelWeights) {
+            [node setMorphTargetWeightValues:[instance morphTargetWeightsAtIndex:i]
+                                       count:[instance morphTargetWeightCountAtIndex:i]];
+        }
+    }
+}
+
+@end
@@ -27,6 +27,8 @@
 #import "GLTFKHRLight.h"
 #import "GLTFMaterial.h"
 #import "GLTFMesh.h"
+#import "GLTFMeshlet.h"
+#import "GLTFMeshSimplifier.h"
 #import "GLTFNode.h"
 #import "GLTFTexture.h"
 #import "GLTFTextureSampler.h"
@@ -63,8 +65,177 @@
 @property (nonatomic, assign) BOOL usesKHRLights;
 @property (nonatomic, assign) BOOL usesKHRTextureTransform;
 @property (nonatomic, assign) BOOL usesKHRMaterialsUnlit;
+@property (nonatomic, assign) BOOL usesMSFTLOD;
 @end
 
+static const uint64_t GLTFHashSeed = 0xcbf29ce484222325ULL;
+
+// FNV-1a, which is plenty for bucketing candidates that are compared exactly afterward
+static uint64_t GLTFHashBytes(uint64_t hash, const void *bytes, size_t length) {
+    const uint8_t *p = bytes;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static id GLTFRepresentative(NSMapTable *representatives, id object) {
+    if (object == nil) {
+        return nil;
+    }
+    return [representatives objectForKey:object] ?: object;
+}
+
+// Maps each object that is equal to an earlier object in the array to the earliest such object.
+// Objects are only compared when their hashes match.
+static NSMapTable *GLTFRepresentativesForObjects(NSArray *objects, const uint64_t *hashes, BOOL (^isEqual)(NSUInteger, NSUInteger)) {
+    NSMapTable *representatives = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsObjectPointerPersonality
+                                                         valueOptions:NSPointerFunctionsObjectPointerPersonality];
+    NSMutableDictionary<NSNumber *, NSMutableArray<NSNumber *> *> *buckets = [NSMutableDictionary dictionary];
+    for (NSUInteger index = 0; index < objects.count; ++index) {
+        NSNumber *key = @(hashes[index]);
+        NSMutableArray<NSNumber *> *bucket = buckets[key];
+        if (bucket == nil) {
+            buckets[key] = [NSMutableArray arrayWithObject:@(index)];
+            continue;
+        }
+        BOOL merged = NO;
+        for (NSNumber *candidateIndex in bucket) {
+            if (isEqual(candidateIndex.unsignedIntegerValue, index)) {
+                [representatives setObject:objects[candidateIndex.unsignedIntegerValue] forKey:objects[index]];
+                merged = YES;
+                break;
+            }
+        }
+        if (!merged) {
+            [bucket addObject:@(index)];
+        }
+    }
+    return representatives;
+}
+
+static NSArray *GLTFObjectsInTable(NSArray *objects, NSHashTable *table) {
+    NSMutableArray *filtered = [NSMutableArray arrayWithCapacity:objects.count];
+    for (id object in objects) {
+        if ([table containsObject:object]) {
+            [filtered addObject:object];
+        }
+    }
+    return filtered;
+}
+
+static NSDictionary *GLTFRemappedAccessors(NSDictionary<NSString *, GLTFAccessor *> *accessors, NSMapTable *representatives) {
+    NSMutableDictionary *remapped = [NSMutableDictionary dictionaryWithCapacity:accessors.count];
+    [accessors enumerateKeysAndObjectsUsingBlock:^(NSString *name, GLTFAccessor *accessor, BOOL *stop) {
+        remapped[name] = GLTFRepresentative(representatives, accessor);
+    }];
+    return remapped;
+}
+
+static BOOL GLTFPropertiesEqual(NSDictionary *a, NSDictionary *b) {
+    return (a.count == 0 && b.count == 0) || [a isEqualToDictionary:b];
+}
+
+static uint64_t GLTFAccessorHash(GLTFAccessor *accessor) {
+    int64_t header[4] = { accessor.componentType, accessor.dimension, accessor.normalized, accessor.count };
+    uint64_t hash = GLTFHashBytes(GLTFHashSeed, header, sizeof(header));
+    const uint8_t *contents = accessor.contents;
+    if (contents == NULL) {
+        return hash;
+    }
+    size_t elementSize = GLTFSizeOfComponentTypeWithDimension(accessor.componentType, accessor.dimension);
+    NSInteger stride = accessor.elementStride;
+    if (stride == (NSInteger)elementSize) {
+        return GLTFHashBytes(hash, contents, elementSize * accessor.count);
+    }
+    for (NSInteger i = 0; i < accessor.count; ++i) {
+        hash = GLTFHashBytes(hash, contents + i * stride, elementSize);
+    }
+    return hash;
+}
+
+static BOOL GLTFAccessorsEqual(GLTFAccessor *a, GLTFAccessor *b) {
+    if (a.componentType != b.componentType || a.dimension != b.dimension ||
+        a.normalized != b.normalized || a.count != b.count)
+    {
+        return NO;
+    }
+    const uint8_t *aContents = a.contents;
+    const uint8_t *bContents = b.contents;
+    if (aContents == NULL || bContents == NULL) {
+        return NO;
+    }
+    size_t elementSize = GLTFSizeOfComponentTypeWithDimension(a.componentType, a.dimension);
+    NSInteger aStride = a.elementStride, bStride = b.elementStride;
+    if (aStride == (NSInteger)elementSize && bStride == (NSInteger)elementSize) {
+        return memcmp(aContents, bContents, elementSize * a.count) == 0;
+    }
+    for (NSInteger i = 0; i < a.count; ++i) {
+        if (memcmp(aContents + i * aStride, bContents + i * bStride, elementSize) != 0) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+static BOOL GLTFTextureInfosEqual(GLTFTextureInfo *a, GLTFTextureInfo *b) {
+    if (a == nil || b == nil) {
+        return a == b;
+    }
+    return (a.texture == b.texture) && (a.texCoord == b.texCoord) &&
+           simd_equal(a.transform.offset, b.transform.offset) &&
+           simd_equal(a.transform.scale, b.transform.scale) &&
+           (a.transform.rotation == b.transform.rotation) &&
+           GLTFPropertiesEqual(a.extensions, b.extensions) && GLTFPropertiesEqual(a.extras, b.extras);
+}
+
+static NSArray<GLTFTextureInfo *> *GLTFTextureInfosForMaterial(GLTFMaterial *material) {
+    NSMutableArray *textureInfos = [NSMutableArray arrayWithCapacity:5];
+    if (material.baseColorTexture) { [textureInfos addObject:material.baseColorTexture]; }
+    if (material.metallicRoughnessTexture) { [textureInfos addObject:material.metallicRoughnessTexture]; }
+    if (material.normalTexture) { [textureInfos addObject:material.normalTexture]; }
+    if (material.emissiveTexture) { [textureInfos addObject:material.emissiveTexture]; }
+    if (material.occlusionTexture) { [textureInfos addObject:material.occlusionTexture]; }
+    return textureInfos;
+}
+
+static uint64_t GLTFMaterialHash(GLTFMaterial *material) {
+    float factors[6] = {
+        material.baseColorFactor.x, material.baseColorFactor.y, material.baseColorFactor.z, material.baseColorFactor.w,
+        material.metalnessFactor, material.roughnessFactor
+    };
+    uintptr_t textures[3] = {
+        (uintptr_t)(__bridge void *)material.baseColorTexture.texture,
+        (uintptr_t)(__bridge void *)material.normalTexture.texture,
+        (uintptr_t)material.alphaMode
+    };
+    uint64_t hash = GLTFHashBytes(GLTFHashSeed, factors, sizeof(factors));
+    return GLTFHashBytes(hash, textures, sizeof(textures));
+}
+
+static BOOL GLTFMaterialsEqual(GLTFMaterial *a, GLTFMaterial *b) {
+    return simd_equal(a.baseColorFactor, b.baseColorFactor) &&
+           (a.metalnessFactor == b.metalnessFactor) &&
+           (a.roughnessFactor == b.roughnessFactor) &&
+           (a.normalTextureScale == b.normalTextureScale) &&
+           (a.occlusionStrength == b.occlusionStrength) &&
+           simd_equal(a.emissiveFactor, b.emissiveFactor) &&
+           (a.glossinessFactor == b.glossinessFactor) &&
+           simd_equal(a.specularFactor, b.specularFactor) &&
+           (a.hasTextureTransforms == b.hasTextureTransforms) &&
+           (a.isDoubleSided == b.isDoubleSided) &&
+           (a.alphaMode == b.alphaMode) &&
+           (a.alphaCutoff == b.alphaCutoff) &&
+           (a.isUnlit == b.isUnlit) &&
+           GLTFTextureInfosEqual(a.baseColorTexture, b.baseColorTexture) &&
+           GLTFTextureInfosEqual(a.metallicRoughnessTexture, b.metallicRoughnessTexture) &&
+           GLTFTextureInfosEqual(a.normalTexture, b.normalTexture) &&
+           GLTFTextureInfosEqual(a.emissiveTexture, b.emissiveTexture) &&
+           GLTFTextureInfosEqual(a.occlusionTexture, b.occlusionTexture) &&
+           GLTFPropertiesEqual(a.extensions, b.extensions) && GLTFPropertiesEqual(a.extras, b.extras);
+}
+
 @implementation GLTFAsset
 
 + (dispatch_queue_t)assetLoaderQueue {
@@ -111,6 +282,450 @@
     [_cameras addObject:camera];
 }
 
+- (void)buildMeshletsWithMaxVertexCount:(NSInteger)maxVertexCount maxTriangleCount:(NSInteger)maxTriangleCount {
+    NSMutableArray<GLTFSubmesh *> *submeshes = [NSMutableArray array];
+    for (GLTFMesh *mesh in _meshes) {
+        [submeshes addObjectsFromArray:mesh.submeshes];
+    }
+    
+    dispatch_apply(submeshes.count, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t index) {
+        GLTFSubmesh *submesh = submeshes[index];
+        submesh.meshlets = [[GLTFMeshletSet alloc] initWithSubmesh:submesh
+                                                    maxVertexCount:maxVertexCount
+                                                  maxTriangleCount:maxTriangleCount];
+    });
+}
+
+- (void)buildLevelsOfDetailWithCount:(NSInteger)levelCount reductionFactor:(float)reductionFactor maxError:(float)maxError {
+    NSMutableArray<GLTFSubmesh *> *submeshes = [NSMutableArray array];
+    for (GLTFMesh *mesh in _meshes) {
+        for (GLTFSubmesh *submesh in mesh.submeshes) {
+            if (submesh.primitiveType == GLTFPrimitiveTypeTriangles && submesh.levelsOfDetail.count == 0) {
+                [submeshes addObject:submesh];
+            }
+        }
+    }
+    
+    // Simplification is independent per submesh, but allocating buffers and mutating the
+    // asset's object lists is not, so we gather the index lists first and publish them afterward.
+    NSMutableArray<NSArray<NSData *> *> *levelIndices = [NSMutableArray arrayWithCapacity:submeshes.count];
+    NSMutableArray<NSArray<NSNumber *> *> *levelErrors = [NSMutableArray arrayWithCapacity:submeshes.count];
+    for (NSUInteger i = 0; i < submeshes.count; ++i) {
+        [levelIndices addObject:@[]];
+        [levelErrors addObject:@[]];
+    }
+    NSLock *resultsLock = [NSLock new];
+    
+    dispatch_apply(submeshes.count, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t submeshIndex) {
+        GLTFSubmesh *submesh = submeshes[submeshIndex];
+        GLTFAccessor *positionAccessor = submesh.accessorsForAttributes[GLTFAttributeSemanticPosition];
+        if (positionAccessor.dimension != GLTFDataDimensionVector3 || positionAccessor.contents == NULL) {
+            return;
+        }
+        
+        size_t vertexCount = positionAccessor.count;
+        float *positions = malloc(sizeof(float) * 3 * vertexCount);
+        [positionAccessor getFloatValues:positions];
+        
+        GLTFAccessor *indexAccessor = submesh.indexAccessor;
+        size_t indexCount = indexAccessor ? indexAccessor.count : vertexCount;
+        uint32_t *indices = malloc(sizeof(uint32_t) * MAX(indexCount, 1));
+        if (indexAccessor != nil) {
+            [indexAccessor getUnsignedIntValues:indices];
+        } else {
+            for (size_t i = 0; i < indexCount; ++i) {
+                indices[i] = (uint32_t)i;
+            }
+        }
+        
+        // Indices come straight from the file, so leave out triangles that reach past the positions;
+        // otherwise the simplifier would drop them from the first level and count that as a reduction.
+        size_t validIndexCount = 0;
+        for (size_t i = 0; i + 2 < indexCount; i += 3) {
+            if (indices[i] < vertexCount && indices[i + 1] < vertexCount && indices[i + 2] < vertexCount) {
+                memmove(indices + validIndexCount, indices + i, sizeof(uint32_t) * 3);
+                validIndexCount += 3;
+            }
+        }
+        indexCount = validIndexCount;
+        
+        // Accessor min and max are optional, so measure the positions the same way the simplifier does
+        float extent = GLTFSimplifierExtent(positions, vertexCount);
+        
+        NSMutableArray *indexData = [NSMutableArray array];
+        NSMutableArray *errors = [NSMutableArray array];
+        uint32_t *simplifiedIndices = malloc(sizeof(uint32_t) * MAX(indexCount, 1));
+        size_t previousIndexCount = indexCount;
+        float targetRatio = 1;
+        float accumulatedError = 0;
+        for (NSInteger level = 0; level < levelCount; ++level) {
+            // Each level is simplified from the one before it, so its error relative to the full-detail
+            // mesh is bounded by the sum of the steps, and maxError limits that sum rather than each step.
+            float remainingError = maxError - accumulatedError;
+            if (remainingError <= 0) {
+                break;
+            }
+            targetRatio *= reductionFactor;
+            size_t targetIndexCount = (size_t)(indexCount * targetRatio) / 3 * 3;
+            float error = 0;
+            size_t simplifiedCount = GLTFSimplifyTriangles(simplifiedIndices, indices, previousIndexCount,
+                                                           positions, vertexCount, targetIndexCount, remainingError, &error);
+            if (simplifiedCount == 0 || simplifiedCount >= previousIndexCount) {
+                break;
+            }
+            accumulatedError += error;
+            [indexData addObject:[NSData dataWithBytes:simplifiedIndices length:sizeof(uint32_t) * simplifiedCount]];
+            [errors addObject:@(accumulatedError * extent)];
+            memcpy(indices, simplifiedIndices, sizeof(uint32_t) * simplifiedCount);
+            previousIndexCount = simplifiedCount;
+        }
+        
+        free(simplifiedIndices);
+        free(indices);
+        free(positions);
+        
+        [resultsLock lock];
+        levelIndices[submeshIndex] = indexData;
+        levelErrors[submeshIndex] = errors;
+        [resultsLock unlock];
+    });
+    
+    NSMutableArray *buffers = [_buffers mutableCopy];
+    NSMutableArray *bufferViews = [_bufferViews mutableCopy];
+    NSMutableArray *accessors = [_accessors mutableCopy];
+    
+    [submeshes enumerateObjectsUsingBlock:^(GLTFSubmesh *submesh, NSUInteger submeshIndex, BOOL *stop) {
+        NSArray<NSData *> *levels = levelIndices[submeshIndex];
+        if (levels.count == 0) {
+            return;
+        }
+        
+        GLTFAccessor *positionAccessor = submesh.accessorsForAttributes[GLTFAttributeSemanticPosition];
+        BOOL useShortIndices = positionAccessor.count <= UINT16_MAX;
+        size_t indexSize = useShortIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+        
+        // All levels share a single buffer, each occupying its own index range
+        size_t totalIndexCount = 0;
+        for (NSData *data in levels) {
+            totalIndexCount += data.length / sizeof(uint32_t);
+        }
+        id<GLTFBuffer> buffer = [_bufferAllocator newBufferWithLength:totalIndexCount * indexSize];
+        [buffers addObject:buffer];
+        
+        GLTFBufferView *bufferView = [GLTFBufferView new];
+        bufferView.buffer = buffer;
+        bufferView.length = totalIndexCount * indexSize;
+        bufferView.offset = 0;
+        bufferView.stride = 0;
+        bufferView.target = GLTFTargetElementArrayBuffer;
+        [bufferViews addObject:bufferView];
+        
+        NSMutableArray *levelsOfDetail = [NSMutableArray arrayWithCapacity:levels.count];
+        size_t indexOffset = 0;
+        for (NSUInteger level = 0; level < levels.count; ++level) {
+            NSData *data = levels[level];
+            const uint32_t *source = data.bytes;
+            size_t count = data.length / sizeof(uint32_t);
+            if (useShortIndices) {
+                uint16_t *destination = (uint16_t *)buffer.contents + indexOffset;
+                for (size_t i = 0; i < count; ++i) {
+                    destination[i] = (uint16_t)source[i];
+                }
+            } else {
+                memcpy((uint32_t *)buffer.contents + indexOffset, source, data.length);
+            }
+            
+            GLTFAccessor *accessor = [GLTFAccessor new];
+            accessor.bufferView = bufferView;
+            accessor.componentType = useShortIndices ? GLTFDataTypeUShort : GLTFDataTypeUInt;
+            accessor.dimension = GLTFDataDimensionScalar;
+            accessor.offset = indexOffset * indexSize;
+            accessor.count = count;
+            [accessors addObject:accessor];
+            
+            GLTFLevelOfDetail *levelOfDetail = [GLTFLevelOfDetail new];
+            levelOfDetail.indexAccessor = accessor;
+            levelOfDetail.error = levelErrors[submeshIndex][level].floatValue;
+            [levelsOfDetail addObject:levelOfDetail];
+            
+            indexOffset += count;
+        }
+        submesh.levelsOfDetail = levelsOfDetail;
+    }];
+    
+    _buffers = [buffers copy];
+    _bufferViews = [bufferViews copy];
+    _accessors = [accessors copy];
+}
+
+- (NSData *)_contentsOfImage:(GLTFImage *)image {
+    if (image.imageData.length > 0) {
+        return image.imageData;
+    }
+    GLTFBufferView *bufferView = image.bufferView;
+    if (bufferView.buffer != nil) {
+        return [NSData dataWithBytesNoCopy:bufferView.buffer.contents + bufferView.offset length:bufferView.length freeWhenDone:NO];
+    }
+    if (image.url.isFileURL) {
+        return [NSData dataWithContentsOfURL:image.url options:NSDataReadingMappedIfSafe error:nil];
+    }
+    return nil;
+}
+
+- (GLTFAssetCompactionStatistics)removeUnusedAndDuplicateObjects {
+    GLTFAssetCompactionStatistics statistics = { 0 };
+    dispatch_queue_t hashQueue = dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0);
+    
+    // Samplers
+    
+    NSArray<GLTFTextureSampler *> *samplers = _samplers;
+    uint64_t *samplerHashes = malloc(sizeof(uint64_t) * MAX(samplers.count, 1));
+    for (NSUInteger i = 0; i < samplers.count; ++i) {
+        samplerHashes[i] = samplers[i].hash;
+    }
+    NSMapTable *samplerRepresentatives = GLTFRepresentativesForObjects(samplers, samplerHashes, ^BOOL(NSUInteger a, NSUInteger b) {
+        return [samplers[a] isEqual:samplers[b]];
+    });
+    free(samplerHashes);
+    statistics.mergedSamplerCount = samplerRepresentatives.count;
+    
+    // Images, which may be identical even when they come from different URIs or buffer views
+    
+    NSArray<GLTFImage *> *images = _images;
+    NSMutableArray *imageContents = [NSMutableArray arrayWithCapacity:images.count];
+    for (NSUInteger i = 0; i < images.count; ++i) {
+        [imageContents addObject:[NSNull null]];
+    }
+    NSLock *imageContentsLock = [NSLock new];
+    uint64_t *imageHashes = malloc(sizeof(uint64_t) * MAX(images.count, 1));
+    dispatch_apply(images.count, hashQueue, ^(size_t index) {
+        NSData *data = [self _contentsOfImage:images[index]];
+        imageHashes[index] = GLTFHashBytes(GLTFHashSeed, data.bytes, data.length);
+        if (data != nil) {
+            [imageContentsLock lock];
+            imageContents[index] = data;
+            [imageContentsLock unlock];
+        }
+    });
+    NSMapTable *imageRepresentatives = GLTFRepresentativesForObjects(images, imageHashes, ^BOOL(NSUInteger a, NSUInteger b) {
+        if (imageContents[a] == [NSNull null] || imageContents[b] == [NSNull null]) {
+            return NO;
+        }
+        NSString *aType = images[a].mimeType, *bType = images[b].mimeType;
+        return (aType == bType || [aType isEqualToString:bType]) && [imageContents[a] isEqualToData:imageContents[b]];
+    });
+    free(imageHashes);
+    statistics.mergedImageCount = imageRepresentatives.count;
+    for (GLTFImage *image in imageRepresentatives.keyEnumerator) {
+        statistics.duplicateByteCount += [imageContents[[images indexOfObjectIdenticalTo:image]] length];
+    }
+    
+    // Textures, which are only identical once their images and samplers have been merged
+    
+    for (GLTFTexture *texture in _textures) {
+        texture.image = GLTFRepresentative(imageRepresentatives, texture.image);
+        texture.sampler = GLTFRepresentative(samplerRepresentatives, texture.sampler);
+    }
+    
+    NSArray<GLTFTexture *> *textures = _textures;
+    uint64_t *textureHashes = malloc(sizeof(uint64_t) * MAX(textures.count, 1));
+    for (NSUInteger i = 0; i < textures.count; ++i) {
+        uintptr_t references[2] = { (uintptr_t)(__bridge void *)textures[i].image, (uintptr_t)(__bridge void *)textures[i].sampler };
+        textureHashes[i] = GLTFHashBytes(GLTFHashSeed, references, sizeof(references));
+    }
+    NSMapTable *textureRepresentatives = GLTFRepresentativesForObjects(textures, textureHashes, ^BOOL(NSUInteger a, NSUInteger b) {
+        GLTFTexture *x = textures[a], *y = textures[b];
+        return (x.image == y.image) && (x.sampler == y.sampler) && (x.format == y.format) &&
+               (x.internalFormat == y.internalFormat) && (x.type == y.type) && (x.target == y.target) &&
+               GLTFPropertiesEqual(x.extensions, y.extensions);
+    });
+    free(textureHashes);
+    statistics.mergedTextureCount = textureRepresentatives.count;
+    
+    // Materials
+    
+    for (GLTFMaterial *material in _materials) {
+        for (GLTFTextureInfo *textureInfo in GLTFTextureInfosForMaterial(material)) {
+            textureInfo.texture = GLTFRepresentative(textureRepresentatives, textureInfo.texture);
+        }
+    }
+    
+    NSArray<GLTFMaterial *> *materials = _materials;
+    uint64_t *materialHashes = malloc(sizeof(uint64_t) * MAX(materials.count, 1));
+    for (NSUInteger i = 0; i < materials.count; ++i) {
+        materialHashes[i] = GLTFMaterialHash(materials[i]);
+    }
+    NSMapTable *materialRepresentatives = GLTFRepresentativesForObjects(materials, materialHashes, ^BOOL(NSUInteger a, NSUInteger b) {
+        return GLTFMaterialsEqual(materials[a], materials[b]);
+    });
+    free(materialHashes);
+    statistics.mergedMaterialCount = materialRepresentatives.count;
+    
+    // Accessors, which are compared by their element contents rather than by where they live
+    
+    NSArray<GLTFAccessor *> *accessors = _accessors;
+    uint64_t *accessorHashes = malloc(sizeof(uint64_t) * MAX(accessors.count, 1));
+    dispatch_apply(accessors.count, hashQueue, ^(size_t index) {
+        accessorHashes[index] = GLTFAccessorHash(accessors[index]);
+    });
+    NSMapTable *accessorRepresentatives = GLTFRepresentativesForObjects(accessors, accessorHashes, ^BOOL(NSUInteger a, NSUInteger b) {
+        return GLTFAccessorsEqual(accessors[a], accessors[b]);
+    });
+    free(accessorHashes);
+    statistics.mergedAccessorCount = accessorRepresentatives.count;
+    for (GLTFAccessor *accessor in accessorRepresentatives.keyEnumerator) {
+        statistics.duplicateByteCount += accessor.count * GLTFSizeOfComponentTypeWithDimension(accessor.componentType, accessor.dimension);
+    }
+    
+    for (GLTFMesh *mesh in _meshes) {
+        for (GLTFSubmesh *submesh in mesh.submeshes) {
+            submesh.material = GLTFRepresentative(materialRepresentatives, submesh.material);
+            if (accessorRepresentatives.count == 0) {
+                continue;
+            }
+            submesh.accessorsForAttributes = GLTFRemappedAccessors(submesh.accessorsForAttributes, accessorRepresentatives);
+            submesh.indexAccessor = GLTFRepresentative(accessorRepresentatives, submesh.indexAccessor);
+            for (GLTFMorphTarget *target in submesh.morphTargets) {
+                target.accessorsForAttributes = GLTFRemappedAccessors(target.accessorsForAttributes, accessorRepresentatives);
+            }
+            for (GLTFLevelOfDetail *levelOfDetail in submesh.levelsOfDetail) {
+                levelOfDetail.indexAccessor = GLTFRepresentative(accessorRepresentatives, levelOfDetail.indexAccessor);
+            }
+        }
+    }
+    for (GLTFSkin *skin in _skins) {
+        skin.inverseBindMatricesAccessor = GLTFRepresentative(accessorRepresentatives, skin.inverseBindMatricesAccessor);
+    }
+    for (GLTFAnimation *animation in _animations) {
+        for (GLTFAnimationSampler *sampler in animation.samplers) {
+            sampler.inputAccessor = GLTFRepresentative(accessorRepresentatives, sampler.inputAccessor);
+            sampler.outputAccessor = GLTFRepresentative(accessorRepresentatives, sampler.outputAccessor);
+        }
+        [animation setNeedsCompile];
+    }
+    
+    // Now that every reference points at a representative, walk the graph from the nodes,
+    // skins and animations and keep only what is reachable.
+    
+    NSPointerFunctionsOptions options = NSPointerFunctionsObjectPointerPersonality;
+    NSHashTable *usedMeshes = [NSHashTable hashTableWithOptions:options];
+    NSHashTable *usedMaterials = [NSHashTable hashTableWithOptions:options];
+    NSHashTable *usedTextures = [NSHashTable hashTableWithOptions:options];
+    NSHashTable *usedImages = [NSHashTable hashTableWithOptions:options];
+    NSHashTable *usedSamplers = [NSHashTable hashTableWithOptions:options];
+    NSHashTable *usedAccessors = [NSHashTable hashTableWithOptions:options];
+    NSHashTable *usedBufferViews = [NSHashTable hashTableWithOptions:options];
+    NSHashTable *usedBuffers = [NSHashTable hashTableWithOptions:options];
+    
+    for (GLTFNode *node in _nodes) {
+        if (node.mesh != nil) {
+            [usedMeshes addObject:node.mesh];
+        }
+    }
+    for (GLTFMesh *mesh in usedMeshes) {
+        for (GLTFSubmesh *submesh in mesh.submeshes) {
+            if (submesh.material != nil) {
+                [usedMaterials addObject:submesh.material];
+            }
+            for (GLTFAccessor *accessor in submesh.accessorsForAttributes.allValues) {
+                [usedAccessors addObject:accessor];
+            }
+            if (submesh.indexAccessor != nil) {
+                [usedAccessors addObject:submesh.indexAccessor];
+            }
+            for (GLTFMorphTarget *target in submesh.morphTargets) {
+                for (GLTFAccessor *accessor in target.accessorsForAttributes.allValues) {
+                    [usedAccessors addObject:accessor];
+                }
+            }
+            for (GLTFLevelOfDetail *levelOfDetail in submesh.levelsOfDetail) {
+                [usedAccessors addObject:levelOfDetail.indexAccessor];
+            }
+        }
+    }
+    for (GLTFSkin *skin in _skins) {
+        if (skin.inverseBindMatricesAccessor != nil) {
+            [usedAccessors addObject:skin.inverseBindMatricesAccessor];
+        }
+    }
+    for (GLTFAnimation *animation in _animations) {
+        for (GLTFAnimationSampler *sampler in animation.samplers) {
+            if (sampler.inputAccessor != nil) {
+                [usedAccessors addObject:sampler.inputAccessor];
+            }
+            if (sampler.outputAccessor != nil) {
+                [usedAccessors addObject:sampler.outputAccessor];
+            }
+        }
+    }
+    for (GLTFMaterial *material in usedMaterials) {
+        for (GLTFTextureInfo *textureInfo in GLTFTextureInfosForMaterial(material)) {
+            if (textureInfo.texture != nil) {
+                [usedTextures addObject:textureInfo.texture];
+            }
+        }
+    }
+    for (GLTFTexture *texture in usedTextures) {
+        if (texture.image != nil) {
+            [usedImages addObject:texture.image];
+        }
+        if (texture.sampler != nil) {
+            [usedSamplers addObject:texture.sampler];
+        }
+    }
+    for (GLTFAccessor *accessor in usedAccessors) {
+        if (accessor.bufferView != nil) {
+            [usedBufferViews addObject:accessor.bufferView];
+        }
+    }
+    for (GLTFImage *image in usedImages) {
+        if (image.bufferView != nil) {
+            [usedBufferViews addObject:image.bufferView];
+        }
+    }
+    for (GLTFBufferView *bufferView in usedBufferViews) {
+        if (bufferView.buffer != nil) {
+            [usedBuffers addObject:bufferView.buffer];
+        }
+    }
+    
+    for (id<GLTFBuffer> buffer in _buffers) {
+        if (![usedBuffers containsObject:buffer]) {
+            statistics.reclaimedBufferByteCount += buffer.length;
+        }
+    }
+    
+    NSArray *remainingMeshes = GLTFObjectsInTable(_meshes, usedMeshes);
+    NSArray *remainingMaterials = GLTFObjectsInTable(_materials, usedMaterials);
+    NSArray *remainingTextures = GLTFObjectsInTable(_textures, usedTextures);
+    NSArray *remainingImages = GLTFObjectsInTable(_images, usedImages);
+    NSArray *remainingSamplers = GLTFObjectsInTable(_samplers, usedSamplers);
+    NSArray *remainingAccessors = GLTFObjectsInTable(_accessors, usedAccessors);
+    NSArray *remainingBufferViews = GLTFObjectsInTable(_bufferViews, usedBufferViews);
+    NSArray *remainingBuffers = GLTFObjectsInTable(_buffers, usedBuffers);
+    
+    // Merged duplicates are unreachable by now, so they are excluded from the removal counts
+    statistics.removedMeshCount = _meshes.count - remainingMeshes.count;
+    statistics.removedMaterialCount = _materials.count - remainingMaterials.count - statistics.mergedMaterialCount;
+    statistics.removedTextureCount = _textures.count - remainingTextures.count - statistics.mergedTextureCount;
+    statistics.removedImageCount = _images.count - remainingImages.count - statistics.mergedImageCount;
+    statistics.removedSamplerCount = _samplers.count - remainingSamplers.count - statistics.mergedSamplerCount;
+    statistics.removedAccessorCount = _accessors.count - remainingAccessors.count - statistics.mergedAccessorCount;
+    statistics.removedBufferViewCount = _bufferViews.count - remainingBufferViews.count;
+    statistics.removedBufferCount = _buffers.count - remainingBuffers.count;
+    
+    _meshes = remainingMeshes;
+    _materials = remainingMaterials;
+    _textures = remainingTextures;
+    _images = remainingImages;
+    _samplers = remainingSamplers;
+    _accessors = remainingAccessors;
+    _bufferViews = remainingBufferViews;
+    _buffers = remainingBuffers;
+    
+    return statistics;
+}
+
 - (NSData *)imageDataForDataURI:(NSString *)uriData {
     NSString *prefix = @"data:";
     if ([uriData hasPrefix:prefix]) {
@@ -231,6 +846,8 @@
             _usesKHRMaterialsUnlit = YES;
         } else if ([extension isEqualToString:GLTFExtensionKHRTextureTransform]) {
             _usesKHRTextureTransform = YES;
+        } else if ([extension isEqualToString:GLTFExtensionMSFTLOD]) {
+            _usesMSFTLOD = YES;
         } else {
             NSLog(@"WARNING: Unsupported extension \"%@\" used", extension);
         }
@@ -347,6 +964,7 @@
     accessor.dimension = GLTFDataDimensionForName(properties[@"type"]);
     accessor.offset = [properties[@"byteOffset"] integerValue];
     accessor.count = [properties[@"count"] integerValue];
+    accessor.normalized = [properties[@"normalized"] boolValue];
     NSUInteger bufferViewIndex = [properties[@"bufferView"] intValue];
     BOOL isSparse = properties[@"sparse"] != nil;
     [self considerToCreateNewBufferView:accessor currentBufferViewIndex:bufferViewIndex force:isSparse];
@@ -728,15 +1346,17 @@
 
             submesh.accessorsForAttributes = attributeAccessors;
             
-            NSUInteger materialIndex = [submeshProperties[@"material"] intValue];
-            if (materialIndex < _materials.count) {
+            NSNumber *materialIndexValue = submeshProperties[@"material"];
+            NSUInteger materialIndex = materialIndexValue.unsignedIntegerValue;
+            if (materialIndexValue != nil && materialIndex < _materials.count) {
                 submesh.material = _materials[materialIndex];
             } else {
                 submesh.material = _defaultMaterial;
             }
             
-            NSUInteger indexAccessorIndex = [submeshProperties[@"indices"] intValue];
-            if (indexAccessorIndex < _accessors.count) {
+            NSNumber *indexAccessorIndexValue = submeshProperties[@"indices"];
+            NSUInteger indexAccessorIndex = indexAccessorIndexValue.unsignedIntegerValue;
+            if (indexAccessorIndexValue != nil && indexAccessorIndex < _accessors.count) {
                 GLTFAccessor *indexAccessor = _accessors[indexAccessorIndex];
                 if (indexAccessor.componentType == GLTFTextureTypeUChar) {
                     // Fix up 8-bit indices, since they're unsupported in modern APIs
@@ -1142,6 +1762,19 @@
             }
         }
         
+        if (_usesMSFTLOD) {
+            NSDictionary *lodProperties = node.extensions[GLTFExtensionMSFTLOD];
+            NSArray *lodIdentifiers = lodProperties[@"ids"];
+            if (lodIdentifiers.count > 0) {
+                // As with children, these are indices until fixNodeRelationships resolves them.
+                node.levelOfDetailNodes = [lodIdentifiers copy];
+                NSArray *screenCoverages = node.extras[@"MSFT_screencoverage"];
+                if ([screenCoverages isKindOfClass:[NSArray class]]) {
+                    node.levelOfDetailScreenCoverages = [screenCoverages copy];
+                }
+            }
+        }
+        
         [nodes addObject: node];
     }
 
@@ -1163,6 +1796,17 @@
             }
         }
         node.children = children;
+        
+        if (node.levelOfDetailNodes.count > 0) {
+            NSMutableArray *levelOfDetailNodes = [NSMutableArray arrayWithCapacity:node.levelOfDetailNodes.count];
+            for (NSNumber *lodIndexValue in node.levelOfDetailNodes) {
+                NSUInteger lodIndex = lodIndexValue.integerValue;
+                if (lodIndex < _nodes.count) {
+                    [levelOfDetailNodes addObject:_nodes[lodIndex]];
+                }
+            }
+            node.levelOfDetailNodes = levelOfDetailNodes;
+        }
     }
     
     for (GLTFSkin *skin in _skins) {
@@ -0,0 +1,803 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+#import "GLTFAssetWriter.h"
+#import "GLTFAsset.h"
+#import "GLTFAccessor.h"
+#import "GLTFAnimation.h"
+#import "GLTFBinaryChunk.h"
+#import "GLTFBuffer.h"
+#import "GLTFBufferView.h"
+#import "GLTFCamera.h"
+#import "GLTFExtensionNames.h"
+#import "GLTFImage.h"
+#import "GLTFKHRLight.h"
+#import "GLTFMaterial.h"
+#import "GLTFMesh.h"
+#import "GLTFNode.h"
+#import "GLTFScene.h"
+#import "GLTFSkin.h"
+#import "GLTFTexture.h"
+#import "GLTFTextureSampler.h"
+#import "GLTFUtilities.h"
+
+@import simd;
+
+static const NSUInteger GLTFBufferViewAlignment = 16;
+
+static NSString *GLTFNameForDataDimension(GLTFDataDimension dimension) {
+    switch (dimension) {
+        case GLTFDataDimensionScalar:    return @"SCALAR";
+        case GLTFDataDimensionVector2:   return @"VEC2";
+        case GLTFDataDimensionVector3:   return @"VEC3";
+        case GLTFDataDimensionVector4:   return @"VEC4";
+        case GLTFDataDimensionMatrix2x2: return @"MAT2";
+        case GLTFDataDimensionMatrix3x3: return @"MAT3";
+        case GLTFDataDimensionMatrix4x4: return @"MAT4";
+        default:                         return @"SCALAR";
+    }
+}
+
+static NSString *GLTFNameForInterpolationMode(GLTFInterpolationMode mode) {
+    switch (mode) {
+        case GLTFInterpolationModeStep:  return @"STEP";
+        case GLTFInterpolationModeCubic: return @"CUBICSPLINE";
+        default:                         return @"LINEAR";
+    }
+}
+
+static NSString *GLTFNameForAlphaMode(GLTFAlphaMode mode) {
+    switch (mode) {
+        case GLTFAlphaModeMask:  return @"MASK";
+        case GLTFAlphaModeBlend: return @"BLEND";
+        default:                 return @"OPAQUE";
+    }
+}
+
+static NSString *GLTFNameForLightType(GLTFKHRLightType type) {
+    switch (type) {
+        case GLTFKHRLightTypeAmbient:     return @"ambient";
+        case GLTFKHRLightTypeDirectional: return @"directional";
+        case GLTFKHRLightTypeSpot:        return @"spot";
+        default:                          return @"point";
+    }
+}
+
+static NSArray *GLTFArrayFromFloats(const float *values, NSInteger count) {
+    NSMutableArray *array = [NSMutableArray arrayWithCapacity:count];
+    for (NSInteger i = 0; i < count; ++i) {
+        [array addObject:@(values[i])];
+    }
+    return array;
+}
+
+static NSArray *GLTFArrayFromVector2(simd_float2 v) {
+    return @[ @(v.x), @(v.y) ];
+}
+
+static NSArray *GLTFArrayFromVector3(simd_float3 v) {
+    return @[ @(v.x), @(v.y), @(v.z) ];
+}
+
+static NSArray *GLTFArrayFromVector4(simd_float4 v) {
+    return @[ @(v.x), @(v.y), @(v.z), @(v.w) ];
+}
+
+static NSArray *GLTFArrayFromMatrix4x4(simd_float4x4 m) {
+    NSMutableArray *array = [NSMutableArray arrayWithCapacity:16];
+    for (int c = 0; c < 4; ++c) {
+        for (int r = 0; r < 4; ++r) {
+            [array addObject:@(m.columns[c][r])];
+        }
+    }
+    return array;
+}
+
+static NSString *GLTFMIMETypeForImageData(NSData *data) {
+    const uint8_t *bytes = data.bytes;
+    if (data.length >= 4 && bytes[0] == 0x89 && bytes[1] == 'P' && bytes[2] == 'N' && bytes[3] == 'G') {
+        return @"image/png";
+    } else if (data.length >= 2 && bytes[0] == 0xFF && bytes[1] == 0xD8) {
+        return @"image/jpeg";
+    }
+    return nil;
+}
+
+@interface GLTFAssetWriter ()
+@property (nonatomic, strong) GLTFAsset *asset;
+@property (nonatomic, strong) NSMutableData *binaryData;
+@property (nonatomic, strong) NSMutableArray *bufferViews;
+@property (nonatomic, strong) NSMutableArray *accessors;
+@property (nonatomic, strong) NSMutableArray *images;
+@property (nonatomic, strong) NSMutableArray *samplers;
+@property (nonatomic, strong) NSMutableArray *textures;
+@property (nonatomic, strong) NSMutableArray *materials;
+@property (nonatomic, strong) NSMutableArray *meshes;
+@property (nonatomic, strong) NSMutableArray *skins;
+@property (nonatomic, strong) NSMutableArray *cameras;
+@property (nonatomic, strong) NSMutableArray *lights;
+@property (nonatomic, strong) NSMutableArray<GLTFNode *> *nodes;
+@property (nonatomic, strong) NSMapTable *indicesForObjects;
+@end
+
+@implementation GLTFAssetWriter
+
+- (instancetype)initWithAsset:(GLTFAsset *)asset {
+    if ((self = [super init])) {
+        _asset = asset;
+    }
+    return self;
+}
+
+- (BOOL)writeBinaryToURL:(NSURL *)url error:(NSError **)error {
+    NSData *data = [self binaryDataWithError:error];
+    if (data == nil) {
+        return NO;
+    }
+    return [data writeToURL:url options:NSDataWritingAtomic error:error];
+}
+
+- (NSData *)binaryDataWithError:(NSError **)error {
+    _binaryData = [NSMutableData data];
+    _bufferViews = [NSMutableArray array];
+    _accessors = [NSMutableArray array];
+    _images = [NSMutableArray array];
+    _samplers = [NSMutableArray array];
+    _textures = [NSMutableArray array];
+    _materials = [NSMutableArray array];
+    _meshes = [NSMutableArray array];
+    _skins = [NSMutableArray array];
+    _cameras = [NSMutableArray array];
+    _lights = [NSMutableArray array];
+    _nodes = [NSMutableArray array];
+    // Every kind of object lives in the same table; an object only ever appears in one list
+    _indicesForObjects = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsObjectPointerPersonality
+                                               valueOptions:NSPointerFunctionsStrongMemory];
+    
+    NSDictionary *root = [self rootObject];
+    
+    NSData *json = [NSJSONSerialization dataWithJSONObject:root options:0 error:error];
+    if (json == nil) {
+        return nil;
+    }
+    
+    struct {
+        UInt32 length;
+        UInt32 type;
+    } chunkHeader;
+    
+    // Pad the JSON with trailing spaces so that the binary chunk's contents begin on a 16-byte file
+    // offset; the GLB container itself only requires 4-byte alignment.
+    NSUInteger prefixLength = sizeof(GLTFBinaryHeader) + 2 * sizeof(chunkHeader);
+    NSUInteger jsonLength = json.length;
+    while ((prefixLength + jsonLength) % GLTFBufferViewAlignment != 0) {
+        ++jsonLength;
+    }
+    NSUInteger binaryLength = (_binaryData.length + 3) & ~3;
+    
+    GLTFBinaryHeader header;
+    header.magic = GLTFBinaryMagic;
+    header.version = 2;
+    header.length = (UInt32)(sizeof(GLTFBinaryHeader) + sizeof(chunkHeader) + jsonLength +
+                             (binaryLength > 0 ? sizeof(chunkHeader) + binaryLength : 0));
+    
+    NSMutableData *data = [NSMutableData dataWithCapacity:header.length];
+    [data appendBytes:&header length:sizeof(header)];
+    
+    chunkHeader.length = (UInt32)jsonLength;
+    chunkHeader.type = GLTFChunkTypeJSON;
+    [data appendBytes:&chunkHeader length:sizeof(chunkHeader)];
+    [data appendData:json];
+    for (NSUInteger i = json.length; i < jsonLength; ++i) {
+        [data appendBytes:" " length:1];
+    }
+    
+    if (binaryLength > 0) {
+        chunkHeader.length = (UInt32)binaryLength;
+        chunkHeader.type = GLTFChunkTypeBinary;
+        [data appendBytes:&chunkHeader length:sizeof(chunkHeader)];
+        [data appendData:_binaryData];
+        [data increaseLengthBy:binaryLength - _binaryData.length];
+    }
+    
+    return data;
+}
+
+- (NSDictionary *)rootObject {
+    GLTFAsset *asset = self.asset;
+    
+    // Nodes reference each other in arbitrary ways, so they are all assigned indices before
+    // any of them is serialized. Every other kind of object is serialized when first referenced.
+    for (GLTFScene *scene in asset.scenes) {
+        for (GLTFNode *node in scene.nodes) {
+            [self collectNode:node];
+        }
+    }
+    for (GLTFAnimation *animation in asset.animations) {
+        for (GLTFAnimationChannel *channel in animation.channels) {
+            if (channel.targetNode != nil) {
+                [self collectNode:channel.targetNode];
+            }
+        }
+    }
+    
+    NSMutableArray *nodes = [NSMutableArray arrayWithCapacity:_nodes.count];
+    for (GLTFNode *node in _nodes) {
+        [nodes addObject:[self JSONForNode:node]];
+    }
+    
+    NSMutableArray *scenes = [NSMutableArray arrayWithCapacity:asset.scenes.count];
+    for (GLTFScene *scene in asset.scenes) {
+        [scenes addObject:[self JSONForScene:scene]];
+    }
+    
+    NSMutableArray *animations = [NSMutableArray arrayWithCapacity:asset.animations.count];
+    for (GLTFAnimation *animation in asset.animations) {
+        [animations addObject:[self JSONForAnimation:animation]];
+    }
+    
+    NSMutableDictionary *assetProperties = [NSMutableDictionary dictionary];
+    assetProperties[@"version"] = @"2.0";
+    assetProperties[@"generator"] = asset.generator ?: @"GLTFKit";
+    assetProperties[@"copyright"] = asset.copyright;
+    
+    NSMutableDictionary *root = [NSMutableDictionary dictionary];
+    root[@"asset"] = assetProperties;
+    if (asset.extensionsUsed.count > 0) {
+        root[@"extensionsUsed"] = asset.extensionsUsed;
+    }
+    if (asset.defaultScene != nil) {
+        root[@"scene"] = @([asset.scenes indexOfObjectIdenticalTo:asset.defaultScene]);
+    }
+    
+    NSDictionary *lists = @{
+        @"scenes" : scenes,
+        @"nodes" : nodes,
+        @"animations" : animations,
+        @"meshes" : _meshes,
+        @"skins" : _skins,
+        @"cameras" : _cameras,
+        @"materials" : _materials,
+        @"textures" : _textures,
+        @"samplers" : _samplers,
+        @"images" : _images,
+        @"accessors" : _accessors,
+        @"bufferViews" : _bufferViews,
+    };
+    [lists enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSArray *list, BOOL *stop) {
+        if (list.count > 0) {
+            root[key] = list;
+        }
+    }];
+    
+    if (_binaryData.length > 0) {
+        root[@"buffers"] = @[ @{ @"byteLength" : @(_binaryData.length) } ];
+    }
+    
+    if (_lights.count > 0) {
+        root[@"extensions"] = @{ GLTFExtensionKHRLights : @{ @"lights" : _lights } };
+    }
+    
+    return root;
+}
+
+#pragma mark - Object indices
+
+- (NSNumber *)indexForObject:(id)object inList:(NSMutableArray *)list build:(NSDictionary *(^)(void))build {
+    NSNumber *index = [_indicesForObjects objectForKey:object];
+    if (index == nil) {
+        // Building an object only ever references objects of other kinds, so the list can't grow meanwhile
+        NSDictionary *json = build();
+        index = @(list.count);
+        [list addObject:json];
+        [_indicesForObjects setObject:index forKey:object];
+    }
+    return index;
+}
+
+// Extensions are passed through unless the caller has already written its own rewritten copy
+- (void)addCommonPropertiesOfObject:(GLTFObject *)object toJSON:(NSMutableDictionary *)json {
+    if (object.name.length > 0) {
+        json[@"name"] = object.name;
+    }
+    if (object.extras.count > 0) {
+        json[@"extras"] = object.extras;
+    }
+    if (object.extensions.count > 0 && json[@"extensions"] == nil) {
+        json[@"extensions"] = object.extensions;
+    }
+}
+
+- (NSUInteger)appendBinaryDataWithLength:(NSUInteger)length {
+    NSUInteger offset = (_binaryData.length + GLTFBufferViewAlignment - 1) & ~(GLTFBufferViewAlignment - 1);
+    [_binaryData setLength:offset + length];
+    return offset;
+}
+
+- (NSNumber *)addBufferViewWithOffset:(NSUInteger)offset length:(NSUInteger)length stride:(NSUInteger)stride target:(GLTFTarget)target {
+    NSMutableDictionary *json = [NSMutableDictionary dictionary];
+    json[@"buffer"] = @0;
+    json[@"byteOffset"] = @(offset);
+    json[@"byteLength"] = @(length);
+    if (stride > 0) {
+        json[@"byteStride"] = @(stride);
+    }
+    if (target != GLTFTargetUnknown) {
+        json[@"target"] = @(target);
+    }
+    [_bufferViews addObject:json];
+    return @(_bufferViews.count - 1);
+}
+
+#pragma mark - Accessors and images
+
+- (NSNumber *)indexForAccessor:(GLTFAccessor *)accessor target:(GLTFTarget)target {
+    return [self indexForObject:accessor inList:_accessors build:^NSDictionary *{
+        GLTFDataType componentType = accessor.componentType;
+        BOOL widenIndices = (target == GLTFTargetElementArrayBuffer) && (componentType == GLTFDataTypeUChar);
+        if (widenIndices) {
+            componentType = GLTFDataTypeUShort;
+        }
+        size_t sourceElementSize = GLTFSizeOfComponentTypeWithDimension(accessor.componentType, accessor.dimension);
+        size_t elementSize = GLTFSizeOfComponentTypeWithDimension(componentType, accessor.dimension);
+        // Vertex attribute elements must start on 4-byte boundaries
+        size_t stride = (target == GLTFTargetArrayBuffer) ? ((elementSize + 3) & ~3) : elementSize;
+        NSUInteger length = MAX(stride * accessor.count, 1);
+        
+        NSUInteger offset = [self appendBinaryDataWithLength:length];
+        uint8_t *destination = (uint8_t *)_binaryData.mutableBytes + offset;
+        const uint8_t *source = accessor.contents;
+        NSInteger sourceStride = accessor.elementStride;
+        if (source != NULL) {
+            for (NSInteger i = 0; i < accessor.count; ++i) {
+                if (widenIndices) {
+                    ((uint16_t *)destination)[i] = source[i * sourceStride];
+                } else {
+                    memcpy(destination + i * stride, source + i * sourceStride, sourceElementSize);
+                }
+            }
+        }
+        
+        NSMutableDictionary *json = [NSMutableDictionary dictionary];
+        json[@"bufferView"] = [self addBufferViewWithOffset:offset length:length
+                                                     stride:(stride != elementSize) ? stride : 0
+                                                     target:target];
+        json[@"componentType"] = @(componentType);
+        json[@"count"] = @(accessor.count);
+        json[@"type"] = GLTFNameForDataDimension(accessor.dimension);
+        if (accessor.normalized) {
+            json[@"normalized"] = @YES;
+        }
+        
+        // Bounds are recomputed rather than copied, since they're optional on input but required for positions
+        if (GLTFDataTypeComponentsAreFloats(componentType) && source != NULL && accessor.count > 0) {
+            NSInteger componentCount = accessor.componentCount;
+            float *values = malloc(sizeof(float) * componentCount * accessor.count);
+            [accessor getFloatValues:values];
+            float minValues[16], maxValues[16];
+            for (NSInteger c = 0; c < componentCount; ++c) {
+                minValues[c] = maxValues[c] = values[c];
+            }
+            for (NSInteger i = 1; i < accessor.count; ++i) {
+                for (NSInteger c = 0; c < componentCount; ++c) {
+                    float value = values[i * componentCount + c];
+                    minValues[c] = fminf(minValues[c], value);
+                    maxValues[c] = fmaxf(maxValues[c], value);
+                }
+            }
+            free(values);
+            json[@"min"] = GLTFArrayFromFloats(minValues, componentCount);
+            json[@"max"] = GLTFArrayFromFloats(maxValues, componentCount);
+        }
+        
+        [self addCommonPropertiesOfObject:accessor toJSON:json];
+        return json;
+    }];
+}
+
+- (NSData *)contentsOfImage:(GLTFImage *)image {
+    if (image.imageData.length > 0) {
+        return image.imageData;
+    }
+    GLTFBufferView *bufferView = image.bufferView;
+    if (bufferView.buffer != nil) {
+        return [NSData dataWithBytesNoCopy:bufferView.buffer.contents + bufferView.offset length:bufferView.length freeWhenDone:NO];
+    }
+    if (image.url.isFileURL) {
+        return [NSData dataWithContentsOfURL:image.url options:NSDataReadingMappedIfSafe error:nil];
+    }
+    return nil;
+}
+
+- (NSNumber *)indexForImage:(GLTFImage *)image {
+    return [self indexForObject:image inList:_images build:^NSDictionary *{
+        NSMutableDictionary *json = [NSMutableDictionary dictionary];
+        NSData *data = [self contentsOfImage:image];
+        if (data.length > 0) {
+            NSUInteger offset = [self appendBinaryDataWithLength:data.length];
+            memcpy((uint8_t *)_binaryData.mutableBytes + offset, data.bytes, data.length);
+            json[@"bufferView"] = [self addBufferViewWithOffset:offset length:data.length stride:0 target:GLTFTargetUnknown];
+            json[@"mimeType"] = image.mimeType ?: GLTFMIMETypeForImageData(data) ?: @"image/png";
+        } else {
+            NSLog(@"WARNING: Unable to read contents of image %@; writing it as an external reference", image.url);
+            json[@"uri"] = image.url.lastPathComponent ?: @"";
+        }
+        [self addCommonPropertiesOfObject:image toJSON:json];
+        return json;
+    }];
+}
+
+#pragma mark - Materials
+
+- (NSNumber *)indexForSampler:(GLTFTextureSampler *)sampler {
+    return [self indexForObject:sampler inList:_samplers build:^NSDictionary *{
+        NSMutableDictionary *json = [NSMutableDictionary dictionary];
+        json[@"magFilter"] = @(sampler.magFilter);
+        json[@"minFilter"] = @(sampler.minFilter);
+        json[@"wrapS"] = @(sampler.sAddressMode);
+        json[@"wrapT"] = @(sampler.tAddressMode);
+        [self addCommonPropertiesOfObject:sampler toJSON:json];
+        return json;
+    }];
+}
+
+- (NSNumber *)indexForTexture:(GLTFTexture *)texture {
+    return [self indexForObject:texture inList:_textures build:^NSDictionary *{
+        NSMutableDictionary *json = [NSMutableDictionary dictionary];
+        if (texture.sampler != nil) {
+            json[@"sampler"] = [self indexForSampler:texture.sampler];
+        }
+        if (texture.image != nil) {
+            json[@"source"] = [self indexForImage:texture.image];
+        }
+        [self addCommonPropertiesOfObject:texture toJSON:json];
+        return json;
+    }];
+}
+
+- (NSMutableDictionary *)JSONForTextureInfo:(GLTFTextureInfo *)textureInfo writeTransform:(BOOL)writeTransform {
+    NSMutableDictionary *json = [NSMutableDictionary dictionary];
+    json[@"index"] = [self indexForTexture:textureInfo.texture];
+    if (textureInfo.texCoord != 0) {
+        json[@"texCoord"] = @(textureInfo.texCoord);
+    }
+    NSMutableDictionary *extensions = [textureInfo.extensions mutableCopy] ?: [NSMutableDictionary dictionary];
+    if (writeTransform) {
+        GLTFTextureTransform transform = textureInfo.transform;
+        extensions[GLTFExtensionKHRTextureTransform] = @{
+            @"offset" : GLTFArrayFromVector2(transform.offset),
+            @"scale" : GLTFArrayFromVector2(transform.scale),
+            @"rotation" : @(transform.rotation),
+        };
+    }
+    if (extensions.count > 0) {
+        json[@"extensions"] = extensions;
+    }
+    if (textureInfo.extras.count > 0) {
+        json[@"extras"] = textureInfo.extras;
+    }
+    return json;
+}
+
+- (NSNumber *)indexForMaterial:(GLTFMaterial *)material {
+    return [self indexForObject:material inList:_materials build:^NSDictionary *{
+        BOOL writeTransforms = material.hasTextureTransforms;
+        NSMutableDictionary *json = [NSMutableDictionary dictionary];
+        
+        NSMutableDictionary *pbr = [NSMutableDictionary dictionary];
+        pbr[@"baseColorFactor"] = GLTFArrayFromVector4(material.baseColorFactor);
+        pbr[@"metallicFactor"] = @(material.metalnessFactor);
+        pbr[@"roughnessFactor"] = @(material.roughnessFactor);
+        if (material.baseColorTexture.texture != nil) {
+            pbr[@"baseColorTexture"] = [self JSONForTextureInfo:material.baseColorTexture writeTransform:writeTransforms];
+        }
+        if (material.metallicRoughnessTexture.texture != nil) {
+            pbr[@"metallicRoughnessTexture"] = [self JSONForTextureInfo:material.metallicRoughnessTexture writeTransform:writeTransforms];
+        }
+        json[@"pbrMetallicRoughness"] = pbr;
+        
+        if (material.normalTexture.texture != nil) {
+            NSMutableDictionary *normalTexture = [self JSONForTextureInfo:material.normalTexture writeTransform:writeTransforms];
+            normalTexture[@"scale"] = @(material.normalTextureScale);
+            json[@"normalTexture"] = normalTexture;
+        }
+        if (material.occlusionTexture.texture != nil) {
+            NSMutableDictionary *occlusionTexture = [self JSONForTextureInfo:material.occlusionTexture writeTransform:writeTransforms];
+            occlusionTexture[@"strength"] = @(material.occlusionStrength);
+            json[@"occlusionTexture"] = occlusionTexture;
+        }
+        if (material.emissiveTexture.texture != nil) {
+            json[@"emissiveTexture"] = [self JSONForTextureInfo:material.emissiveTexture writeTransform:writeTransforms];
+        }
+        json[@"emissiveFactor"] = GLTFArrayFromVector3(material.emissiveFactor);
+        
+        // Always explicit, since the loader treats a missing value as double-sided
+        json[@"doubleSided"] = @(material.isDoubleSided);
+        json[@"alphaMode"] = GLTFNameForAlphaMode(material.alphaMode);
+        if (material.alphaMode == GLTFAlphaModeMask) {
+            json[@"alphaCutoff"] = @(material.alphaCutoff);
+        }
+        
+        NSMutableDictionary *extensions = [material.extensions mutableCopy] ?: [NSMutableDictionary dictionary];
+        if (extensions[GLTFExtensionKHRMaterialsPBRSpecularGlossiness] != nil) {
+            // Rewritten from the loaded values, since any texture indices it held refer to the source asset.
+            // The loader doesn't support specular-glossiness textures, so those are dropped.
+            NSMutableDictionary *specularGlossiness = [NSMutableDictionary dictionary];
+            specularGlossiness[@"diffuseFactor"] = GLTFArrayFromVector4(material.baseColorFactor);
+            specularGlossiness[@"specularFactor"] = GLTFArrayFromVector3(material.specularFactor);
+            specularGlossiness[@"glossinessFactor"] = @(material.glossinessFactor);
+            if (material.baseColorTexture.texture != nil) {
+                specularGlossiness[@"diffuseTexture"] = pbr[@"baseColorTexture"];
+            }
+            extensions[GLTFExtensionKHRMaterialsPBRSpecularGlossiness] = specularGlossiness;
+        }
+        if (material.isUnlit) {
+            extensions[GLTFExtensionKHRMaterialsUnlit] = @{};
+        }
+        if (extensions.count > 0) {
+            json[@"extensions"] = extensions;
+        }
+        
+        [self addCommonPropertiesOfObject:material toJSON:json];
+        return json;
+    }];
+}
+
+#pragma mark - Meshes, skins, cameras and lights
+
+- (NSDictionary *)JSONForAttributeAccessors:(NSDictionary<NSString *, GLTFAccessor *> *)accessorsForAttributes {
+    NSMutableDictionary *json = [NSMutableDictionary dictionaryWithCapacity:accessorsForAttributes.count];
+    [accessorsForAttributes enumerateKeysAndObjectsUsingBlock:^(NSString *name, GLTFAccessor *accessor, BOOL *stop) {
+        json[name] = [self indexForAccessor:accessor target:GLTFTargetArrayBuffer];
+    }];
+    return json;
+}
+
+- (NSNumber *)indexForMesh:(GLTFMesh *)mesh {
+    return [self indexForObject:mesh inList:_meshes build:^NSDictionary *{
+        NSMutableArray *primitives = [NSMutableArray arrayWithCapacity:mesh.submeshes.count];
+        for (GLTFSubmesh *submesh in mesh.submeshes) {
+            NSMutableDictionary *primitive = [NSMutableDictionary dictionary];
+            primitive[@"attributes"] = [self JSONForAttributeAccessors:submesh.accessorsForAttributes];
+            if (submesh.indexAccessor != nil) {
+                primitive[@"indices"] = [self indexForAccessor:submesh.indexAccessor target:GLTFTargetElementArrayBuffer];
+            }
+            if (submesh.material != nil) {
+                primitive[@"material"] = [self indexForMaterial:submesh.material];
+            }
+            primitive[@"mode"] = @(submesh.primitiveType);
+            if (submesh.morphTargets.count > 0) {
+                NSMutableArray *targets = [NSMutableArray arrayWithCapacity:submesh.morphTargets.count];
+                for (GLTFMorphTarget *target in submesh.morphTargets) {
+                    [targets addObject:[self JSONForAttributeAccessors:target.accessorsForAttributes]];
+                }
+                primitive[@"targets"] = targets;
+            }
+            [primitives addObject:primitive];
+        }
+        
+        NSMutableDictionary *json = [NSMutableDictionary dictionary];
+        json[@"primitives"] = primitives;
+        if (mesh.defaultMorphTargetWeights.count > 0) {
+            json[@"weights"] = mesh.defaultMorphTargetWeights;
+        }
+        [self addCommonPropertiesOfObject:mesh toJSON:json];
+        return json;
+    }];
+}
+
+- (NSNumber *)indexForSkin:(GLTFSkin *)skin {
+    return [self indexForObject:skin inList:_skins build:^NSDictionary *{
+        NSMutableDictionary *json = [NSMutableDictionary dictionary];
+        if (skin.inverseBindMatricesAccessor != nil) {
+            json[@"inverseBindMatrices"] = [self indexForAccessor:skin.inverseBindMatricesAccessor target:GLTFTargetUnknown];
+        }
+        NSMutableArray *joints = [NSMutableArray arrayWithCapacity:skin.jointNodes.count];
+        for (GLTFNode *joint in skin.jointNodes) {
+            [joints addObject:[self indexForNode:joint]];
+        }
+        json[@"joints"] = joints;
+        if ([skin.skeletonRootNode isKindOfClass:[GLTFNode class]]) {
+            json[@"skeleton"] = [self indexForNode:skin.skeletonRootNode];
+        }
+        [self addCommonPropertiesOfObject:skin toJSON:json];
+        return json;
+    }];
+}
+
+- (NSNumber *)indexForCamera:(GLTFCamera *)camera {
+    return [self indexForObject:camera inList:_cameras build:^NSDictionary *{
+        NSMutableDictionary *json = [NSMutableDictionary dictionary];
+        NSMutableDictionary *parameters = [NSMutableDictionary dictionary];
+        parameters[@"znear"] = @(camera.znear);
+        if (camera.cameraType == GLTFCameraTypeOrthographic) {
+            json[@"type"] = @"orthographic";
+            parameters[@"xmag"] = @(camera.xmag);
+            parameters[@"ymag"] = @(camera.ymag);
+            parameters[@"zfar"] = @(camera.zfar);
+        } else {
+            json[@"type"] = @"perspective";
+            parameters[@"yfov"] = @(camera.yfov);
+            parameters[@"aspectRatio"] = @(camera.aspectRatio);
+            if (camera.zfar < FLT_MAX) {
+                parameters[@"zfar"] = @(camera.zfar);
+            }
+        }
+        json[json[@"type"]] = parameters;
+        [self addCommonPropertiesOfObject:camera toJSON:json];
+        return json;
+    }];
+}
+
+- (NSNumber *)indexForLight:(GLTFKHRLight *)light {
+    return [self indexForObject:light inList:_lights build:^NSDictionary *{
+        NSMutableDictionary *json = [NSMutableDictionary dictionary];
+        json[@"type"] = GLTFNameForLightType(light.type);
+        json[@"color"] = GLTFArrayFromVector3(light.color.xyz);
+        json[@"intensity"] = @(light.intensity);
+        if (light.type == GLTFKHRLightTypeSpot) {
+            json[@"spot"] = @{ @"innerConeAngle" : @(light.innerConeAngle), @"outerConeAngle" : @(light.outerConeAngle) };
+        }
+        [self addCommonPropertiesOfObject:light toJSON:json];
+        return json;
+    }];
+}
+
+#pragma mark - Nodes, scenes and animations
+
+- (void)collectNode:(GLTFNode *)node {
+    if ([_indicesForObjects objectForKey:node] != nil) {
+        return;
+    }
+    [_indicesForObjects setObject:@(_nodes.count) forKey:node];
+    [_nodes addObject:node];
+    
+    for (GLTFNode *child in node.children) {
+        [self collectNode:child];
+    }
+    for (GLTFNode *levelOfDetailNode in node.levelOfDetailNodes) {
+        [self collectNode:levelOfDetailNode];
+    }
+    for (GLTFNode *joint in node.skin.jointNodes) {
+        [self collectNode:joint];
+    }
+    if ([node.skin.skeletonRootNode isKindOfClass:[GLTFNode class]]) {
+        [self collectNode:node.skin.skeletonRootNode];
+    }
+}
+
+- (NSNumber *)indexForNode:(GLTFNode *)node {
+    [self collectNode:node];
+    return [_indicesForObjects objectForKey:node];
+}
+
+- (NSDictionary *)JSONForNode:(GLTFNode *)node {
+    NSMutableDictionary *json = [NSMutableDictionary dictionary];
+    
+    if (node.children.count > 0) {
+        NSMutableArray *children = [NSMutableArray arrayWithCapacity:node.children.count];
+        for (GLTFNode *child in node.children) {
+            [children addObject:[self indexForNode:child]];
+        }
+        json[@"children"] = children;
+    }
+    if (node.mesh != nil) {
+        json[@"mesh"] = [self indexForMesh:node.mesh];
+    }
+    if (node.skin != nil) {
+        json[@"skin"] = [self indexForSkin:node.skin];
+    }
+    if (node.camera != nil) {
+        json[@"camera"] = [self indexForCamera:node.camera];
+    }
+    if (node.morphTargetWeights.count > 0) {
+        json[@"weights"] = node.morphTargetWeights;
+    }
+    if (node.jointName.length > 0) {
+        json[@"jointName"] = node.jointName;
+    }
+    
+    // Prefer TRS, which animation channels require, unless the node was given a matrix that TRS can't reproduce
+    simd_float4x4 trs = matrix_multiply(matrix_multiply(GLTFMatrixFromTranslation(node.translation),
+                                                        simd_matrix4x4(node.rotationQuaternion)),
+                                        GLTFMatrixFromScale(node.scale));
+    simd_float4x4 localTransform = node.localTransform;
+    if (simd_almost_equal_elements(trs, localTransform, 1e-6f)) {
+        if (!simd_equal(node.translation, (simd_float3){ 0, 0, 0 })) {
+            json[@"translation"] = GLTFArrayFromVector3(node.translation);
+        }
+        if (!simd_equal(node.rotationQuaternion.vector, (simd_float4){ 0, 0, 0, 1 })) {
+            json[@"rotation"] = GLTFArrayFromVector4(node.rotationQuaternion.vector);
+        }
+        if (!simd_equal(node.scale, (simd_float3){ 1, 1, 1 })) {
+            json[@"scale"] = GLTFArrayFromVector3(node.scale);
+        }
+    } else {
+        json[@"matrix"] = GLTFArrayFromMatrix4x4(localTransform);
+    }
+    
+    NSMutableDictionary *extensions = [node.extensions mutableCopy] ?: [NSMutableDictionary dictionary];
+    [extensions removeObjectForKey:GLTFExtensionKHRLights];
+    [extensions removeObjectForKey:GLTFExtensionMSFTLOD];
+    if (node.light != nil) {
+        extensions[GLTFExtensionKHRLights] = @{ @"light" : [self indexForLight:node.light] };
+    }
+    if (node.levelOfDetailNodes.count > 0) {
+        NSMutableArray *identifiers = [NSMutableArray arrayWithCapacity:node.levelOfDetailNodes.count];
+        for (GLTFNode *levelOfDetailNode in node.levelOfDetailNodes) {
+            [identifiers addObject:[self indexForNode:levelOfDetailNode]];
+        }
+        extensions[GLTFExtensionMSFTLOD] = @{ @"ids" : identifiers };
+    }
+    if (extensions.count > 0) {
+        json[@"extensions"] = extensions;
+    }
+    
+    [self addCommonPropertiesOfObject:node toJSON:json];
+    return json;
+}
+
+- (NSDictionary *)JSONForScene:(GLTFScene *)scene {
+    NSMutableDictionary *json = [NSMutableDictionary dictionary];
+    NSMutableArray *nodes = [NSMutableArray arrayWithCapacity:scene.nodes.count];
+    for (GLTFNode *node in scene.nodes) {
+        [nodes addObject:[self indexForNode:node]];
+    }
+    json[@"nodes"] = nodes;
+    
+    NSMutableDictionary *extensions = [scene.extensions mutableCopy] ?: [NSMutableDictionary dictionary];
+    [extensions removeObjectForKey:GLTFExtensionKHRLights];
+    if (scene.ambientLight != nil) {
+        extensions[GLTFExtensionKHRLights] = @{ @"light" : [self indexForLight:scene.ambientLight] };
+    }
+    if (extensions.count > 0) {
+        json[@"extensions"] = extensions;
+    }
+    
+    [self addCommonPropertiesOfObject:scene toJSON:json];
+    return json;
+}
+
+- (NSDictionary *)JSONForAnimation:(GLTFAnimation *)animation {
+    NSMutableArray *samplers = [NSMutableArray arrayWithCapacity:animation.samplers.count];
+    for (GLTFAnimationSampler *sampler in animation.samplers) {
+        NSMutableDictionary *json = [NSMutableDictionary dictionary];
+        json[@"input"] = [self indexForAccessor:sampler.inputAccessor target:GLTFTargetUnknown];
+        json[@"output"] = [self indexForAccessor:sampler.outputAccessor target:GLTFTargetUnknown];
+        json[@"interpolation"] = GLTFNameForInterpolationMode(sampler.interpolationMode);
+        [samplers addObject:json];
+    }
+    
+    NSMutableArray *channels = [NSMutableArray arrayWithCapacity:animation.channels.count];
+    for (GLTFAnimationChannel *channel in animation.channels) {
+        NSUInteger samplerIndex = [animation.samplers indexOfObjectIdenticalTo:channel.sampler];
+        if (samplerIndex == NSNotFound || channel.targetNode == nil) {
+            continue;
+        }
+        [channels addObject:@{
+            @"sampler" : @(samplerIndex),
+            @"target" : @{ @"node" : [self indexForNode:channel.targetNode], @"path" : channel.targetPath },
+        }];
+    }
+    
+    NSMutableDictionary *json = [NSMutableDictionary dictionary];
+    json[@"samplers"] = samplers;
+    json[@"channels"] = channels;
+    [self addCommonPropertiesOfObject:animation toJSON:json];
+    return json;
+}
+
+@end
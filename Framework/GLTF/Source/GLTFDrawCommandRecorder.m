@@ -0,0 +1,445 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFDrawCommandRecorder.h"
+
+enum {
+    GLTFDrawCommandRecorderBufferSlotCount = 31,
+    GLTFDrawCommandRecorderTextureSlotCount = 32,
+    GLTFDrawCommandRecorderSamplerSlotCount = 16,
+};
+
+const NSInteger GLTFDrawCommandTypeCount = GLTFDrawCommandTypePopDebugGroup + 1;
+const NSUInteger GLTFDrawCommandMaxBufferCount = GLTFDrawCommandRecorderBufferSlotCount;
+const NSUInteger GLTFDrawCommandMaxTextureCount = GLTFDrawCommandRecorderTextureSlotCount;
+const NSUInteger GLTFDrawCommandMaxSamplerCount = GLTFDrawCommandRecorderSamplerSlotCount;
+
+typedef struct {
+    GLTFDrawCommandType type;
+    __unsafe_unretained id object; // pipeline, depth-stencil state, buffer, texture or sampler
+    NSUInteger index;              // binding index, index type of indexed draws, or debug group name index
+    NSUInteger offset;             // buffer offset, offset of copied bytes, or first vertex
+    NSUInteger length;             // length of copied bytes, or vertex or index count
+    NSInteger value;               // cull mode, winding or primitive type
+} GLTFDrawCommand;
+
+// What a slot is known to hold. Vertex buffers and bytes share slots, as they do in the encoder.
+typedef struct {
+    __unsafe_unretained id object;
+    NSUInteger offset;
+    NSUInteger length;
+    BOOL holdsBytes;
+    BOOL known;
+} GLTFDrawBinding;
+
+@interface GLTFDrawCommandRecorder () {
+    GLTFDrawCommand *_commands;
+    NSInteger _commandCount;
+    NSInteger _commandCapacity;
+    
+    uint8_t *_bytes;
+    NSUInteger _byteCount;
+    NSUInteger _byteCapacity;
+    
+    __unsafe_unretained id _pipelineState;
+    __unsafe_unretained id _depthStencilState;
+    NSInteger _cullMode;
+    NSInteger _winding;
+    GLTFDrawBinding _vertexBindings[GLTFDrawCommandRecorderBufferSlotCount];
+    GLTFDrawBinding _fragmentBindings[GLTFDrawCommandRecorderBufferSlotCount];
+    GLTFDrawBinding _fragmentTextures[GLTFDrawCommandRecorderTextureSlotCount];
+    GLTFDrawBinding _fragmentSamplers[GLTFDrawCommandRecorderSamplerSlotCount];
+    
+    GLTFDrawCommandStatistics _statistics;
+}
+@property (nonatomic, strong) NSMutableArray<NSString *> *debugGroupNames;
+@end
+
+@implementation GLTFDrawCommandRecorder
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        _debugGroupNames = [NSMutableArray array];
+        [self reset];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_commands);
+    free(_bytes);
+}
+
+- (void)reset {
+    _commandCount = 0;
+    _byteCount = 0;
+    _pipelineState = nil;
+    _depthStencilState = nil;
+    _cullMode = -1;
+    _winding = -1;
+    memset(_vertexBindings, 0, sizeof(_vertexBindings));
+    memset(_fragmentBindings, 0, sizeof(_fragmentBindings));
+    memset(_fragmentTextures, 0, sizeof(_fragmentTextures));
+    memset(_fragmentSamplers, 0, sizeof(_fragmentSamplers));
+    memset(&_statistics, 0, sizeof(_statistics));
+    [self.debugGroupNames removeAllObjects];
+}
+
+- (GLTFDrawCommandStatistics)statistics {
+    return _statistics;
+}
+
+- (GLTFDrawCommand *)appendCommandOfType:(GLTFDrawCommandType)type {
+    if (_commandCount == _commandCapacity) {
+        _commandCapacity = MAX(_commandCapacity * 2, 256);
+        _commands = realloc(_commands, sizeof(GLTFDrawCommand) * _commandCapacity);
+    }
+    GLTFDrawCommand *command = &_commands[_commandCount++];
+    memset(command, 0, sizeof(GLTFDrawCommand));
+    command->type = type;
+    ++_statistics.commandCount;
+    return command;
+}
+
+// Copies bytes to the end of byte storage, 16-byte aligned, and returns where they went
+- (NSUInteger)appendBytes:(const void *)bytes length:(NSUInteger)length {
+    NSUInteger offset = (_byteCount + 15) & ~(NSUInteger)15;
+    if (offset + length > _byteCapacity) {
+        _byteCapacity = MAX(_byteCapacity * 2, MAX(offset + length, 4096));
+        _bytes = realloc(_bytes, _byteCapacity);
+    }
+    memcpy(_bytes + offset, bytes, length);
+    _byteCount = offset + length;
+    return offset;
+}
+
+- (void)recordBytes:(const void *)bytes
+             length:(NSUInteger)length
+            atIndex:(NSUInteger)index
+           bindings:(GLTFDrawBinding *)bindings
+        commandType:(GLTFDrawCommandType)type
+{
+    GLTFDrawBinding *binding = (index < GLTFDrawCommandRecorderBufferSlotCount) ? &bindings[index] : NULL;
+    if (binding && binding->known && binding->holdsBytes && binding->length == length &&
+        memcmp(_bytes + binding->offset, bytes, length) == 0)
+    {
+        ++_statistics.redundantCommandCount;
+        return;
+    }
+    
+    NSUInteger offset = [self appendBytes:bytes length:length];
+    GLTFDrawCommand *command = [self appendCommandOfType:type];
+    command->index = index;
+    command->offset = offset;
+    command->length = length;
+    
+    if (binding) {
+        *binding = (GLTFDrawBinding){ nil, offset, length, YES, YES };
+    }
+}
+
+// Returns whether an object bind at the index would change anything, noting the new binding if so
+- (BOOL)updateBinding:(GLTFDrawBinding *)bindings
+            slotCount:(NSUInteger)slotCount
+              atIndex:(NSUInteger)index
+               object:(id)object
+{
+    if (index >= slotCount) {
+        return YES;
+    }
+    GLTFDrawBinding *binding = &bindings[index];
+    if (binding->known && !binding->holdsBytes && binding->object == object) {
+        ++_statistics.redundantCommandCount;
+        return NO;
+    }
+    *binding = (GLTFDrawBinding){ object, 0, 0, NO, YES };
+    return YES;
+}
+
+#pragma mark - GLTFDrawCommandBackend
+
+- (void)setPipelineState:(id)pipelineState {
+    if (pipelineState == _pipelineState) {
+        ++_statistics.redundantCommandCount;
+        return;
+    }
+    _pipelineState = pipelineState;
+    [self appendCommandOfType:GLTFDrawCommandTypeSetPipelineState]->object = pipelineState;
+}
+
+- (void)setDepthStencilState:(id)depthStencilState {
+    if (depthStencilState == _depthStencilState) {
+        ++_statistics.redundantCommandCount;
+        return;
+    }
+    _depthStencilState = depthStencilState;
+    [self appendCommandOfType:GLTFDrawCommandTypeSetDepthStencilState]->object = depthStencilState;
+}
+
+- (void)setCullMode:(GLTFDrawCullMode)cullMode {
+    if (cullMode == _cullMode) {
+        ++_statistics.redundantCommandCount;
+        return;
+    }
+    _cullMode = cullMode;
+    [self appendCommandOfType:GLTFDrawCommandTypeSetCullMode]->value = cullMode;
+}
+
+- (void)setFrontFacingWinding:(GLTFDrawWinding)winding {
+    if (winding == _winding) {
+        ++_statistics.redundantCommandCount;
+        return;
+    }
+    _winding = winding;
+    [self appendCommandOfType:GLTFDrawCommandTypeSetFrontFacingWinding]->value = winding;
+}
+
+- (void)setVertexBuffer:(id)buffer offset:(NSUInteger)offset atIndex:(NSUInteger)index {
+    if (index < GLTFDrawCommandRecorderBufferSlotCount) {
+        GLTFDrawBinding *binding = &_vertexBindings[index];
+        if (binding->known && !binding->holdsBytes && binding->object == buffer) {
+            if (binding->offset == offset) {
+                ++_statistics.redundantCommandCount;
+                return;
+            }
+            // Only the offset changes, which is cheaper to send on its own
+            binding->offset = offset;
+            GLTFDrawCommand *command = [self appendCommandOfType:GLTFDrawCommandTypeSetVertexBufferOffset];
+            command->index = index;
+            command->offset = offset;
+            return;
+        }
+        *binding = (GLTFDrawBinding){ buffer, offset, 0, NO, YES };
+    }
+    GLTFDrawCommand *command = [self appendCommandOfType:GLTFDrawCommandTypeSetVertexBuffer];
+    command->object = buffer;
+    command->index = index;
+    command->offset = offset;
+}
+
+- (void)setVertexBufferOffset:(NSUInteger)offset atIndex:(NSUInteger)index {
+    if (index < GLTFDrawCommandRecorderBufferSlotCount) {
+        GLTFDrawBinding *binding = &_vertexBindings[index];
+        if (binding->known && !binding->holdsBytes && binding->offset == offset) {
+            ++_statistics.redundantCommandCount;
+            return;
+        }
+        binding->offset = offset;
+    }
+    GLTFDrawCommand *command = [self appendCommandOfType:GLTFDrawCommandTypeSetVertexBufferOffset];
+    command->index = index;
+    command->offset = offset;
+}
+
+- (void)setVertexBytes:(const void *)bytes length:(NSUInteger)length atIndex:(NSUInteger)index {
+    [self recordBytes:bytes length:length atIndex:index bindings:_vertexBindings commandType:GLTFDrawCommandTypeSetVertexBytes];
+}
+
+- (void)setFragmentBytes:(const void *)bytes length:(NSUInteger)length atIndex:(NSUInteger)index {
+    [self recordBytes:bytes length:length atIndex:index bindings:_fragmentBindings commandType:GLTFDrawCommandTypeSetFragmentBytes];
+}
+
+- (void)setFragmentTexture:(id)texture atIndex:(NSUInteger)index {
+    if ([self updateBinding:_fragmentTextures slotCount:GLTFDrawCommandRecorderTextureSlotCount atIndex:index object:texture]) {
+        GLTFDrawCommand *command = [self appendCommandOfType:GLTFDrawCommandTypeSetFragmentTexture];
+        command->object = texture;
+        command->index = index;
+    }
+}
+
+- (void)setFragmentSamplerState:(id)samplerState atIndex:(NSUInteger)index {
+    if ([self updateBinding:_fragmentSamplers slotCount:GLTFDrawCommandRecorderSamplerSlotCount atIndex:index object:samplerState]) {
+        GLTFDrawCommand *command = [self appendCommandOfType:GLTFDrawCommandTypeSetFragmentSamplerState];
+        command->object = samplerState;
+        command->index = index;
+    }
+}
+
+- (void)drawPrimitives:(GLTFPrimitiveType)primitiveType vertexStart:(NSUInteger)vertexStart vertexCount:(NSUInteger)vertexCount {
+    GLTFDrawCommand *command = [self appendCommandOfType:GLTFDrawCommandTypeDraw];
+    command->value = primitiveType;
+    command->offset = vertexStart;
+    command->length = vertexCount;
+    ++_statistics.drawCount;
+}
+
+- (void)drawIndexedPrimitives:(GLTFPrimitiveType)primitiveType
+                   indexCount:(NSUInteger)indexCount
+                    indexType:(GLTFDataType)indexType
+                  indexBuffer:(id)indexBuffer
+            indexBufferOffset:(NSUInteger)indexBufferOffset
+{
+    GLTFDrawCommand *command = [self appendCommandOfType:GLTFDrawCommandTypeDrawIndexed];
+    command->value = primitiveType;
+    command->length = indexCount;
+    command->index = indexType;
+    command->object = indexBuffer;
+    command->offset = indexBufferOffset;
+    ++_statistics.drawCount;
+}
+
+- (void)pushDebugGroup:(NSString *)name {
+    [self appendCommandOfType:GLTFDrawCommandTypePushDebugGroup]->index = self.debugGroupNames.count;
+    [self.debugGroupNames addObject:name];
+}
+
+- (void)popDebugGroup {
+    [self appendCommandOfType:GLTFDrawCommandTypePopDebugGroup];
+}
+
+#pragma mark - Replay
+
+- (void)replayWithBackend:(id<GLTFDrawCommandBackend>)backend {
+    for (NSInteger i = 0; i < _commandCount; ++i) {
+        const GLTFDrawCommand *command = &_commands[i];
+        switch (command->type) {
+            case GLTFDrawCommandTypeSetPipelineState:
+                [backend setPipelineState:command->object];
+                break;
+            case GLTFDrawCommandTypeSetDepthStencilState:
+                [backend setDepthStencilState:command->object];
+                break;
+            case GLTFDrawCommandTypeSetCullMode:
+                [backend setCullMode:(GLTFDrawCullMode)command->value];
+                break;
+            case GLTFDrawCommandTypeSetFrontFacingWinding:
+                [backend setFrontFacingWinding:(GLTFDrawWinding)command->value];
+                break;
+            case GLTFDrawCommandTypeSetVertexBuffer:
+                [backend setVertexBuffer:command->object offset:command->offset atIndex:command->index];
+                break;
+            case GLTFDrawCommandTypeSetVertexBufferOffset:
+                [backend setVertexBufferOffset:command->offset atIndex:command->index];
+                break;
+            case GLTFDrawCommandTypeSetVertexBytes:
+                [backend setVertexBytes:_bytes + command->offset length:command->length atIndex:command->index];
+                break;
+            case GLTFDrawCommandTypeSetFragmentBytes:
+                [backend setFragmentBytes:_bytes + command->offset length:command->length atIndex:command->index];
+                break;
+            case GLTFDrawCommandTypeSetFragmentTexture:
+                [backend setFragmentTexture:command->object atIndex:command->index];
+                break;
+            case GLTFDrawCommandTypeSetFragmentSamplerState:
+                [backend setFragmentSamplerState:command->object atIndex:command->index];
+                break;
+            case GLTFDrawCommandTypeDraw:
+                [backend drawPrimitives:(GLTFPrimitiveType)command->value vertexStart:command->offset vertexCount:command->length];
+                break;
+            case GLTFDrawCommandTypeDrawIndexed:
+                [backend drawIndexedPrimitives:(GLTFPrimitiveType)command->value
+                                    indexCount:command->length
+                                     indexType:(GLTFDataType)command->index
+                                   indexBuffer:command->object
+                             indexBufferOffset:command->offset];
+                break;
+            case GLTFDrawCommandTypePushDebugGroup:
+                [backend pushDebugGroup:self.debugGroupNames[command->index]];
+                break;
+            case GLTFDrawCommandTypePopDebugGroup:
+                [backend popDebugGroup];
+                break;
+        }
+    }
+}
+
+@end
+
+@interface GLTFNullDrawCommandBackend () {
+    NSInteger _commandCounts[GLTFDrawCommandTypePopDebugGroup + 1];
+}
+@end
+
+@implementation GLTFNullDrawCommandBackend
+
+- (void)reset {
+    memset(_commandCounts, 0, sizeof(_commandCounts));
+    _commandCount = 0;
+}
+
+- (NSInteger)countOfCommandsOfType:(GLTFDrawCommandType)commandType {
+    NSParameterAssert(commandType >= 0 && commandType < GLTFDrawCommandTypeCount);
+    return _commandCounts[commandType];
+}
+
+- (void)countCommandOfType:(GLTFDrawCommandType)commandType {
+    ++_commandCounts[commandType];
+    ++_commandCount;
+}
+
+- (void)setPipelineState:(id)pipelineState {
+    [self countCommandOfType:GLTFDrawCommandTypeSetPipelineState];
+}
+
+- (void)setDepthStencilState:(id)depthStencilState {
+    [self countCommandOfType:GLTFDrawCommandTypeSetDepthStencilState];
+}
+
+- (void)setCullMode:(GLTFDrawCullMode)cullMode {
+    [self countCommandOfType:GLTFDrawCommandTypeSetCullMode];
+}
+
+- (void)setFrontFacingWinding:(GLTFDrawWinding)winding {
+    [self countCommandOfType:GLTFDrawCommandTypeSetFrontFacingWinding];
+}
+
+- (void)setVertexBuffer:(id)buffer offset:(NSUInteger)offset atIndex:(NSUInteger)index {
+    [self countCommandOfType:GLTFDrawCommandTypeSetVertexBuffer];
+}
+
+- (void)setVertexBufferOffset:(NSUInteger)offset atIndex:(NSUInteger)index {
+    [self countCommandOfType:GLTFDrawCommandTypeSetVertexBufferOffset];
+}
+
+- (void)setVertexBytes:(const void *)bytes length:(NSUInteger)length atIndex:(NSUInteger)index {
+    [self countCommandOfType:GLTFDrawCommandTypeSetVertexBytes];
+}
+
+- (void)setFragmentBytes:(const void *)bytes length:(NSUInteger)length atIndex:(NSUInteger)index {
+    [self countCommandOfType:GLTFDrawCommandTypeSetFragmentBytes];
+}
+
+- (void)setFragmentTexture:(id)texture atIndex:(NSUInteger)index {
+    [self countCommandOfType:GLTFDrawCommandTypeSetFragmentTexture];
+}
+
+- (void)setFragmentSamplerState:(id)samplerState atIndex:(NSUInteger)index {
+    [self countCommandOfType:GLTFDrawCommandTypeSetFragmentSamplerState];
+}
+
+- (void)drawPrimitives:(GLTFPrimitiveType)primitiveType vertexStart:(NSUInteger)vertexStart vertexCount:(NSUInteger)vertexCount {
+    [self countCommandOfType:GLTFDrawCommandTypeDraw];
+}
+
+- (void)drawIndexedPrimitives:(GLTFPrimitiveType)primitiveType
+                   indexCount:(NSUInteger)indexCount
+                    indexType:(GLTFDataType)indexType
+                  indexBuffer:(id)indexBuffer
+            indexBufferOffset:(NSUInteger)indexBufferOffset
+{
+    [self countCommandOfType:GLTFDrawCommandTypeDrawIndexed];
+}
+
+- (void)pushDebugGroup:(NSString *)name {
+    [self countCommandOfType:GLTFDrawCommandTypePushDebugGroup];
+}
+
+- (void)popDebugGroup {
+    [self countCommandOfType:GLTFDrawCommandTypePopDebugGroup];
+}
+
+@end
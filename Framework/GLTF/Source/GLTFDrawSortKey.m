@@ -0,0 +1,107 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFDrawSortKey.h"
+
+// Field widths shared by opaque and transparent keys
+#define GLTFDrawSortKeyPipelineBits 16
+#define GLTFDrawSortKeyMaterialBits 20
+#define GLTFDrawSortKeyDepthBits 28
+
+// Maps float bit patterns onto unsigned integers that compare in the same order as the floats
+static uint32_t GLTFOrderedBitsFromFloat(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+}
+
+uint64_t GLTFOpaqueDrawSortKey(uint32_t pipelineIndex, uint32_t materialIndex, float viewDepth) {
+    // Non-negative floats compare like their bit patterns, and the sign bit is always clear, so the top
+    // 28 of the remaining 31 bits keep the depth order up to the lowest mantissa bits
+    uint32_t depthBits = 0;
+    if (viewDepth > 0) {
+        memcpy(&depthBits, &viewDepth, sizeof(depthBits));
+    }
+    uint64_t pipeline = pipelineIndex & ((1u << GLTFDrawSortKeyPipelineBits) - 1);
+    uint64_t material = materialIndex & ((1u << GLTFDrawSortKeyMaterialBits) - 1);
+    uint64_t depth = depthBits >> (31 - GLTFDrawSortKeyDepthBits);
+    return (pipeline << (GLTFDrawSortKeyMaterialBits + GLTFDrawSortKeyDepthBits)) |
+           (material << GLTFDrawSortKeyDepthBits) |
+           depth;
+}
+
+uint64_t GLTFTransparentDrawSortKey(uint32_t pipelineIndex, uint32_t materialIndex, float viewDepth) {
+    // The top 28 bits of the inverted ordered pattern, which keep the farther-first order of any depths whose
+    // float representations differ above the lowest four bits
+    uint64_t depth = (~GLTFOrderedBitsFromFloat(viewDepth)) >> (32 - GLTFDrawSortKeyDepthBits);
+    uint64_t pipeline = pipelineIndex & ((1u << GLTFDrawSortKeyPipelineBits) - 1);
+    uint64_t material = materialIndex & ((1u << GLTFDrawSortKeyMaterialBits) - 1);
+    return (depth << (GLTFDrawSortKeyPipelineBits + GLTFDrawSortKeyMaterialBits)) |
+           (pipeline << GLTFDrawSortKeyMaterialBits) |
+           material;
+}
+
+void GLTFRadixSortDrawKeys(uint64_t *keys, uint32_t *values, NSInteger count,
+                           uint64_t *scratchKeys, uint32_t *scratchValues)
+{
+    if (count < 2) {
+        return;
+    }
+    
+    // Counting every byte in a single pass over the keys
+    enum { passCount = sizeof(uint64_t) };
+    NSInteger histograms[passCount][256];
+    memset(histograms, 0, sizeof(histograms));
+    for (NSInteger i = 0; i < count; ++i) {
+        uint64_t key = keys[i];
+        for (int pass = 0; pass < passCount; ++pass) {
+            ++histograms[pass][(key >> (pass * 8)) & 0xFF];
+        }
+    }
+    
+    uint64_t *sourceKeys = keys, *destinationKeys = scratchKeys;
+    uint32_t *sourceValues = values, *destinationValues = scratchValues;
+    for (int pass = 0; pass < passCount; ++pass) {
+        NSInteger *histogram = histograms[pass];
+        int shift = pass * 8;
+        if (histogram[(sourceKeys[0] >> shift) & 0xFF] == count) {
+            continue;
+        }
+        
+        NSInteger offset = 0;
+        for (int digit = 0; digit < 256; ++digit) {
+            NSInteger digitCount = histogram[digit];
+            histogram[digit] = offset;
+            offset += digitCount;
+        }
+        
+        for (NSInteger i = 0; i < count; ++i) {
+            uint64_t key = sourceKeys[i];
+            NSInteger destination = histogram[(key >> shift) & 0xFF]++;
+            destinationKeys[destination] = key;
+            destinationValues[destination] = sourceValues[i];
+        }
+        
+        uint64_t *swapKeys = sourceKeys; sourceKeys = destinationKeys; destinationKeys = swapKeys;
+        uint32_t *swapValues = sourceValues; sourceValues = destinationValues; destinationValues = swapValues;
+    }
+    
+    if (sourceKeys != keys) {
+        memcpy(keys, sourceKeys, sizeof(uint64_t) * count);
+        memcpy(values, sourceValues, sizeof(uint32_t) * count);
+    }
+}
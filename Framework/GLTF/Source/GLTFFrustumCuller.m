@@ -0,0 +1,125 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFFrustumCuller.h"
+#import "GLTFNode.h"
+#import "GLTFSceneBVH.h"
+#import "GLTFTransformStore.h"
+
+@interface GLTFFrustumCuller ()
+@property (nonatomic, strong) GLTFSceneBVH *bvh;
+@property (nonatomic, strong) NSMutableData *leafVisibility;
+@property (nonatomic, strong) NSMutableData *subtreeVisibility;
+// Transform indices of the nodes with MSFT_lod alternatives, found again whenever the hierarchy's nodes change
+@property (nonatomic, strong) NSArray<GLTFNode *> *indexedNodes;
+@property (nonatomic, strong) NSMutableData *levelOfDetailIndices;
+@end
+
+@implementation GLTFFrustumCuller
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        _leafVisibility = [NSMutableData data];
+        _subtreeVisibility = [NSMutableData data];
+        _levelOfDetailIndices = [NSMutableData data];
+    }
+    return self;
+}
+
+- (void)beginWithFrustum:(GLTFFrustum)frustum {
+    _frustum = frustum;
+    _statistics = (GLTFCullingStatistics){ 0 };
+}
+
+- (void)cullWithBoundingVolumeHierarchy:(GLTFSceneBVH *)bvh {
+    self.bvh = bvh;
+    if (bvh == nil) {
+        return;
+    }
+    
+    [bvh refit];
+    self.leafVisibility.length = MAX(bvh.leafCount, 1) * sizeof(bool);
+    GLTFCullingStatistics bvhStatistics = [bvh cullWithFrustum:_frustum visibility:self.leafVisibility.mutableBytes];
+    // Every leaf is counted here, whether or not it's asked about later
+    _statistics.testedBoundsCount += bvhStatistics.testedBoundsCount;
+    _statistics.visibleCount += bvhStatistics.visibleCount;
+    _statistics.culledCount += bvhStatistics.culledCount;
+    
+    NSArray<GLTFNode *> *nodes = bvh.transformStore.nodes;
+    if (nodes != self.indexedNodes) {
+        self.indexedNodes = nodes;
+        self.levelOfDetailIndices.length = 0;
+        for (NSInteger i = 0; i < (NSInteger)nodes.count; ++i) {
+            if (nodes[i].levelOfDetailNodes.count > 0) {
+                int32_t index = (int32_t)i;
+                [self.levelOfDetailIndices appendBytes:&index length:sizeof(index)];
+            }
+        }
+    }
+    
+    // Zeroed, then seeded with the nodes that must always be visited
+    self.subtreeVisibility.length = 0;
+    self.subtreeVisibility.length = MAX(nodes.count, 1) * sizeof(bool);
+    bool *subtreeVisibility = self.subtreeVisibility.mutableBytes;
+    const int32_t *levelOfDetailIndices = self.levelOfDetailIndices.bytes;
+    NSInteger levelOfDetailCount = self.levelOfDetailIndices.length / sizeof(int32_t);
+    for (NSInteger i = 0; i < levelOfDetailCount; ++i) {
+        subtreeVisibility[levelOfDetailIndices[i]] = true;
+    }
+    [bvh getSubtreeVisibility:subtreeVisibility fromLeafVisibility:self.leafVisibility.bytes];
+}
+
+- (NSInteger)transformIndexOfNode:(GLTFNode *)node {
+    NSInteger index = [self.bvh.transformStore indexOfNode:node];
+    if (index < 0 || index >= (NSInteger)self.indexedNodes.count || self.indexedNodes[index] != node) {
+        return -1;
+    }
+    return index;
+}
+
+- (BOOL)isSubtreeOfNodeVisible:(GLTFNode *)node {
+    if (self.bvh == nil) {
+        return YES;
+    }
+    NSInteger index = [self transformIndexOfNode:node];
+    return (index < 0) || ((const bool *)self.subtreeVisibility.bytes)[index];
+}
+
+- (BOOL)isSubmeshAtIndex:(NSInteger)submeshIndex
+                  ofNode:(GLTFNode *)node
+  visibleWithLocalBounds:(GLTFBoundingBox)localBounds
+             modelMatrix:(simd_float4x4)modelMatrix
+{
+    NSInteger leafIndex = (self.bvh != nil) ? [self.bvh leafIndexForNode:node submeshIndex:submeshIndex] : -1;
+    if (leafIndex >= 0) {
+        return ((const bool *)self.leafVisibility.bytes)[leafIndex];
+    }
+    
+    GLTFBoundingBox bounds = localBounds;
+    GLTFBoundingBoxTransform(&bounds, modelMatrix);
+    uint32_t planeMask = GLTFFrustumAllPlanesMask;
+    BOOL visible = (GLTFFrustumContainsBox(&_frustum, bounds, &planeMask) != GLTFFrustumContainmentOutside);
+    ++_statistics.testedBoundsCount;
+    if (visible) {
+        ++_statistics.visibleCount;
+    } else {
+        ++_statistics.culledCount;
+    }
+    return visible;
+}
+
+@end
@@ -18,9 +18,40 @@
 #import "GLTFVertexDescriptor.h"
 #import "GLTFAccessor.h"
 #import "GLTFBufferView.h"
+#import "GLTFTriangleBVH.h"
 #import "GLTFUtilities.h"
 
+@interface GLTFMesh ()
+@property (nonatomic, strong) NSData *defaultMorphTargetWeightData;
+@end
+
 @implementation GLTFMesh
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        _defaultMorphTargetWeightData = [NSData data];
+    }
+    return self;
+}
+
+- (void)setDefaultMorphTargetWeights:(NSArray<NSNumber *> *)defaultMorphTargetWeights {
+    NSMutableData *data = [NSMutableData dataWithLength:sizeof(float) * defaultMorphTargetWeights.count];
+    GLTFGetFloatsFromNumbers(defaultMorphTargetWeights, data.mutableBytes);
+    _defaultMorphTargetWeightData = data;
+}
+
+- (NSArray<NSNumber *> *)defaultMorphTargetWeights {
+    return GLTFNumbersFromFloats(self.defaultMorphTargetWeightValues, self.defaultMorphTargetWeightCount);
+}
+
+- (NSInteger)defaultMorphTargetWeightCount {
+    return _defaultMorphTargetWeightData.length / sizeof(float);
+}
+
+- (const float *)defaultMorphTargetWeightValues {
+    return (_defaultMorphTargetWeightData.length > 0) ? _defaultMorphTargetWeightData.bytes : NULL;
+}
+
 @end
 
 @implementation GLTFMorphTarget
@@ -28,6 +59,8 @@
 
 @interface GLTFSubmesh ()
 @property (nonatomic, strong) GLTFVertexDescriptor *cachedVertexDescriptor;
+@property (nonatomic, strong) GLTFTriangleBVH *cachedTriangleBVH;
+@property (nonatomic, assign) BOOL builtTriangleBVH;
 @end
 
 @implementation GLTFSubmesh
@@ -35,6 +68,7 @@
 - (instancetype)init {
     if ((self = [super init])) {
         _primitiveType = GLTFPrimitiveTypeTriangles;
+        _levelsOfDetail = @[];
     }
     return self;
 }
@@ -42,6 +76,10 @@
 - (void)setAccessorsForAttributes:(NSDictionary *)accessorsForAttributes {
     _accessorsForAttributes = accessorsForAttributes;
     _cachedVertexDescriptor = nil;
+    @synchronized (self) {
+        _cachedTriangleBVH = nil;
+        _builtTriangleBVH = NO;
+    }
 }
 
 - (GLTFVertexDescriptor *)vertexDescriptor {
@@ -66,4 +104,15 @@
     return self.cachedVertexDescriptor;
 }
 
+// Ray casts from several threads may ask at once
+- (GLTFTriangleBVH *)triangleBVH {
+    @synchronized (self) {
+        if (!_builtTriangleBVH) {
+            _cachedTriangleBVH = [[GLTFTriangleBVH alloc] initWithSubmesh:self];
+            _builtTriangleBVH = YES;
+        }
+        return _cachedTriangleBVH;
+    }
+}
+
 @end
@@ -0,0 +1,329 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFMeshSimplifier.h"
+#import "GLTFAccessor.h"
+
+@import simd;
+
+typedef struct {
+    double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+    double w;
+} GLTFQuadric;
+
+typedef struct {
+    uint32_t from;
+    uint32_t to;
+    float cost;
+} GLTFEdgeCollapse;
+
+static void GLTFQuadricAddPlane(GLTFQuadric *q, double a, double b, double c, double d, double w) {
+    q->a2 += w * a * a; q->ab += w * a * b; q->ac += w * a * c; q->ad += w * a * d;
+    q->b2 += w * b * b; q->bc += w * b * c; q->bd += w * b * d;
+    q->c2 += w * c * c; q->cd += w * c * d;
+    q->d2 += w * d * d;
+    q->w += w;
+}
+
+static void GLTFQuadricAdd(GLTFQuadric *q, const GLTFQuadric *r) {
+    q->a2 += r->a2; q->ab += r->ab; q->ac += r->ac; q->ad += r->ad;
+    q->b2 += r->b2; q->bc += r->bc; q->bd += r->bd;
+    q->c2 += r->c2; q->cd += r->cd;
+    q->d2 += r->d2;
+    q->w += r->w;
+}
+
+static double GLTFQuadricError(const GLTFQuadric *q, simd_float3 v) {
+    double x = v.x, y = v.y, z = v.z;
+    double e = q->a2 * x * x + 2 * q->ab * x * y + 2 * q->ac * x * z + 2 * q->ad * x
+             + q->b2 * y * y + 2 * q->bc * y * z + 2 * q->bd * y
+             + q->c2 * z * z + 2 * q->cd * z
+             + q->d2;
+    // Normalizing by the accumulated area makes this a mean squared distance rather than a sum
+    return (q->w > 0) ? fabs(e) / q->w : fabs(e);
+}
+
+static int GLTFEdgeCollapseCompare(const void *lhs, const void *rhs) {
+    float a = ((const GLTFEdgeCollapse *)lhs)->cost;
+    float b = ((const GLTFEdgeCollapse *)rhs)->cost;
+    return (a < b) ? -1 : ((a > b) ? 1 : 0);
+}
+
+static uint64_t GLTFEdgeKey(uint32_t a, uint32_t b) {
+    return ((uint64_t)a << 32) | b;
+}
+
+static int GLTFEdgeKeyCompare(const void *lhs, const void *rhs) {
+    uint64_t a = *(const uint64_t *)lhs, b = *(const uint64_t *)rhs;
+    return (a < b) ? -1 : ((a > b) ? 1 : 0);
+}
+
+static bool GLTFEdgeKeyExists(const uint64_t *sortedKeys, size_t count, uint64_t key) {
+    return bsearch(&key, sortedKeys, count, sizeof(uint64_t), GLTFEdgeKeyCompare) != NULL;
+}
+
+// Marks every vertex that lies on an edge without an opposing half-edge. This covers open boundaries
+// as well as UV and normal seams, since seam vertices are split in the index buffer.
+static void GLTFMarkBorderVertices(const uint32_t *indices, size_t indexCount, bool *locked) {
+    uint64_t *halfEdges = malloc(sizeof(uint64_t) * (indexCount ? indexCount : 1));
+    for (size_t i = 0; i < indexCount; i += 3) {
+        for (int e = 0; e < 3; ++e) {
+            halfEdges[i + e] = GLTFEdgeKey(indices[i + e], indices[i + (e + 1) % 3]);
+        }
+    }
+    qsort(halfEdges, indexCount, sizeof(uint64_t), GLTFEdgeKeyCompare);
+    
+    for (size_t i = 0; i < indexCount; i += 3) {
+        for (int e = 0; e < 3; ++e) {
+            uint32_t a = indices[i + e], b = indices[i + (e + 1) % 3];
+            if (!GLTFEdgeKeyExists(halfEdges, indexCount, GLTFEdgeKey(b, a))) {
+                locked[a] = true;
+                locked[b] = true;
+            }
+        }
+    }
+    free(halfEdges);
+}
+
+static simd_float3 GLTFSimplifierPosition(const float *positions, uint32_t index) {
+    return (simd_float3){ positions[index * 3 + 0], positions[index * 3 + 1], positions[index * 3 + 2] };
+}
+
+// Rejects a collapse if moving `from` onto `to` would flip or degenerate any triangle that survives it
+static bool GLTFCollapseFlipsTriangles(uint32_t from, uint32_t to, const uint32_t *indices,
+                                       const uint32_t *adjacencyOffsets, const uint32_t *adjacency,
+                                       const float *positions)
+{
+    simd_float3 target = GLTFSimplifierPosition(positions, to);
+    for (uint32_t k = adjacencyOffsets[from]; k < adjacencyOffsets[from + 1]; ++k) {
+        const uint32_t *triangle = indices + adjacency[k] * 3;
+        if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+            continue; // This triangle collapses away
+        }
+        simd_float3 p[3], q[3];
+        for (int c = 0; c < 3; ++c) {
+            p[c] = GLTFSimplifierPosition(positions, triangle[c]);
+            q[c] = (triangle[c] == from) ? target : p[c];
+        }
+        simd_float3 oldNormal = simd_cross(p[1] - p[0], p[2] - p[0]);
+        simd_float3 newNormal = simd_cross(q[1] - q[0], q[2] - q[0]);
+        if (simd_dot(oldNormal, newNormal) <= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void GLTFSimplifierGetBounds(const float *positions, size_t vertexCount, simd_float3 *minPoint, simd_float3 *maxPoint) {
+    *minPoint = *maxPoint = GLTFSimplifierPosition(positions, 0);
+    for (size_t i = 1; i < vertexCount; ++i) {
+        simd_float3 p = GLTFSimplifierPosition(positions, (uint32_t)i);
+        *minPoint = simd_min(*minPoint, p);
+        *maxPoint = simd_max(*maxPoint, p);
+    }
+}
+
+float GLTFSimplifierExtent(const float *positions, size_t vertexCount) {
+    if (vertexCount == 0) {
+        return 0;
+    }
+    simd_float3 minPoint, maxPoint;
+    GLTFSimplifierGetBounds(positions, vertexCount, &minPoint, &maxPoint);
+    simd_float3 size = maxPoint - minPoint;
+    return fmaxf(fmaxf(size.x, size.y), size.z);
+}
+
+size_t GLTFSimplifyTriangles(uint32_t *destination, const uint32_t *sourceIndices, size_t indexCount,
+                             const float *sourcePositions, size_t vertexCount,
+                             size_t targetIndexCount, float targetError, float *resultError)
+{
+    // Triangles that reference vertices past the end of the positions can't be measured or collapsed
+    size_t validIndexCount = 0;
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        uint32_t a = sourceIndices[i + 0], b = sourceIndices[i + 1], c = sourceIndices[i + 2];
+        if (a < vertexCount && b < vertexCount && c < vertexCount) {
+            destination[validIndexCount++] = a;
+            destination[validIndexCount++] = b;
+            destination[validIndexCount++] = c;
+        }
+    }
+    indexCount = validIndexCount;
+    if (resultError) {
+        *resultError = 0;
+    }
+    if (indexCount == 0 || vertexCount == 0) {
+        return indexCount;
+    }
+    
+    // Normalize positions into the unit cube so error thresholds are scale-independent
+    simd_float3 minPoint, maxPoint;
+    GLTFSimplifierGetBounds(sourcePositions, vertexCount, &minPoint, &maxPoint);
+    simd_float3 size = maxPoint - minPoint;
+    float extent = fmaxf(fmaxf(size.x, size.y), size.z);
+    float invExtent = (extent > 0) ? 1 / extent : 1;
+    
+    float *positions = malloc(sizeof(float) * 3 * vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        simd_float3 p = (GLTFSimplifierPosition(sourcePositions, (uint32_t)i) - minPoint) * invExtent;
+        positions[i * 3 + 0] = p.x;
+        positions[i * 3 + 1] = p.y;
+        positions[i * 3 + 2] = p.z;
+    }
+    
+    bool *locked = calloc(vertexCount, sizeof(bool));
+    GLTFMarkBorderVertices(destination, indexCount, locked);
+    
+    GLTFQuadric *quadrics = calloc(vertexCount, sizeof(GLTFQuadric));
+    for (size_t i = 0; i < indexCount; i += 3) {
+        simd_float3 p0 = GLTFSimplifierPosition(positions, destination[i + 0]);
+        simd_float3 p1 = GLTFSimplifierPosition(positions, destination[i + 1]);
+        simd_float3 p2 = GLTFSimplifierPosition(positions, destination[i + 2]);
+        simd_float3 n = simd_cross(p1 - p0, p2 - p0);
+        float area = simd_length(n);
+        if (area == 0) {
+            continue;
+        }
+        n /= area;
+        for (int c = 0; c < 3; ++c) {
+            GLTFQuadricAddPlane(&quadrics[destination[i + c]], n.x, n.y, n.z, -simd_dot(n, p0), area);
+        }
+    }
+    
+    uint32_t *remap = malloc(sizeof(uint32_t) * vertexCount);
+    bool *touched = malloc(sizeof(bool) * vertexCount);
+    uint32_t *adjacencyOffsets = malloc(sizeof(uint32_t) * (vertexCount + 1));
+    uint32_t *adjacency = malloc(sizeof(uint32_t) * indexCount);
+    GLTFEdgeCollapse *collapses = malloc(sizeof(GLTFEdgeCollapse) * indexCount * 2);
+    
+    double maxErrorSquared = (double)targetError * targetError;
+    float worstError = 0;
+    
+    while (indexCount > targetIndexCount) {
+        size_t triangleCount = indexCount / 3;
+        
+        memset(adjacencyOffsets, 0, sizeof(uint32_t) * (vertexCount + 1));
+        for (size_t i = 0; i < indexCount; ++i) {
+            adjacencyOffsets[destination[i] + 1] += 1;
+        }
+        for (size_t v = 0; v < vertexCount; ++v) {
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        }
+        for (size_t i = 0; i < indexCount; ++i) {
+            uint32_t v = destination[i];
+            adjacency[adjacencyOffsets[v]++] = (uint32_t)(i / 3);
+        }
+        for (size_t v = vertexCount; v > 0; --v) {
+            adjacencyOffsets[v] = adjacencyOffsets[v - 1];
+        }
+        adjacencyOffsets[0] = 0;
+        
+        size_t collapseCount = 0;
+        for (size_t i = 0; i < indexCount; i += 3) {
+            for (int e = 0; e < 3; ++e) {
+                uint32_t a = destination[i + e], b = destination[i + (e + 1) % 3];
+                GLTFQuadric q = quadrics[a];
+                GLTFQuadricAdd(&q, &quadrics[b]);
+                if (!locked[a]) {
+                    float cost = (float)GLTFQuadricError(&q, GLTFSimplifierPosition(positions, b));
+                    collapses[collapseCount++] = (GLTFEdgeCollapse){ a, b, cost };
+                }
+                if (!locked[b]) {
+                    float cost = (float)GLTFQuadricError(&q, GLTFSimplifierPosition(positions, a));
+                    collapses[collapseCount++] = (GLTFEdgeCollapse){ b, a, cost };
+                }
+            }
+        }
+        if (collapseCount == 0) {
+            break;
+        }
+        qsort(collapses, collapseCount, sizeof(GLTFEdgeCollapse), GLTFEdgeCollapseCompare);
+        
+        for (size_t v = 0; v < vertexCount; ++v) {
+            remap[v] = (uint32_t)v;
+        }
+        memset(touched, 0, sizeof(bool) * vertexCount);
+        
+        // Each collapse removes about two triangles; stop a little past what we need in this pass
+        size_t trianglesToRemove = triangleCount - targetIndexCount / 3;
+        size_t collapsesWanted = trianglesToRemove / 2 + 1;
+        size_t collapsesPerformed = 0;
+        
+        for (size_t c = 0; c < collapseCount && collapsesPerformed < collapsesWanted; ++c) {
+            GLTFEdgeCollapse collapse = collapses[c];
+            if (collapse.cost > maxErrorSquared) {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to]) {
+                continue;
+            }
+            if (GLTFCollapseFlipsTriangles(collapse.from, collapse.to, destination, adjacencyOffsets, adjacency, positions)) {
+                continue;
+            }
+            
+            remap[collapse.from] = collapse.to;
+            GLTFQuadricAdd(&quadrics[collapse.to], &quadrics[collapse.from]);
+            
+            // Lock the one-ring of the source so neighboring collapses see up-to-date geometry next pass
+            for (uint32_t k = adjacencyOffsets[collapse.from]; k < adjacencyOffsets[collapse.from + 1]; ++k) {
+                const uint32_t *triangle = destination + adjacency[k] * 3;
+                touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+            }
+            touched[collapse.to] = true;
+            
+            worstError = fmaxf(worstError, sqrtf(collapse.cost));
+            ++collapsesPerformed;
+        }
+        
+        if (collapsesPerformed == 0) {
+            break;
+        }
+        
+        size_t writeIndex = 0;
+        for (size_t i = 0; i < indexCount; i += 3) {
+            uint32_t a = remap[destination[i + 0]], b = remap[destination[i + 1]], c = remap[destination[i + 2]];
+            if (a != b && b != c && a != c) {
+                destination[writeIndex++] = a;
+                destination[writeIndex++] = b;
+                destination[writeIndex++] = c;
+            }
+        }
+        indexCount = writeIndex;
+    }
+    
+    if (resultError) {
+        *resultError = worstError;
+    }
+    
+    free(collapses);
+    free(adjacency);
+    free(adjacencyOffsets);
+    free(touched);
+    free(remap);
+    free(quadrics);
+    free(locked);
+    free(positions);
+    
+    return indexCount;
+}
+
+@implementation GLTFLevelOfDetail
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"%@ indices: %d; error: %f", super.description, (int)self.indexAccessor.count, self.error];
+}
+
+@end
@@ -0,0 +1,339 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFMeshlet.h"
+#import "GLTFMesh.h"
+#import "GLTFAccessor.h"
+#import "GLTFVertexDescriptor.h"
+
+const NSInteger GLTFMeshletDefaultMaxVertexCount = 64;
+const NSInteger GLTFMeshletDefaultMaxTriangleCount = 124;
+
+static const uint32_t GLTFMeshletSerializationMagic = 0x544C4D47; // 'GMLT'
+static const uint32_t GLTFMeshletSerializationVersion = 1;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t maxVertexCount;
+    uint32_t maxTriangleCount;
+    uint32_t meshletCount;
+    uint32_t vertexIndexCount;
+    uint32_t triangleIndexCount;
+    uint32_t meshletSize;
+} GLTFMeshletSerializationHeader;
+
+static simd_float3 GLTFMeshletPosition(const float *positions, uint32_t index) {
+    return (simd_float3){ positions[index * 3 + 0], positions[index * 3 + 1], positions[index * 3 + 2] };
+}
+
+static void GLTFMeshletComputeBounds(GLTFMeshlet *meshlet, const float *positions,
+                                     const uint32_t *vertexIndices, const uint8_t *triangleIndices,
+                                     simd_float3 *scratchNormals)
+{
+    const uint32_t *localVertices = vertexIndices + meshlet->vertexOffset;
+    const uint8_t *localTriangles = triangleIndices + meshlet->triangleOffset;
+    
+    simd_float3 minPoint = GLTFMeshletPosition(positions, localVertices[0]);
+    simd_float3 maxPoint = minPoint;
+    for (uint32_t i = 1; i < meshlet->vertexCount; ++i) {
+        simd_float3 p = GLTFMeshletPosition(positions, localVertices[i]);
+        minPoint = simd_min(minPoint, p);
+        maxPoint = simd_max(maxPoint, p);
+    }
+    
+    simd_float3 center = (minPoint + maxPoint) * 0.5f;
+    float radiusSquared = 0;
+    for (uint32_t i = 0; i < meshlet->vertexCount; ++i) {
+        simd_float3 p = GLTFMeshletPosition(positions, localVertices[i]);
+        radiusSquared = fmaxf(radiusSquared, simd_distance_squared(p, center));
+    }
+    meshlet->bounds.center = center;
+    meshlet->bounds.radius = sqrtf(radiusSquared);
+    
+    simd_float3 axis = 0;
+    uint32_t normalCount = 0;
+    for (uint32_t t = 0; t < meshlet->triangleCount; ++t) {
+        simd_float3 p0 = GLTFMeshletPosition(positions, localVertices[localTriangles[t * 3 + 0]]);
+        simd_float3 p1 = GLTFMeshletPosition(positions, localVertices[localTriangles[t * 3 + 1]]);
+        simd_float3 p2 = GLTFMeshletPosition(positions, localVertices[localTriangles[t * 3 + 2]]);
+        simd_float3 n = simd_cross(p1 - p0, p2 - p0);
+        float length = simd_length(n);
+        if (length > 0) {
+            n /= length;
+            axis += n;
+            scratchNormals[normalCount++] = n;
+        }
+    }
+    
+    meshlet->coneApex = center;
+    meshlet->coneAxis = 0;
+    meshlet->coneCutoff = 1;
+    
+    float axisLength = simd_length(axis);
+    if (normalCount == 0 || axisLength == 0) {
+        return;
+    }
+    axis /= axisLength;
+    
+    float minDot = 1;
+    for (uint32_t i = 0; i < normalCount; ++i) {
+        minDot = fminf(minDot, simd_dot(scratchNormals[i], axis));
+    }
+    
+    // Cones wider than a hemisphere (or nearly so) can never be rejected, so don't bother
+    if (minDot <= 0.1f) {
+        meshlet->coneAxis = axis;
+        return;
+    }
+    
+    // Move the apex back along the axis until every triangle plane is in front of it
+    float maxT = 0;
+    uint32_t normalIndex = 0;
+    for (uint32_t t = 0; t < meshlet->triangleCount; ++t) {
+        simd_float3 p0 = GLTFMeshletPosition(positions, localVertices[localTriangles[t * 3 + 0]]);
+        simd_float3 p1 = GLTFMeshletPosition(positions, localVertices[localTriangles[t * 3 + 1]]);
+        simd_float3 p2 = GLTFMeshletPosition(positions, localVertices[localTriangles[t * 3 + 2]]);
+        if (simd_length_squared(simd_cross(p1 - p0, p2 - p0)) == 0) {
+            continue;
+        }
+        simd_float3 n = scratchNormals[normalIndex++];
+        float dc = simd_dot(center - p0, n);
+        float dn = simd_dot(axis, n);
+        maxT = fmaxf(maxT, dc / dn);
+    }
+    
+    meshlet->coneApex = center - axis * maxT;
+    meshlet->coneAxis = axis;
+    meshlet->coneCutoff = sqrtf(1 - minDot * minDot);
+}
+
+@interface GLTFMeshletSet ()
+@property (nonatomic, strong) NSData *meshletData;
+@property (nonatomic, strong) NSData *vertexIndexData;
+@property (nonatomic, strong) NSData *triangleIndexData;
+@end
+
+@implementation GLTFMeshletSet
+
+- (instancetype)initWithSubmesh:(GLTFSubmesh *)submesh
+                 maxVertexCount:(NSInteger)maxVertexCount
+               maxTriangleCount:(NSInteger)maxTriangleCount
+{
+    if (submesh.primitiveType != GLTFPrimitiveTypeTriangles) {
+        return nil;
+    }
+    
+    GLTFAccessor *positionAccessor = submesh.accessorsForAttributes[GLTFAttributeSemanticPosition];
+    if (positionAccessor == nil || positionAccessor.dimension != GLTFDataDimensionVector3 || positionAccessor.contents == NULL) {
+        return nil;
+    }
+    
+    if ((self = [super init])) {
+        // Local vertex indices are stored in a byte, and 0xFF is reserved as a sentinel
+        _maxVertexCount = MIN(MAX(maxVertexCount, 3), 255);
+        _maxTriangleCount = MAX(maxTriangleCount, 1);
+        
+        uint32_t vertexCount = (uint32_t)positionAccessor.count;
+        float *positions = malloc(sizeof(float) * 3 * vertexCount);
+        [positionAccessor getFloatValues:positions];
+        
+        GLTFAccessor *indexAccessor = submesh.indexAccessor;
+        uint32_t indexCount = (uint32_t)(indexAccessor ? indexAccessor.count : vertexCount);
+        uint32_t *indices = malloc(sizeof(uint32_t) * MAX(indexCount, 1));
+        if (indexAccessor != nil) {
+            [indexAccessor getUnsignedIntValues:indices];
+        } else {
+            for (uint32_t i = 0; i < indexCount; ++i) {
+                indices[i] = i;
+            }
+        }
+        
+        uint32_t triangleCount = indexCount / 3;
+        GLTFMeshlet *meshlets = malloc(sizeof(GLTFMeshlet) * MAX(triangleCount, 1));
+        uint32_t *vertexIndices = malloc(sizeof(uint32_t) * MAX(triangleCount * 3, 1));
+        uint8_t *triangleIndices = malloc(sizeof(uint8_t) * MAX(triangleCount * 3, 1));
+        simd_float3 *scratchNormals = malloc(sizeof(simd_float3) * _maxTriangleCount);
+        uint8_t *localIndices = malloc(MAX(vertexCount, 1));
+        memset(localIndices, 0xFF, vertexCount);
+        
+        uint32_t meshletCount = 0;
+        GLTFMeshlet current = { 0 };
+        
+        for (uint32_t t = 0; t < triangleCount; ++t) {
+            uint32_t a = indices[t * 3 + 0], b = indices[t * 3 + 1], c = indices[t * 3 + 2];
+            if (a >= vertexCount || b >= vertexCount || c >= vertexCount || a == b || b == c || a == c) {
+                continue;
+            }
+            
+            uint32_t newVertexCount = (localIndices[a] == 0xFF) + (localIndices[b] == 0xFF) + (localIndices[c] == 0xFF);
+            if (current.vertexCount + newVertexCount > _maxVertexCount || current.triangleCount + 1 > _maxTriangleCount) {
+                GLTFMeshletComputeBounds(&current, positions, vertexIndices, triangleIndices, scratchNormals);
+                meshlets[meshletCount++] = current;
+                for (uint32_t i = 0; i < current.vertexCount; ++i) {
+                    localIndices[vertexIndices[current.vertexOffset + i]] = 0xFF;
+                }
+                GLTFMeshlet next = { 0 };
+                next.vertexOffset = current.vertexOffset + current.vertexCount;
+                next.triangleOffset = current.triangleOffset + current.triangleCount * 3;
+                current = next;
+            }
+            
+            uint32_t corners[3] = { a, b, c };
+            for (int k = 0; k < 3; ++k) {
+                uint32_t v = corners[k];
+                if (localIndices[v] == 0xFF) {
+                    localIndices[v] = (uint8_t)current.vertexCount;
+                    vertexIndices[current.vertexOffset + current.vertexCount] = v;
+                    current.vertexCount += 1;
+                }
+                triangleIndices[current.triangleOffset + current.triangleCount * 3 + k] = localIndices[v];
+            }
+            current.triangleCount += 1;
+        }
+        
+        if (current.triangleCount > 0) {
+            GLTFMeshletComputeBounds(&current, positions, vertexIndices, triangleIndices, scratchNormals);
+            meshlets[meshletCount++] = current;
+        }
+        
+        uint32_t usedVertexIndexCount = current.vertexOffset + current.vertexCount;
+        uint32_t usedTriangleIndexCount = current.triangleOffset + current.triangleCount * 3;
+        
+        _meshletData = [NSData dataWithBytes:meshlets length:sizeof(GLTFMeshlet) * meshletCount];
+        _vertexIndexData = [NSData dataWithBytes:vertexIndices length:sizeof(uint32_t) * usedVertexIndexCount];
+        _triangleIndexData = [NSData dataWithBytes:triangleIndices length:sizeof(uint8_t) * usedTriangleIndexCount];
+        
+        free(localIndices);
+        free(scratchNormals);
+        free(triangleIndices);
+        free(vertexIndices);
+        free(meshlets);
+        free(indices);
+        free(positions);
+    }
+    return self;
+}
+
+- (instancetype)initWithSerializedData:(NSData *)data {
+    GLTFMeshletSerializationHeader header;
+    if (data.length < sizeof(header)) {
+        return nil;
+    }
+    [data getBytes:&header length:sizeof(header)];
+    if (header.magic != GLTFMeshletSerializationMagic ||
+        header.version != GLTFMeshletSerializationVersion ||
+        header.meshletSize != sizeof(GLTFMeshlet))
+    {
+        return nil;
+    }
+    
+    NSUInteger meshletLength = header.meshletCount * sizeof(GLTFMeshlet);
+    NSUInteger vertexIndexLength = header.vertexIndexCount * sizeof(uint32_t);
+    NSUInteger triangleIndexLength = header.triangleIndexCount * sizeof(uint8_t);
+    if (data.length < sizeof(header) + meshletLength + vertexIndexLength + triangleIndexLength) {
+        return nil;
+    }
+    
+    if ((self = [super init])) {
+        _maxVertexCount = header.maxVertexCount;
+        _maxTriangleCount = header.maxTriangleCount;
+        NSUInteger offset = sizeof(header);
+        _meshletData = [data subdataWithRange:NSMakeRange(offset, meshletLength)];
+        offset += meshletLength;
+        _vertexIndexData = [data subdataWithRange:NSMakeRange(offset, vertexIndexLength)];
+        offset += vertexIndexLength;
+        _triangleIndexData = [data subdataWithRange:NSMakeRange(offset, triangleIndexLength)];
+    }
+    return self;
+}
+
+- (NSData *)serializedData {
+    GLTFMeshletSerializationHeader header;
+    header.magic = GLTFMeshletSerializationMagic;
+    header.version = GLTFMeshletSerializationVersion;
+    header.maxVertexCount = (uint32_t)self.maxVertexCount;
+    header.maxTriangleCount = (uint32_t)self.maxTriangleCount;
+    header.meshletCount = (uint32_t)self.meshletCount;
+    header.vertexIndexCount = (uint32_t)self.vertexIndexCount;
+    header.triangleIndexCount = (uint32_t)self.triangleIndexCount;
+    header.meshletSize = sizeof(GLTFMeshlet);
+    
+    NSMutableData *data = [NSMutableData dataWithBytes:&header length:sizeof(header)];
+    [data appendData:self.meshletData];
+    [data appendData:self.vertexIndexData];
+    [data appendData:self.triangleIndexData];
+    return data;
+}
+
+- (NSInteger)meshletCount {
+    return self.meshletData.length / sizeof(GLTFMeshlet);
+}
+
+- (const GLTFMeshlet *)meshlets {
+    return self.meshletData.bytes;
+}
+
+- (NSInteger)vertexIndexCount {
+    return self.vertexIndexData.length / sizeof(uint32_t);
+}
+
+- (const uint32_t *)vertexIndices {
+    return self.vertexIndexData.bytes;
+}
+
+- (NSInteger)triangleIndexCount {
+    return self.triangleIndexData.length;
+}
+
+- (const uint8_t *)triangleIndices {
+    return self.triangleIndexData.bytes;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"%@ meshlets: %d; max vertices: %d; max triangles: %d",
+            super.description, (int)self.meshletCount, (int)self.maxVertexCount, (int)self.maxTriangleCount];
+}
+
+@end
+
+NSInteger GLTFMeshletCull(const GLTFMeshlet *meshlets, NSInteger meshletCount, simd_float4x4 modelMatrix,
+                          const GLTFFrustum *frustum, simd_float3 cameraPosition, uint32_t *visibleIndices)
+{
+    simd_float3x3 normalMatrix = simd_inverse(simd_transpose(GLTFMatrixUpperLeft3x3(modelMatrix)));
+    
+    NSInteger visibleCount = 0;
+    for (NSInteger i = 0; i < meshletCount; ++i) {
+        const GLTFMeshlet *meshlet = &meshlets[i];
+        
+        GLTFBoundingSphere worldBounds = GLTFBoundingSphereTransform(meshlet->bounds, modelMatrix);
+        if (!GLTFFrustumIntersectsSphere(frustum, worldBounds)) {
+            continue;
+        }
+        
+        if (meshlet->coneCutoff < 1) {
+            simd_float3 apex = matrix_multiply(modelMatrix, simd_make_float4(meshlet->coneApex, 1)).xyz;
+            simd_float3 axis = simd_normalize(matrix_multiply(normalMatrix, meshlet->coneAxis));
+            if (simd_dot(simd_normalize(apex - cameraPosition), axis) >= meshlet->coneCutoff) {
+                continue;
+            }
+        }
+        
+        visibleIndices[visibleCount++] = (uint32_t)i;
+    }
+    return visibleCount;
+}
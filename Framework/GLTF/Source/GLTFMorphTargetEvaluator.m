@@ -0,0 +1,224 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+#import "GLTFMorphTargetEvaluator.h"
+#import "GLTFAccessor.h"
+#import "GLTFMesh.h"
+#import "GLTFVertexDescriptor.h"
+
+// A target that moves more than this fraction of the vertices is kept dense, without an index per vertex
+#define GLTFMorphTargetDenseFraction 0.5
+
+typedef struct {
+    int32_t *vertexIndices; // NULL if the target is dense
+    simd_float4 *deltas;    // deltaStride per moved vertex: position, then normal and tangent if present
+    NSInteger deltaCount;
+} GLTFMorphTargetDeltas;
+
+static BOOL GLTFMorphTargetAccessorCoversVertices(GLTFAccessor *accessor, NSInteger vertexCount) {
+    return (accessor != nil) && (accessor.count >= vertexCount) && (accessor.contents != NULL);
+}
+
+// Reads a vector attribute as float4s, or leaves them zero if the accessor is missing or too short
+static void GLTFMorphTargetReadVectors(GLTFAccessor *accessor, NSInteger vertexCount, simd_float4 *vectors, float w) {
+    for (NSInteger v = 0; v < vertexCount; ++v) {
+        vectors[v] = (simd_float4){ 0, 0, 0, w };
+    }
+    if (!GLTFMorphTargetAccessorCoversVertices(accessor, vertexCount)) {
+        return;
+    }
+    NSInteger componentCount = MIN(accessor.componentCount, 4);
+    float *values = malloc(sizeof(float) * accessor.count * accessor.componentCount);
+    [accessor getFloatValues:values];
+    for (NSInteger v = 0; v < vertexCount; ++v) {
+        for (NSInteger c = 0; c < componentCount; ++c) {
+            vectors[v][c] = values[v * accessor.componentCount + c];
+        }
+    }
+    free(values);
+}
+
+static bool GLTFMorphTargetMovesVertex(const simd_float4 *positionDeltas, const simd_float4 *normalDeltas,
+                                       const simd_float4 *tangentDeltas, NSInteger v)
+{
+    return simd_any(positionDeltas[v] != 0) || simd_any(normalDeltas[v] != 0) || simd_any(tangentDeltas[v] != 0);
+}
+
+@interface GLTFMorphTargetEvaluator () {
+    simd_float4 *_basePositions;
+    simd_float4 *_baseNormals;
+    simd_float4 *_baseTangents;
+    GLTFMorphTargetDeltas *_targets;
+    NSInteger _deltaStride;
+}
+@end
+
+@implementation GLTFMorphTargetEvaluator
+
+- (instancetype)initWithSubmesh:(GLTFSubmesh *)submesh {
+    if ((self = [super init])) {
+        _submesh = submesh;
+        NSDictionary<NSString *, GLTFAccessor *> *accessors = submesh.accessorsForAttributes;
+        GLTFAccessor *positionAccessor = accessors[GLTFAttributeSemanticPosition];
+        GLTFAccessor *normalAccessor = accessors[GLTFAttributeSemanticNormal];
+        GLTFAccessor *tangentAccessor = accessors[GLTFAttributeSemanticTangent];
+        _vertexCount = positionAccessor.count;
+        // Base normals and tangents that don't cover every vertex would read as zero and normalize to NaN
+        _hasNormals = GLTFMorphTargetAccessorCoversVertices(normalAccessor, _vertexCount);
+        _hasTangents = GLTFMorphTargetAccessorCoversVertices(tangentAccessor, _vertexCount);
+        _deltaStride = 1 + (_hasNormals ? 1 : 0) + (_hasTangents ? 1 : 0);
+        
+        NSInteger vertexCount = MAX(_vertexCount, 1);
+        _basePositions = malloc(sizeof(simd_float4) * vertexCount);
+        GLTFMorphTargetReadVectors(positionAccessor, _vertexCount, _basePositions, 0);
+        if (_hasNormals) {
+            _baseNormals = malloc(sizeof(simd_float4) * vertexCount);
+            GLTFMorphTargetReadVectors(normalAccessor, _vertexCount, _baseNormals, 0);
+        }
+        if (_hasTangents) {
+            _baseTangents = malloc(sizeof(simd_float4) * vertexCount);
+            GLTFMorphTargetReadVectors(tangentAccessor, _vertexCount, _baseTangents, 1);
+        }
+        
+        NSArray<GLTFMorphTarget *> *morphTargets = submesh.morphTargets;
+        _targetCount = morphTargets.count;
+        _targets = calloc(MAX(_targetCount, 1), sizeof(GLTFMorphTargetDeltas));
+        
+        simd_float4 *positionDeltas = malloc(sizeof(simd_float4) * vertexCount);
+        simd_float4 *normalDeltas = malloc(sizeof(simd_float4) * vertexCount);
+        simd_float4 *tangentDeltas = malloc(sizeof(simd_float4) * vertexCount);
+        for (NSInteger t = 0; t < _targetCount; ++t) {
+            NSDictionary<NSString *, GLTFAccessor *> *targetAccessors = morphTargets[t].accessorsForAttributes;
+            GLTFMorphTargetReadVectors(targetAccessors[GLTFAttributeSemanticPosition], _vertexCount, positionDeltas, 0);
+            GLTFMorphTargetReadVectors(_hasNormals ? targetAccessors[GLTFAttributeSemanticNormal] : nil, _vertexCount, normalDeltas, 0);
+            GLTFMorphTargetReadVectors(_hasTangents ? targetAccessors[GLTFAttributeSemanticTangent] : nil, _vertexCount, tangentDeltas, 0);
+            
+            NSInteger movedCount = 0;
+            for (NSInteger v = 0; v < _vertexCount; ++v) {
+                if (GLTFMorphTargetMovesVertex(positionDeltas, normalDeltas, tangentDeltas, v)) {
+                    ++movedCount;
+                }
+            }
+            
+            GLTFMorphTargetDeltas *target = &_targets[t];
+            BOOL dense = (movedCount > _vertexCount * GLTFMorphTargetDenseFraction);
+            target->deltaCount = dense ? _vertexCount : movedCount;
+            target->deltas = malloc(sizeof(simd_float4) * _deltaStride * MAX(target->deltaCount, 1));
+            target->vertexIndices = dense ? NULL : malloc(sizeof(int32_t) * MAX(movedCount, 1));
+            NSInteger d = 0;
+            for (NSInteger v = 0; v < _vertexCount; ++v) {
+                if (!dense && !GLTFMorphTargetMovesVertex(positionDeltas, normalDeltas, tangentDeltas, v)) {
+                    continue;
+                }
+                simd_float4 *deltas = target->deltas + d * _deltaStride;
+                NSInteger k = 0;
+                deltas[k++] = positionDeltas[v];
+                if (_hasNormals) {
+                    deltas[k++] = normalDeltas[v];
+                }
+                if (_hasTangents) {
+                    deltas[k++] = (simd_float4){ tangentDeltas[v].x, tangentDeltas[v].y, tangentDeltas[v].z, 0 };
+                }
+                if (!dense) {
+                    target->vertexIndices[d] = (int32_t)v;
+                }
+                ++d;
+            }
+            _deltaCount += target->deltaCount;
+        }
+        free(positionDeltas);
+        free(normalDeltas);
+        free(tangentDeltas);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    for (NSInteger t = 0; t < _targetCount; ++t) {
+        free(_targets[t].vertexIndices);
+        free(_targets[t].deltas);
+    }
+    free(_targets);
+    free(_basePositions);
+    free(_baseNormals);
+    free(_baseTangents);
+}
+
+- (void)evaluateWithWeights:(const float *)weights
+                      count:(NSInteger)count
+                  positions:(simd_float3 *)positions
+                    normals:(simd_float3 *)normals
+                   tangents:(simd_float4 *)tangents
+{
+    NSInteger vertexCount = _vertexCount;
+    NSInteger stride = _deltaStride;
+    if (!_hasNormals) {
+        normals = NULL;
+    }
+    if (!_hasTangents) {
+        tangents = NULL;
+    }
+    // Offsets of each attribute's delta within a vertex's run of deltas
+    NSInteger normalOffset = 1, tangentOffset = _hasNormals ? 2 : 1;
+    
+    // simd_float3 has the size and alignment of simd_float4, so the bases copy straight across
+    if (positions != NULL) {
+        memcpy(positions, _basePositions, sizeof(simd_float4) * vertexCount);
+    }
+    if (normals != NULL) {
+        memcpy(normals, _baseNormals, sizeof(simd_float4) * vertexCount);
+    }
+    if (tangents != NULL) {
+        memcpy(tangents, _baseTangents, sizeof(simd_float4) * vertexCount);
+    }
+    
+    NSInteger targetCount = MIN(count, _targetCount);
+    for (NSInteger t = 0; t < targetCount; ++t) {
+        float weight = weights[t];
+        if (weight == 0) {
+            continue;
+        }
+        const GLTFMorphTargetDeltas *target = &_targets[t];
+        const int32_t *vertexIndices = target->vertexIndices;
+        NSInteger deltaCount = target->deltaCount;
+        for (NSInteger d = 0; d < deltaCount; ++d) {
+            NSInteger v = (vertexIndices != NULL) ? vertexIndices[d] : d;
+            const simd_float4 *deltas = target->deltas + d * stride;
+            if (positions != NULL) {
+                positions[v] += weight * deltas[0].xyz;
+            }
+            if (normals != NULL) {
+                normals[v] += weight * deltas[normalOffset].xyz;
+            }
+            if (tangents != NULL) {
+                tangents[v] += weight * deltas[tangentOffset];
+            }
+        }
+    }
+    
+    if (normals != NULL) {
+        for (NSInteger v = 0; v < vertexCount; ++v) {
+            normals[v] = simd_normalize(normals[v]);
+        }
+    }
+    if (tangents != NULL) {
+        for (NSInteger v = 0; v < vertexCount; ++v) {
+            tangents[v].xyz = simd_normalize(tangents[v].xyz);
+        }
+    }
+}
+
+@end
@@ -16,14 +16,186 @@
 
 #import "GLTFNode.h"
 #import "GLTFAccessor.h"
+#import "GLTFAnimatedBounds.h"
 #import "GLTFMesh.h"
+#import "GLTFSceneInstance.h"
+#import "GLTFSkin.h"
+#import "GLTFSkinPalette.h"
+#import "GLTFTransformStore.h"
+#import "GLTFTriangleBVH.h"
 #import "GLTFVertexDescriptor.h"
 
 @interface GLTFNode ()
 @property (nonatomic, assign, getter=localTransformIsDirty) BOOL localTransformDirty;
 @property (nonatomic, strong) NSMutableArray *mutableChildren;
+@property (nonatomic, weak) GLTFTransformStore *transformStore;
+@property (nonatomic, assign) NSInteger transformIndex;
+@property (nonatomic, strong) NSMutableData *morphTargetWeightData;
+@property (nonatomic, strong) GLTFAnimatedBounds *cachedAnimatedBounds;
 @end
 
+// Deep enough for nearly every real hierarchy; deeper or bushier ones spill to the heap
+#define GLTFNodeStackInlineCapacity 128
+
+typedef struct {
+    __unsafe_unretained GLTFNode *node; // kept alive by its parent for the duration of the traversal
+    int depth;
+    BOOL childrenVisited;
+} GLTFNodeStackEntry;
+
+typedef struct {
+    GLTFNodeStackEntry *entries;
+    NSUInteger count;
+    NSUInteger capacity;
+    GLTFNodeStackEntry inlineEntries[GLTFNodeStackInlineCapacity];
+} GLTFNodeStack;
+
+static void GLTFNodeStackInit(GLTFNodeStack *stack) {
+    stack->entries = stack->inlineEntries;
+    stack->count = 0;
+    stack->capacity = GLTFNodeStackInlineCapacity;
+}
+
+static void GLTFNodeStackPush(GLTFNodeStack *stack, GLTFNode *node, int depth) {
+    if (stack->count == stack->capacity) {
+        NSUInteger capacity = stack->capacity * 2;
+        if (stack->entries == stack->inlineEntries) {
+            stack->entries = malloc(capacity * sizeof(GLTFNodeStackEntry));
+            memcpy(stack->entries, stack->inlineEntries, stack->count * sizeof(GLTFNodeStackEntry));
+        } else {
+            stack->entries = realloc(stack->entries, capacity * sizeof(GLTFNodeStackEntry));
+        }
+        stack->capacity = capacity;
+    }
+    stack->entries[stack->count++] = (GLTFNodeStackEntry){ node, depth, NO };
+}
+
+static void GLTFNodeStackDestroy(GLTFNodeStack *stack) {
+    if (stack->entries != stack->inlineEntries) {
+        free(stack->entries);
+    }
+}
+
+static void GLTFVisitDepthFirst(NSArray<GLTFNode *> *nodes, int depth, GLTFNodeVisitor visitor) {
+    GLTFNodeStack stack;
+    GLTFNodeStackInit(&stack);
+    // Push in reverse so siblings are popped in their original order
+    for (NSInteger i = nodes.count - 1; i >= 0; --i) {
+        GLTFNodeStackPush(&stack, nodes[i], depth);
+    }
+    while (stack.count > 0) {
+        GLTFNodeStackEntry entry = stack.entries[--stack.count];
+        BOOL recurse = YES;
+        visitor(entry.node, entry.depth, &recurse);
+        if (recurse) {
+            NSUInteger childCount = entry.node.childCount;
+            for (NSInteger i = childCount - 1; i >= 0; --i) {
+                GLTFNodeStackPush(&stack, [entry.node childAtIndex:i], entry.depth + 1);
+            }
+        }
+    }
+    GLTFNodeStackDestroy(&stack);
+}
+
+static void GLTFVisitDepthFirstPostOrder(NSArray<GLTFNode *> *nodes, int depth, GLTFNodeVisitor visitor) {
+    GLTFNodeStack stack;
+    GLTFNodeStackInit(&stack);
+    for (NSInteger i = nodes.count - 1; i >= 0; --i) {
+        GLTFNodeStackPush(&stack, nodes[i], depth);
+    }
+    while (stack.count > 0) {
+        GLTFNodeStackEntry *entry = &stack.entries[stack.count - 1];
+        if (entry->childrenVisited) {
+            BOOL recurse = YES;
+            visitor(entry->node, entry->depth, &recurse);
+            --stack.count;
+        } else {
+            // The entry stays on the stack beneath its children and is visited once they have all been popped
+            entry->childrenVisited = YES;
+            GLTFNode *node = entry->node;
+            int childDepth = entry->depth + 1;
+            NSUInteger childCount = node.childCount;
+            for (NSInteger i = childCount - 1; i >= 0; --i) {
+                // Pushing may reallocate the stack, so entry must not be used past this point
+                GLTFNodeStackPush(&stack, [node childAtIndex:i], childDepth);
+            }
+        }
+    }
+    GLTFNodeStackDestroy(&stack);
+}
+
+static void GLTFVisitBreadthFirst(NSArray<GLTFNode *> *nodes, int depth, GLTFNodeVisitor visitor) {
+    // The stack doubles as a queue; entries before head have already been visited
+    GLTFNodeStack queue;
+    GLTFNodeStackInit(&queue);
+    for (GLTFNode *node in nodes) {
+        GLTFNodeStackPush(&queue, node, depth);
+    }
+    NSUInteger head = 0;
+    while (head < queue.count) {
+        GLTFNodeStackEntry entry = queue.entries[head++];
+        BOOL recurse = YES;
+        visitor(entry.node, entry.depth, &recurse);
+        if (recurse) {
+            if (head == queue.count || (head > GLTFNodeStackInlineCapacity && head > queue.count / 2)) {
+                // Reclaim the visited prefix rather than letting the queue grow to the size of the whole scene
+                memmove(queue.entries, queue.entries + head, (queue.count - head) * sizeof(GLTFNodeStackEntry));
+                queue.count -= head;
+                head = 0;
+            }
+            NSUInteger childCount = entry.node.childCount;
+            for (NSUInteger i = 0; i < childCount; ++i) {
+                GLTFNodeStackPush(&queue, [entry.node childAtIndex:i], entry.depth + 1);
+            }
+        }
+    }
+    GLTFNodeStackDestroy(&queue);
+}
+
+static void GLTFVisitConcurrently(NSArray<GLTFNode *> *nodes, int depth, GLTFNodeVisitor visitor) {
+    // Visit the top levels serially until there are enough independent subtrees to keep every core busy,
+    // then hand each subtree to its own iteration.
+    NSUInteger targetSubtreeCount = NSProcessInfo.processInfo.activeProcessorCount * 4;
+    NSArray<GLTFNode *> *subtrees = nodes;
+    while (subtrees.count > 0 && subtrees.count < targetSubtreeCount) {
+        NSMutableArray<GLTFNode *> *nextLevel = [NSMutableArray array];
+        for (GLTFNode *node in subtrees) {
+            BOOL recurse = YES;
+            visitor(node, depth, &recurse);
+            if (recurse) {
+                NSUInteger childCount = node.childCount;
+                for (NSUInteger i = 0; i < childCount; ++i) {
+                    [nextLevel addObject:[node childAtIndex:i]];
+                }
+            }
+        }
+        subtrees = nextLevel;
+        ++depth;
+    }
+    
+    dispatch_apply(subtrees.count, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t i) {
+        GLTFVisitDepthFirst(@[ subtrees[i] ], depth, visitor);
+    });
+}
+
+void GLTFVisitNodes(NSArray<GLTFNode *> *nodes, GLTFNodeVisitor visitor, GLTFVisitationStrategy strategy) {
+    switch (strategy) {
+        case GLTFVisitationStrategyDepthFirstPostOrder:
+            GLTFVisitDepthFirstPostOrder(nodes, 0, visitor);
+            break;
+        case GLTFVisitationStrategyBreadthFirst:
+            GLTFVisitBreadthFirst(nodes, 0, visitor);
+            break;
+        case GLTFVisitationStrategyConcurrent:
+            GLTFVisitConcurrently(nodes, 0, visitor);
+            break;
+        case GLTFVisitationStrategyDepthFirst:
+        default:
+            GLTFVisitDepthFirst(nodes, 0, visitor);
+            break;
+    }
+}
+
 @implementation GLTFNode
 
 @synthesize localTransform=_localTransform;
@@ -34,25 +206,44 @@
         _rotationQuaternion = simd_quaternion(0.f, 0.f, 0.f, 1.f);
         _scale = vector3(1.0f, 1.0f, 1.0f);
         _translation = vector3(0.0f, 0.0f, 0.0f);
-        _morphTargetWeights = @[];
+        _morphTargetWeightData = [NSMutableData data];
+        _levelOfDetailNodes = @[];
+        _levelOfDetailScreenCoverages = @[];
+        _transformIndex = -1;
+        _mutableChildren = [NSMutableArray array];
     }
     return self;
 }
 
+- (void)_setTransformStore:(GLTFTransformStore *)transformStore index:(NSInteger)index {
+    _transformStore = transformStore;
+    _transformIndex = index;
+}
+
 - (void)setChildren:(NSArray<GLTFNode *> *)children {
-    _mutableChildren = [children mutableCopy];
+    _mutableChildren = children ? [children mutableCopy] : [NSMutableArray array];
+    [_transformStore setNeedsRebuild];
 }
 
 - (NSArray<GLTFNode *> *)children {
     return [_mutableChildren copy];
 }
 
+- (NSUInteger)childCount {
+    return _mutableChildren.count;
+}
+
+- (GLTFNode *)childAtIndex:(NSUInteger)index {
+    return _mutableChildren[index];
+}
+
 - (void)addChildNode:(GLTFNode *)node {
     if (node.parent) {
         [node removeFromParent];
     }
     node.parent = self;
     [self.mutableChildren addObject:node];
+    [_transformStore setNeedsRebuild];
 }
 
 - (void)removeFromParent {
@@ -62,24 +253,68 @@
 - (void)_removeChildNode:(GLTFNode *)child {
     [self.mutableChildren removeObject:child];
     child.parent = nil;
+    [_transformStore setNeedsRebuild];
+}
+
+- (void)setMorphTargetWeights:(NSArray<NSNumber *> *)morphTargetWeights {
+    NSInteger count = morphTargetWeights.count;
+    _morphTargetWeightData.length = sizeof(float) * count;
+    GLTFGetFloatsFromNumbers(morphTargetWeights, _morphTargetWeightData.mutableBytes);
+}
+
+- (NSArray<NSNumber *> *)morphTargetWeights {
+    return GLTFNumbersFromFloats(self.morphTargetWeightValues, self.morphTargetWeightCount);
+}
+
+- (NSInteger)morphTargetWeightCount {
+    return _morphTargetWeightData.length / sizeof(float);
+}
+
+- (const float *)morphTargetWeightValues {
+    return (_morphTargetWeightData.length > 0) ? _morphTargetWeightData.bytes : NULL;
+}
+
+- (void)setMorphTargetWeightValues:(const float *)weights count:(NSInteger)count {
+    if (count == self.morphTargetWeightCount) {
+        // The weights may be our own, e.g. when written back after editing them in place
+        if (count > 0) {
+            memmove(_morphTargetWeightData.mutableBytes, weights, sizeof(float) * count);
+        }
+        return;
+    }
+    // Resizing may move or free the storage the weights point into, so build the new storage first
+    _morphTargetWeightData = [NSMutableData dataWithBytes:weights length:sizeof(float) * count];
 }
 
 - (void)setScale:(simd_float3)scale {
     _scale = scale;
     _localTransformDirty = YES;
+    [_transformStore setScale:scale atIndex:_transformIndex];
 }
 
 - (void)setRotationQuaternion:(GLTFQuaternion)rotationQuaternion {
     _rotationQuaternion = rotationQuaternion;
     _localTransformDirty = YES;
+    [_transformStore setRotation:rotationQuaternion atIndex:_transformIndex];
 }
 
 - (void)setTranslation:(simd_float3)translation {
     _translation = translation;
     _localTransformDirty = YES;
+    [_transformStore setTranslation:translation atIndex:_transformIndex];
 }
 
 - (simd_float4x4)globalTransform {
+    GLTFTransformStore *transformStore = _transformStore;
+    if (transformStore != nil) {
+        // Locks only if something changed since the last update, so concurrent queries don't contend
+        [transformStore updateWorldTransforms];
+        // Updating may have flattened the hierarchy again without this node in it
+        if (_transformStore == transformStore) {
+            return transformStore.worldTransforms[_transformIndex];
+        }
+    }
+    
     simd_float4x4 localTransform = self.localTransform;
     simd_float4x4 ancestorTransform = self.parent ? self.parent.globalTransform : matrix_identity_float4x4;
     return matrix_multiply(ancestorTransform, localTransform);
@@ -87,6 +322,8 @@
 
 - (void)setLocalTransform:(simd_float4x4)localTransform {
     _localTransform = localTransform;
+    _localTransformDirty = NO;
+    [_transformStore setLocalTransform:localTransform atIndex:_transformIndex];
 }
 
 - (simd_float4x4)localTransform {
@@ -119,28 +356,13 @@
 }
 
 - (GLTFBoundingBox)_approximateBoundsRecursive:(simd_float4x4)transform {
-    GLTFBoundingBox bounds = { 0 };
-    
-    if (self.mesh != nil) {
-        for (GLTFSubmesh *submesh in self.mesh.submeshes) {
-            GLTFBoundingBox submeshBounds = { 0 };
-            GLTFAccessor *positionAccessor = submesh.accessorsForAttributes[GLTFAttributeSemanticPosition];
-            GLTFValueRange positionRange = positionAccessor.valueRange;
-            submeshBounds.minPoint.x = positionRange.minValue[0];
-            submeshBounds.minPoint.y = positionRange.minValue[1];
-            submeshBounds.minPoint.z = positionRange.minValue[2];
-            submeshBounds.maxPoint.x = positionRange.maxValue[0];
-            submeshBounds.maxPoint.y = positionRange.maxValue[1];
-            submeshBounds.maxPoint.z = positionRange.maxValue[2];
-            GLTFBoundingBoxUnion(&bounds, submeshBounds);
-        }
-    }
+    GLTFBoundingBox bounds = [self meshBoundsForInstance:nil];
     
     simd_float4x4 globalTransform = matrix_multiply(transform, self.localTransform);
     
     GLTFBoundingBoxTransform(&bounds, globalTransform);
     
-    for (GLTFNode *child in self.children) {
+    for (GLTFNode *child in _mutableChildren) {
         GLTFBoundingBox childBounds = [child _approximateBoundsRecursive:globalTransform];
         GLTFBoundingBoxUnion(&bounds, childBounds);
     }
@@ -148,24 +370,109 @@
     return bounds;
 }
 
-- (void)acceptVisitor:(GLTFNodeVisitor)visitor strategy:(GLTFVisitationStrategy)strategy {
-    [self _acceptVisitor:visitor depth:0 strategy:strategy];
+- (BOOL)hasDeformableMesh {
+    GLTFMesh *mesh = self.mesh;
+    if (mesh == nil) {
+        return NO;
+    }
+    if (self.skin.jointNodes.count > 0) {
+        return YES;
+    }
+    for (GLTFSubmesh *submesh in mesh.submeshes) {
+        if (submesh.morphTargets.count > 0) {
+            return YES;
+        }
+    }
+    return NO;
 }
 
-- (void)_acceptVisitor:(GLTFNodeVisitor)visitor depth:(int)depth strategy:(GLTFVisitationStrategy)strategy {
-    switch (strategy) {
-        case GLTFVisitationStrategyDepthFirst:
-        default:
-        {
-            BOOL recurse = YES;
-            visitor(self, depth, &recurse);
-            if (recurse) {
-                for (GLTFNode *child in self.children) {
-                    [child _acceptVisitor:visitor depth:(depth + 1) strategy:strategy];
+- (GLTFBoundingBox)meshBoundsForInstance:(GLTFSceneInstance *)instance {
+    GLTFBoundingBox bounds = { 0 };
+    GLTFMesh *mesh = self.mesh;
+    if (mesh == nil) {
+        return bounds;
+    }
+    
+    if (self.hasDeformableMesh) {
+        if (self.skin.jointNodes.count > 0) {
+            // Renderers keep their palettes from frame to frame; this one-off only serves occasional queries
+            GLTFSkinPalette *palette = [[GLTFSkinPalette alloc] initWithSkin:self.skin meshNode:self instance:instance];
+            [palette update];
+            return palette.bounds;
+        }
+        const float *weights = self.morphTargetWeightValues;
+        NSInteger weightCount = self.morphTargetWeightCount;
+        NSInteger index = (instance != nil) ? [instance.transformStore indexOfNode:self] : -1;
+        if (index >= 0) {
+            weights = [instance morphTargetWeightsAtIndex:index];
+            weightCount = [instance morphTargetWeightCountAtIndex:index];
+        } else if (weightCount == 0) {
+            weights = mesh.defaultMorphTargetWeightValues;
+            weightCount = mesh.defaultMorphTargetWeightCount;
+        }
+        return [self.animatedBounds boundsWithJointMatrices:NULL jointCount:0 morphTargetWeights:weights count:weightCount];
+    }
+    
+    for (GLTFSubmesh *submesh in mesh.submeshes) {
+        GLTFValueRange positionRange = submesh.accessorsForAttributes[GLTFAttributeSemanticPosition].valueRange;
+        GLTFBoundingBox submeshBounds = {
+            (simd_float3){ positionRange.minValue[0], positionRange.minValue[1], positionRange.minValue[2] },
+            (simd_float3){ positionRange.maxValue[0], positionRange.maxValue[1], positionRange.maxValue[2] }
+        };
+        GLTFBoundingBoxUnion(&bounds, submeshBounds);
+    }
+    return bounds;
+}
+
+// Scene instances on several threads may ask at once
+- (GLTFAnimatedBounds *)animatedBounds {
+    if (self.mesh == nil) {
+        return nil;
+    }
+    @synchronized (self) {
+        if (_cachedAnimatedBounds == nil) {
+            _cachedAnimatedBounds = [[GLTFAnimatedBounds alloc] initWithMesh:self.mesh skin:self.skin];
+        }
+        return _cachedAnimatedBounds;
+    }
+}
+
+- (GLTFRayHit *)_intersectRay:(GLTFRay)ray maximumDistance:(float)maximumDistance anyHit:(BOOL)anyHit {
+    __block GLTFRayHit *closestHit = nil;
+    __block float closestDistance = maximumDistance;
+    __block BOOL done = NO;
+    [self acceptVisitor:^(GLTFNode *node, int depth, BOOL *stop) {
+        if (done || node.mesh == nil) {
+            return;
+        }
+        // Distances along a transformed ray are the same as along the original
+        GLTFRay localRay = GLTFRayTransform(ray, simd_inverse(node.globalTransform));
+        for (GLTFSubmesh *submesh in node.mesh.submeshes) {
+            GLTFTriangleBVH *triangleBVH = submesh.triangleBVH;
+            GLTFTriangleHit triangleHit;
+            if ([triangleBVH intersectRay:localRay maximumDistance:closestDistance anyHit:anyHit hit:&triangleHit]) {
+                closestDistance = triangleHit.distance;
+                closestHit = [[GLTFRayHit alloc] initWithNode:node submesh:submesh ray:ray triangleHit:triangleHit];
+                if (anyHit) {
+                    done = YES;
+                    return;
                 }
             }
         }
-    }
+    } strategy:GLTFVisitationStrategyDepthFirst];
+    return closestHit;
+}
+
+- (GLTFRayHit *)closestHitForRay:(GLTFRay)ray maximumDistance:(float)maximumDistance {
+    return [self _intersectRay:ray maximumDistance:maximumDistance anyHit:NO];
+}
+
+- (GLTFRayHit *)anyHitForRay:(GLTFRay)ray maximumDistance:(float)maximumDistance {
+    return [self _intersectRay:ray maximumDistance:maximumDistance anyHit:YES];
+}
+
+- (void)acceptVisitor:(GLTFNodeVisitor)visitor strategy:(GLTFVisitationStrategy)strategy {
+    GLTFVisitNodes(@[ self ], visitor, strategy);
 }
 
 @end
@@ -0,0 +1,366 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFOcclusionBuffer.h"
+#import "GLTFAccessor.h"
+#import "GLTFMesh.h"
+#import "GLTFMeshSimplifier.h"
+#import "GLTFVertexDescriptor.h"
+
+// Pixels per side of the square tiles rasterized in parallel; a multiple of the SIMD width
+#define GLTFOcclusionTileSize 32
+
+// Pixels per side of the blocks of the coarse depth level
+#define GLTFOcclusionBlockSize 8
+
+// Occluder vertices closer to the eye than this (in clip-space w) are treated as crossing the near plane
+#define GLTFOcclusionMinimumW 1e-5f
+
+// Boxes must be this much farther than the occluders (in clip-space z / w) to count as hidden, so that an occluder's
+// own bounds, whose nearest face often lies right on its triangles, aren't hidden by rounding
+#define GLTFOcclusionDepthBias 1e-5f
+
+// In pixels, with depth in z, wound so that the edge functions are positive inside
+typedef struct {
+    simd_float3 v0, v1, v2;
+} GLTFOcclusionTriangle;
+
+static void GLTFOcclusionRasterizeTriangle(float *depthValues, NSInteger rowStride, const GLTFOcclusionTriangle *triangle,
+                                           int tileX0, int tileY0, int tileX1, int tileY1)
+{
+    simd_float3 a = triangle->v0, b = triangle->v1, c = triangle->v2;
+    
+    // Start each row on a SIMD boundary; the tile origin is on one, so this never leaves the tile
+    int x0 = ((int)MAX(floorf(fminf(fminf(a.x, b.x), c.x)), tileX0)) & ~3;
+    int y0 = (int)MAX(floorf(fminf(fminf(a.y, b.y), c.y)), tileY0);
+    int x1 = (int)MIN(ceilf(fmaxf(fmaxf(a.x, b.x), c.x)), tileX1);
+    int y1 = (int)MIN(ceilf(fmaxf(fmaxf(a.y, b.y), c.y)), tileY1);
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+    
+    // Edge functions as A * x + B * y + C, each zero along one edge and positive towards the opposite vertex
+    simd_float3 edgeA = { a.y - b.y, b.y - c.y, c.y - a.y };
+    simd_float3 edgeB = { b.x - a.x, c.x - b.x, a.x - c.x };
+    simd_float3 edgeC = { -(edgeA[0] * a.x + edgeB[0] * a.y), -(edgeA[1] * b.x + edgeB[1] * b.y), -(edgeA[2] * c.x + edgeB[2] * c.y) };
+    
+    // Depth is affine in screen space: weight each vertex's depth by the edge function opposite it
+    float inverseArea = 1.0f / (edgeA[0] * c.x + edgeB[0] * c.y + edgeC[0]);
+    float depthA = (edgeA[1] * a.z + edgeA[2] * b.z + edgeA[0] * c.z) * inverseArea;
+    float depthB = (edgeB[1] * a.z + edgeB[2] * b.z + edgeB[0] * c.z) * inverseArea;
+    float depthC = (edgeC[1] * a.z + edgeC[2] * b.z + edgeC[0] * c.z) * inverseArea;
+    
+    const simd_float4 laneOffsets = { 0.5f, 1.5f, 2.5f, 3.5f };
+    for (int y = y0; y < y1; ++y) {
+        float py = y + 0.5f;
+        float rowE0 = edgeB[0] * py + edgeC[0];
+        float rowE1 = edgeB[1] * py + edgeC[1];
+        float rowE2 = edgeB[2] * py + edgeC[2];
+        float rowDepth = depthB * py + depthC;
+        simd_float4 *row = (simd_float4 *)(depthValues + y * rowStride);
+        for (int x = x0; x < x1; x += 4) {
+            simd_float4 px = x + laneOffsets;
+            simd_int4 inside = (edgeA[0] * px + rowE0 >= 0) & (edgeA[1] * px + rowE1 >= 0) & (edgeA[2] * px + rowE2 >= 0) & (px < x1);
+            if (!simd_any(inside)) {
+                continue;
+            }
+            simd_float4 depth = depthA * px + rowDepth;
+            simd_float4 current = row[x / 4];
+            row[x / 4] = simd_select(current, simd_min(current, depth), inside);
+        }
+    }
+}
+
+@interface GLTFOcclusionBuffer () {
+    float *_depthValues;
+    float *_blockDepths; // Farthest depth of each block
+    NSInteger _blocksWide;
+    NSInteger _blocksHigh;
+    simd_float4x4 _viewProjection;
+}
+@property (nonatomic, strong) NSMutableData *triangles;
+@property (nonatomic, strong) NSMapTable<GLTFSubmesh *, NSData *> *trianglesForSubmeshes;
+@end
+
+@implementation GLTFOcclusionBuffer
+
+- (instancetype)initWithWidth:(NSInteger)width height:(NSInteger)height {
+    if ((self = [super init])) {
+        _width = MAX(width, 1);
+        _height = MAX(height, 1);
+        _depthRowStride = (_width + 3) & ~3;
+        _depthValues = malloc(sizeof(float) * _depthRowStride * _height);
+        _blocksWide = (_width + GLTFOcclusionBlockSize - 1) / GLTFOcclusionBlockSize;
+        _blocksHigh = (_height + GLTFOcclusionBlockSize - 1) / GLTFOcclusionBlockSize;
+        _blockDepths = malloc(sizeof(float) * _blocksWide * _blocksHigh);
+        _triangles = [NSMutableData data];
+        _trianglesForSubmeshes = [NSMapTable weakToStrongObjectsMapTable];
+        [self beginFrameWithViewProjectionMatrix:matrix_identity_float4x4];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_depthValues);
+    free(_blockDepths);
+}
+
+- (const float *)depthValues {
+    return _depthValues;
+}
+
+- (NSInteger)occluderTriangleCount {
+    return self.triangles.length / sizeof(GLTFOcclusionTriangle);
+}
+
+- (void)beginFrameWithViewProjectionMatrix:(simd_float4x4)viewProjection {
+    _viewProjection = viewProjection;
+    self.triangles.length = 0;
+    for (NSInteger i = 0; i < _depthRowStride * _height; ++i) {
+        _depthValues[i] = 1;
+    }
+    for (NSInteger i = 0; i < _blocksWide * _blocksHigh; ++i) {
+        _blockDepths[i] = 1;
+    }
+}
+
+- (NSData *)trianglesForSubmesh:(GLTFSubmesh *)submesh {
+    NSData *triangles = [self.trianglesForSubmeshes objectForKey:submesh];
+    if (triangles != nil) {
+        return triangles;
+    }
+    
+    NSMutableData *trianglePositions = [NSMutableData data];
+    GLTFAccessor *positionAccessor = submesh.accessorsForAttributes[GLTFAttributeSemanticPosition];
+    if (submesh.primitiveType == GLTFPrimitiveTypeTriangles &&
+        positionAccessor.dimension == GLTFDataDimensionVector3 && positionAccessor.contents != NULL)
+    {
+        uint32_t vertexCount = (uint32_t)positionAccessor.count;
+        float *positions = malloc(sizeof(float) * 3 * MAX(vertexCount, 1));
+        [positionAccessor getFloatValues:positions];
+        
+        // The coarsest level of detail is plenty for occlusion
+        GLTFAccessor *indexAccessor = submesh.levelsOfDetail.lastObject.indexAccessor ?: submesh.indexAccessor;
+        uint32_t indexCount = (uint32_t)(indexAccessor ? indexAccessor.count : vertexCount);
+        uint32_t *indices = malloc(sizeof(uint32_t) * MAX(indexCount, 1));
+        if (indexAccessor != nil) {
+            [indexAccessor getUnsignedIntValues:indices];
+        } else {
+            for (uint32_t i = 0; i < indexCount; ++i) {
+                indices[i] = i;
+            }
+        }
+        
+        for (uint32_t i = 0; i + 2 < indexCount; i += 3) {
+            if (indices[i] >= vertexCount || indices[i + 1] >= vertexCount || indices[i + 2] >= vertexCount) {
+                continue;
+            }
+            for (int k = 0; k < 3; ++k) {
+                const float *p = positions + indices[i + k] * 3;
+                simd_float3 position = { p[0], p[1], p[2] };
+                [trianglePositions appendBytes:&position length:sizeof(position)];
+            }
+        }
+        
+        free(positions);
+        free(indices);
+    }
+    
+    [self.trianglesForSubmeshes setObject:trianglePositions forKey:submesh];
+    return trianglePositions;
+}
+
+- (void)addOccluderSubmesh:(GLTFSubmesh *)submesh modelMatrix:(simd_float4x4)modelMatrix {
+    NSData *triangles = [self trianglesForSubmesh:submesh];
+    [self addOccluderTriangles:triangles.bytes triangleCount:triangles.length / (sizeof(simd_float3) * 3) modelMatrix:modelMatrix];
+}
+
+- (void)addOccluderTriangles:(const simd_float3 *)positions triangleCount:(NSInteger)triangleCount modelMatrix:(simd_float4x4)modelMatrix {
+    simd_float4x4 transform = matrix_multiply(_viewProjection, modelMatrix);
+    simd_float2 viewportScale = { 0.5f * _width, -0.5f * _height };
+    simd_float2 viewportOffset = { 0.5f * _width, 0.5f * _height };
+    
+    for (NSInteger t = 0; t < triangleCount; ++t) {
+        simd_float3 screen[3];
+        BOOL clipped = NO;
+        for (int k = 0; k < 3; ++k) {
+            simd_float4 clip = matrix_multiply(transform, simd_make_float4(positions[t * 3 + k], 1));
+            if (clip.w < GLTFOcclusionMinimumW || clip.z < 0) {
+                clipped = YES;
+                break;
+            }
+            simd_float3 ndc = clip.xyz / clip.w;
+            screen[k] = simd_make_float3(ndc.xy * viewportScale + viewportOffset, ndc.z);
+        }
+        if (clipped) {
+            continue;
+        }
+        
+        // Off-screen triangles never reach a tile, so skip them here
+        simd_float2 minimum = simd_min(simd_min(screen[0].xy, screen[1].xy), screen[2].xy);
+        simd_float2 maximum = simd_max(simd_max(screen[0].xy, screen[1].xy), screen[2].xy);
+        if (maximum.x <= 0 || maximum.y <= 0 || minimum.x >= _width || minimum.y >= _height) {
+            continue;
+        }
+        
+        // Both windings are drawn; flip the clockwise ones so that the inside is where all edge functions are positive
+        simd_float2 e1 = screen[1].xy - screen[0].xy, e2 = screen[2].xy - screen[0].xy;
+        float area = e1.x * e2.y - e1.y * e2.x;
+        if (area == 0) {
+            continue;
+        }
+        GLTFOcclusionTriangle triangle = { screen[0], screen[1], screen[2] };
+        if (area < 0) {
+            triangle.v1 = screen[2];
+            triangle.v2 = screen[1];
+        }
+        [self.triangles appendBytes:&triangle length:sizeof(triangle)];
+    }
+}
+
+- (void)rasterizeOccluders {
+    NSInteger triangleCount = self.occluderTriangleCount;
+    const GLTFOcclusionTriangle *triangles = self.triangles.bytes;
+    if (triangleCount == 0) {
+        return;
+    }
+    
+    NSInteger tilesWide = (_width + GLTFOcclusionTileSize - 1) / GLTFOcclusionTileSize;
+    NSInteger tilesHigh = (_height + GLTFOcclusionTileSize - 1) / GLTFOcclusionTileSize;
+    NSInteger tileCount = tilesWide * tilesHigh;
+    
+    // Bin triangles by the tiles their bounds overlap, keeping submission order within each tile
+    int32_t *tileStarts = calloc(tileCount + 1, sizeof(int32_t));
+    simd_int4 *tileRanges = malloc(sizeof(simd_int4) * triangleCount);
+    for (NSInteger t = 0; t < triangleCount; ++t) {
+        const GLTFOcclusionTriangle *triangle = &triangles[t];
+        float minX = fminf(fminf(triangle->v0.x, triangle->v1.x), triangle->v2.x);
+        float minY = fminf(fminf(triangle->v0.y, triangle->v1.y), triangle->v2.y);
+        float maxX = fmaxf(fmaxf(triangle->v0.x, triangle->v1.x), triangle->v2.x);
+        float maxY = fmaxf(fmaxf(triangle->v0.y, triangle->v1.y), triangle->v2.y);
+        simd_int4 range = {
+            (int)MAX(floorf(minX), 0) / GLTFOcclusionTileSize,
+            (int)MAX(floorf(minY), 0) / GLTFOcclusionTileSize,
+            (int)MIN(ceilf(maxX), _width - 1) / GLTFOcclusionTileSize,
+            (int)MIN(ceilf(maxY), _height - 1) / GLTFOcclusionTileSize,
+        };
+        tileRanges[t] = range;
+        for (int ty = range.y; ty <= range.w; ++ty) {
+            for (int tx = range.x; tx <= range.z; ++tx) {
+                ++tileStarts[ty * tilesWide + tx + 1];
+            }
+        }
+    }
+    for (NSInteger i = 0; i < tileCount; ++i) {
+        tileStarts[i + 1] += tileStarts[i];
+    }
+    int32_t *tileTriangles = malloc(sizeof(int32_t) * MAX(tileStarts[tileCount], 1));
+    int32_t *tileFill = malloc(sizeof(int32_t) * tileCount);
+    memcpy(tileFill, tileStarts, sizeof(int32_t) * tileCount);
+    for (NSInteger t = 0; t < triangleCount; ++t) {
+        simd_int4 range = tileRanges[t];
+        for (int ty = range.y; ty <= range.w; ++ty) {
+            for (int tx = range.x; tx <= range.z; ++tx) {
+                tileTriangles[tileFill[ty * tilesWide + tx]++] = (int32_t)t;
+            }
+        }
+    }
+    
+    // Tiles don't share pixels, so they can be rasterized and reduced to blocks independently
+    float *depthValues = _depthValues, *blockDepths = _blockDepths;
+    NSInteger rowStride = _depthRowStride, width = _width, height = _height, blocksWide = _blocksWide;
+    dispatch_apply(tileCount, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t tile) {
+        int tileX0 = (int)(tile % tilesWide) * GLTFOcclusionTileSize;
+        int tileY0 = (int)(tile / tilesWide) * GLTFOcclusionTileSize;
+        int tileX1 = (int)MIN(tileX0 + GLTFOcclusionTileSize, width);
+        int tileY1 = (int)MIN(tileY0 + GLTFOcclusionTileSize, height);
+        for (int32_t i = tileStarts[tile]; i < tileStarts[tile + 1]; ++i) {
+            GLTFOcclusionRasterizeTriangle(depthValues, rowStride, &triangles[tileTriangles[i]], tileX0, tileY0, tileX1, tileY1);
+        }
+        
+        for (int by = tileY0; by < tileY1; by += GLTFOcclusionBlockSize) {
+            for (int bx = tileX0; bx < tileX1; bx += GLTFOcclusionBlockSize) {
+                float farthest = 0;
+                for (int y = by; y < MIN(by + GLTFOcclusionBlockSize, tileY1); ++y) {
+                    for (int x = bx; x < MIN(bx + GLTFOcclusionBlockSize, tileX1); ++x) {
+                        farthest = fmaxf(farthest, depthValues[y * rowStride + x]);
+                    }
+                }
+                blockDepths[(by / GLTFOcclusionBlockSize) * blocksWide + bx / GLTFOcclusionBlockSize] = farthest;
+            }
+        }
+    });
+    
+    free(tileStarts);
+    free(tileRanges);
+    free(tileTriangles);
+    free(tileFill);
+}
+
+- (BOOL)isBoundingBoxVisible:(GLTFBoundingBox)bounds modelMatrix:(simd_float4x4)modelMatrix {
+    simd_float4x4 transform = matrix_multiply(_viewProjection, modelMatrix);
+    
+    // Screen rectangle and nearest depth of the box's corners
+    simd_float2 minimum = FLT_MAX, maximum = -FLT_MAX;
+    float nearestDepth = FLT_MAX;
+    for (int i = 0; i < 8; ++i) {
+        simd_float4 corner = {
+            (i & 1) ? bounds.maxPoint.x : bounds.minPoint.x,
+            (i & 2) ? bounds.maxPoint.y : bounds.minPoint.y,
+            (i & 4) ? bounds.maxPoint.z : bounds.minPoint.z,
+            1
+        };
+        simd_float4 clip = matrix_multiply(transform, corner);
+        if (clip.w < GLTFOcclusionMinimumW || clip.z < 0) {
+            // Reaches the near plane, and so can't be behind anything
+            return YES;
+        }
+        simd_float3 ndc = clip.xyz / clip.w;
+        simd_float2 screen = { (ndc.x * 0.5f + 0.5f) * _width, (0.5f - ndc.y * 0.5f) * _height };
+        minimum = simd_min(minimum, screen);
+        maximum = simd_max(maximum, screen);
+        nearestDepth = fminf(nearestDepth, ndc.z);
+    }
+    nearestDepth -= GLTFOcclusionDepthBias;
+    
+    int x0 = (int)MAX(floorf(minimum.x), 0), y0 = (int)MAX(floorf(minimum.y), 0);
+    int x1 = (int)MIN(ceilf(maximum.x), _width), y1 = (int)MIN(ceilf(maximum.y), _height);
+    if (x0 >= x1 || y0 >= y1) {
+        return NO;
+    }
+    
+    // Blocks whose farthest occluder is nearer than the box hide it entirely; only the others need their pixels read
+    for (int by = y0 / GLTFOcclusionBlockSize; by <= (y1 - 1) / GLTFOcclusionBlockSize; ++by) {
+        for (int bx = x0 / GLTFOcclusionBlockSize; bx <= (x1 - 1) / GLTFOcclusionBlockSize; ++bx) {
+            if (nearestDepth >= _blockDepths[by * _blocksWide + bx]) {
+                continue;
+            }
+            int pixelY0 = MAX(by * GLTFOcclusionBlockSize, y0), pixelY1 = MIN((by + 1) * GLTFOcclusionBlockSize, y1);
+            int pixelX0 = MAX(bx * GLTFOcclusionBlockSize, x0), pixelX1 = MIN((bx + 1) * GLTFOcclusionBlockSize, x1);
+            for (int y = pixelY0; y < pixelY1; ++y) {
+                for (int x = pixelX0; x < pixelX1; ++x) {
+                    if (nearestDepth < _depthValues[y * _depthRowStride + x]) {
+                        return YES;
+                    }
+                }
+            }
+        }
+    }
+    return NO;
+}
+
+@end
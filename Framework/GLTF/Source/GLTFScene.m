@@ -16,15 +16,27 @@
 
 #import "GLTFScene.h"
 #import "GLTFNode.h"
+#import "GLTFSceneBVH.h"
+#import "GLTFTransformStore.h"
+#import "GLTFTriangleBVH.h"
 
 @interface GLTFScene ()
 @property (nonatomic, strong) NSMutableArray *mutableNodes;
+@property (nonatomic, strong) GLTFSceneBVH *cachedBoundingVolumeHierarchy;
 @end
 
 @implementation GLTFScene
 
+- (instancetype)init {
+    if ((self = [super init])) {
+        _mutableNodes = [NSMutableArray array];
+    }
+    return self;
+}
+
 - (void)setNodes:(NSArray<GLTFNode *> *)nodes {
-    _mutableNodes = [nodes mutableCopy];
+    _mutableNodes = nodes ? [nodes mutableCopy] : [NSMutableArray array];
+    [_transformStore setNeedsRebuild];
 }
 
 - (NSArray<GLTFNode *> *)nodes {
@@ -37,21 +49,70 @@
     }
     
     [_mutableNodes addObject:node];
+    [_transformStore setNeedsRebuild];
+}
+
+- (GLTFSceneBVH *)boundingVolumeHierarchy {
+    if (_transformStore == nil) {
+        return nil;
+    }
+    if (_cachedBoundingVolumeHierarchy == nil || _cachedBoundingVolumeHierarchy.transformStore != _transformStore) {
+        _cachedBoundingVolumeHierarchy = [[GLTFSceneBVH alloc] initWithScene:self];
+    }
+    return _cachedBoundingVolumeHierarchy;
 }
 
 - (GLTFBoundingBox)approximateBounds {
+    if (_transformStore != nil) {
+        GLTFSceneBVH *bvh = self.boundingVolumeHierarchy;
+        [bvh refit];
+        return bvh.bounds;
+    }
+    
     GLTFBoundingBox sceneBounds = { 0 };
-    for (GLTFNode *node in self.nodes) {
+    for (GLTFNode *node in _mutableNodes) {
         GLTFBoundingBox nodeBounds = node.approximateBounds;
         GLTFBoundingBoxUnion(&sceneBounds, nodeBounds);
     }
     return sceneBounds;
 }
 
-- (void)acceptVisitor:(GLTFNodeVisitor)visitor strategy:(GLTFVisitationStrategy)strategy {
-    for (GLTFNode *node in self.nodes) {
-        [node acceptVisitor:visitor strategy:strategy];
+- (GLTFRayHit *)closestHitForRay:(GLTFRay)ray maximumDistance:(float)maximumDistance {
+    GLTFSceneBVH *bvh = self.boundingVolumeHierarchy;
+    if (bvh != nil) {
+        [bvh refit];
+        return [bvh closestHitForRay:ray maximumDistance:maximumDistance];
     }
+    
+    GLTFRayHit *closestHit = nil;
+    for (GLTFNode *node in _mutableNodes) {
+        GLTFRayHit *hit = [node closestHitForRay:ray maximumDistance:maximumDistance];
+        if (hit != nil) {
+            closestHit = hit;
+            maximumDistance = hit.distance;
+        }
+    }
+    return closestHit;
+}
+
+- (GLTFRayHit *)anyHitForRay:(GLTFRay)ray maximumDistance:(float)maximumDistance {
+    GLTFSceneBVH *bvh = self.boundingVolumeHierarchy;
+    if (bvh != nil) {
+        [bvh refit];
+        return [bvh anyHitForRay:ray maximumDistance:maximumDistance];
+    }
+    
+    for (GLTFNode *node in _mutableNodes) {
+        GLTFRayHit *hit = [node anyHitForRay:ray maximumDistance:maximumDistance];
+        if (hit != nil) {
+            return hit;
+        }
+    }
+    return nil;
+}
+
+- (void)acceptVisitor:(GLTFNodeVisitor)visitor strategy:(GLTFVisitationStrategy)strategy {
+    GLTFVisitNodes(_mutableNodes, visitor, strategy);
 }
 
 @end
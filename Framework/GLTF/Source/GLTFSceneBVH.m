@@ -0,0 +1,609 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFSceneBVH.h"
+#import "GLTFAccessor.h"
+#import "GLTFMesh.h"
+#import "GLTFNode.h"
+#import "GLTFScene.h"
+#import "GLTFSceneInstance.h"
+#import "GLTFTransformStore.h"
+#import "GLTFTriangleBVH.h"
+#import "GLTFVertexDescriptor.h"
+
+// Leaves per BVH leaf node
+#define GLTFSceneBVHMaximumLeafSize 4
+
+// Subtrees and batches of at least this many leaves are split across cores
+#define GLTFSceneBVHParallelThreshold 4096
+
+// Deep enough for any tree built by median splits
+#define GLTFSceneBVHMaximumDepth 64
+
+typedef struct {
+    simd_float3 minimum;
+    simd_float3 maximum;
+    int32_t rightChildOrFirstLeaf; // The left child of an interior node immediately follows it
+    int32_t leafCount; // Zero for interior nodes
+} GLTFSceneBVHNode;
+
+typedef struct {
+    simd_float3 localMinimum;
+    simd_float3 localMaximum;
+    simd_float3 minimum;
+    simd_float3 maximum;
+    __unsafe_unretained GLTFSubmesh *submesh; // Retained by the node's mesh
+    int32_t transformIndex;
+} GLTFSceneBVHLeaf;
+
+typedef struct {
+    GLTFSceneBVHNode *nodes;
+    const GLTFSceneBVHLeaf *leaves;
+    const simd_float3 *centroids;
+    int32_t *leafOrder;
+} GLTFSceneBVHBuildContext;
+
+static void GLTFSceneBVHUpdateLeafBounds(GLTFSceneBVHLeaf *leaf, simd_float4x4 worldTransform) {
+    GLTFBoundingBox bounds = { leaf->localMinimum, leaf->localMaximum };
+    GLTFBoundingBoxTransform(&bounds, worldTransform);
+    leaf->minimum = bounds.minPoint;
+    leaf->maximum = bounds.maxPoint;
+}
+
+// The tree for a given number of leaves always has the same shape, so the size of the left subtree tells where
+// the right child goes without building the left subtree first
+static int32_t GLTFSceneBVHNodeCountForLeafCount(int32_t leafCount) {
+    if (leafCount <= GLTFSceneBVHMaximumLeafSize) {
+        return 1;
+    }
+    int32_t leftCount = leafCount / 2;
+    return 1 + GLTFSceneBVHNodeCountForLeafCount(leftCount) + GLTFSceneBVHNodeCountForLeafCount(leafCount - leftCount);
+}
+
+// Reorders the leaves so that the first k have centroids no greater than the rest along the axis
+static void GLTFSceneBVHPartition(const simd_float3 *centroids, int32_t *order, int32_t count, int32_t k, int axis) {
+    int32_t low = 0, high = count - 1;
+    while (high > low) {
+        float pivot = centroids[order[(low + high) / 2]][axis];
+        int32_t i = low, j = high;
+        while (i <= j) {
+            while (centroids[order[i]][axis] < pivot) { ++i; }
+            while (centroids[order[j]][axis] > pivot) { --j; }
+            if (i <= j) {
+                int32_t swap = order[i];
+                order[i] = order[j];
+                order[j] = swap;
+                ++i;
+                --j;
+            }
+        }
+        if (k <= j) {
+            high = j;
+        } else if (k >= i) {
+            low = i;
+        } else {
+            break;
+        }
+    }
+}
+
+static void GLTFSceneBVHBuild(const GLTFSceneBVHBuildContext *context, int32_t nodeIndex, int32_t start, int32_t count) {
+    GLTFSceneBVHNode *node = &context->nodes[nodeIndex];
+    int32_t *order = context->leafOrder + start;
+    
+    simd_float3 minimum = FLT_MAX, maximum = -FLT_MAX;
+    simd_float3 centroidMinimum = FLT_MAX, centroidMaximum = -FLT_MAX;
+    for (int32_t i = 0; i < count; ++i) {
+        const GLTFSceneBVHLeaf *leaf = &context->leaves[order[i]];
+        minimum = simd_min(minimum, leaf->minimum);
+        maximum = simd_max(maximum, leaf->maximum);
+        centroidMinimum = simd_min(centroidMinimum, context->centroids[order[i]]);
+        centroidMaximum = simd_max(centroidMaximum, context->centroids[order[i]]);
+    }
+    node->minimum = minimum;
+    node->maximum = maximum;
+    
+    if (count <= GLTFSceneBVHMaximumLeafSize) {
+        node->rightChildOrFirstLeaf = start;
+        node->leafCount = count;
+        return;
+    }
+    
+    // Median split along the axis the centroids spread furthest on
+    simd_float3 spread = centroidMaximum - centroidMinimum;
+    int axis = (spread.x >= spread.y && spread.x >= spread.z) ? 0 : ((spread.y >= spread.z) ? 1 : 2);
+    int32_t leftCount = count / 2;
+    GLTFSceneBVHPartition(context->centroids, order, count, leftCount, axis);
+    
+    int32_t leftIndex = nodeIndex + 1;
+    int32_t rightIndex = leftIndex + GLTFSceneBVHNodeCountForLeafCount(leftCount);
+    node->rightChildOrFirstLeaf = rightIndex;
+    node->leafCount = 0;
+    
+    if (count >= GLTFSceneBVHParallelThreshold) {
+        dispatch_apply(2, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t side) {
+            if (side == 0) {
+                GLTFSceneBVHBuild(context, leftIndex, start, leftCount);
+            } else {
+                GLTFSceneBVHBuild(context, rightIndex, start + leftCount, count - leftCount);
+            }
+        });
+    } else {
+        GLTFSceneBVHBuild(context, leftIndex, start, leftCount);
+        GLTFSceneBVHBuild(context, rightIndex, start + leftCount, count - leftCount);
+    }
+}
+
+@interface GLTFSceneBVH () {
+    GLTFSceneBVHLeaf *_leaves;
+    int32_t *_leafOrder;
+    int32_t *_leafStarts; // Leaves of transform index i are [_leafStarts[i], _leafStarts[i + 1])
+    bool *_leafChanged;
+    bool *_leafNeedsUpdate;
+    GLTFSceneBVHNode *_nodes;
+    bool *_nodeChanged;
+    simd_float4x4 *_worldTransforms; // As of the last refit, including the root transform
+    NSInteger _transformCount;
+}
+@property (nonatomic, weak) GLTFSceneInstance *instance;
+@property (nonatomic, copy) NSArray<GLTFNode *> *indexedNodes;
+@end
+
+@implementation GLTFSceneBVH
+
+- (instancetype)initWithScene:(GLTFScene *)scene {
+    if ((self = [super init])) {
+        NSParameterAssert(scene.transformStore != nil);
+        _transformStore = scene.transformStore;
+        [self rebuild];
+    }
+    return self;
+}
+
+- (instancetype)initWithSceneInstance:(GLTFSceneInstance *)instance {
+    if ((self = [super init])) {
+        _transformStore = instance.transformStore;
+        _instance = instance;
+        [self rebuild];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [self freeStorage];
+}
+
+- (void)freeStorage {
+    free(_leaves);
+    free(_leafOrder);
+    free(_leafStarts);
+    free(_leafChanged);
+    free(_leafNeedsUpdate);
+    free(_nodes);
+    free(_nodeChanged);
+    free(_worldTransforms);
+    _leaves = NULL;
+    _leafOrder = NULL;
+    _leafStarts = NULL;
+    _leafChanged = NULL;
+    _leafNeedsUpdate = NULL;
+    _nodes = NULL;
+    _nodeChanged = NULL;
+    _worldTransforms = NULL;
+    _leafCount = 0;
+    _nodeCount = 0;
+    _transformCount = 0;
+}
+
+- (simd_float4x4)currentRootTransform {
+    GLTFSceneInstance *instance = self.instance;
+    return (instance != nil) ? instance.rootTransform : matrix_identity_float4x4;
+}
+
+- (void)rebuild {
+    GLTFTransformStore *store = self.transformStore;
+    [store updateWorldTransforms];
+    
+    [self freeStorage];
+    
+    NSArray<GLTFNode *> *nodes = store.nodes;
+    self.indexedNodes = nodes;
+    _transformCount = nodes.count;
+    simd_float4x4 rootTransform = [self currentRootTransform];
+    
+    _leafStarts = malloc(sizeof(int32_t) * (_transformCount + 1));
+    int32_t leafCount = 0;
+    for (NSInteger i = 0; i < _transformCount; ++i) {
+        _leafStarts[i] = leafCount;
+        leafCount += (int32_t)nodes[i].mesh.submeshes.count;
+    }
+    _leafStarts[_transformCount] = leafCount;
+    _leafCount = leafCount;
+    
+    _leaves = malloc(sizeof(GLTFSceneBVHLeaf) * MAX(leafCount, 1));
+    _leafOrder = malloc(sizeof(int32_t) * MAX(leafCount, 1));
+    _leafChanged = calloc(MAX(leafCount, 1), sizeof(bool));
+    _leafNeedsUpdate = calloc(MAX(leafCount, 1), sizeof(bool));
+    _worldTransforms = malloc(sizeof(simd_float4x4) * MAX(_transformCount, 1));
+    
+    const simd_float4x4 *worldTransforms = store.worldTransforms;
+    for (NSInteger i = 0; i < _transformCount; ++i) {
+        _worldTransforms[i] = matrix_multiply(rootTransform, worldTransforms[i]);
+        int32_t leafIndex = _leafStarts[i];
+        for (GLTFSubmesh *submesh in nodes[i].mesh.submeshes) {
+            GLTFSceneBVHLeaf *leaf = &_leaves[leafIndex];
+            GLTFValueRange positionRange = submesh.accessorsForAttributes[GLTFAttributeSemanticPosition].valueRange;
+            leaf->localMinimum = (simd_float3){ positionRange.minValue[0], positionRange.minValue[1], positionRange.minValue[2] };
+            leaf->localMaximum = (simd_float3){ positionRange.maxValue[0], positionRange.maxValue[1], positionRange.maxValue[2] };
+            leaf->submesh = submesh;
+            leaf->transformIndex = (int32_t)i;
+            _leafOrder[leafIndex] = leafIndex;
+            ++leafIndex;
+        }
+    }
+    
+    if (leafCount == 0) {
+        return;
+    }
+    
+    // World bounds and centroids of the leaves, in parallel batches for large scenes
+    GLTFSceneBVHLeaf *leaves = _leaves;
+    const simd_float4x4 *cachedWorldTransforms = _worldTransforms;
+    simd_float3 *centroids = malloc(sizeof(simd_float3) * leafCount);
+    size_t batchCount = (leafCount + GLTFSceneBVHParallelThreshold - 1) / GLTFSceneBVHParallelThreshold;
+    dispatch_apply(batchCount, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t batch) {
+        int32_t start = (int32_t)batch * GLTFSceneBVHParallelThreshold;
+        int32_t end = MIN(start + GLTFSceneBVHParallelThreshold, leafCount);
+        for (int32_t i = start; i < end; ++i) {
+            GLTFSceneBVHUpdateLeafBounds(&leaves[i], cachedWorldTransforms[leaves[i].transformIndex]);
+            centroids[i] = (leaves[i].minimum + leaves[i].maximum) * 0.5f;
+        }
+    });
+    
+    _nodeCount = GLTFSceneBVHNodeCountForLeafCount(leafCount);
+    _nodes = malloc(sizeof(GLTFSceneBVHNode) * _nodeCount);
+    _nodeChanged = calloc(_nodeCount, sizeof(bool));
+    
+    GLTFSceneBVHBuildContext context = { _nodes, _leaves, centroids, _leafOrder };
+    GLTFSceneBVHBuild(&context, 0, 0, leafCount);
+    
+    free(centroids);
+}
+
+- (void)refit {
+    GLTFTransformStore *store = self.transformStore;
+    [store updateWorldTransforms];
+    
+    if (store.nodes != self.indexedNodes) {
+        [self rebuild];
+        return;
+    }
+    
+    if (_leafCount == 0) {
+        return;
+    }
+    
+    // Find the nodes that moved and rebound their leaves. The cached transforms include the root transform.
+    simd_float4x4 rootTransform = [self currentRootTransform];
+    GLTFSceneBVHLeaf *leaves = _leaves;
+    const int32_t *leafStarts = _leafStarts;
+    bool *leafChanged = _leafChanged;
+    bool *leafNeedsUpdate = _leafNeedsUpdate;
+    simd_float4x4 *cachedWorldTransforms = _worldTransforms;
+    const simd_float4x4 *worldTransforms = store.worldTransforms;
+    NSInteger transformCount = _transformCount;
+    size_t batchCount = (transformCount + GLTFSceneBVHParallelThreshold - 1) / GLTFSceneBVHParallelThreshold;
+    dispatch_apply(batchCount, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t batch) {
+        NSInteger start = batch * GLTFSceneBVHParallelThreshold;
+        NSInteger end = MIN(start + GLTFSceneBVHParallelThreshold, transformCount);
+        for (NSInteger t = start; t < end; ++t) {
+            int32_t firstLeaf = leafStarts[t], lastLeaf = leafStarts[t + 1];
+            if (firstLeaf == lastLeaf) {
+                continue;
+            }
+            simd_float4x4 worldTransform = matrix_multiply(rootTransform, worldTransforms[t]);
+            BOOL moved = memcmp(&worldTransform, &cachedWorldTransforms[t], sizeof(simd_float4x4)) != 0;
+            if (moved) {
+                cachedWorldTransforms[t] = worldTransform;
+            }
+            for (int32_t i = firstLeaf; i < lastLeaf; ++i) {
+                leafChanged[i] = moved || leafNeedsUpdate[i];
+                if (leafChanged[i]) {
+                    GLTFSceneBVHUpdateLeafBounds(&leaves[i], worldTransform);
+                    leafNeedsUpdate[i] = false;
+                }
+            }
+        }
+    });
+    
+    // Children always follow their parents, so a reverse pass sees both children before their parent
+    for (NSInteger i = _nodeCount - 1; i >= 0; --i) {
+        GLTFSceneBVHNode *node = &_nodes[i];
+        bool changed = false;
+        if (node->leafCount > 0) {
+            const int32_t *order = _leafOrder + node->rightChildOrFirstLeaf;
+            for (int32_t j = 0; j < node->leafCount; ++j) {
+                changed = changed || leafChanged[order[j]];
+            }
+            if (changed) {
+                simd_float3 minimum = FLT_MAX, maximum = -FLT_MAX;
+                for (int32_t j = 0; j < node->leafCount; ++j) {
+                    minimum = simd_min(minimum, leaves[order[j]].minimum);
+                    maximum = simd_max(maximum, leaves[order[j]].maximum);
+                }
+                node->minimum = minimum;
+                node->maximum = maximum;
+            }
+        } else {
+            const GLTFSceneBVHNode *left = &_nodes[i + 1], *right = &_nodes[node->rightChildOrFirstLeaf];
+            changed = _nodeChanged[i + 1] || _nodeChanged[node->rightChildOrFirstLeaf];
+            if (changed) {
+                node->minimum = simd_min(left->minimum, right->minimum);
+                node->maximum = simd_max(left->maximum, right->maximum);
+            }
+        }
+        _nodeChanged[i] = changed;
+    }
+}
+
+- (GLTFBoundingBox)bounds {
+    GLTFBoundingBox bounds = { 0 };
+    if (_nodeCount > 0) {
+        bounds.minPoint = _nodes[0].minimum;
+        bounds.maxPoint = _nodes[0].maximum;
+    }
+    return bounds;
+}
+
+- (void)setLocalBounds:(GLTFBoundingBox)bounds forNode:(GLTFNode *)node {
+    if (self.transformStore.nodes != self.indexedNodes) {
+        [self rebuild];
+    }
+    NSInteger index = [self.transformStore indexOfNode:node];
+    if (index < 0 || index >= _transformCount) {
+        return;
+    }
+    for (int32_t i = _leafStarts[index]; i < _leafStarts[index + 1]; ++i) {
+        _leaves[i].localMinimum = bounds.minPoint;
+        _leaves[i].localMaximum = bounds.maxPoint;
+        _leafNeedsUpdate[i] = true;
+    }
+}
+
+- (void)enumerateLeavesPassingTest:(GLTFSceneBVHBoundsTest)test usingVisitor:(GLTFSceneBVHLeafVisitor)visitor {
+    if (_nodeCount == 0) {
+        return;
+    }
+    
+    NSArray<GLTFNode *> *nodes = self.indexedNodes;
+    int32_t stack[GLTFSceneBVHMaximumDepth];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    BOOL stop = NO;
+    while (stackSize > 0 && !stop) {
+        const GLTFSceneBVHNode *node = &_nodes[stack[--stackSize]];
+        if (!test((GLTFBoundingBox){ node->minimum, node->maximum })) {
+            continue;
+        }
+        if (node->leafCount > 0) {
+            for (int32_t j = 0; j < node->leafCount && !stop; ++j) {
+                const GLTFSceneBVHLeaf *leaf = &_leaves[_leafOrder[node->rightChildOrFirstLeaf + j]];
+                GLTFBoundingBox leafBounds = { leaf->minimum, leaf->maximum };
+                if (test(leafBounds)) {
+                    visitor(nodes[leaf->transformIndex], leaf->submesh, leafBounds, &stop);
+                }
+            }
+        } else {
+            stack[stackSize++] = node->rightChildOrFirstLeaf;
+            stack[stackSize++] = (int32_t)(node - _nodes) + 1;
+        }
+    }
+}
+
+- (GLTFCullingStatistics)cullWithFrustum:(GLTFFrustum)frustum visibility:(bool *)visibility {
+    GLTFCullingStatistics statistics = { 0 };
+    if (_leafCount == 0) {
+        return statistics;
+    }
+    memset(visibility, 0, sizeof(bool) * _leafCount);
+    
+    struct {
+        int32_t nodeIndex;
+        uint32_t planeMask;
+    } stack[GLTFSceneBVHMaximumDepth];
+    int stackSize = 0;
+    stack[stackSize].nodeIndex = 0;
+    stack[stackSize].planeMask = GLTFFrustumAllPlanesMask;
+    ++stackSize;
+    
+    while (stackSize > 0) {
+        --stackSize;
+        const GLTFSceneBVHNode *node = &_nodes[stack[stackSize].nodeIndex];
+        uint32_t planeMask = stack[stackSize].planeMask;
+        
+        // Once every plane has been cleared, the subtree is inside and needs no more tests
+        if (planeMask != 0) {
+            ++statistics.testedBoundsCount;
+            if (GLTFFrustumContainsBox(&frustum, (GLTFBoundingBox){ node->minimum, node->maximum }, &planeMask) == GLTFFrustumContainmentOutside) {
+                continue;
+            }
+        }
+        
+        if (node->leafCount > 0) {
+            for (int32_t j = 0; j < node->leafCount; ++j) {
+                int32_t leafIndex = _leafOrder[node->rightChildOrFirstLeaf + j];
+                const GLTFSceneBVHLeaf *leaf = &_leaves[leafIndex];
+                uint32_t leafPlaneMask = planeMask;
+                if (leafPlaneMask != 0) {
+                    ++statistics.testedBoundsCount;
+                    if (GLTFFrustumContainsBox(&frustum, (GLTFBoundingBox){ leaf->minimum, leaf->maximum }, &leafPlaneMask) == GLTFFrustumContainmentOutside) {
+                        continue;
+                    }
+                }
+                visibility[leafIndex] = true;
+                ++statistics.visibleCount;
+            }
+        } else {
+            stack[stackSize].nodeIndex = node->rightChildOrFirstLeaf;
+            stack[stackSize].planeMask = planeMask;
+            ++stackSize;
+            stack[stackSize].nodeIndex = (int32_t)(node - _nodes) + 1;
+            stack[stackSize].planeMask = planeMask;
+            ++stackSize;
+        }
+    }
+    
+    statistics.culledCount = _leafCount - statistics.visibleCount;
+    return statistics;
+}
+
+- (void)getSubtreeVisibility:(bool *)subtreeVisibility fromLeafVisibility:(const bool *)visibility {
+    for (NSInteger i = 0; i < _transformCount; ++i) {
+        for (int32_t j = _leafStarts[i]; j < _leafStarts[i + 1] && !subtreeVisibility[i]; ++j) {
+            subtreeVisibility[i] = visibility[j];
+        }
+    }
+    
+    // Parents always precede their children, so a reverse pass finishes every subtree before its root
+    const int32_t *parentIndices = self.transformStore.parentIndices;
+    for (NSInteger i = _transformCount - 1; i > 0; --i) {
+        if (subtreeVisibility[i] && parentIndices[i] >= 0) {
+            subtreeVisibility[parentIndices[i]] = true;
+        }
+    }
+}
+
+- (NSInteger)leafIndexForNode:(GLTFNode *)node submeshIndex:(NSInteger)submeshIndex {
+    NSInteger index = [self.transformStore indexOfNode:node];
+    if (index < 0 || index >= _transformCount || self.indexedNodes[index] != node) {
+        return -1;
+    }
+    NSInteger leafIndex = _leafStarts[index] + submeshIndex;
+    return (submeshIndex >= 0 && leafIndex < _leafStarts[index + 1]) ? leafIndex : -1;
+}
+
+- (GLTFRayHit *)intersectRay:(GLTFRay)ray maximumDistance:(float)maximumDistance anyHit:(BOOL)anyHit {
+    if (_nodeCount == 0) {
+        return nil;
+    }
+    
+    NSArray<GLTFNode *> *nodes = self.indexedNodes;
+    GLTFRayHit *closestHit = nil;
+    float closestDistance = maximumDistance;
+    
+    struct {
+        int32_t nodeIndex;
+        float entryDistance;
+    } stack[GLTFSceneBVHMaximumDepth];
+    int stackSize = 0;
+    
+    float entryDistance = 0;
+    if (!GLTFRayIntersectsBox(ray, (GLTFBoundingBox){ _nodes[0].minimum, _nodes[0].maximum }, closestDistance, &entryDistance)) {
+        return nil;
+    }
+    stack[stackSize].nodeIndex = 0;
+    stack[stackSize].entryDistance = entryDistance;
+    ++stackSize;
+    
+    while (stackSize > 0) {
+        --stackSize;
+        if (stack[stackSize].entryDistance > closestDistance) {
+            continue;
+        }
+        int32_t nodeIndex = stack[stackSize].nodeIndex;
+        const GLTFSceneBVHNode *node = &_nodes[nodeIndex];
+        
+        if (node->leafCount > 0) {
+            for (int32_t j = 0; j < node->leafCount; ++j) {
+                const GLTFSceneBVHLeaf *leaf = &_leaves[_leafOrder[node->rightChildOrFirstLeaf + j]];
+                if (!GLTFRayIntersectsBox(ray, (GLTFBoundingBox){ leaf->minimum, leaf->maximum }, closestDistance, NULL)) {
+                    continue;
+                }
+                GLTFTriangleBVH *triangleBVH = leaf->submesh.triangleBVH;
+                if (triangleBVH == nil) {
+                    continue;
+                }
+                // Distances along a transformed ray are the same as along the original
+                GLTFRay localRay = GLTFRayTransform(ray, simd_inverse(_worldTransforms[leaf->transformIndex]));
+                GLTFTriangleHit triangleHit;
+                if ([triangleBVH intersectRay:localRay maximumDistance:closestDistance anyHit:anyHit hit:&triangleHit]) {
+                    closestDistance = triangleHit.distance;
+                    closestHit = [[GLTFRayHit alloc] initWithNode:nodes[leaf->transformIndex]
+                                                          submesh:leaf->submesh
+                                                              ray:ray
+                                                      triangleHit:triangleHit];
+                    if (anyHit) {
+                        return closestHit;
+                    }
+                }
+            }
+            continue;
+        }
+        
+        // Visit the nearer child first, so that its hits let the farther one be skipped
+        int32_t leftIndex = nodeIndex + 1, rightIndex = node->rightChildOrFirstLeaf;
+        float leftEntry = 0, rightEntry = 0;
+        bool hitsLeft = GLTFRayIntersectsBox(ray, (GLTFBoundingBox){ _nodes[leftIndex].minimum, _nodes[leftIndex].maximum },
+                                             closestDistance, &leftEntry);
+        bool hitsRight = GLTFRayIntersectsBox(ray, (GLTFBoundingBox){ _nodes[rightIndex].minimum, _nodes[rightIndex].maximum },
+                                              closestDistance, &rightEntry);
+        if (hitsLeft && hitsRight) {
+            bool leftFirst = leftEntry <= rightEntry;
+            stack[stackSize].nodeIndex = leftFirst ? rightIndex : leftIndex;
+            stack[stackSize].entryDistance = leftFirst ? rightEntry : leftEntry;
+            ++stackSize;
+            stack[stackSize].nodeIndex = leftFirst ? leftIndex : rightIndex;
+            stack[stackSize].entryDistance = leftFirst ? leftEntry : rightEntry;
+            ++stackSize;
+        } else if (hitsLeft || hitsRight) {
+            stack[stackSize].nodeIndex = hitsLeft ? leftIndex : rightIndex;
+            stack[stackSize].entryDistance = hitsLeft ? leftEntry : rightEntry;
+            ++stackSize;
+        }
+    }
+    
+    return closestHit;
+}
+
+- (GLTFRayHit *)closestHitForRay:(GLTFRay)ray maximumDistance:(float)maximumDistance {
+    return [self intersectRay:ray maximumDistance:maximumDistance anyHit:NO];
+}
+
+- (GLTFRayHit *)anyHitForRay:(GLTFRay)ray maximumDistance:(float)maximumDistance {
+    return [self intersectRay:ray maximumDistance:maximumDistance anyHit:YES];
+}
+
+- (void)closestHitsForRays:(const GLTFRay *)rays
+                     count:(NSInteger)count
+           maximumDistance:(float)maximumDistance
+                usingBlock:(void (^)(NSInteger rayIndex, GLTFRayHit *hit))block
+{
+    // Batches amortize the dispatch overhead over enough rays to be worth it
+    const NSInteger batchSize = 64;
+    size_t batchCount = (count + batchSize - 1) / batchSize;
+    dispatch_apply(batchCount, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t batch) {
+        NSInteger start = batch * batchSize;
+        NSInteger end = MIN(start + batchSize, count);
+        for (NSInteger i = start; i < end; ++i) {
+            @autoreleasepool {
+                block(i, [self intersectRay:rays[i] maximumDistance:maximumDistance anyHit:NO]);
+            }
+        }
+    });
+}
+
+@end
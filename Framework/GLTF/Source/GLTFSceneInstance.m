@@ -0,0 +1,129 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+#import "GLTFSceneInstance.h"
+#import "GLTFMesh.h"
+#import "GLTFNode.h"
+#import "GLTFScene.h"
+#import "GLTFSceneBVH.h"
+#import "GLTFTransformStore.h"
+
+@interface GLTFSceneInstance () {
+    float *_morphTargetWeights;
+    NSInteger *_morphTargetWeightOffsets;
+}
+// The store's node list as of the last time per-node state was laid out; a different list means it was rebuilt
+@property (nonatomic, strong) NSArray<GLTFNode *> *layoutNodes;
+@property (nonatomic, strong) NSMapTable<id, NSMutableData *> *animationStates;
+@property (nonatomic, strong) GLTFSceneBVH *cachedBoundingVolumeHierarchy;
+@end
+
+@implementation GLTFSceneInstance
+
+- (instancetype)initWithScene:(GLTFScene *)scene {
+    if ((self = [super init])) {
+        _scene = scene;
+        _transformStore = [[GLTFTransformStore alloc] initWithScene:scene bindingNodes:NO];
+        _rootTransform = matrix_identity_float4x4;
+        _animationStates = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPointerPersonality
+                                                 valueOptions:NSPointerFunctionsStrongMemory];
+        [self layOutIfNeeded];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_morphTargetWeights);
+    free(_morphTargetWeightOffsets);
+}
+
+- (GLTFSceneBVH *)boundingVolumeHierarchy {
+    if (_cachedBoundingVolumeHierarchy == nil) {
+        _cachedBoundingVolumeHierarchy = [[GLTFSceneBVH alloc] initWithSceneInstance:self];
+    }
+    return _cachedBoundingVolumeHierarchy;
+}
+
+- (void)layOutIfNeeded {
+    NSArray<GLTFNode *> *nodes = _transformStore.nodes;
+    if (nodes == _layoutNodes) {
+        return;
+    }
+    _layoutNodes = nodes;
+    
+    // Anything indexed by transform index is stale
+    [_animationStates removeAllObjects];
+    
+    free(_morphTargetWeights);
+    free(_morphTargetWeightOffsets);
+    
+    NSInteger nodeCount = nodes.count;
+    _morphTargetWeightOffsets = malloc(sizeof(NSInteger) * (nodeCount + 1));
+    NSInteger weightCount = 0;
+    for (NSInteger i = 0; i < nodeCount; ++i) {
+        _morphTargetWeightOffsets[i] = weightCount;
+        NSInteger nodeWeightCount = nodes[i].morphTargetWeightCount;
+        weightCount += (nodeWeightCount > 0) ? nodeWeightCount : nodes[i].mesh.defaultMorphTargetWeightCount;
+    }
+    _morphTargetWeightOffsets[nodeCount] = weightCount;
+    
+    _morphTargetWeights = malloc(sizeof(float) * MAX(weightCount, 1));
+    for (NSInteger i = 0; i < nodeCount; ++i) {
+        NSInteger nodeWeightCount = _morphTargetWeightOffsets[i + 1] - _morphTargetWeightOffsets[i];
+        if (nodeWeightCount > 0) {
+            const float *weights = (nodes[i].morphTargetWeightCount > 0) ? nodes[i].morphTargetWeightValues
+                                                                        : nodes[i].mesh.defaultMorphTargetWeightValues;
+            memcpy(_morphTargetWeights + _morphTargetWeightOffsets[i], weights, sizeof(float) * nodeWeightCount);
+        }
+    }
+}
+
+- (simd_float4x4)worldTransformForNode:(GLTFNode *)node {
+    GLTFTransformStore *transformStore = _transformStore;
+    [transformStore updateWorldTransforms];
+    NSInteger index = [transformStore indexOfNode:node];
+    if (index < 0) {
+        return node.globalTransform;
+    }
+    return matrix_multiply(_rootTransform, transformStore.worldTransforms[index]);
+}
+
+- (NSInteger)morphTargetWeightCountAtIndex:(NSInteger)index {
+    [self layOutIfNeeded];
+    if (index < 0 || index >= _layoutNodes.count) {
+        return 0;
+    }
+    return _morphTargetWeightOffsets[index + 1] - _morphTargetWeightOffsets[index];
+}
+
+- (float *)morphTargetWeightsAtIndex:(NSInteger)index {
+    if ([self morphTargetWeightCountAtIndex:index] == 0) {
+        return NULL;
+    }
+    return _morphTargetWeights + _morphTargetWeightOffsets[index];
+}
+
+- (NSMutableData *)_animationStateForKey:(id)key {
+    [self layOutIfNeeded];
+    NSMutableData *state = [_animationStates objectForKey:key];
+    if (state == nil) {
+        state = [NSMutableData data];
+        [_animationStates setObject:state forKey:key];
+    }
+    return state;
+}
+
+@end
@@ -0,0 +1,171 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+#import "GLTFSkinPalette.h"
+#import "GLTFAccessor.h"
+#import "GLTFAnimatedBounds.h"
+#import "GLTFMesh.h"
+#import "GLTFNode.h"
+#import "GLTFSceneInstance.h"
+#import "GLTFSkin.h"
+#import "GLTFTransformStore.h"
+
+void GLTFComputeJointMatrices(simd_float4x4 meshTransform,
+                              const simd_float4x4 *jointTransforms,
+                              const simd_float4x4 *inverseBindMatrices,
+                              NSInteger jointCount,
+                              simd_float4x4 *jointMatrices)
+{
+    simd_float4x4 inverseMeshTransform = simd_inverse(meshTransform);
+    if (inverseBindMatrices == NULL) {
+        for (NSInteger i = 0; i < jointCount; ++i) {
+            jointMatrices[i] = simd_mul(inverseMeshTransform, jointTransforms[i]);
+        }
+        return;
+    }
+    for (NSInteger i = 0; i < jointCount; ++i) {
+        jointMatrices[i] = simd_mul(simd_mul(inverseMeshTransform, jointTransforms[i]), inverseBindMatrices[i]);
+    }
+}
+
+@interface GLTFSkinPalette () {
+    // World transforms of the mesh node followed by each joint, as of this update and the one before
+    simd_float4x4 *_transforms;
+    simd_float4x4 *_previousTransforms;
+    simd_float4x4 *_jointMatrices;
+    NSInteger *_jointIndices;
+}
+// The instance's node list as of the last time joints were looked up in it; a different list means it was rebuilt
+@property (nonatomic, strong) NSArray<GLTFNode *> *indexedNodes;
+@end
+
+@implementation GLTFSkinPalette
+
+- (instancetype)initWithSkin:(GLTFSkin *)skin meshNode:(GLTFNode *)meshNode instance:(GLTFSceneInstance *)instance {
+    if ((self = [super init])) {
+        _skin = skin;
+        _meshNode = meshNode;
+        _instance = instance;
+        _jointCount = skin.jointNodes.count;
+        _transforms = malloc(sizeof(simd_float4x4) * (_jointCount + 1));
+        _previousTransforms = malloc(sizeof(simd_float4x4) * (_jointCount + 1));
+        _jointMatrices = malloc(sizeof(simd_float4x4) * MAX(_jointCount, 1));
+        _jointIndices = malloc(sizeof(NSInteger) * MAX(_jointCount, 1));
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_transforms);
+    free(_previousTransforms);
+    free(_jointMatrices);
+    free(_jointIndices);
+}
+
+- (const simd_float4x4 *)jointMatrices {
+    return _jointMatrices;
+}
+
+- (const simd_float4x4 *)inverseBindMatrices {
+    GLTFAccessor *accessor = _skin.inverseBindMatricesAccessor;
+    if (accessor == nil) {
+        return NULL;
+    }
+    if (accessor.componentType != GLTFDataTypeFloat || accessor.dimension != GLTFDataDimensionMatrix4x4 ||
+        accessor.elementStride != sizeof(simd_float4x4) || accessor.count < _jointCount || accessor.contents == NULL)
+    {
+        static dispatch_once_t unsupportedMatricesNonce;
+        dispatch_once(&unsupportedMatricesNonce, ^{
+            NSLog(@"WARNING: Only tightly packed float4x4 inverse bind matrices with one matrix per joint are supported; "
+                  "treating others as identity. This will only be reported once.");
+        });
+        return NULL;
+    }
+    return accessor.contents;
+}
+
+- (void)gatherTransforms {
+    GLTFNode *meshNode = _meshNode;
+    GLTFSceneInstance *instance = _instance;
+    NSArray<GLTFNode *> *jointNodes = _skin.jointNodes;
+    
+    if (instance == nil) {
+        _transforms[0] = meshNode.globalTransform;
+        for (NSInteger i = 0; i < _jointCount; ++i) {
+            _transforms[i + 1] = jointNodes[i].globalTransform;
+        }
+        return;
+    }
+    
+    // Brings the instance's store up to date, after which joints can be read straight out of it
+    _transforms[0] = [instance worldTransformForNode:meshNode];
+    GLTFTransformStore *transformStore = instance.transformStore;
+    NSArray<GLTFNode *> *nodes = transformStore.nodes;
+    if (nodes != _indexedNodes) {
+        _indexedNodes = nodes;
+        for (NSInteger i = 0; i < _jointCount; ++i) {
+            _jointIndices[i] = [transformStore indexOfNode:jointNodes[i]];
+        }
+    }
+    const simd_float4x4 *worldTransforms = transformStore.worldTransforms;
+    simd_float4x4 rootTransform = instance.rootTransform;
+    for (NSInteger i = 0; i < _jointCount; ++i) {
+        NSInteger index = _jointIndices[i];
+        _transforms[i + 1] = (index >= 0) ? simd_mul(rootTransform, worldTransforms[index]) : jointNodes[i].globalTransform;
+    }
+}
+
+- (GLTFBoundingBox)bounds {
+    GLTFNode *meshNode = _meshNode;
+    GLTFSceneInstance *instance = _instance;
+    const float *weights = meshNode.morphTargetWeightValues;
+    NSInteger weightCount = meshNode.morphTargetWeightCount;
+    NSInteger index = (instance != nil) ? [instance.transformStore indexOfNode:meshNode] : -1;
+    if (index >= 0) {
+        weights = [instance morphTargetWeightsAtIndex:index];
+        weightCount = [instance morphTargetWeightCountAtIndex:index];
+    } else if (weightCount == 0) {
+        weights = meshNode.mesh.defaultMorphTargetWeightValues;
+        weightCount = meshNode.mesh.defaultMorphTargetWeightCount;
+    }
+    return [meshNode.animatedBounds boundsWithJointMatrices:(_version > 0) ? _jointMatrices : NULL
+                                                 jointCount:_jointCount
+                                         morphTargetWeights:weights
+                                                      count:weightCount];
+}
+
+- (BOOL)update {
+    if (_jointCount == 0 || _meshNode == nil) {
+        return NO;
+    }
+    
+    [self gatherTransforms];
+    
+    size_t transformsLength = sizeof(simd_float4x4) * (_jointCount + 1);
+    if (_version > 0 && memcmp(_transforms, _previousTransforms, transformsLength) == 0) {
+        return NO;
+    }
+    
+    GLTFComputeJointMatrices(_transforms[0], _transforms + 1, [self inverseBindMatrices], _jointCount, _jointMatrices);
+    
+    simd_float4x4 *transforms = _transforms;
+    _transforms = _previousTransforms;
+    _previousTransforms = transforms;
+    ++_version;
+    return YES;
+}
+
+@end
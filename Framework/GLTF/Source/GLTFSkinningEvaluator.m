@@ -0,0 +1,315 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+#import "GLTFSkinningEvaluator.h"
+#import "GLTFAccessor.h"
+#import "GLTFMesh.h"
+#import "GLTFVertexDescriptor.h"
+
+// Meshes with more vertices than this are skinned in chunks of this size spread across cores
+#define GLTFSkinningChunkSize 4096
+
+static inline simd_float4x4 GLTFBlendJointMatrices(const uint16_t *joints, const float *weights, int influenceCount,
+                                                   const simd_float4x4 *jointMatrices, NSInteger jointCount)
+{
+    simd_float4 c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+    for (int i = 0; i < influenceCount; ++i) {
+        float weight = weights[i];
+        uint16_t joint = joints[i];
+        if (weight == 0 || joint >= jointCount) {
+            continue;
+        }
+        const simd_float4x4 *m = &jointMatrices[joint];
+        c0 += weight * m->columns[0];
+        c1 += weight * m->columns[1];
+        c2 += weight * m->columns[2];
+        c3 += weight * m->columns[3];
+    }
+    return (simd_float4x4){{ c0, c1, c2, c3 }};
+}
+
+static inline void GLTFSkinVertex(const GLTFSkinningVertices *vertices, NSInteger v,
+                                  const simd_float4x4 *jointMatrices, NSInteger jointCount,
+                                  simd_float3 *positions, simd_float3 *normals, simd_float4 *tangents)
+{
+    int influenceCount = vertices->influenceCount;
+    simd_float4x4 m = GLTFBlendJointMatrices(vertices->joints + v * influenceCount, vertices->weights + v * influenceCount,
+                                             influenceCount, jointMatrices, jointCount);
+    if (positions != NULL) {
+        simd_float3 p = vertices->positions[v];
+        positions[v] = (m.columns[0] * p.x + m.columns[1] * p.y + m.columns[2] * p.z + m.columns[3]).xyz;
+    }
+    if (normals != NULL) {
+        simd_float3 n = vertices->normals[v];
+        normals[v] = simd_normalize((m.columns[0] * n.x + m.columns[1] * n.y + m.columns[2] * n.z).xyz);
+    }
+    if (tangents != NULL) {
+        simd_float4 t = vertices->tangents[v];
+        simd_float3 direction = simd_normalize((m.columns[0] * t.x + m.columns[1] * t.y + m.columns[2] * t.z).xyz);
+        tangents[v] = (simd_float4){ direction.x, direction.y, direction.z, t.w };
+    }
+}
+
+// Influences on joints past the end of the palette blend this instead, with a weight of zero
+static const simd_float4x4 GLTFSkinningZeroMatrix = { 0 };
+
+// Skins vertices [v, v + 4) with one vertex per SIMD lane. The top three rows of the four blended matrices are
+// accumulated as twelve four-wide vectors, so after each influence's joint matrices are gathered and transposed,
+// every multiply-add, transform and normalization works on all four vertices at once.
+static inline void GLTFSkinVertexQuad(const GLTFSkinningVertices *vertices, NSInteger v,
+                                      const simd_float4x4 *jointMatrices, NSInteger jointCount,
+                                      simd_float3 *positions, simd_float3 *normals, simd_float4 *tangents)
+{
+    int influenceCount = vertices->influenceCount;
+    const uint16_t *joints = vertices->joints + v * influenceCount;
+    const float *weights = vertices->weights + v * influenceCount;
+    
+    // rows[r][c] holds row r, column c of each lane's blended matrix
+    simd_float4 rows[3][4] = { 0 };
+    for (int i = 0; i < influenceCount; ++i) {
+        const simd_float4x4 *m[4];
+        simd_float4 w;
+        for (int lane = 0; lane < 4; ++lane) {
+            uint16_t joint = joints[lane * influenceCount + i];
+            BOOL valid = (joint < jointCount);
+            m[lane] = valid ? &jointMatrices[joint] : &GLTFSkinningZeroMatrix;
+            w[lane] = valid ? weights[lane * influenceCount + i] : 0;
+        }
+        for (int c = 0; c < 4; ++c) {
+            simd_float4 c0 = m[0]->columns[c], c1 = m[1]->columns[c], c2 = m[2]->columns[c], c3 = m[3]->columns[c];
+            rows[0][c] += w * (simd_float4){ c0.x, c1.x, c2.x, c3.x };
+            rows[1][c] += w * (simd_float4){ c0.y, c1.y, c2.y, c3.y };
+            rows[2][c] += w * (simd_float4){ c0.z, c1.z, c2.z, c3.z };
+        }
+    }
+    
+    if (positions != NULL) {
+        const simd_float3 *p = vertices->positions + v;
+        simd_float4 x = { p[0].x, p[1].x, p[2].x, p[3].x };
+        simd_float4 y = { p[0].y, p[1].y, p[2].y, p[3].y };
+        simd_float4 z = { p[0].z, p[1].z, p[2].z, p[3].z };
+        simd_float4 rx = rows[0][0] * x + rows[0][1] * y + rows[0][2] * z + rows[0][3];
+        simd_float4 ry = rows[1][0] * x + rows[1][1] * y + rows[1][2] * z + rows[1][3];
+        simd_float4 rz = rows[2][0] * x + rows[2][1] * y + rows[2][2] * z + rows[2][3];
+        for (int lane = 0; lane < 4; ++lane) {
+            positions[v + lane] = (simd_float3){ rx[lane], ry[lane], rz[lane] };
+        }
+    }
+    if (normals != NULL) {
+        const simd_float3 *n = vertices->normals + v;
+        simd_float4 x = { n[0].x, n[1].x, n[2].x, n[3].x };
+        simd_float4 y = { n[0].y, n[1].y, n[2].y, n[3].y };
+        simd_float4 z = { n[0].z, n[1].z, n[2].z, n[3].z };
+        simd_float4 rx = rows[0][0] * x + rows[0][1] * y + rows[0][2] * z;
+        simd_float4 ry = rows[1][0] * x + rows[1][1] * y + rows[1][2] * z;
+        simd_float4 rz = rows[2][0] * x + rows[2][1] * y + rows[2][2] * z;
+        simd_float4 inverseLength = simd_rsqrt(rx * rx + ry * ry + rz * rz);
+        for (int lane = 0; lane < 4; ++lane) {
+            normals[v + lane] = (simd_float3){ rx[lane], ry[lane], rz[lane] } * inverseLength[lane];
+        }
+    }
+    if (tangents != NULL) {
+        const simd_float4 *t = vertices->tangents + v;
+        simd_float4 x = { t[0].x, t[1].x, t[2].x, t[3].x };
+        simd_float4 y = { t[0].y, t[1].y, t[2].y, t[3].y };
+        simd_float4 z = { t[0].z, t[1].z, t[2].z, t[3].z };
+        simd_float4 rx = rows[0][0] * x + rows[0][1] * y + rows[0][2] * z;
+        simd_float4 ry = rows[1][0] * x + rows[1][1] * y + rows[1][2] * z;
+        simd_float4 rz = rows[2][0] * x + rows[2][1] * y + rows[2][2] * z;
+        simd_float4 inverseLength = simd_rsqrt(rx * rx + ry * ry + rz * rz);
+        for (int lane = 0; lane < 4; ++lane) {
+            tangents[v + lane] = (simd_float4){ rx[lane] * inverseLength[lane], ry[lane] * inverseLength[lane],
+                                                rz[lane] * inverseLength[lane], t[lane].w };
+        }
+    }
+}
+
+void GLTFSkinVertices(const GLTFSkinningVertices *vertices, NSInteger start, NSInteger count,
+                      const simd_float4x4 *jointMatrices, NSInteger jointCount,
+                      simd_float3 *positions, simd_float3 *normals, simd_float4 *tangents)
+{
+    if (vertices->normals == NULL) {
+        normals = NULL;
+    }
+    if (vertices->tangents == NULL) {
+        tangents = NULL;
+    }
+    NSInteger end = start + count;
+    NSInteger v = start;
+    for (; v + 4 <= end; v += 4) {
+        GLTFSkinVertexQuad(vertices, v, jointMatrices, jointCount, positions, normals, tangents);
+    }
+    // The last few vertices, one at a time
+    for (; v < end; ++v) {
+        GLTFSkinVertex(vertices, v, jointMatrices, jointCount, positions, normals, tangents);
+    }
+}
+
+// Reads a vector attribute as simd_float3s or simd_float4s (stride in floats), or returns NULL if it's unusable
+static float *GLTFSkinningReadVectors(GLTFAccessor *accessor, NSInteger vertexCount, NSInteger stride) {
+    if (accessor == nil || accessor.count < vertexCount || accessor.contents == NULL) {
+        return NULL;
+    }
+    NSInteger componentCount = accessor.componentCount;
+    float *values = malloc(sizeof(float) * accessor.count * componentCount);
+    [accessor getFloatValues:values];
+    float *vectors = calloc(MAX(vertexCount, 1) * stride, sizeof(float));
+    for (NSInteger v = 0; v < vertexCount; ++v) {
+        for (NSInteger c = 0; c < MIN(componentCount, stride); ++c) {
+            vectors[v * stride + c] = values[v * componentCount + c];
+        }
+    }
+    free(values);
+    return vectors;
+}
+
+@interface GLTFSkinningEvaluator () {
+    uint16_t *_joints;
+    float *_weights;
+    simd_float3 *_positions;
+    simd_float3 *_normals;
+    simd_float4 *_tangents;
+}
+@end
+
+@implementation GLTFSkinningEvaluator
+
+- (instancetype)initWithSubmesh:(GLTFSubmesh *)submesh {
+    if ((self = [super init])) {
+        _submesh = submesh;
+        NSDictionary<NSString *, GLTFAccessor *> *accessors = submesh.accessorsForAttributes;
+        GLTFAccessor *positionAccessor = accessors[GLTFAttributeSemanticPosition];
+        _vertexCount = positionAccessor.count;
+        
+        _positions = (simd_float3 *)GLTFSkinningReadVectors(positionAccessor, _vertexCount, 4);
+        _normals = (simd_float3 *)GLTFSkinningReadVectors(accessors[GLTFAttributeSemanticNormal], _vertexCount, 4);
+        _tangents = (simd_float4 *)GLTFSkinningReadVectors(accessors[GLTFAttributeSemanticTangent], _vertexCount, 4);
+        _hasNormals = (_normals != NULL);
+        _hasTangents = (_tangents != NULL);
+        
+        GLTFAccessor *jointAccessors[2] = { accessors[GLTFAttributeSemanticJoints0], accessors[GLTFAttributeSemanticJoints1] };
+        GLTFAccessor *weightAccessors[2] = { accessors[GLTFAttributeSemanticWeights0], accessors[GLTFAttributeSemanticWeights1] };
+        int setCount = 0;
+        for (int s = 0; s < 2; ++s) {
+            if (jointAccessors[s].count < _vertexCount || weightAccessors[s].count < _vertexCount ||
+                jointAccessors[s].componentCount != 4 || weightAccessors[s].componentCount != 4)
+            {
+                break;
+            }
+            ++setCount;
+        }
+        if (_positions == NULL || setCount == 0) {
+            return self;
+        }
+        
+        _influenceCount = 4 * setCount;
+        NSInteger vertexCount = _vertexCount;
+        _joints = malloc(sizeof(uint16_t) * _influenceCount * MAX(vertexCount, 1));
+        _weights = malloc(sizeof(float) * _influenceCount * MAX(vertexCount, 1));
+        uint32_t *joints = malloc(sizeof(uint32_t) * 4 * MAX(vertexCount, 1));
+        float *weights = malloc(sizeof(float) * 4 * MAX(vertexCount, 1));
+        for (int s = 0; s < setCount; ++s) {
+            // Only the first vertexCount elements are wanted; both accessors may be longer
+            uint32_t *allJoints = malloc(sizeof(uint32_t) * 4 * jointAccessors[s].count);
+            float *allWeights = malloc(sizeof(float) * 4 * weightAccessors[s].count);
+            [jointAccessors[s] getUnsignedIntValues:allJoints];
+            [weightAccessors[s] getFloatValues:allWeights];
+            memcpy(joints, allJoints, sizeof(uint32_t) * 4 * vertexCount);
+            memcpy(weights, allWeights, sizeof(float) * 4 * vertexCount);
+            free(allJoints);
+            free(allWeights);
+            for (NSInteger v = 0; v < vertexCount; ++v) {
+                for (int i = 0; i < 4; ++i) {
+                    _joints[v * _influenceCount + s * 4 + i] = (uint16_t)MIN(joints[v * 4 + i], UINT16_MAX);
+                    _weights[v * _influenceCount + s * 4 + i] = weights[v * 4 + i];
+                }
+            }
+        }
+        free(joints);
+        free(weights);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_joints);
+    free(_weights);
+    free(_positions);
+    free(_normals);
+    free(_tangents);
+}
+
+- (void)skinWithJointMatrices:(const simd_float4x4 *)jointMatrices
+                   jointCount:(NSInteger)jointCount
+                    positions:(simd_float3 *)positions
+                      normals:(simd_float3 *)normals
+                     tangents:(simd_float4 *)tangents
+{
+    if (_positions == NULL) {
+        return;
+    }
+    [self skinPositions:_positions normals:_normals tangents:_tangents
+      withJointMatrices:jointMatrices jointCount:jointCount
+            toPositions:positions normals:normals tangents:tangents];
+}
+
+- (void)skinPositions:(const simd_float3 *)sourcePositions
+              normals:(const simd_float3 *)sourceNormals
+             tangents:(const simd_float4 *)sourceTangents
+    withJointMatrices:(const simd_float4x4 *)jointMatrices
+           jointCount:(NSInteger)jointCount
+          toPositions:(simd_float3 *)positions
+              normals:(simd_float3 *)normals
+             tangents:(simd_float4 *)tangents
+{
+    NSInteger vertexCount = _vertexCount;
+    if (_influenceCount == 0) {
+        // Unskinned geometry passes through untouched
+        if (positions != NULL && positions != sourcePositions) {
+            memcpy(positions, sourcePositions, sizeof(simd_float3) * vertexCount);
+        }
+        if (normals != NULL && sourceNormals != NULL && normals != sourceNormals) {
+            memcpy(normals, sourceNormals, sizeof(simd_float3) * vertexCount);
+        }
+        if (tangents != NULL && sourceTangents != NULL && tangents != sourceTangents) {
+            memcpy(tangents, sourceTangents, sizeof(simd_float4) * vertexCount);
+        }
+        return;
+    }
+    
+    GLTFSkinningVertices vertices = {
+        .joints = _joints,
+        .weights = _weights,
+        .influenceCount = _influenceCount,
+        .positions = sourcePositions,
+        .normals = sourceNormals,
+        .tangents = sourceTangents,
+    };
+    GLTFSkinningVertices *verticesPointer = &vertices;
+    
+    if (vertexCount <= GLTFSkinningChunkSize) {
+        GLTFSkinVertices(verticesPointer, 0, vertexCount, jointMatrices, jointCount, positions, normals, tangents);
+        return;
+    }
+    size_t chunkCount = (vertexCount + GLTFSkinningChunkSize - 1) / GLTFSkinningChunkSize;
+    dispatch_apply(chunkCount, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t chunk) {
+        NSInteger start = chunk * GLTFSkinningChunkSize;
+        NSInteger count = MIN(GLTFSkinningChunkSize, vertexCount - start);
+        GLTFSkinVertices(verticesPointer, start, count, jointMatrices, jointCount, positions, normals, tangents);
+    });
+}
+
+@end
@@ -0,0 +1,316 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+#import "GLTFTransformStore.h"
+#import "GLTFNode.h"
+#import "GLTFScene.h"
+
+#import <stdatomic.h>
+
+typedef NS_OPTIONS(uint8_t, GLTFTransformFlags) {
+    GLTFTransformFlagLocalDirty = 1 << 0,
+    GLTFTransformFlagWorldDirty = 1 << 1,
+};
+
+@interface GLTFNode (GLTFTransformStoreBinding)
+- (void)_setTransformStore:(GLTFTransformStore *)transformStore index:(NSInteger)index;
+@end
+
+@interface GLTFTransformStore () {
+    simd_float3 *_translations;
+    simd_quatf *_rotations;
+    simd_float3 *_scales;
+    simd_float4x4 *_localTransforms;
+    simd_float4x4 *_worldTransforms;
+    int32_t *_parentIndices;
+    GLTFTransformFlags *_flags;
+    // Read without taking the lock, so that queries of a store that is already up to date never contend
+    atomic_bool _needsRebuild;
+    atomic_bool _needsUpdate;
+}
+@property (nonatomic, weak) GLTFScene *scene;
+@property (nonatomic, copy) NSArray<GLTFNode *> *nodes;
+@property (nonatomic, strong) NSMapTable<GLTFNode *, NSNumber *> *indicesForNodes;
+@property (nonatomic, assign) NSInteger nodeCount;
+@end
+
+@implementation GLTFTransformStore
+
+- (instancetype)initWithScene:(GLTFScene *)scene {
+    return [self initWithScene:scene bindingNodes:YES];
+}
+
+- (instancetype)initWithScene:(GLTFScene *)scene bindingNodes:(BOOL)bindNodes {
+    if ((self = [super init])) {
+        _scene = scene;
+        _bindsNodes = bindNodes;
+        _nodes = @[];
+        _needsRebuild = YES;
+        [self rebuildIfNeeded];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    // Bound nodes hold us weakly, so they fall back to their own transforms without being told
+    [self freeStorage];
+}
+
+- (void)freeStorage {
+    free(_translations);
+    free(_rotations);
+    free(_scales);
+    free(_localTransforms);
+    free(_worldTransforms);
+    free(_parentIndices);
+    free(_flags);
+}
+
+- (NSArray<GLTFNode *> *)nodes {
+    [self rebuildIfNeeded];
+    return _nodes;
+}
+
+- (NSInteger)nodeCount {
+    [self rebuildIfNeeded];
+    return _nodeCount;
+}
+
+- (const int32_t *)parentIndices {
+    [self rebuildIfNeeded];
+    return _parentIndices;
+}
+
+- (NSInteger)indexOfNode:(GLTFNode *)node {
+    if (_bindsNodes) {
+        [self rebuildIfNeeded];
+        return (node.transformStore == self) ? node.transformIndex : -1;
+    }
+    NSNumber *index = [self.indicesForNodes objectForKey:node];
+    return (index != nil) ? index.integerValue : -1;
+}
+
+- (NSMapTable<GLTFNode *, NSNumber *> *)indicesForNodes {
+    [self rebuildIfNeeded];
+    return _indicesForNodes;
+}
+
+- (const simd_float3 *)translations {
+    return _translations;
+}
+
+- (const GLTFQuaternion *)rotations {
+    return _rotations;
+}
+
+- (const simd_float3 *)scales {
+    return _scales;
+}
+
+- (const simd_float4x4 *)localTransforms {
+    return _localTransforms;
+}
+
+- (const simd_float4x4 *)worldTransforms {
+    return _worldTransforms;
+}
+
+- (void)setNeedsRebuild {
+    _needsRebuild = YES;
+}
+
+- (void)rebuildIfNeeded {
+    if (!_needsRebuild) {
+        return;
+    }
+    @synchronized (self) {
+        if (_needsRebuild) {
+            [self rebuild];
+        }
+    }
+}
+
+- (void)rebuild {
+    if (_bindsNodes) {
+        for (GLTFNode *node in _nodes) {
+            if (node.transformStore == self) {
+                [node _setTransformStore:nil index:-1];
+            }
+        }
+    }
+    
+    // Breadth-first, which puts every parent ahead of its children. The node list doubles as the queue.
+    NSMutableArray<GLTFNode *> *nodes = [NSMutableArray array];
+    NSMutableData *parentIndexData = [NSMutableData data];
+    NSHashTable *visitedNodes = [NSHashTable hashTableWithOptions:NSPointerFunctionsObjectPointerPersonality];
+    for (GLTFNode *root in self.scene.nodes) {
+        if (![visitedNodes containsObject:root]) {
+            [visitedNodes addObject:root];
+            [nodes addObject:root];
+            int32_t parentIndex = -1;
+            [parentIndexData appendBytes:&parentIndex length:sizeof(parentIndex)];
+        }
+    }
+    for (NSUInteger i = 0; i < nodes.count; ++i) {
+        int32_t parentIndex = (int32_t)i;
+        GLTFNode *node = nodes[i];
+        NSUInteger childCount = node.childCount;
+        for (NSUInteger c = 0; c < childCount; ++c) {
+            GLTFNode *child = [node childAtIndex:c];
+            if (![visitedNodes containsObject:child]) {
+                [visitedNodes addObject:child];
+                [nodes addObject:child];
+                [parentIndexData appendBytes:&parentIndex length:sizeof(parentIndex)];
+            }
+        }
+    }
+    
+    [self freeStorage];
+    
+    NSInteger nodeCount = nodes.count;
+    _translations = malloc(sizeof(simd_float3) * MAX(nodeCount, 1));
+    _rotations = malloc(sizeof(simd_quatf) * MAX(nodeCount, 1));
+    _scales = malloc(sizeof(simd_float3) * MAX(nodeCount, 1));
+    _localTransforms = malloc(sizeof(simd_float4x4) * MAX(nodeCount, 1));
+    _worldTransforms = malloc(sizeof(simd_float4x4) * MAX(nodeCount, 1));
+    _parentIndices = malloc(sizeof(int32_t) * MAX(nodeCount, 1));
+    _flags = malloc(sizeof(GLTFTransformFlags) * MAX(nodeCount, 1));
+    memcpy(_parentIndices, parentIndexData.bytes, parentIndexData.length);
+    
+    NSMapTable *indicesForNodes = nil;
+    if (!_bindsNodes) {
+        indicesForNodes = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsObjectPointerPersonality
+                                                valueOptions:NSPointerFunctionsStrongMemory];
+    }
+    
+    for (NSInteger i = 0; i < nodeCount; ++i) {
+        GLTFNode *node = nodes[i];
+        _translations[i] = node.translation;
+        _rotations[i] = node.rotationQuaternion;
+        _scales[i] = node.scale;
+        _localTransforms[i] = node.localTransform;
+        _flags[i] = GLTFTransformFlagWorldDirty;
+        if (_bindsNodes) {
+            [node _setTransformStore:self index:i];
+        } else {
+            [indicesForNodes setObject:@(i) forKey:node];
+        }
+    }
+    
+    _nodes = [nodes copy];
+    _indicesForNodes = indicesForNodes;
+    _nodeCount = nodeCount;
+    _needsUpdate = YES;
+    // Cleared last, so that threads that find it clear also find the new storage filled in
+    _needsRebuild = NO;
+}
+
+- (void)updateWorldTransforms {
+    if (!_needsRebuild && !_needsUpdate) {
+        return;
+    }
+    @synchronized (self) {
+        [self rebuildIfNeeded];
+        if (_needsUpdate) {
+            [self updateChangedWorldTransforms];
+        }
+    }
+}
+
+- (void)updateChangedWorldTransforms {
+    // Parents precede their children, so by the time we reach a node its parent's world transform is
+    // final, and a dirty parent's flag is still set to mark the node dirty in turn.
+    for (NSInteger i = 0; i < _nodeCount; ++i) {
+        GLTFTransformFlags flags = _flags[i];
+        int32_t parentIndex = _parentIndices[i];
+        if (parentIndex >= 0 && (_flags[parentIndex] & GLTFTransformFlagWorldDirty)) {
+            flags |= GLTFTransformFlagWorldDirty;
+        }
+        if (flags & GLTFTransformFlagLocalDirty) {
+            simd_float4x4 m = simd_matrix4x4(_rotations[i]);
+            m.columns[0] *= _scales[i].x;
+            m.columns[1] *= _scales[i].y;
+            m.columns[2] *= _scales[i].z;
+            m.columns[3] = simd_make_float4(_translations[i], 1);
+            _localTransforms[i] = m;
+            flags |= GLTFTransformFlagWorldDirty;
+        }
+        if (flags & GLTFTransformFlagWorldDirty) {
+            _worldTransforms[i] = (parentIndex >= 0) ? simd_mul(_worldTransforms[parentIndex], _localTransforms[i])
+                                                     : _localTransforms[i];
+        }
+        _flags[i] = flags;
+    }
+    
+    memset(_flags, 0, sizeof(GLTFTransformFlags) * _nodeCount);
+    _needsUpdate = NO;
+}
+
+- (void)setTranslation:(simd_float3)translation atIndex:(NSInteger)index {
+    _translations[index] = translation;
+    _flags[index] |= GLTFTransformFlagLocalDirty;
+    _needsUpdate = YES;
+}
+
+- (void)setRotation:(GLTFQuaternion)rotation atIndex:(NSInteger)index {
+    _rotations[index] = rotation;
+    _flags[index] |= GLTFTransformFlagLocalDirty;
+    _needsUpdate = YES;
+}
+
+- (void)setScale:(simd_float3)scale atIndex:(NSInteger)index {
+    _scales[index] = scale;
+    _flags[index] |= GLTFTransformFlagLocalDirty;
+    _needsUpdate = YES;
+}
+
+- (void)setLocalTransform:(simd_float4x4)localTransform atIndex:(NSInteger)index {
+    _localTransforms[index] = localTransform;
+    _flags[index] = (_flags[index] & ~GLTFTransformFlagLocalDirty) | GLTFTransformFlagWorldDirty;
+    _needsUpdate = YES;
+}
+
+- (void)setTranslations:(const simd_float3 *)translations atIndices:(const int32_t *)indices count:(NSInteger)count {
+    for (NSInteger i = 0; i < count; ++i) {
+        _translations[indices[i]] = translations[i];
+        _flags[indices[i]] |= GLTFTransformFlagLocalDirty;
+    }
+    if (count > 0) {
+        _needsUpdate = YES;
+    }
+}
+
+- (void)setRotations:(const GLTFQuaternion *)rotations atIndices:(const int32_t *)indices count:(NSInteger)count {
+    for (NSInteger i = 0; i < count; ++i) {
+        _rotations[indices[i]] = rotations[i];
+        _flags[indices[i]] |= GLTFTransformFlagLocalDirty;
+    }
+    if (count > 0) {
+        _needsUpdate = YES;
+    }
+}
+
+- (void)setScales:(const simd_float3 *)scales atIndices:(const int32_t *)indices count:(NSInteger)count {
+    for (NSInteger i = 0; i < count; ++i) {
+        _scales[indices[i]] = scales[i];
+        _flags[indices[i]] |= GLTFTransformFlagLocalDirty;
+    }
+    if (count > 0) {
+        _needsUpdate = YES;
+    }
+}
+
+@end
@@ -0,0 +1,432 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFTriangleBVH.h"
+#import "GLTFAccessor.h"
+#import "GLTFMesh.h"
+#import "GLTFNode.h"
+#import "GLTFVertexDescriptor.h"
+
+// Triangles per leaf, one per SIMD lane
+#define GLTFTriangleBVHGroupSize 4
+
+// Subtrees with at least this many triangles are built on two queues
+#define GLTFTriangleBVHParallelThreshold 16384
+
+// Deep enough for any tree built by median splits
+#define GLTFTriangleBVHMaximumDepth 64
+
+typedef struct {
+    simd_float3 minimum;
+    simd_float3 maximum;
+    int32_t rightChildOrGroup; // The left child of an interior node immediately follows it
+    int32_t triangleCount; // Zero for interior nodes
+} GLTFTriangleBVHNode;
+
+// Up to four triangles as a vertex and two edges each, one triangle per lane. Unused lanes have zero edges,
+// which no ray hits.
+typedef struct {
+    simd_float4 vertexX, vertexY, vertexZ;
+    simd_float4 edge1X, edge1Y, edge1Z;
+    simd_float4 edge2X, edge2Y, edge2Z;
+    simd_int4 triangleIndices;
+} GLTFTriangleGroup;
+
+typedef struct {
+    GLTFTriangleBVHNode *nodes;
+    const simd_float3 *minimums;
+    const simd_float3 *maximums;
+    const simd_float3 *centroids;
+    int32_t *triangleOrder;
+} GLTFTriangleBVHBuildContext;
+
+// The tree for a given number of triangles always has the same shape, so the size of the left subtree tells where
+// the right child goes without building the left subtree first
+static int32_t GLTFTriangleBVHNodeCountForTriangleCount(int32_t triangleCount) {
+    if (triangleCount <= GLTFTriangleBVHGroupSize) {
+        return 1;
+    }
+    int32_t leftCount = triangleCount / 2;
+    return 1 + GLTFTriangleBVHNodeCountForTriangleCount(leftCount) + GLTFTriangleBVHNodeCountForTriangleCount(triangleCount - leftCount);
+}
+
+// Reorders the triangles so that the first k have centroids no greater than the rest along the axis
+static void GLTFTriangleBVHPartition(const simd_float3 *centroids, int32_t *order, int32_t count, int32_t k, int axis) {
+    int32_t low = 0, high = count - 1;
+    while (high > low) {
+        float pivot = centroids[order[(low + high) / 2]][axis];
+        int32_t i = low, j = high;
+        while (i <= j) {
+            while (centroids[order[i]][axis] < pivot) { ++i; }
+            while (centroids[order[j]][axis] > pivot) { --j; }
+            if (i <= j) {
+                int32_t swap = order[i];
+                order[i] = order[j];
+                order[j] = swap;
+                ++i;
+                --j;
+            }
+        }
+        if (k <= j) {
+            high = j;
+        } else if (k >= i) {
+            low = i;
+        } else {
+            break;
+        }
+    }
+}
+
+static void GLTFTriangleBVHBuild(const GLTFTriangleBVHBuildContext *context, int32_t nodeIndex, int32_t start, int32_t count) {
+    GLTFTriangleBVHNode *node = &context->nodes[nodeIndex];
+    int32_t *order = context->triangleOrder + start;
+    
+    simd_float3 minimum = FLT_MAX, maximum = -FLT_MAX;
+    simd_float3 centroidMinimum = FLT_MAX, centroidMaximum = -FLT_MAX;
+    for (int32_t i = 0; i < count; ++i) {
+        minimum = simd_min(minimum, context->minimums[order[i]]);
+        maximum = simd_max(maximum, context->maximums[order[i]]);
+        centroidMinimum = simd_min(centroidMinimum, context->centroids[order[i]]);
+        centroidMaximum = simd_max(centroidMaximum, context->centroids[order[i]]);
+    }
+    node->minimum = minimum;
+    node->maximum = maximum;
+    
+    if (count <= GLTFTriangleBVHGroupSize) {
+        // Refers to the first triangle until the groups are packed
+        node->rightChildOrGroup = start;
+        node->triangleCount = count;
+        return;
+    }
+    
+    simd_float3 spread = centroidMaximum - centroidMinimum;
+    int axis = (spread.x >= spread.y && spread.x >= spread.z) ? 0 : ((spread.y >= spread.z) ? 1 : 2);
+    int32_t leftCount = count / 2;
+    GLTFTriangleBVHPartition(context->centroids, order, count, leftCount, axis);
+    
+    int32_t leftIndex = nodeIndex + 1;
+    int32_t rightIndex = leftIndex + GLTFTriangleBVHNodeCountForTriangleCount(leftCount);
+    node->rightChildOrGroup = rightIndex;
+    node->triangleCount = 0;
+    
+    if (count >= GLTFTriangleBVHParallelThreshold) {
+        dispatch_apply(2, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t side) {
+            if (side == 0) {
+                GLTFTriangleBVHBuild(context, leftIndex, start, leftCount);
+            } else {
+                GLTFTriangleBVHBuild(context, rightIndex, start + leftCount, count - leftCount);
+            }
+        });
+    } else {
+        GLTFTriangleBVHBuild(context, leftIndex, start, leftCount);
+        GLTFTriangleBVHBuild(context, rightIndex, start + leftCount, count - leftCount);
+    }
+}
+
+static inline bool GLTFTriangleBVHNodeIntersectsRay(const GLTFTriangleBVHNode *node, simd_float3 origin, simd_float3 inverseDirection,
+                                                    float maximumDistance, float *entryDistance)
+{
+    simd_float3 t0 = (node->minimum - origin) * inverseDirection;
+    simd_float3 t1 = (node->maximum - origin) * inverseDirection;
+    simd_float3 entries = simd_min(t0, t1);
+    simd_float3 exits = simd_max(t0, t1);
+    float firstDistance = fmax(fmax(entries.x, entries.y), fmax(entries.z, 0));
+    float lastDistance = fmin(fmin(exits.x, exits.y), fmin(exits.z, maximumDistance));
+    *entryDistance = firstDistance;
+    return firstDistance <= lastDistance;
+}
+
+// Möller-Trumbore against all four triangles of a group at once; returns a mask of the lanes that were hit
+static inline simd_int4 GLTFTriangleGroupIntersectRay(const GLTFTriangleGroup *group, simd_float3 origin, simd_float3 direction,
+                                                      float maximumDistance, simd_float4 *distances, simd_float4 *us, simd_float4 *vs)
+{
+    simd_float4 px = direction.y * group->edge2Z - direction.z * group->edge2Y;
+    simd_float4 py = direction.z * group->edge2X - direction.x * group->edge2Z;
+    simd_float4 pz = direction.x * group->edge2Y - direction.y * group->edge2X;
+    simd_float4 determinant = group->edge1X * px + group->edge1Y * py + group->edge1Z * pz;
+    simd_float4 inverseDeterminant = 1.0f / determinant;
+    
+    simd_float4 tx = origin.x - group->vertexX;
+    simd_float4 ty = origin.y - group->vertexY;
+    simd_float4 tz = origin.z - group->vertexZ;
+    simd_float4 u = (tx * px + ty * py + tz * pz) * inverseDeterminant;
+    
+    simd_float4 qx = ty * group->edge1Z - tz * group->edge1Y;
+    simd_float4 qy = tz * group->edge1X - tx * group->edge1Z;
+    simd_float4 qz = tx * group->edge1Y - ty * group->edge1X;
+    simd_float4 v = (direction.x * qx + direction.y * qy + direction.z * qz) * inverseDeterminant;
+    simd_float4 t = (group->edge2X * qx + group->edge2Y * qy + group->edge2Z * qz) * inverseDeterminant;
+    
+    *distances = t;
+    *us = u;
+    *vs = v;
+    return (determinant != 0) & (u >= 0) & (v >= 0) & (u + v <= 1) & (t >= 0) & (t <= maximumDistance);
+}
+
+@interface GLTFTriangleBVH () {
+    GLTFTriangleBVHNode *_nodes;
+    NSInteger _nodeCount;
+    GLTFTriangleGroup *_groups;
+    simd_uint3 *_vertexIndices; // By triangle index
+}
+@end
+
+@implementation GLTFTriangleBVH
+
+- (instancetype)initWithSubmesh:(GLTFSubmesh *)submesh {
+    GLTFPrimitiveType primitiveType = submesh.primitiveType;
+    if (primitiveType != GLTFPrimitiveTypeTriangles &&
+        primitiveType != GLTFPrimitiveTypeTriangleStrip &&
+        primitiveType != GLTFPrimitiveTypeTriangleFan)
+    {
+        return nil;
+    }
+    
+    GLTFAccessor *positionAccessor = submesh.accessorsForAttributes[GLTFAttributeSemanticPosition];
+    if (positionAccessor == nil || positionAccessor.dimension != GLTFDataDimensionVector3 || positionAccessor.contents == NULL) {
+        return nil;
+    }
+    
+    if ((self = [super init])) {
+        uint32_t vertexCount = (uint32_t)positionAccessor.count;
+        float *positionValues = malloc(sizeof(float) * 3 * MAX(vertexCount, 1));
+        [positionAccessor getFloatValues:positionValues];
+        
+        GLTFAccessor *indexAccessor = submesh.indexAccessor;
+        uint32_t indexCount = (uint32_t)(indexAccessor ? indexAccessor.count : vertexCount);
+        uint32_t *indices = malloc(sizeof(uint32_t) * MAX(indexCount, 1));
+        if (indexAccessor != nil) {
+            [indexAccessor getUnsignedIntValues:indices];
+        } else {
+            for (uint32_t i = 0; i < indexCount; ++i) {
+                indices[i] = i;
+            }
+        }
+        
+        uint32_t assembledCount = 0;
+        if (primitiveType == GLTFPrimitiveTypeTriangles) {
+            assembledCount = indexCount / 3;
+        } else if (indexCount >= 3) {
+            assembledCount = indexCount - 2;
+        }
+        
+        _vertexIndices = malloc(sizeof(simd_uint3) * MAX(assembledCount, 1));
+        simd_float3 *minimums = malloc(sizeof(simd_float3) * MAX(assembledCount, 1));
+        simd_float3 *maximums = malloc(sizeof(simd_float3) * MAX(assembledCount, 1));
+        simd_float3 *centroids = malloc(sizeof(simd_float3) * MAX(assembledCount, 1));
+        int32_t *triangleOrder = malloc(sizeof(int32_t) * MAX(assembledCount, 1));
+        
+        // Assemble triangles in primitive order, leaving out degenerate ones and any that index past the vertices
+        int32_t triangleCount = 0;
+        for (uint32_t t = 0; t < assembledCount; ++t) {
+            simd_uint3 v;
+            if (primitiveType == GLTFPrimitiveTypeTriangles) {
+                v = (simd_uint3){ indices[t * 3 + 0], indices[t * 3 + 1], indices[t * 3 + 2] };
+            } else if (primitiveType == GLTFPrimitiveTypeTriangleStrip) {
+                // Every other triangle of a strip is flipped to keep the winding consistent
+                v = (t % 2 == 0) ? (simd_uint3){ indices[t], indices[t + 1], indices[t + 2] }
+                                 : (simd_uint3){ indices[t + 1], indices[t], indices[t + 2] };
+            } else {
+                v = (simd_uint3){ indices[0], indices[t + 1], indices[t + 2] };
+            }
+            _vertexIndices[t] = v;
+            
+            if (v.x >= vertexCount || v.y >= vertexCount || v.z >= vertexCount || v.x == v.y || v.y == v.z || v.x == v.z) {
+                continue;
+            }
+            
+            simd_float3 p0 = simd_make_float3(positionValues[v.x * 3], positionValues[v.x * 3 + 1], positionValues[v.x * 3 + 2]);
+            simd_float3 p1 = simd_make_float3(positionValues[v.y * 3], positionValues[v.y * 3 + 1], positionValues[v.y * 3 + 2]);
+            simd_float3 p2 = simd_make_float3(positionValues[v.z * 3], positionValues[v.z * 3 + 1], positionValues[v.z * 3 + 2]);
+            minimums[t] = simd_min(simd_min(p0, p1), p2);
+            maximums[t] = simd_max(simd_max(p0, p1), p2);
+            centroids[t] = (p0 + p1 + p2) * (1.0f / 3);
+            triangleOrder[triangleCount++] = (int32_t)t;
+        }
+        _triangleCount = triangleCount;
+        
+        if (triangleCount > 0) {
+            _nodeCount = GLTFTriangleBVHNodeCountForTriangleCount(triangleCount);
+            _nodes = malloc(sizeof(GLTFTriangleBVHNode) * _nodeCount);
+            
+            GLTFTriangleBVHBuildContext context = { _nodes, minimums, maximums, centroids, triangleOrder };
+            GLTFTriangleBVHBuild(&context, 0, 0, triangleCount);
+            
+            // Every node of the tree has zero or two children, so it has one more leaf than interior nodes
+            NSInteger groupCount = (_nodeCount + 1) / 2;
+            _groups = calloc(groupCount, sizeof(GLTFTriangleGroup));
+            int32_t groupIndex = 0;
+            for (NSInteger i = 0; i < _nodeCount; ++i) {
+                GLTFTriangleBVHNode *node = &_nodes[i];
+                if (node->triangleCount == 0) {
+                    continue;
+                }
+                GLTFTriangleGroup *group = &_groups[groupIndex];
+                group->triangleIndices = -1;
+                for (int32_t lane = 0; lane < node->triangleCount; ++lane) {
+                    int32_t t = triangleOrder[node->rightChildOrGroup + lane];
+                    simd_uint3 v = _vertexIndices[t];
+                    simd_float3 p0 = simd_make_float3(positionValues[v.x * 3], positionValues[v.x * 3 + 1], positionValues[v.x * 3 + 2]);
+                    simd_float3 p1 = simd_make_float3(positionValues[v.y * 3], positionValues[v.y * 3 + 1], positionValues[v.y * 3 + 2]);
+                    simd_float3 p2 = simd_make_float3(positionValues[v.z * 3], positionValues[v.z * 3 + 1], positionValues[v.z * 3 + 2]);
+                    simd_float3 edge1 = p1 - p0, edge2 = p2 - p0;
+                    group->vertexX[lane] = p0.x;
+                    group->vertexY[lane] = p0.y;
+                    group->vertexZ[lane] = p0.z;
+                    group->edge1X[lane] = edge1.x;
+                    group->edge1Y[lane] = edge1.y;
+                    group->edge1Z[lane] = edge1.z;
+                    group->edge2X[lane] = edge2.x;
+                    group->edge2Y[lane] = edge2.y;
+                    group->edge2Z[lane] = edge2.z;
+                    group->triangleIndices[lane] = t;
+                }
+                node->rightChildOrGroup = groupIndex++;
+            }
+        }
+        
+        free(positionValues);
+        free(indices);
+        free(minimums);
+        free(maximums);
+        free(centroids);
+        free(triangleOrder);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_nodes);
+    free(_groups);
+    free(_vertexIndices);
+}
+
+- (GLTFBoundingBox)bounds {
+    GLTFBoundingBox bounds = { 0 };
+    if (_nodeCount > 0) {
+        bounds.minPoint = _nodes[0].minimum;
+        bounds.maxPoint = _nodes[0].maximum;
+    }
+    return bounds;
+}
+
+- (BOOL)intersectRay:(GLTFRay)ray maximumDistance:(float)maximumDistance anyHit:(BOOL)anyHit hit:(GLTFTriangleHit *)hit {
+    if (_nodeCount == 0) {
+        return NO;
+    }
+    
+    simd_float3 origin = ray.origin, direction = ray.direction;
+    simd_float3 inverseDirection = 1.0f / direction;
+    
+    float closestDistance = maximumDistance;
+    int32_t closestTriangle = -1;
+    float closestU = 0, closestV = 0;
+    
+    struct {
+        int32_t nodeIndex;
+        float entryDistance;
+    } stack[GLTFTriangleBVHMaximumDepth];
+    int stackSize = 0;
+    
+    float entryDistance = 0;
+    if (!GLTFTriangleBVHNodeIntersectsRay(&_nodes[0], origin, inverseDirection, closestDistance, &entryDistance)) {
+        return NO;
+    }
+    stack[stackSize].nodeIndex = 0;
+    stack[stackSize].entryDistance = entryDistance;
+    ++stackSize;
+    
+    while (stackSize > 0) {
+        --stackSize;
+        if (stack[stackSize].entryDistance > closestDistance) {
+            continue;
+        }
+        int32_t nodeIndex = stack[stackSize].nodeIndex;
+        const GLTFTriangleBVHNode *node = &_nodes[nodeIndex];
+        
+        if (node->triangleCount > 0) {
+            const GLTFTriangleGroup *group = &_groups[node->rightChildOrGroup];
+            simd_float4 distances, us, vs;
+            simd_int4 hits = GLTFTriangleGroupIntersectRay(group, origin, direction, closestDistance, &distances, &us, &vs);
+            if (!simd_any(hits)) {
+                continue;
+            }
+            for (int lane = 0; lane < GLTFTriangleBVHGroupSize; ++lane) {
+                if (hits[lane] && distances[lane] <= closestDistance) {
+                    closestDistance = distances[lane];
+                    closestTriangle = group->triangleIndices[lane];
+                    closestU = us[lane];
+                    closestV = vs[lane];
+                }
+            }
+            if (anyHit) {
+                break;
+            }
+            continue;
+        }
+        
+        // Visit the nearer child first, so that its hits let the farther one be skipped
+        int32_t leftIndex = nodeIndex + 1, rightIndex = node->rightChildOrGroup;
+        float leftEntry = 0, rightEntry = 0;
+        bool hitsLeft = GLTFTriangleBVHNodeIntersectsRay(&_nodes[leftIndex], origin, inverseDirection, closestDistance, &leftEntry);
+        bool hitsRight = GLTFTriangleBVHNodeIntersectsRay(&_nodes[rightIndex], origin, inverseDirection, closestDistance, &rightEntry);
+        if (hitsLeft && hitsRight) {
+            bool leftFirst = leftEntry <= rightEntry;
+            stack[stackSize].nodeIndex = leftFirst ? rightIndex : leftIndex;
+            stack[stackSize].entryDistance = leftFirst ? rightEntry : leftEntry;
+            ++stackSize;
+            stack[stackSize].nodeIndex = leftFirst ? leftIndex : rightIndex;
+            stack[stackSize].entryDistance = leftFirst ? leftEntry : rightEntry;
+            ++stackSize;
+        } else if (hitsLeft || hitsRight) {
+            stack[stackSize].nodeIndex = hitsLeft ? leftIndex : rightIndex;
+            stack[stackSize].entryDistance = hitsLeft ? leftEntry : rightEntry;
+            ++stackSize;
+        }
+    }
+    
+    if (closestTriangle < 0) {
+        return NO;
+    }
+    
+    if (hit != NULL) {
+        hit->triangleIndex = closestTriangle;
+        hit->vertexIndices = _vertexIndices[closestTriangle];
+        hit->barycentricCoordinates = simd_make_float3(1 - closestU - closestV, closestU, closestV);
+        hit->distance = closestDistance;
+    }
+    return YES;
+}
+
+@end
+
+@implementation GLTFRayHit
+
+- (instancetype)initWithNode:(GLTFNode *)node submesh:(GLTFSubmesh *)submesh ray:(GLTFRay)ray triangleHit:(GLTFTriangleHit)triangleHit {
+    if ((self = [super init])) {
+        _node = node;
+        _submesh = submesh;
+        _triangleIndex = triangleHit.triangleIndex;
+        _vertexIndices = triangleHit.vertexIndices;
+        _barycentricCoordinates = triangleHit.barycentricCoordinates;
+        _distance = triangleHit.distance;
+        _position = ray.origin + ray.direction * triangleHit.distance;
+    }
+    return self;
+}
+
+@end
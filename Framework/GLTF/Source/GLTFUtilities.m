@@ -41,30 +41,21 @@ GLTFBoundingBox *GLTFBoundingBoxUnion(GLTFBoundingBox *a, GLTFBoundingBox b) {
 }
 
 void GLTFBoundingBoxTransform(GLTFBoundingBox *b, simd_float4x4 transform) {
-    simd_float4 ltf = (simd_float4) { b->minPoint.x, b->maxPoint.y, b->maxPoint.z, 1 };
-    simd_float4 rtf = (simd_float4) { b->maxPoint.x, b->maxPoint.y, b->maxPoint.z, 1 };
-    simd_float4 lbf = (simd_float4) { b->minPoint.x, b->minPoint.y, b->maxPoint.z, 1 };
-    simd_float4 rbf = (simd_float4) { b->maxPoint.x, b->minPoint.y, b->maxPoint.z, 1 };
-    simd_float4 ltb = (simd_float4) { b->minPoint.x, b->maxPoint.y, b->minPoint.z, 1 };
-    simd_float4 rtb = (simd_float4) { b->maxPoint.x, b->maxPoint.y, b->minPoint.z, 1 };
-    simd_float4 lbb = (simd_float4) { b->minPoint.x, b->minPoint.y, b->minPoint.z, 1 };
-    simd_float4 rbb = (simd_float4) { b->maxPoint.x, b->minPoint.y, b->minPoint.z, 1 };
+    // Arvo's method: rather than transforming all eight corners, move the center and grow the half-extents by
+    // the absolute value of the upper 3x3. This gives the same box as the corners for any affine transform.
+    simd_float3 center = (b->minPoint + b->maxPoint) * 0.5f;
+    simd_float3 extent = (b->maxPoint - b->minPoint) * 0.5f;
     
-    ltf = matrix_multiply(transform, ltf);
-    rtf = matrix_multiply(transform, rtf);
-    lbf = matrix_multiply(transform, lbf);
-    rbf = matrix_multiply(transform, rbf);
-    ltb = matrix_multiply(transform, ltb);
-    rtb = matrix_multiply(transform, rtb);
-    lbb = matrix_multiply(transform, lbb);
-    rbb = matrix_multiply(transform, rbb);
+    simd_float3 transformedCenter = transform.columns[3].xyz +
+                                    transform.columns[0].xyz * center.x +
+                                    transform.columns[1].xyz * center.y +
+                                    transform.columns[2].xyz * center.z;
+    simd_float3 transformedExtent = simd_abs(transform.columns[0].xyz) * extent.x +
+                                    simd_abs(transform.columns[1].xyz) * extent.y +
+                                    simd_abs(transform.columns[2].xyz) * extent.z;
     
-    b->minPoint.x = fmin(fmin(fmin(fmin(fmin(fmin(fmin(ltf.x, rtf.x), lbf.x), rbf.x), ltb.x), rtb.x), lbb.x), rbb.x);
-    b->minPoint.y = fmin(fmin(fmin(fmin(fmin(fmin(fmin(ltf.y, rtf.y), lbf.y), rbf.y), ltb.y), rtb.y), lbb.y), rbb.y);
-    b->minPoint.z = fmin(fmin(fmin(fmin(fmin(fmin(fmin(ltf.z, rtf.z), lbf.z), rbf.z), ltb.z), rtb.z), lbb.z), rbb.z);
-    b->maxPoint.x = fmax(fmax(fmax(fmax(fmax(fmax(fmax(ltf.x, rtf.x), lbf.x), rbf.x), ltb.x), rtb.x), lbb.x), rbb.x);
-    b->maxPoint.y = fmax(fmax(fmax(fmax(fmax(fmax(fmax(ltf.y, rtf.y), lbf.y), rbf.y), ltb.y), rtb.y), lbb.y), rbb.y);
-    b->maxPoint.z = fmax(fmax(fmax(fmax(fmax(fmax(fmax(ltf.z, rtf.z), lbf.z), rbf.z), ltb.z), rtb.z), lbb.z), rbb.z);
+    b->minPoint = transformedCenter - transformedExtent;
+    b->maxPoint = transformedCenter + transformedExtent;
 }
 
 GLTFBoundingSphere GLTFBoundingSphereFromBox(const GLTFBoundingBox b) {
@@ -80,6 +71,99 @@ GLTFBoundingSphere GLTFBoundingSphereFromBox(const GLTFBoundingBox b) {
     return s;
 }
 
+GLTFBoundingSphere GLTFBoundingSphereTransform(GLTFBoundingSphere s, simd_float4x4 transform) {
+    float scaleX = simd_length_squared(transform.columns[0].xyz);
+    float scaleY = simd_length_squared(transform.columns[1].xyz);
+    float scaleZ = simd_length_squared(transform.columns[2].xyz);
+    float maxScale = sqrtf(fmaxf(fmaxf(scaleX, scaleY), scaleZ));
+    
+    GLTFBoundingSphere t;
+    t.center = matrix_multiply(transform, simd_make_float4(s.center, 1)).xyz;
+    t.radius = s.radius * maxScale;
+    return t;
+}
+
+GLTFFrustum GLTFFrustumFromViewProjectionMatrix(simd_float4x4 m) {
+    simd_float4x4 mt = simd_transpose(m);
+    simd_float4 row0 = mt.columns[0], row1 = mt.columns[1], row2 = mt.columns[2], row3 = mt.columns[3];
+    
+    GLTFFrustum frustum;
+    frustum.planes[0] = row3 + row0;
+    frustum.planes[1] = row3 - row0;
+    frustum.planes[2] = row3 + row1;
+    frustum.planes[3] = row3 - row1;
+    frustum.planes[4] = row2;
+    frustum.planes[5] = row3 - row2;
+    
+    for (int i = 0; i < 6; ++i) {
+        float length = simd_length(frustum.planes[i].xyz);
+        if (length > 0) {
+            frustum.planes[i] /= length;
+        }
+    }
+    
+    return frustum;
+}
+
+bool GLTFFrustumIntersectsSphere(const GLTFFrustum *frustum, GLTFBoundingSphere s) {
+    for (int i = 0; i < 6; ++i) {
+        simd_float4 plane = frustum->planes[i];
+        if (simd_dot(plane.xyz, s.center) + plane.w < -s.radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const uint32_t GLTFFrustumAllPlanesMask = 0x3F;
+
+GLTFFrustumContainment GLTFFrustumContainsBox(const GLTFFrustum *frustum, GLTFBoundingBox b, uint32_t *planeMask) {
+    simd_float3 center = (b.minPoint + b.maxPoint) * 0.5f;
+    simd_float3 extent = (b.maxPoint - b.minPoint) * 0.5f;
+    for (int i = 0; i < 6; ++i) {
+        if ((*planeMask & (1u << i)) == 0) {
+            continue;
+        }
+        simd_float4 plane = frustum->planes[i];
+        // Signed distance of the center from the plane, and the box's reach towards it
+        float distance = simd_dot(plane.xyz, center) + plane.w;
+        float radius = simd_dot(simd_abs(plane.xyz), extent);
+        if (distance < -radius) {
+            return GLTFFrustumContainmentOutside;
+        }
+        if (distance >= radius) {
+            *planeMask &= ~(1u << i);
+        }
+    }
+    return (*planeMask == 0) ? GLTFFrustumContainmentInside : GLTFFrustumContainmentIntersecting;
+}
+
+GLTFRay GLTFRayTransform(GLTFRay ray, simd_float4x4 transform) {
+    GLTFRay transformed;
+    transformed.origin = simd_mul(transform, simd_make_float4(ray.origin, 1)).xyz;
+    transformed.direction = simd_mul(transform, simd_make_float4(ray.direction, 0)).xyz;
+    return transformed;
+}
+
+bool GLTFRayIntersectsBox(GLTFRay ray, GLTFBoundingBox b, float maximumDistance, float *entryDistance) {
+    // Slab test. Axis-parallel rays divide by zero, and the resulting infinities (or NaNs, for rays that lie in a
+    // face's plane) are discarded by fmin/fmax.
+    simd_float3 inverseDirection = 1.0f / ray.direction;
+    simd_float3 t0 = (b.minPoint - ray.origin) * inverseDirection;
+    simd_float3 t1 = (b.maxPoint - ray.origin) * inverseDirection;
+    simd_float3 entries = simd_min(t0, t1);
+    simd_float3 exits = simd_max(t0, t1);
+    float firstDistance = fmax(fmax(entries.x, entries.y), fmax(entries.z, 0));
+    float lastDistance = fmin(fmin(exits.x, exits.y), fmin(exits.z, maximumDistance));
+    if (firstDistance > lastDistance) {
+        return false;
+    }
+    if (entryDistance != NULL) {
+        *entryDistance = firstDistance;
+    }
+    return true;
+}
+
 GLTFQuaternion GLTFQuaternionFromEulerAngles(float pitch, float yaw, float roll) {
     float cx = cos(pitch / 2);
     float sx = sin(pitch / 2);
@@ -297,6 +381,21 @@ NSInteger GLTFComponentCountForDimension(GLTFDataDimension dimension) {
     }
 }
 
+void GLTFGetFloatsFromNumbers(NSArray<NSNumber *> *numbers, float *values) {
+    NSInteger i = 0;
+    for (NSNumber *number in numbers) {
+        values[i++] = number.floatValue;
+    }
+}
+
+NSArray<NSNumber *> *GLTFNumbersFromFloats(const float *values, NSInteger count) {
+    NSMutableArray<NSNumber *> *numbers = [NSMutableArray arrayWithCapacity:count];
+    for (NSInteger i = 0; i < count; ++i) {
+        [numbers addObject:@(values[i])];
+    }
+    return numbers;
+}
+
 BOOL GLTFDataTypeComponentsAreFloats(GLTFDataType type) {
     switch (type) {
         case GLTFDataTypeFloat:
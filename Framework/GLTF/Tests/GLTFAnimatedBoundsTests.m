@@ -0,0 +1,160 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFTestGeometry.h"
+
+@import XCTest;
+
+@interface GLTFAnimatedBoundsTests : XCTestCase
+@property (nonatomic, strong) GLTFTestAccessorPool *pool;
+@end
+
+@implementation GLTFAnimatedBoundsTests
+
+- (void)setUp {
+    [super setUp];
+    self.pool = [GLTFTestAccessorPool new];
+}
+
+// Four vertices; the first two follow joint 0 and the last two joint 1, unless joints is NULL
+- (GLTFSubmesh *)submeshWithPositions:(const float *)positions joints:(const float *)joints {
+    GLTFSubmesh *submesh = [GLTFSubmesh new];
+    NSMutableDictionary<NSString *, GLTFAccessor *> *accessors = [NSMutableDictionary dictionary];
+    accessors[GLTFAttributeSemanticPosition] = [self.pool accessorWithFloats:positions count:4 dimension:GLTFDataDimensionVector3];
+    if (joints != NULL) {
+        const float weights[] = { 1, 0, 0, 0,   1, 0, 0, 0,   1, 0, 0, 0,   1, 0, 0, 0 };
+        accessors[GLTFAttributeSemanticJoints0] = [self.pool accessorWithFloats:joints count:4 dimension:GLTFDataDimensionVector4];
+        accessors[GLTFAttributeSemanticWeights0] = [self.pool accessorWithFloats:weights count:4 dimension:GLTFDataDimensionVector4];
+    }
+    submesh.accessorsForAttributes = accessors;
+    return submesh;
+}
+
+- (GLTFSkin *)skinWithJointCount:(NSInteger)jointCount {
+    NSMutableArray<GLTFNode *> *jointNodes = [NSMutableArray array];
+    for (NSInteger j = 0; j < jointCount; ++j) {
+        [jointNodes addObject:[GLTFNode new]];
+    }
+    GLTFSkin *skin = [GLTFSkin new];
+    skin.jointNodes = jointNodes;
+    return skin;
+}
+
+- (void)assertBounds:(GLTFBoundingBox)bounds containPoint:(simd_float3)point {
+    const float slack = 1e-5f;
+    XCTAssertTrue(simd_all(bounds.minPoint - slack <= point) && simd_all(point <= bounds.maxPoint + slack),
+                  @"(%g, %g, %g) lies outside the bounds", point.x, point.y, point.z);
+}
+
+static const float GLTFTestQuadPositions[] = { -1, 0, 0,   0, 1, 0,   1, 0, 0,   2, 1, 1 };
+
+- (void)testSkinnedBoundsFollowJoints {
+    const float joints[] = { 0, 0, 0, 0,   0, 0, 0, 0,   1, 0, 0, 0,   1, 0, 0, 0 };
+    GLTFMesh *mesh = [GLTFMesh new];
+    mesh.submeshes = @[ [self submeshWithPositions:GLTFTestQuadPositions joints:joints] ];
+    GLTFAnimatedBounds *animatedBounds = [[GLTFAnimatedBounds alloc] initWithMesh:mesh skin:[self skinWithJointCount:2]];
+    XCTAssertEqual(animatedBounds.jointCount, 2);
+
+    GLTFBoundingBox bindBounds = [animatedBounds boundsWithJointMatrices:NULL jointCount:0 morphTargetWeights:NULL count:0];
+    XCTAssertTrue(simd_equal(bindBounds.minPoint, ((simd_float3){ -1, 0, 0 })));
+    XCTAssertTrue(simd_equal(bindBounds.maxPoint, ((simd_float3){ 2, 1, 1 })));
+
+    simd_float4x4 jointMatrices[2] = {
+        simd_matrix4x4(simd_quaternion((float)M_PI_2, GLTFAxisZ)),
+        matrix_identity_float4x4,
+    };
+    jointMatrices[1].columns[3] = (simd_float4){ 10, -5, 0, 1 };
+    GLTFBoundingBox bounds = [animatedBounds boundsWithJointMatrices:jointMatrices jointCount:2 morphTargetWeights:NULL count:0];
+    for (int v = 0; v < 4; ++v) {
+        simd_float3 position = { GLTFTestQuadPositions[v * 3], GLTFTestQuadPositions[v * 3 + 1], GLTFTestQuadPositions[v * 3 + 2] };
+        simd_float3 skinnedPosition = simd_mul(jointMatrices[(int)joints[v * 4]], simd_make_float4(position, 1)).xyz;
+        [self assertBounds:bounds containPoint:skinnedPosition];
+    }
+    // The moved joint's vertices are no longer near the bind pose
+    XCTAssertGreaterThanOrEqual(bounds.maxPoint.x, 11);
+}
+
+- (void)testMorphedBoundsContainMorphedVertices {
+    const float deltas[2][12] = {
+        { 0, 2, 0,   0, 0, 0,   0, -1, 0,   0, 0, 0 },
+        { 1, 0, 0,   0, 0, 3,   0, 0, 0,    -2, 0, 0 },
+    };
+    GLTFSubmesh *submesh = [self submeshWithPositions:GLTFTestQuadPositions joints:NULL];
+    NSMutableArray<GLTFMorphTarget *> *targets = [NSMutableArray array];
+    for (int t = 0; t < 2; ++t) {
+        GLTFMorphTarget *target = [GLTFMorphTarget new];
+        target.accessorsForAttributes = @{
+            GLTFAttributeSemanticPosition : [self.pool accessorWithFloats:deltas[t] count:4 dimension:GLTFDataDimensionVector3]
+        };
+        [targets addObject:target];
+    }
+    submesh.morphTargets = targets;
+    GLTFMesh *mesh = [GLTFMesh new];
+    mesh.submeshes = @[ submesh ];
+    GLTFAnimatedBounds *animatedBounds = [[GLTFAnimatedBounds alloc] initWithMesh:mesh skin:nil];
+    XCTAssertEqual(animatedBounds.targetCount, 2);
+
+    // Negative weights move vertices against their deltas
+    const float weightSets[][2] = { { 0, 0 }, { 1, 0 }, { 0.5f, 1 }, { -1, 0.25f }, { 0.3f, -2 } };
+    for (int w = 0; w < sizeof(weightSets) / sizeof(weightSets[0]); ++w) {
+        const float *weights = weightSets[w];
+        GLTFBoundingBox bounds = [animatedBounds boundsWithJointMatrices:NULL jointCount:0 morphTargetWeights:weights count:2];
+        for (int v = 0; v < 4; ++v) {
+            simd_float3 position = { GLTFTestQuadPositions[v * 3], GLTFTestQuadPositions[v * 3 + 1], GLTFTestQuadPositions[v * 3 + 2] };
+            for (int t = 0; t < 2; ++t) {
+                position += weights[t] * (simd_float3){ deltas[t][v * 3], deltas[t][v * 3 + 1], deltas[t][v * 3 + 2] };
+            }
+            [self assertBounds:bounds containPoint:position];
+        }
+    }
+}
+
+- (void)testVerticesWithoutJointsStayInBounds {
+    // A skinned submesh, one without joints at all, and one whose influences are all zero or out of range
+    const float joints[] = { 0, 0, 0, 0,   0, 0, 0, 0,   0, 0, 0, 0,   0, 0, 0, 0 };
+    const float farPositions[] = { 20, 0, 0,   21, 1, 0,   20, 2, 0,   22, 0, 1 };
+    const float otherPositions[] = { 0, -30, 0,   1, -30, 0,   0, -31, 0,   1, -31, 1 };
+    const float missingJoints[] = { 7, 0, 0, 0,   7, 0, 0, 0,   7, 0, 0, 0,   7, 0, 0, 0 };
+    GLTFSubmesh *otherSubmesh = [self submeshWithPositions:otherPositions joints:missingJoints];
+    GLTFMesh *mesh = [GLTFMesh new];
+    mesh.submeshes = @[
+        [self submeshWithPositions:GLTFTestQuadPositions joints:joints],
+        [self submeshWithPositions:farPositions joints:NULL],
+        otherSubmesh,
+    ];
+    GLTFAnimatedBounds *animatedBounds = [[GLTFAnimatedBounds alloc] initWithMesh:mesh skin:[self skinWithJointCount:1]];
+
+    simd_float4x4 jointMatrix = matrix_identity_float4x4;
+    jointMatrix.columns[3] = (simd_float4){ 0, 0, -50, 1 };
+    GLTFBoundingBox bounds = [animatedBounds boundsWithJointMatrices:&jointMatrix jointCount:1 morphTargetWeights:NULL count:0];
+    for (int v = 0; v < 4; ++v) {
+        [self assertBounds:bounds containPoint:(simd_float3){ farPositions[v * 3], farPositions[v * 3 + 1], farPositions[v * 3 + 2] }];
+        [self assertBounds:bounds containPoint:(simd_float3){ otherPositions[v * 3], otherPositions[v * 3 + 1], otherPositions[v * 3 + 2] }];
+        simd_float3 position = { GLTFTestQuadPositions[v * 3], GLTFTestQuadPositions[v * 3 + 1], GLTFTestQuadPositions[v * 3 + 2] };
+        [self assertBounds:bounds containPoint:simd_mul(jointMatrix, simd_make_float4(position, 1)).xyz];
+    }
+
+    // With no influenced vertices at all the bounds still aren't empty
+    GLTFMesh *unskinnedMesh = [GLTFMesh new];
+    unskinnedMesh.submeshes = @[ [self submeshWithPositions:farPositions joints:NULL] ];
+    animatedBounds = [[GLTFAnimatedBounds alloc] initWithMesh:unskinnedMesh skin:[self skinWithJointCount:1]];
+    bounds = [animatedBounds boundsWithJointMatrices:&jointMatrix jointCount:1 morphTargetWeights:NULL count:0];
+    XCTAssertTrue(simd_equal(bounds.minPoint, ((simd_float3){ 20, 0, 0 })));
+    XCTAssertTrue(simd_equal(bounds.maxPoint, ((simd_float3){ 22, 2, 1 })));
+}
+
+@end
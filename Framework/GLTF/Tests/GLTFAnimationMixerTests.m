@@ -0,0 +1,145 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFTestGeometry.h"
+
+@import XCTest;
+
+@interface GLTFAnimationMixerTests : XCTestCase
+@end
+
+@implementation GLTFAnimationMixerTests
+
+- (void)testAdditiveOnlyLayerIsStableAcrossEvaluations {
+    GLTFTestAccessorPool *pool = [GLTFTestAccessorPool new];
+    GLTFNode *node = [GLTFNode new];
+    node.translation = (simd_float3){ 1, 0, 0 };
+    const float restWeights[] = { 0.5f, 0 };
+    [node setMorphTargetWeightValues:restWeights count:2];
+    GLTFScene *scene = [GLTFScene new];
+    scene.nodes = @[ node ];
+
+    const float times[] = { 0, 1 };
+    const float translations[] = { 1, 0, 0,   1, 2, 0 };
+    simd_quatf rotations[] = { simd_quaternion(0.0f, GLTFAxisY), simd_quaternion((float)M_PI_2, GLTFAxisY) };
+    const float weights[] = { 0.5f, 0,   0.5f, 1 };
+    NSArray *samplers = @[
+        [pool samplerWithTimes:times keyCount:2 values:translations valueCount:2 dimension:GLTFDataDimensionVector3],
+        [pool samplerWithTimes:times keyCount:2 values:(const float *)rotations valueCount:2 dimension:GLTFDataDimensionVector4],
+        [pool samplerWithTimes:times keyCount:2 values:weights valueCount:4 dimension:GLTFDataDimensionScalar],
+    ];
+    NSArray *paths = @[ @"translation", @"rotation", @"weights" ];
+    NSMutableArray *channels = [NSMutableArray array];
+    for (NSUInteger i = 0; i < paths.count; ++i) {
+        GLTFAnimationChannel *channel = [GLTFAnimationChannel new];
+        channel.targetNode = node;
+        channel.targetPath = paths[i];
+        channel.sampler = samplers[i];
+        [channels addObject:channel];
+    }
+    GLTFAnimation *animation = [GLTFAnimation new];
+    animation.samplers = samplers;
+    animation.channels = channels;
+
+    GLTFSceneInstance *instance = [[GLTFSceneInstance alloc] initWithScene:scene];
+    GLTFAnimationMixer *mixer = [[GLTFAnimationMixer alloc] initWithSceneInstance:instance];
+    GLTFAnimationMixerLayer *layer = [mixer addLayerWithAnimation:animation];
+    layer.blendMode = GLTFAnimationBlendModeAdditive;
+    layer.weight = 0.5f;
+    layer.time = 1;
+
+    NSInteger index = [instance.transformStore indexOfNode:node];
+    [mixer evaluate];
+    simd_float3 firstTranslation = instance.transformStore.translations[index];
+    GLTFQuaternion firstRotation = instance.transformStore.rotations[index];
+    float firstWeight = [instance morphTargetWeightsAtIndex:index][1];
+    [mixer evaluate];
+    [mixer evaluate];
+
+    // Half of the layer's offset from the rest pose, applied once, however many times the mixer runs
+    XCTAssertLessThanOrEqual(simd_distance(firstTranslation, (simd_float3){ 1, 1, 0 }), 1e-5f);
+    XCTAssertLessThanOrEqual(simd_distance(instance.transformStore.translations[index], firstTranslation), 1e-6f);
+    XCTAssertEqualWithAccuracy(fabsf(simd_dot(firstRotation.vector, simd_quaternion((float)M_PI_4, GLTFAxisY).vector)), 1, 1e-5f);
+    XCTAssertLessThanOrEqual(simd_distance(instance.transformStore.rotations[index].vector, firstRotation.vector), 1e-6f);
+    XCTAssertEqualWithAccuracy(firstWeight, 0.5f, 1e-6f);
+    XCTAssertEqualWithAccuracy([instance morphTargetWeightsAtIndex:index][1], firstWeight, 1e-6f);
+    XCTAssertEqualWithAccuracy([instance morphTargetWeightsAtIndex:index][0], 0.5f, 1e-6f);
+}
+
+- (GLTFAnimation *)weightsAnimationForNode:(GLTFNode *)node values:(const float *)values valueCount:(NSInteger)valueCount pool:(GLTFTestAccessorPool *)pool {
+    const float times[] = { 0, 1 };
+    GLTFAnimationSampler *sampler = [pool samplerWithTimes:times keyCount:2 values:values valueCount:valueCount dimension:GLTFDataDimensionScalar];
+    GLTFAnimationChannel *channel = [GLTFAnimationChannel new];
+    channel.targetNode = node;
+    channel.targetPath = @"weights";
+    channel.sampler = sampler;
+    GLTFAnimation *animation = [GLTFAnimation new];
+    animation.samplers = @[ sampler ];
+    animation.channels = @[ channel ];
+    return animation;
+}
+
+- (void)testShortWeightsTrackLeavesTrailingWeightsAtRest {
+    GLTFTestAccessorPool *pool = [GLTFTestAccessorPool new];
+    GLTFNode *node = [GLTFNode new];
+    const float restWeights[] = { 0.2f, 0.4f, 0.6f };
+    [node setMorphTargetWeightValues:restWeights count:3];
+    GLTFScene *scene = [GLTFScene new];
+    scene.nodes = @[ node ];
+    
+    // One track sets all three weights to one; the other only has a value for the first weight
+    const float fullValues[] = { 1, 1, 1,   1, 1, 1 };
+    const float shortValues[] = { 0,   0 };
+    GLTFAnimation *fullAnimation = [self weightsAnimationForNode:node values:fullValues valueCount:6 pool:pool];
+    GLTFAnimation *shortAnimation = [self weightsAnimationForNode:node values:shortValues valueCount:2 pool:pool];
+    
+    GLTFSceneInstance *instance = [[GLTFSceneInstance alloc] initWithScene:scene];
+    NSInteger index = [instance.transformStore indexOfNode:node];
+    GLTFAnimationMixer *mixer = [[GLTFAnimationMixer alloc] initWithSceneInstance:instance];
+    GLTFAnimationMixerLayer *fullLayer = [mixer addLayerWithAnimation:fullAnimation];
+    GLTFAnimationMixerLayer *shortLayer = [mixer addLayerWithAnimation:shortAnimation];
+    fullLayer.weight = 0.5f;
+    shortLayer.weight = 0.5f;
+    fullLayer.time = shortLayer.time = 0.5;
+    
+    // The short track contributes rest values for the weights it doesn't have, not the full track's
+    [mixer evaluate];
+    const float *weights = [instance morphTargetWeightsAtIndex:index];
+    XCTAssertEqualWithAccuracy(weights[0], 0.5f, 1e-6f);
+    XCTAssertEqualWithAccuracy(weights[1], 0.7f, 1e-6f);
+    XCTAssertEqualWithAccuracy(weights[2], 0.8f, 1e-6f);
+    
+    // Alone, it only moves the first weight
+    fullLayer.weight = 0;
+    shortLayer.weight = 1;
+    [mixer evaluate];
+    weights = [instance morphTargetWeightsAtIndex:index];
+    XCTAssertEqualWithAccuracy(weights[0], 0, 1e-6f);
+    XCTAssertEqualWithAccuracy(weights[1], 0.4f, 1e-6f);
+    XCTAssertEqualWithAccuracy(weights[2], 0.6f, 1e-6f);
+    
+    // And added on top of the full track, it offsets only the first weight
+    fullLayer.weight = 1;
+    shortLayer.blendMode = GLTFAnimationBlendModeAdditive;
+    [mixer evaluate];
+    weights = [instance morphTargetWeightsAtIndex:index];
+    XCTAssertEqualWithAccuracy(weights[0], 0.8f, 1e-6f);
+    XCTAssertEqualWithAccuracy(weights[1], 1, 1e-6f);
+    XCTAssertEqualWithAccuracy(weights[2], 1, 1e-6f);
+}
+
+@end
@@ -0,0 +1,394 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFTestGeometry.h"
+
+@import XCTest;
+
+@interface GLTFAnimationTests : XCTestCase
+@property (nonatomic, strong) GLTFTestAccessorPool *pool;
+@end
+
+@implementation GLTFAnimationTests
+
+- (void)setUp {
+    [super setUp];
+    self.pool = [GLTFTestAccessorPool new];
+}
+
+- (GLTFAnimation *)animationWithChannelForNode:(GLTFNode *)node path:(NSString *)path sampler:(GLTFAnimationSampler *)sampler {
+    GLTFAnimationChannel *channel = [GLTFAnimationChannel new];
+    channel.targetNode = node;
+    channel.targetPath = path;
+    channel.sampler = sampler;
+    GLTFAnimation *animation = [GLTFAnimation new];
+    animation.samplers = @[ sampler ];
+    animation.channels = @[ channel ];
+    return animation;
+}
+
+- (void)testWeightTracksWritePackedWeights {
+    GLTFNode *node = [GLTFNode new];
+    const float initialWeights[] = { 0, 0, 0 };
+    [node setMorphTargetWeightValues:initialWeights count:3];
+    GLTFScene *scene = [GLTFScene new];
+    scene.nodes = @[ node ];
+
+    const float times[] = { 0, 1, 2 };
+    const float weights[] = { 0, 0.5f, 1,   1, 0.5f, 0,   0.25f, 0.25f, 0.25f };
+    GLTFAnimationSampler *sampler = [self.pool samplerWithTimes:times keyCount:3 values:weights valueCount:9
+                                                      dimension:GLTFDataDimensionScalar];
+    GLTFAnimation *animation = [self animationWithChannelForNode:node path:@"weights" sampler:sampler];
+
+    GLTFSceneInstance *instance = [[GLTFSceneInstance alloc] initWithScene:scene];
+    [animation runAtTime:1.5 instance:instance];
+    XCTAssertEqual(node.morphTargetWeightValues[0], 0, @"Running an instance must leave the node alone");
+
+    [animation runAtTime:1.5];
+    const float expected[] = { 0.625f, 0.375f, 0.125f };
+    const float *instanceWeights = [instance morphTargetWeightsAtIndex:[instance.transformStore indexOfNode:node]];
+    XCTAssertEqual(node.morphTargetWeightCount, 3);
+    for (int i = 0; i < 3; ++i) {
+        XCTAssertEqualWithAccuracy(node.morphTargetWeightValues[i], expected[i], 1e-6f);
+        XCTAssertEqualWithAccuracy(instanceWeights[i], expected[i], 1e-6f);
+    }
+}
+
+- (GLTFAnimation *)clipAnimatingNodes:(NSArray<GLTFNode *> *)nodes seed:(uint32_t)seed {
+    const int keyCount = 8;
+    float times[keyCount];
+    for (int k = 0; k < keyCount; ++k) {
+        times[k] = k * 0.25f;
+    }
+    NSMutableArray *channels = [NSMutableArray array];
+    NSMutableArray *samplers = [NSMutableArray array];
+    srand48(seed);
+    for (NSUInteger n = 0; n < nodes.count; n += 2) {
+        float translations[keyCount * 3], rotations[keyCount * 4], scales[keyCount * 3];
+        for (int k = 0; k < keyCount; ++k) {
+            simd_float3 axis = simd_normalize((simd_float3){ drand48() - 0.5, drand48() - 0.5, drand48() - 0.5 });
+            simd_quatf q = simd_quaternion((float)(drand48() * M_PI), axis);
+            memcpy(rotations + k * 4, &q, sizeof(float) * 4);
+            for (int c = 0; c < 3; ++c) {
+                translations[k * 3 + c] = drand48() * 4 - 2;
+                scales[k * 3 + c] = 0.5 + drand48();
+            }
+        }
+        NSString *paths[] = { @"translation", @"rotation", @"scale" };
+        const float *values[] = { translations, rotations, scales };
+        GLTFDataDimension dimensions[] = { GLTFDataDimensionVector3, GLTFDataDimensionVector4, GLTFDataDimensionVector3 };
+        for (int p = 0; p < 3; ++p) {
+            GLTFAnimationSampler *sampler = [self.pool samplerWithTimes:times keyCount:keyCount values:values[p]
+                                                             valueCount:keyCount dimension:dimensions[p]];
+            GLTFAnimationChannel *channel = [GLTFAnimationChannel new];
+            channel.targetNode = nodes[n];
+            channel.targetPath = paths[p];
+            channel.sampler = sampler;
+            [samplers addObject:sampler];
+            [channels addObject:channel];
+        }
+    }
+    GLTFAnimation *animation = [GLTFAnimation new];
+    animation.samplers = samplers;
+    animation.channels = channels;
+    return animation;
+}
+
+static BOOL GLTFTestRotationsEqual(GLTFQuaternion a, GLTFQuaternion b, float tolerance) {
+    // q and -q are the same rotation
+    return fabsf(simd_dot(a.vector, b.vector)) >= 1 - tolerance;
+}
+
+- (void)assertInstance:(GLTFSceneInstance *)instance matchesNodes:(NSArray<GLTFNode *> *)nodes {
+    GLTFTransformStore *store = instance.transformStore;
+    for (GLTFNode *node in nodes) {
+        NSInteger index = [store indexOfNode:node];
+        XCTAssertLessThanOrEqual(simd_distance(store.translations[index], node.translation), 1e-4f);
+        XCTAssertLessThanOrEqual(simd_distance(store.scales[index], node.scale), 1e-4f);
+        // The batched path approximates slerp, so rotations only agree closely
+        XCTAssertTrue(GLTFTestRotationsEqual(store.rotations[index], node.rotationQuaternion, 1e-4f));
+    }
+}
+
+- (void)testBatchedEvaluationMatchesSerialEvaluation {
+    NSArray<GLTFNode *> *nodes = GLTFTestMakeNodeTree(300, 4);
+    GLTFScene *scene = [GLTFScene new];
+    scene.nodes = @[ nodes.firstObject ];
+    GLTFAnimation *animation = [self clipAnimatingNodes:nodes seed:34];
+    GLTFSceneInstance *instance = [[GLTFSceneInstance alloc] initWithScene:scene];
+
+    // Includes times before, between, on and after the keyframes, running backward as well as forward
+    const NSTimeInterval times[] = { -1, 0, 0.1, 0.25, 0.6, 1.3, 1.75, 3, 0.9, 0.05 };
+    for (int t = 0; t < sizeof(times) / sizeof(times[0]); ++t) {
+        [animation runAtTime:times[t]];
+        [animation runAtTime:times[t] instance:instance];
+        [self assertInstance:instance matchesNodes:nodes];
+    }
+}
+
+- (void)testConcurrentRunsMatchSerialEvaluation {
+    NSArray<GLTFNode *> *nodes = GLTFTestMakeNodeTree(120, 3);
+    GLTFScene *scene = [GLTFScene new];
+    scene.nodes = @[ nodes.firstObject ];
+    GLTFAnimation *first = [self clipAnimatingNodes:nodes seed:1];
+    GLTFAnimation *second = [self clipAnimatingNodes:nodes seed:2];
+
+    const NSInteger instanceCount = 16;
+    NSMutableArray<GLTFSceneInstance *> *instances = [NSMutableArray array];
+    NSMutableArray<GLTFAnimation *> *animations = [NSMutableArray array];
+    NSMutableArray<GLTFSceneInstance *> *runInstances = [NSMutableArray array];
+    NSTimeInterval times[instanceCount * 2];
+    for (NSInteger i = 0; i < instanceCount; ++i) {
+        [instances addObject:[[GLTFSceneInstance alloc] initWithScene:scene]];
+    }
+    // Each instance runs both clips, the second overriding the first, with the runs interleaved across instances
+    for (NSInteger r = 0; r < instanceCount * 2; ++r) {
+        NSInteger i = r % instanceCount;
+        [animations addObject:(r < instanceCount) ? first : second];
+        [runInstances addObject:instances[i]];
+        times[r] = (r < instanceCount) ? 0.3 : i * 0.11;
+    }
+    [GLTFAnimation runAnimations:animations atTimes:times instances:runInstances];
+
+    for (NSInteger i = 0; i < instanceCount; ++i) {
+        [first runAtTime:0.3];
+        [second runAtTime:i * 0.11];
+        [self assertInstance:instances[i] matchesNodes:nodes];
+    }
+}
+
+- (void)testCompressionHonorsPerPathTolerances {
+    GLTFNode *node = [GLTFNode new];
+    GLTFScene *scene = [GLTFScene new];
+    scene.nodes = @[ node ];
+
+    // A steady turn and a slow drift, both sampled far more densely than they need to be
+    const int keyCount = 61;
+    float times[keyCount], translations[keyCount * 3];
+    simd_quatf rotations[keyCount];
+    for (int k = 0; k < keyCount; ++k) {
+        times[k] = k / 30.0f;
+        rotations[k] = simd_quaternion(times[k] * 1.5f, GLTFAxisY);
+        translations[k * 3 + 0] = times[k] * 0.01f;
+        translations[k * 3 + 1] = 0;
+        translations[k * 3 + 2] = 0;
+    }
+    GLTFAnimationSampler *rotationSampler = [self.pool samplerWithTimes:times keyCount:keyCount values:(const float *)rotations
+                                                             valueCount:keyCount dimension:GLTFDataDimensionVector4];
+    GLTFAnimationSampler *translationSampler = [self.pool samplerWithTimes:times keyCount:keyCount values:translations
+                                                                valueCount:keyCount dimension:GLTFDataDimensionVector3];
+    GLTFAnimation *animation = [self animationWithChannelForNode:node path:@"rotation" sampler:rotationSampler];
+    GLTFAnimationChannel *translationChannel = [GLTFAnimationChannel new];
+    translationChannel.targetNode = node;
+    translationChannel.targetPath = @"translation";
+    translationChannel.sampler = translationSampler;
+    animation.samplers = @[ rotationSampler, translationSampler ];
+    animation.channels = [animation.channels arrayByAddingObject:translationChannel];
+
+    // Only rotations may be compressed; the drift is far below any translation tolerance but must be kept exactly
+    animation.compressionTolerances = (GLTFAnimationCompressionTolerances){ .rotation = 0.01f };
+    GLTFAnimationCompressionReport *report = animation.compressionReport;
+    XCTAssertNotNil(report);
+    XCTAssertEqual(report.maximumTranslationError, 0);
+    XCTAssertLessThanOrEqual(report.maximumRotationError, 0.011f);
+    XCTAssertLessThan(report.retainedKeyFrameCount, report.sourceKeyFrameCount);
+    XCTAssertGreaterThanOrEqual(report.retainedKeyFrameCount, (NSUInteger)keyCount);
+
+    [animation runAtTime:times[37]];
+    XCTAssertEqual(node.translation.x, translations[37 * 3]);
+}
+
+// The glTF cubic spline: tangents are scaled by the length of the keyframe interval
+static simd_float4 GLTFTestHermite(simd_float4 v0, simd_float4 outTangent0, simd_float4 v1, simd_float4 inTangent1,
+                                   float timeDelta, float t)
+{
+    float t2 = t * t, t3 = t2 * t;
+    return (2 * t3 - 3 * t2 + 1) * v0 + timeDelta * (t3 - 2 * t2 + t) * outTangent0 +
+           (-2 * t3 + 3 * t2) * v1 + timeDelta * (t3 - t2) * inTangent1;
+}
+
+- (void)assertTranslationOfNode:(GLTFNode *)node
+                       instance:(GLTFSceneInstance *)instance
+                         equals:(simd_float3)expected
+                       accuracy:(float)accuracy
+{
+    simd_float3 instanceTranslation = instance.transformStore.translations[[instance.transformStore indexOfNode:node]];
+    XCTAssertLessThanOrEqual(simd_distance(node.translation, expected), accuracy);
+    XCTAssertLessThanOrEqual(simd_distance(instanceTranslation, expected), accuracy);
+}
+
+- (void)testCubicSplineTranslationsMatchHermite {
+    GLTFNode *node = [GLTFNode new];
+    GLTFScene *scene = [GLTFScene new];
+    scene.nodes = @[ node ];
+
+    // Unequally spaced keyframes, so tangents are scaled differently on either side of the middle one
+    const float times[] = { 0, 1, 3 };
+    const simd_float3 inTangents[] = { { 0, 0, 0 }, { 0.5f, -1, 2 }, { 0, 1, 0 } };
+    const simd_float3 values[] = { { 0, 0, 0 }, { 1, 1, 1 }, { 2, 0, -1 } };
+    const simd_float3 outTangents[] = { { 1, 2, 0 }, { -1, 0, 0.5f }, { 0, 0, 0 } };
+    float keyFrames[3 * 9];
+    for (int k = 0; k < 3; ++k) {
+        memcpy(keyFrames + k * 9 + 0, &inTangents[k], sizeof(float) * 3);
+        memcpy(keyFrames + k * 9 + 3, &values[k], sizeof(float) * 3);
+        memcpy(keyFrames + k * 9 + 6, &outTangents[k], sizeof(float) * 3);
+    }
+    GLTFAnimationSampler *sampler = [self.pool samplerWithTimes:times keyCount:3 values:keyFrames valueCount:9
+                                                      dimension:GLTFDataDimensionVector3];
+    sampler.interpolationMode = GLTFInterpolationModeCubic;
+    GLTFAnimation *animation = [self animationWithChannelForNode:node path:@"translation" sampler:sampler];
+    GLTFSceneInstance *instance = [[GLTFSceneInstance alloc] initWithScene:scene];
+
+    // On the keyframes the curve passes through the values, whatever the tangents
+    for (int k = 0; k < 3; ++k) {
+        [animation runAtTime:times[k]];
+        [animation runAtTime:times[k] instance:instance];
+        [self assertTranslationOfNode:node instance:instance equals:values[k] accuracy:1e-5f];
+    }
+
+    const float sampleTimes[] = { 0.25f, 0.5f, 0.9f, 1.5f, 2, 2.75f };
+    for (int i = 0; i < sizeof(sampleTimes) / sizeof(sampleTimes[0]); ++i) {
+        float time = sampleTimes[i];
+        int k = (time < times[1]) ? 0 : 1;
+        float timeDelta = times[k + 1] - times[k];
+        simd_float4 expected = GLTFTestHermite(simd_make_float4(values[k], 0), simd_make_float4(outTangents[k], 0),
+                                               simd_make_float4(values[k + 1], 0), simd_make_float4(inTangents[k + 1], 0),
+                                               timeDelta, (time - times[k]) / timeDelta);
+        [animation runAtTime:time];
+        [animation runAtTime:time instance:instance];
+        [self assertTranslationOfNode:node instance:instance equals:expected.xyz accuracy:1e-5f];
+    }
+}
+
+- (void)testCubicSplineRotationsAreNormalizedHermite {
+    GLTFNode *node = [GLTFNode new];
+    GLTFScene *scene = [GLTFScene new];
+    scene.nodes = @[ node ];
+
+    const float times[] = { 0, 2 };
+    simd_float4 v0 = simd_quaternion(0.0f, GLTFAxisY).vector;
+    simd_float4 v1 = simd_quaternion((float)M_PI_2, GLTFAxisY).vector;
+    simd_float4 outTangent0 = { 0.1f, 0.3f, 0, 0 };
+    simd_float4 inTangent1 = { 0, 0.2f, -0.1f, -0.2f };
+    const simd_float4 keyFrames[] = { 0, v0, outTangent0,   inTangent1, v1, 0 };
+    GLTFAnimationSampler *sampler = [self.pool samplerWithTimes:times keyCount:2 values:(const float *)keyFrames
+                                                     valueCount:6 dimension:GLTFDataDimensionVector4];
+    sampler.interpolationMode = GLTFInterpolationModeCubic;
+    GLTFAnimation *animation = [self animationWithChannelForNode:node path:@"rotation" sampler:sampler];
+    GLTFSceneInstance *instance = [[GLTFSceneInstance alloc] initWithScene:scene];
+    NSInteger index = [instance.transformStore indexOfNode:node];
+
+    const float sampleTimes[] = { 0, 0.3f, 1, 1.6f, 2 };
+    for (int i = 0; i < sizeof(sampleTimes) / sizeof(sampleTimes[0]); ++i) {
+        float time = sampleTimes[i];
+        simd_float4 expected = simd_normalize(GLTFTestHermite(v0, outTangent0, v1, inTangent1, 2, time / 2));
+        [animation runAtTime:time];
+        [animation runAtTime:time instance:instance];
+        XCTAssertEqualWithAccuracy(simd_length(node.rotationQuaternion.vector), 1, 1e-5f);
+        XCTAssertTrue(GLTFTestRotationsEqual(node.rotationQuaternion, simd_quaternion(expected), 1e-5f));
+        XCTAssertTrue(GLTFTestRotationsEqual(instance.transformStore.rotations[index], simd_quaternion(expected), 1e-5f));
+    }
+}
+
+- (void)testStepHoldsLeftValue {
+    GLTFNode *node = [GLTFNode new];
+    GLTFScene *scene = [GLTFScene new];
+    scene.nodes = @[ node ];
+
+    const float times[] = { 0, 1, 3 };
+    const float values[] = { 0, 0, 0,   1, 2, 3,   -1, -2, -3 };
+    GLTFAnimationSampler *sampler = [self.pool samplerWithTimes:times keyCount:3 values:values valueCount:3
+                                                      dimension:GLTFDataDimensionVector3];
+    sampler.interpolationMode = GLTFInterpolationModeStep;
+    GLTFAnimation *animation = [self animationWithChannelForNode:node path:@"translation" sampler:sampler];
+    GLTFSceneInstance *instance = [[GLTFSceneInstance alloc] initWithScene:scene];
+
+    const float sampleTimes[] = { -1, 0, 0.5f, 0.999f, 1, 2.9f, 3, 5 };
+    const int expectedKeyFrames[] = { 0, 0, 0, 0, 1, 1, 2, 2 };
+    for (int i = 0; i < sizeof(sampleTimes) / sizeof(sampleTimes[0]); ++i) {
+        simd_float3 expected = simd_make_float3(values[expectedKeyFrames[i] * 3], values[expectedKeyFrames[i] * 3 + 1],
+                                                values[expectedKeyFrames[i] * 3 + 2]);
+        [animation runAtTime:sampleTimes[i]];
+        [animation runAtTime:sampleTimes[i] instance:instance];
+        [self assertTranslationOfNode:node instance:instance equals:expected accuracy:0];
+    }
+}
+
+- (void)testBakedTrackMatchesSourceAtSampleTimes {
+    GLTFNode *sourceNode = [GLTFNode new];
+    GLTFNode *bakedNode = [GLTFNode new];
+
+    const float times[] = { 0, 0.4f, 1.5f };
+    const simd_float3 inTangents[] = { { 0, 0, 0 }, { 2, -1, 0 }, { 0, 0, 1 } };
+    const simd_float3 values[] = { { 0, 1, 0 }, { 1, -1, 2 }, { -2, 0, 1 } };
+    const simd_float3 outTangents[] = { { 3, 0, -1 }, { 0, 1, 1 }, { 0, 0, 0 } };
+    float keyFrames[3 * 9];
+    for (int k = 0; k < 3; ++k) {
+        memcpy(keyFrames + k * 9 + 0, &inTangents[k], sizeof(float) * 3);
+        memcpy(keyFrames + k * 9 + 3, &values[k], sizeof(float) * 3);
+        memcpy(keyFrames + k * 9 + 6, &outTangents[k], sizeof(float) * 3);
+    }
+    GLTFAnimationSampler *sampler = [self.pool samplerWithTimes:times keyCount:3 values:keyFrames valueCount:9
+                                                      dimension:GLTFDataDimensionVector3];
+    sampler.interpolationMode = GLTFInterpolationModeCubic;
+    GLTFAnimation *source = [self animationWithChannelForNode:sourceNode path:@"translation" sampler:sampler];
+    GLTFAnimation *baked = [self animationWithChannelForNode:bakedNode path:@"translation" sampler:sampler];
+    baked.bakedFrameRate = 30;
+    // 46 frames of one vector each
+    XCTAssertEqual(baked.bakedByteCount, (NSUInteger)(46 * 3 * sizeof(float)));
+
+    for (int frame = 0; frame <= 45; ++frame) {
+        NSTimeInterval time = frame / 30.0;
+        [source runAtTime:time];
+        [baked runAtTime:time];
+        XCTAssertLessThanOrEqual(simd_distance(bakedNode.translation, sourceNode.translation), 1e-4f);
+    }
+    // Between frames the baked track is linear, so it only stays close to the curve
+    [source runAtTime:0.71];
+    [baked runAtTime:0.71];
+    XCTAssertLessThanOrEqual(simd_distance(bakedNode.translation, sourceNode.translation), 1e-2f);
+}
+
+// Poses a thousand instances of a 100-node scene, as a crowd would each frame
+- (void)testConcurrentRunPerformanceWith1000Instances {
+    NSArray<GLTFNode *> *nodes = GLTFTestMakeNodeTree(100, 3);
+    GLTFScene *scene = [GLTFScene new];
+    scene.nodes = @[ nodes.firstObject ];
+    GLTFAnimation *animation = [self clipAnimatingNodes:nodes seed:5];
+
+    const NSInteger instanceCount = 1000;
+    NSMutableArray<GLTFSceneInstance *> *instances = [NSMutableArray array];
+    NSMutableArray<GLTFAnimation *> *animations = [NSMutableArray array];
+    NSTimeInterval *times = malloc(sizeof(NSTimeInterval) * instanceCount);
+    for (NSInteger i = 0; i < instanceCount; ++i) {
+        [instances addObject:[[GLTFSceneInstance alloc] initWithScene:scene]];
+        [animations addObject:animation];
+        times[i] = i * 0.0017;
+    }
+
+    [self measureBlock:^{
+        for (int frame = 0; frame < 10; ++frame) {
+            for (NSInteger i = 0; i < instanceCount; ++i) {
+                times[i] += 1 / 60.0;
+            }
+            [GLTFAnimation runAnimations:animations atTimes:times instances:instances];
+        }
+    }];
+    free(times);
+}
+
+@end
@@ -0,0 +1,165 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFTestGeometry.h"
+
+@import XCTest;
+
+// The asset's object lists, which aren't otherwise visible
+@interface GLTFAsset (CompactionTesting)
+- (NSArray<GLTFAccessor *> *)accessors;
+- (NSArray<GLTFBufferView *> *)bufferViews;
+- (NSArray<GLTFImage *> *)images;
+- (NSArray<GLTFTexture *> *)textures;
+- (NSArray<GLTFMaterial *> *)materials;
+- (NSArray<GLTFMesh *> *)meshes;
+@end
+
+static const uint8_t GLTFTestCompactionImage[15] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A, 1, 2, 3, 4, 5, 6, 7 };
+
+@interface GLTFAssetCompactionTests : XCTestCase
+@end
+
+@implementation GLTFAssetCompactionTests
+
+// Two drawn meshes whose positions, images, textures and materials are copies of each other, and a third mesh,
+// with its own positions and material, that no node draws
+- (GLTFAsset *)assetWithDuplicates {
+    const float positions[9] = { 0, 0, 0,   1, 0, 0,   0, 1, 0 };
+    const float otherPositions[9] = { 0, 0, 0,   2, 0, 0,   0, 2, 0 };
+    const uint16_t indices[4] = { 0, 1, 2, 0 };
+    NSMutableData *bufferContents = [NSMutableData data];
+    [bufferContents appendBytes:positions length:sizeof(positions)];
+    [bufferContents appendBytes:positions length:sizeof(positions)];
+    [bufferContents appendBytes:otherPositions length:sizeof(otherPositions)];
+    [bufferContents appendBytes:indices length:sizeof(indices)];
+    [bufferContents appendBytes:GLTFTestCompactionImage length:sizeof(GLTFTestCompactionImage)];
+    [bufferContents increaseLengthBy:1];
+    [bufferContents appendBytes:GLTFTestCompactionImage length:sizeof(GLTFTestCompactionImage)];
+    
+    NSDictionary *json = @{
+        @"bufferViews" : @[
+            @{ @"buffer" : @0, @"byteOffset" : @0, @"byteLength" : @36 },
+            @{ @"buffer" : @0, @"byteOffset" : @36, @"byteLength" : @36 },
+            @{ @"buffer" : @0, @"byteOffset" : @72, @"byteLength" : @36 },
+            @{ @"buffer" : @0, @"byteOffset" : @108, @"byteLength" : @6 },
+            @{ @"buffer" : @0, @"byteOffset" : @116, @"byteLength" : @15 },
+            @{ @"buffer" : @0, @"byteOffset" : @132, @"byteLength" : @15 },
+        ],
+        @"accessors" : @[
+            @{ @"bufferView" : @0, @"componentType" : @5126, @"count" : @3, @"type" : @"VEC3" },
+            @{ @"bufferView" : @1, @"componentType" : @5126, @"count" : @3, @"type" : @"VEC3" },
+            @{ @"bufferView" : @2, @"componentType" : @5126, @"count" : @3, @"type" : @"VEC3" },
+            @{ @"bufferView" : @3, @"componentType" : @5123, @"count" : @3, @"type" : @"SCALAR" },
+        ],
+        @"images" : @[ @{ @"bufferView" : @4, @"mimeType" : @"image/png" }, @{ @"bufferView" : @5, @"mimeType" : @"image/png" } ],
+        @"textures" : @[ @{ @"source" : @0 }, @{ @"source" : @1 } ],
+        @"materials" : @[
+            @{ @"pbrMetallicRoughness" : @{ @"baseColorFactor" : @[ @1, @0, @0, @1 ], @"baseColorTexture" : @{ @"index" : @0 } } },
+            @{ @"pbrMetallicRoughness" : @{ @"baseColorFactor" : @[ @1, @0, @0, @1 ], @"baseColorTexture" : @{ @"index" : @1 } } },
+            @{ @"pbrMetallicRoughness" : @{ @"baseColorFactor" : @[ @0, @0, @1, @1 ] } },
+        ],
+        @"meshes" : @[
+            @{ @"primitives" : @[ @{ @"attributes" : @{ @"POSITION" : @0 }, @"material" : @0 } ] },
+            @{ @"primitives" : @[ @{ @"attributes" : @{ @"POSITION" : @1 }, @"indices" : @3, @"material" : @1 } ] },
+            @{ @"primitives" : @[ @{ @"attributes" : @{ @"POSITION" : @2 }, @"material" : @2 } ] },
+        ],
+        @"nodes" : @[ @{ @"mesh" : @0 }, @{ @"mesh" : @1 } ],
+        @"scenes" : @[ @{ @"nodes" : @[ @0, @1 ] } ],
+    };
+    return GLTFTestLoadAsset(json, bufferContents);
+}
+
+- (void)testDuplicatesAreMergedAndUnusedObjectsRemoved {
+    GLTFAsset *asset = [self assetWithDuplicates];
+    XCTAssertNotNil(asset);
+    XCTAssertEqual(asset.accessors.count, (NSUInteger)4);
+    XCTAssertEqual(asset.meshes.count, (NSUInteger)3);
+    
+    GLTFAssetCompactionStatistics statistics = [asset removeUnusedAndDuplicateObjects];
+    XCTAssertEqual(statistics.mergedAccessorCount, 1);
+    XCTAssertEqual(statistics.mergedImageCount, 1);
+    XCTAssertEqual(statistics.mergedTextureCount, 1);
+    XCTAssertEqual(statistics.mergedMaterialCount, 1);
+    XCTAssertEqual(statistics.mergedSamplerCount, 0);
+    XCTAssertEqual(statistics.removedMeshCount, 1);
+    XCTAssertEqual(statistics.removedMaterialCount, 1);
+    XCTAssertEqual(statistics.removedAccessorCount, 1);
+    XCTAssertEqual(statistics.removedImageCount, 0);
+    XCTAssertEqual(statistics.removedTextureCount, 0);
+    // The copy of the positions, the undrawn mesh's positions and the copy of the image
+    XCTAssertEqual(statistics.removedBufferViewCount, 3);
+    // Everything lives in the one buffer, which is still needed
+    XCTAssertEqual(statistics.removedBufferCount, 0);
+    XCTAssertEqual(statistics.reclaimedBufferByteCount, 0);
+    XCTAssertEqual(statistics.duplicateByteCount, (NSInteger)(36 + sizeof(GLTFTestCompactionImage)));
+    
+    XCTAssertEqual(asset.meshes.count, (NSUInteger)2);
+    XCTAssertEqual(asset.accessors.count, (NSUInteger)2);
+    XCTAssertEqual(asset.bufferViews.count, (NSUInteger)3);
+    XCTAssertEqual(asset.images.count, (NSUInteger)1);
+    XCTAssertEqual(asset.textures.count, (NSUInteger)1);
+    XCTAssertEqual(asset.materials.count, (NSUInteger)1);
+}
+
+- (void)testReferencesPointAtRemainingObjects {
+    GLTFAsset *asset = [self assetWithDuplicates];
+    NSArray<GLTFNode *> *nodes = asset.scenes.firstObject.nodes;
+    GLTFSubmesh *first = nodes[0].mesh.submeshes.firstObject;
+    GLTFSubmesh *second = nodes[1].mesh.submeshes.firstObject;
+    GLTFAccessor *indexAccessor = second.indexAccessor;
+    XCTAssertNotEqual(first.accessorsForAttributes[GLTFAttributeSemanticPosition], second.accessorsForAttributes[GLTFAttributeSemanticPosition]);
+    XCTAssertNotEqual(first.material, second.material);
+    
+    [asset removeUnusedAndDuplicateObjects];
+    
+    GLTFAccessor *positionAccessor = first.accessorsForAttributes[GLTFAttributeSemanticPosition];
+    XCTAssertEqual(second.accessorsForAttributes[GLTFAttributeSemanticPosition], positionAccessor);
+    XCTAssertEqual(second.material, first.material);
+    XCTAssertEqual(second.indexAccessor, indexAccessor);
+    
+    // Whatever is referenced is among what the asset kept, and its contents are intact
+    XCTAssertTrue([asset.accessors indexOfObjectIdenticalTo:positionAccessor] != NSNotFound);
+    XCTAssertTrue([asset.accessors indexOfObjectIdenticalTo:indexAccessor] != NSNotFound);
+    XCTAssertTrue([asset.materials indexOfObjectIdenticalTo:first.material] != NSNotFound);
+    XCTAssertTrue([asset.bufferViews indexOfObjectIdenticalTo:positionAccessor.bufferView] != NSNotFound);
+    float positions[9];
+    [positionAccessor getFloatValues:positions];
+    XCTAssertEqual(positions[3], 1);
+    XCTAssertEqual(positions[7], 1);
+    
+    GLTFTexture *texture = first.material.baseColorTexture.texture;
+    XCTAssertEqual(texture, asset.textures.firstObject);
+    XCTAssertEqual(texture.image, asset.images.firstObject);
+    XCTAssertTrue([asset.bufferViews indexOfObjectIdenticalTo:texture.image.bufferView] != NSNotFound);
+}
+
+- (void)testCompactingTwiceChangesNothing {
+    GLTFAsset *asset = [self assetWithDuplicates];
+    [asset removeUnusedAndDuplicateObjects];
+    
+    GLTFAssetCompactionStatistics statistics = [asset removeUnusedAndDuplicateObjects];
+    XCTAssertEqual(statistics.mergedAccessorCount + statistics.mergedImageCount + statistics.mergedTextureCount +
+                   statistics.mergedMaterialCount + statistics.mergedSamplerCount, 0);
+    XCTAssertEqual(statistics.removedAccessorCount + statistics.removedBufferViewCount + statistics.removedBufferCount +
+                   statistics.removedImageCount + statistics.removedTextureCount + statistics.removedMaterialCount +
+                   statistics.removedMeshCount, 0);
+    XCTAssertEqual(asset.accessors.count, (NSUInteger)2);
+    XCTAssertEqual(asset.meshes.count, (NSUInteger)2);
+}
+
+@end
@@ -0,0 +1,183 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFTestGeometry.h"
+
+@import XCTest;
+
+static const float GLTFTestWriterPositions[9] = { 0, 0, 0,   1, 0, 0,   0, 1, 0 };
+// Three bytes per color, padded out to the four-byte stride vertex attributes need
+static const uint8_t GLTFTestWriterColors[12] = { 255, 0, 0, 0,   0, 255, 0, 0,   0, 0, 255, 0 };
+static const uint8_t GLTFTestWriterIndices[3] = { 0, 2, 1 };
+// A PNG signature and some bytes of odd length; nothing decodes images while loading or writing
+static const uint8_t GLTFTestWriterImage[15] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A, 1, 2, 3, 4, 5, 6, 7 };
+
+@interface GLTFAssetWriterTests : XCTestCase
+@end
+
+@implementation GLTFAssetWriterTests
+
+// One triangle with positions, 8-bit normalized colors and 8-bit indices, textured with an image in the buffer
+- (GLTFAsset *)sourceAsset {
+    NSMutableData *bufferContents = [NSMutableData data];
+    [bufferContents appendBytes:GLTFTestWriterPositions length:sizeof(GLTFTestWriterPositions)];
+    [bufferContents appendBytes:GLTFTestWriterColors length:sizeof(GLTFTestWriterColors)];
+    [bufferContents appendBytes:GLTFTestWriterIndices length:sizeof(GLTFTestWriterIndices)];
+    [bufferContents appendBytes:GLTFTestWriterImage length:sizeof(GLTFTestWriterImage)];
+    NSDictionary *json = @{
+        @"bufferViews" : @[
+            @{ @"buffer" : @0, @"byteOffset" : @0, @"byteLength" : @36, @"target" : @34962 },
+            @{ @"buffer" : @0, @"byteOffset" : @36, @"byteLength" : @12, @"byteStride" : @4, @"target" : @34962 },
+            @{ @"buffer" : @0, @"byteOffset" : @48, @"byteLength" : @3, @"target" : @34963 },
+            @{ @"buffer" : @0, @"byteOffset" : @51, @"byteLength" : @(sizeof(GLTFTestWriterImage)) },
+        ],
+        @"accessors" : @[
+            @{ @"bufferView" : @0, @"componentType" : @5126, @"count" : @3, @"type" : @"VEC3",
+               @"min" : @[ @0, @0, @0 ], @"max" : @[ @1, @1, @0 ] },
+            @{ @"bufferView" : @1, @"componentType" : @5121, @"normalized" : @YES, @"count" : @3, @"type" : @"VEC3" },
+            @{ @"bufferView" : @2, @"componentType" : @5121, @"count" : @3, @"type" : @"SCALAR" },
+        ],
+        @"images" : @[ @{ @"bufferView" : @3, @"mimeType" : @"image/png" } ],
+        @"textures" : @[ @{ @"source" : @0 } ],
+        @"materials" : @[ @{ @"pbrMetallicRoughness" : @{ @"baseColorTexture" : @{ @"index" : @0 } } } ],
+        @"meshes" : @[ @{ @"primitives" : @[ @{ @"attributes" : @{ @"POSITION" : @0, @"COLOR_0" : @1 },
+                                                @"indices" : @2, @"material" : @0 } ] } ],
+        @"nodes" : @[ @{ @"mesh" : @0, @"translation" : @[ @1, @2, @3 ] } ],
+        @"scenes" : @[ @{ @"nodes" : @[ @0 ] } ],
+    };
+    return GLTFTestLoadAsset(json, bufferContents);
+}
+
+- (GLTFSubmesh *)submeshOfAsset:(GLTFAsset *)asset {
+    return asset.scenes.firstObject.nodes.firstObject.mesh.submeshes.firstObject;
+}
+
+- (NSData *)contentsOfImage:(GLTFImage *)image {
+    if (image.imageData.length > 0) {
+        return image.imageData;
+    }
+    GLTFBufferView *bufferView = image.bufferView;
+    return [NSData dataWithBytes:(const uint8_t *)bufferView.buffer.contents + bufferView.offset length:bufferView.length];
+}
+
+- (void)assertAccessor:(GLTFAccessor *)accessor hasElements:(const void *)elements stride:(size_t)stride {
+    size_t elementSize = GLTFSizeOfComponentTypeWithDimension(accessor.componentType, accessor.dimension);
+    XCTAssertEqual(accessor.count, 3);
+    XCTAssertTrue(accessor.contents != NULL);
+    for (NSInteger i = 0; i < accessor.count; ++i) {
+        XCTAssertEqual(memcmp((const uint8_t *)accessor.contents + i * accessor.elementStride,
+                              (const uint8_t *)elements + i * stride, elementSize), 0, @"Element %d differs", (int)i);
+    }
+}
+
+- (void)testBinaryLayoutIsAligned {
+    GLTFAsset *asset = [self sourceAsset];
+    XCTAssertNotNil(asset);
+    NSError *error = nil;
+    NSData *data = [[[GLTFAssetWriter alloc] initWithAsset:asset] binaryDataWithError:&error];
+    XCTAssertNotNil(data, @"%@", error);
+    
+    GLTFBinaryHeader header;
+    [data getBytes:&header length:sizeof(header)];
+    XCTAssertEqual(header.magic, GLTFBinaryMagic);
+    XCTAssertEqual(header.version, (UInt32)2);
+    XCTAssertEqual(header.length, (UInt32)data.length);
+    
+    UInt32 chunkHeader[2];
+    NSUInteger offset = sizeof(header);
+    [data getBytes:chunkHeader range:NSMakeRange(offset, sizeof(chunkHeader))];
+    XCTAssertEqual(chunkHeader[1], (UInt32)GLTFChunkTypeJSON);
+    XCTAssertEqual(chunkHeader[0] % 4, (UInt32)0);
+    NSData *jsonData = [data subdataWithRange:NSMakeRange(offset + sizeof(chunkHeader), chunkHeader[0])];
+    NSDictionary *json = [NSJSONSerialization JSONObjectWithData:jsonData options:0 error:&error];
+    XCTAssertNotNil(json, @"%@", error);
+    
+    offset += sizeof(chunkHeader) + chunkHeader[0];
+    [data getBytes:chunkHeader range:NSMakeRange(offset, sizeof(chunkHeader))];
+    XCTAssertEqual(chunkHeader[1], (UInt32)GLTFChunkTypeBinary);
+    XCTAssertEqual(chunkHeader[0] % 4, (UInt32)0);
+    offset += sizeof(chunkHeader);
+    XCTAssertEqual(offset % 16, (NSUInteger)0);
+    XCTAssertEqual(offset + chunkHeader[0], data.length);
+    
+    // A single buffer backed by the binary chunk, with every view on a 16-byte boundary inside it
+    NSArray *buffers = json[@"buffers"];
+    XCTAssertEqual(buffers.count, (NSUInteger)1);
+    XCTAssertNil(buffers.firstObject[@"uri"]);
+    XCTAssertLessThanOrEqual([buffers.firstObject[@"byteLength"] unsignedIntegerValue], (NSUInteger)chunkHeader[0]);
+    for (NSDictionary *bufferView in json[@"bufferViews"]) {
+        XCTAssertEqual([bufferView[@"byteOffset"] unsignedIntegerValue] % 16, (NSUInteger)0);
+        XCTAssertEqual([bufferView[@"byteStride"] unsignedIntegerValue] % 4, (NSUInteger)0);
+    }
+    
+    NSArray *images = json[@"images"];
+    XCTAssertEqual(images.count, (NSUInteger)1);
+    XCTAssertNotNil(images.firstObject[@"bufferView"]);
+    XCTAssertNil(images.firstObject[@"uri"]);
+    XCTAssertEqualObjects(images.firstObject[@"mimeType"], @"image/png");
+}
+
+- (void)testWrittenAssetReloadsWithSameContents {
+    GLTFAsset *asset = [self sourceAsset];
+    XCTAssertNotNil(asset);
+    
+    NSURL *url = [[NSURL fileURLWithPath:NSTemporaryDirectory() isDirectory:YES] URLByAppendingPathComponent:[NSUUID UUID].UUIDString];
+    url = [url URLByAppendingPathExtension:@"glb"];
+    NSError *error = nil;
+    XCTAssertTrue([[[GLTFAssetWriter alloc] initWithAsset:asset] writeBinaryToURL:url error:&error], @"%@", error);
+    GLTFAsset *reloaded = [[GLTFAsset alloc] initWithURL:url bufferAllocator:[GLTFDefaultBufferAllocator new]];
+    [[NSFileManager defaultManager] removeItemAtURL:url error:nil];
+    XCTAssertNotNil(reloaded);
+    
+    simd_float3 translation = reloaded.scenes.firstObject.nodes.firstObject.translation;
+    XCTAssertTrue(simd_equal(translation, ((simd_float3){ 1, 2, 3 })));
+    
+    GLTFSubmesh *submesh = [self submeshOfAsset:reloaded];
+    XCTAssertEqual(submesh.primitiveType, GLTFPrimitiveTypeTriangles);
+    
+    GLTFAccessor *positionAccessor = submesh.accessorsForAttributes[GLTFAttributeSemanticPosition];
+    XCTAssertEqual(positionAccessor.componentType, GLTFDataTypeFloat);
+    XCTAssertEqual(positionAccessor.dimension, GLTFDataDimensionVector3);
+    [self assertAccessor:positionAccessor hasElements:GLTFTestWriterPositions stride:12];
+    // Bounds are recomputed from the data as it is written
+    XCTAssertEqual(positionAccessor.valueRange.maxValue[0], 1);
+    XCTAssertEqual(positionAccessor.valueRange.maxValue[2], 0);
+    
+    GLTFAccessor *colorAccessor = submesh.accessorsForAttributes[GLTFAttributeSemanticColor0];
+    XCTAssertEqual(colorAccessor.componentType, GLTFDataTypeUChar);
+    XCTAssertEqual(colorAccessor.dimension, GLTFDataDimensionVector3);
+    XCTAssertTrue(colorAccessor.normalized);
+    XCTAssertEqual(colorAccessor.elementStride % 4, 0);
+    [self assertAccessor:colorAccessor hasElements:GLTFTestWriterColors stride:4];
+    
+    // 8-bit indices are widened but keep their values
+    GLTFAccessor *indexAccessor = submesh.indexAccessor;
+    XCTAssertEqual(indexAccessor.componentType, GLTFDataTypeUShort);
+    XCTAssertEqual(indexAccessor.count, 3);
+    uint32_t indices[3];
+    [indexAccessor getUnsignedIntValues:indices];
+    for (int i = 0; i < 3; ++i) {
+        XCTAssertEqual(indices[i], (uint32_t)GLTFTestWriterIndices[i]);
+    }
+    
+    GLTFImage *image = submesh.material.baseColorTexture.texture.image;
+    XCTAssertNotNil(image);
+    XCTAssertEqualObjects(image.mimeType, @"image/png");
+    XCTAssertEqualObjects([self contentsOfImage:image], [NSData dataWithBytes:GLTFTestWriterImage length:sizeof(GLTFTestWriterImage)]);
+}
+
+@end
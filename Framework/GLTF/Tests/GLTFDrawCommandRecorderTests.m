@@ -0,0 +1,194 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFTestGeometry.h"
+
+@import XCTest;
+
+@interface GLTFDrawCommandRecorderTests : XCTestCase
+@end
+
+@implementation GLTFDrawCommandRecorderTests
+
+- (void)testRepeatedStateIsDropped {
+    GLTFDrawCommandRecorder *recorder = [GLTFDrawCommandRecorder new];
+    NSObject *pipeline = [NSObject new];
+    NSObject *depthStencil = [NSObject new];
+    NSObject *buffer = [NSObject new];
+    NSObject *texture = [NSObject new];
+    NSObject *sampler = [NSObject new];
+    
+    for (int i = 0; i < 3; ++i) {
+        [recorder setPipelineState:pipeline];
+        [recorder setDepthStencilState:depthStencil];
+        [recorder setCullMode:GLTFDrawCullModeBack];
+        [recorder setFrontFacingWinding:GLTFDrawWindingCounterClockwise];
+        [recorder setVertexBuffer:buffer offset:0 atIndex:0];
+        [recorder setFragmentTexture:texture atIndex:0];
+        [recorder setFragmentSamplerState:sampler atIndex:0];
+        [recorder drawPrimitives:GLTFPrimitiveTypeTriangles vertexStart:0 vertexCount:3];
+    }
+    
+    // Seven state commands and a draw the first time round, then only the draws
+    GLTFDrawCommandStatistics statistics = recorder.statistics;
+    XCTAssertEqual(statistics.commandCount, (NSInteger)10);
+    XCTAssertEqual(statistics.drawCount, (NSInteger)3);
+    XCTAssertEqual(statistics.redundantCommandCount, (NSInteger)14);
+    
+    GLTFNullDrawCommandBackend *backend = [GLTFNullDrawCommandBackend new];
+    [recorder replayWithBackend:backend];
+    XCTAssertEqual(backend.commandCount, (NSInteger)10);
+    XCTAssertEqual([backend countOfCommandsOfType:GLTFDrawCommandTypeSetPipelineState], (NSInteger)1);
+    XCTAssertEqual([backend countOfCommandsOfType:GLTFDrawCommandTypeSetVertexBuffer], (NSInteger)1);
+    XCTAssertEqual([backend countOfCommandsOfType:GLTFDrawCommandTypeDraw], (NSInteger)3);
+}
+
+- (void)testChangedStateIsKept {
+    GLTFDrawCommandRecorder *recorder = [GLTFDrawCommandRecorder new];
+    NSObject *pipelineA = [NSObject new];
+    NSObject *pipelineB = [NSObject new];
+    
+    [recorder setPipelineState:pipelineA];
+    [recorder setPipelineState:pipelineB];
+    [recorder setPipelineState:pipelineA];
+    [recorder setCullMode:GLTFDrawCullModeBack];
+    [recorder setCullMode:GLTFDrawCullModeNone];
+    
+    GLTFDrawCommandStatistics statistics = recorder.statistics;
+    XCTAssertEqual(statistics.commandCount, (NSInteger)5);
+    XCTAssertEqual(statistics.redundantCommandCount, (NSInteger)0);
+}
+
+- (void)testVertexBufferOffsetChangeIsSentAlone {
+    GLTFDrawCommandRecorder *recorder = [GLTFDrawCommandRecorder new];
+    NSObject *buffer = [NSObject new];
+    
+    [recorder setVertexBuffer:buffer offset:0 atIndex:1];
+    [recorder setVertexBuffer:buffer offset:256 atIndex:1];
+    [recorder setVertexBufferOffset:256 atIndex:1];
+    
+    XCTAssertEqual(recorder.statistics.commandCount, (NSInteger)2);
+    XCTAssertEqual(recorder.statistics.redundantCommandCount, (NSInteger)1);
+    
+    GLTFNullDrawCommandBackend *backend = [GLTFNullDrawCommandBackend new];
+    [recorder replayWithBackend:backend];
+    XCTAssertEqual([backend countOfCommandsOfType:GLTFDrawCommandTypeSetVertexBuffer], (NSInteger)1);
+    XCTAssertEqual([backend countOfCommandsOfType:GLTFDrawCommandTypeSetVertexBufferOffset], (NSInteger)1);
+}
+
+- (void)testBytesAreDroppedOnlyWhenUnchanged {
+    GLTFDrawCommandRecorder *recorder = [GLTFDrawCommandRecorder new];
+    simd_float4x4 matrix = matrix_identity_float4x4;
+    
+    [recorder setVertexBytes:&matrix length:sizeof(matrix) atIndex:2];
+    [recorder setVertexBytes:&matrix length:sizeof(matrix) atIndex:2];
+    // The same bytes at another index, or in the fragment stage, are a different binding
+    [recorder setVertexBytes:&matrix length:sizeof(matrix) atIndex:3];
+    [recorder setFragmentBytes:&matrix length:sizeof(matrix) atIndex:2];
+    matrix.columns[3].x = 1;
+    [recorder setVertexBytes:&matrix length:sizeof(matrix) atIndex:2];
+    
+    XCTAssertEqual(recorder.statistics.commandCount, (NSInteger)4);
+    XCTAssertEqual(recorder.statistics.redundantCommandCount, (NSInteger)1);
+}
+
+- (void)testBytesReplaceBufferBinding {
+    GLTFDrawCommandRecorder *recorder = [GLTFDrawCommandRecorder new];
+    NSObject *buffer = [NSObject new];
+    float value = 1;
+    
+    // Bytes and buffers share slots, so rebinding the buffer after bytes has to be kept
+    [recorder setVertexBuffer:buffer offset:0 atIndex:0];
+    [recorder setVertexBytes:&value length:sizeof(value) atIndex:0];
+    [recorder setVertexBuffer:buffer offset:0 atIndex:0];
+    
+    XCTAssertEqual(recorder.statistics.commandCount, (NSInteger)3);
+    XCTAssertEqual(recorder.statistics.redundantCommandCount, (NSInteger)0);
+}
+
+- (void)testBindsBeyondTrackedSlotsAreKept {
+    GLTFDrawCommandRecorder *recorder = [GLTFDrawCommandRecorder new];
+    NSObject *texture = [NSObject new];
+    
+    [recorder setFragmentTexture:texture atIndex:GLTFDrawCommandMaxTextureCount];
+    [recorder setFragmentTexture:texture atIndex:GLTFDrawCommandMaxTextureCount];
+    
+    XCTAssertEqual(recorder.statistics.commandCount, (NSInteger)2);
+    XCTAssertEqual(recorder.statistics.redundantCommandCount, (NSInteger)0);
+}
+
+- (void)testResetForgetsBindings {
+    GLTFDrawCommandRecorder *recorder = [GLTFDrawCommandRecorder new];
+    NSObject *pipeline = [NSObject new];
+    
+    [recorder setPipelineState:pipeline];
+    [recorder setPipelineState:pipeline];
+    XCTAssertEqual(recorder.statistics.redundantCommandCount, (NSInteger)1);
+    
+    [recorder reset];
+    XCTAssertEqual(recorder.statistics.commandCount, (NSInteger)0);
+    XCTAssertEqual(recorder.statistics.redundantCommandCount, (NSInteger)0);
+    
+    // A new encoder starts with nothing bound, so the first bind after a reset is always recorded
+    [recorder setPipelineState:pipeline];
+    XCTAssertEqual(recorder.statistics.commandCount, (NSInteger)1);
+    XCTAssertEqual(recorder.statistics.redundantCommandCount, (NSInteger)0);
+    
+    GLTFNullDrawCommandBackend *backend = [GLTFNullDrawCommandBackend new];
+    [recorder replayWithBackend:backend];
+    XCTAssertEqual(backend.commandCount, (NSInteger)1);
+}
+
+// Records and replays a frame of 10,000 draws grouped by pipeline and texture, most of whose binds repeat
+- (void)testRecordAndReplayPerformance {
+    GLTFDrawCommandRecorder *recorder = [GLTFDrawCommandRecorder new];
+    GLTFNullDrawCommandBackend *backend = [GLTFNullDrawCommandBackend new];
+    NSMutableArray *pipelines = [NSMutableArray array];
+    NSMutableArray *textures = [NSMutableArray array];
+    for (int i = 0; i < 64; ++i) {
+        [pipelines addObject:[NSObject new]];
+        [textures addObject:[NSObject new]];
+    }
+    NSObject *depthStencil = [NSObject new];
+    NSObject *buffer = [NSObject new];
+    NSObject *sampler = [NSObject new];
+    const NSInteger drawCount = 10000;
+    
+    [self measureBlock:^{
+        for (int frame = 0; frame < 10; ++frame) {
+            [recorder reset];
+            [backend reset];
+            for (NSInteger i = 0; i < drawCount; ++i) {
+                simd_float4x4 modelMatrix = GLTFMatrixFromTranslation((simd_float3){ (float)i, 0, 0 });
+                [recorder setPipelineState:pipelines[i * 8 / drawCount]];
+                [recorder setDepthStencilState:depthStencil];
+                [recorder setCullMode:GLTFDrawCullModeBack];
+                [recorder setFrontFacingWinding:GLTFDrawWindingCounterClockwise];
+                [recorder setVertexBuffer:buffer offset:(i % 16) * 256 atIndex:0];
+                [recorder setVertexBytes:&modelMatrix length:sizeof(modelMatrix) atIndex:1];
+                [recorder setFragmentTexture:textures[i * 64 / drawCount] atIndex:0];
+                [recorder setFragmentSamplerState:sampler atIndex:0];
+                [recorder drawPrimitives:GLTFPrimitiveTypeTriangles vertexStart:0 vertexCount:36];
+            }
+            [recorder replayWithBackend:backend];
+        }
+        XCTAssertEqual(recorder.statistics.drawCount, drawCount);
+        XCTAssertGreaterThan(recorder.statistics.redundantCommandCount, drawCount);
+    }];
+}
+
+@end
@@ -0,0 +1,103 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFTestGeometry.h"
+
+@import XCTest;
+
+@interface GLTFDrawSortKeyTests : XCTestCase
+@end
+
+@implementation GLTFDrawSortKeyTests
+
+- (void)testOpaqueKeysGroupByPipelineThenMaterialThenNearestFirst {
+    XCTAssertLessThan(GLTFOpaqueDrawSortKey(1, 9, 100), GLTFOpaqueDrawSortKey(2, 0, 1));
+    XCTAssertLessThan(GLTFOpaqueDrawSortKey(1, 2, 100), GLTFOpaqueDrawSortKey(1, 3, 1));
+    XCTAssertLessThan(GLTFOpaqueDrawSortKey(1, 2, 1), GLTFOpaqueDrawSortKey(1, 2, 1.5f));
+    XCTAssertEqual(GLTFOpaqueDrawSortKey(1, 2, -5), GLTFOpaqueDrawSortKey(1, 2, 0));
+}
+
+- (void)testTransparentKeysSortFarthestFirst {
+    XCTAssertLessThan(GLTFTransparentDrawSortKey(9, 9, 100), GLTFTransparentDrawSortKey(0, 0, 10));
+    XCTAssertLessThan(GLTFTransparentDrawSortKey(9, 9, 10), GLTFTransparentDrawSortKey(0, 0, -1));
+    // Pipeline and material only break ties in depth
+    XCTAssertLessThan(GLTFTransparentDrawSortKey(1, 9, 10), GLTFTransparentDrawSortKey(2, 0, 10));
+    XCTAssertLessThan(GLTFTransparentDrawSortKey(1, 2, 10), GLTFTransparentDrawSortKey(1, 3, 10));
+}
+
+- (void)testMaterialIndicesKeepTheSameWidthInBothKeys {
+    // Indices that differ only above 16 bits must still tell materials apart, whatever the blend mode
+    uint32_t material = 0x10001, otherMaterial = 0x00001;
+    XCTAssertNotEqual(GLTFOpaqueDrawSortKey(1, material, 10), GLTFOpaqueDrawSortKey(1, otherMaterial, 10));
+    XCTAssertNotEqual(GLTFTransparentDrawSortKey(1, material, 10), GLTFTransparentDrawSortKey(1, otherMaterial, 10));
+    
+    // Both truncate at 20 bits
+    uint32_t wideMaterial = 0x100001;
+    XCTAssertEqual(GLTFOpaqueDrawSortKey(1, wideMaterial, 10), GLTFOpaqueDrawSortKey(1, otherMaterial, 10));
+    XCTAssertEqual(GLTFTransparentDrawSortKey(1, wideMaterial, 10), GLTFTransparentDrawSortKey(1, otherMaterial, 10));
+}
+
+- (void)testRadixSortMatchesStableSort {
+    const NSInteger count = 5000;
+    uint64_t *keys = malloc(sizeof(uint64_t) * count);
+    uint32_t *values = malloc(sizeof(uint32_t) * count);
+    uint64_t *scratchKeys = malloc(sizeof(uint64_t) * count);
+    uint32_t *scratchValues = malloc(sizeof(uint32_t) * count);
+    NSMutableArray<NSArray<NSNumber *> *> *expected = [NSMutableArray arrayWithCapacity:count];
+    
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    for (NSInteger i = 0; i < count; ++i) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        // A few pipelines and materials and a spread of depths, so that equal keys occur
+        float depth = (float)((state >> 33) % 64) * 0.25f;
+        keys[i] = (i % 3 == 0) ? GLTFTransparentDrawSortKey((uint32_t)(state >> 60), (uint32_t)(state >> 40) & 0xFF, depth)
+                               : GLTFOpaqueDrawSortKey((uint32_t)(state >> 60), (uint32_t)(state >> 40) & 0xFF, depth);
+        values[i] = (uint32_t)i;
+        [expected addObject:@[ @(keys[i]), @(i) ]];
+    }
+    // NSArray's stable sort as the reference
+    [expected sortWithOptions:NSSortStable usingComparator:^NSComparisonResult(NSArray<NSNumber *> *a, NSArray<NSNumber *> *b) {
+        return [a[0] compare:b[0]];
+    }];
+    
+    GLTFRadixSortDrawKeys(keys, values, count, scratchKeys, scratchValues);
+    for (NSInteger i = 0; i < count; ++i) {
+        XCTAssertEqual(keys[i], expected[i][0].unsignedLongLongValue);
+        XCTAssertEqual(values[i], expected[i][1].unsignedIntValue);
+    }
+    
+    free(keys);
+    free(values);
+    free(scratchKeys);
+    free(scratchValues);
+}
+
+- (void)testRadixSortSkipsUniformBytes {
+    // Only the lowest byte differs, so one pass sorts them, and the result must still end up in the caller's arrays
+    uint64_t keys[] = { 0xAB00000000000003ull, 0xAB00000000000001ull, 0xAB00000000000002ull };
+    uint32_t values[] = { 0, 1, 2 };
+    uint64_t scratchKeys[3];
+    uint32_t scratchValues[3];
+    GLTFRadixSortDrawKeys(keys, values, 3, scratchKeys, scratchValues);
+    XCTAssertEqual(keys[0], 0xAB00000000000001ull);
+    XCTAssertEqual(keys[2], 0xAB00000000000003ull);
+    XCTAssertEqual(values[0], 1u);
+    XCTAssertEqual(values[1], 2u);
+    XCTAssertEqual(values[2], 0u);
+}
+
+@end
@@ -0,0 +1,188 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFTestGeometry.h"
+
+@import XCTest;
+
+@interface GLTFFrustumCullerTests : XCTestCase
+@property (nonatomic, strong) GLTFTestGeometry *geometry;
+@property (nonatomic, strong) GLTFMesh *mesh;
+@property (nonatomic, assign) GLTFFrustum frustum;
+@end
+
+@implementation GLTFFrustumCullerTests
+
+- (void)setUp {
+    [super setUp];
+    self.geometry = [GLTFTestGeometry gridWithResolution:2];
+    self.mesh = [GLTFMesh new];
+    self.mesh.submeshes = @[ self.geometry.submesh ];
+    // From the origin down -z, which sees x within about +/-5.8 at a depth of 10
+    simd_float4x4 projection = GLTFPerspectiveProjectionMatrixAspectFovRH(M_PI / 3, 1, 0.1f, 100);
+    self.frustum = GLTFFrustumFromViewProjectionMatrix(projection);
+}
+
+- (GLTFNode *)nodeAt:(simd_float3)translation children:(NSArray<GLTFNode *> *)children {
+    GLTFNode *node = [GLTFNode new];
+    node.mesh = self.mesh;
+    node.translation = translation;
+    for (GLTFNode *child in children) {
+        [node addChildNode:child];
+    }
+    return node;
+}
+
+- (GLTFBoundingBox)meshBounds {
+    GLTFValueRange range = self.geometry.positionAccessor.valueRange;
+    return (GLTFBoundingBox){
+        (simd_float3){ range.minValue[0], range.minValue[1], range.minValue[2] },
+        (simd_float3){ range.maxValue[0], range.maxValue[1], range.maxValue[2] }
+    };
+}
+
+- (void)testSubtreeVisibilityFollowsDescendants {
+    GLTFNode *visibleChild = [self nodeAt:(simd_float3){ 1, 0, 0 } children:@[]];
+    GLTFNode *visibleRoot = [self nodeAt:(simd_float3){ 0, 0, -10 } children:@[ visibleChild ]];
+    GLTFNode *hiddenGrandchild = [self nodeAt:(simd_float3){ 0, 5, 0 } children:@[]];
+    GLTFNode *hiddenChild = [self nodeAt:(simd_float3){ 0, 0, 3 } children:@[ hiddenGrandchild ]];
+    GLTFNode *hiddenRoot = [self nodeAt:(simd_float3){ 100, 0, -10 } children:@[ hiddenChild ]];
+    // Outside the frustum itself, but with a child brought back in front of the camera
+    GLTFNode *returningChild = [self nodeAt:(simd_float3){ -100, 0, 0 } children:@[]];
+    GLTFNode *mixedRoot = [self nodeAt:(simd_float3){ 100, 0, -10 } children:@[ returningChild ]];
+    
+    GLTFScene *scene = [GLTFScene new];
+    scene.nodes = @[ visibleRoot, hiddenRoot, mixedRoot ];
+    scene.transformStore = [[GLTFTransformStore alloc] initWithScene:scene];
+    
+    GLTFFrustumCuller *culler = [GLTFFrustumCuller new];
+    [culler beginWithFrustum:self.frustum];
+    [culler cullWithBoundingVolumeHierarchy:scene.boundingVolumeHierarchy];
+    
+    XCTAssertTrue([culler isSubtreeOfNodeVisible:visibleRoot]);
+    XCTAssertTrue([culler isSubtreeOfNodeVisible:visibleChild]);
+    XCTAssertFalse([culler isSubtreeOfNodeVisible:hiddenRoot]);
+    XCTAssertFalse([culler isSubtreeOfNodeVisible:hiddenChild]);
+    XCTAssertFalse([culler isSubtreeOfNodeVisible:hiddenGrandchild]);
+    XCTAssertTrue([culler isSubtreeOfNodeVisible:mixedRoot]);
+    XCTAssertTrue([culler isSubtreeOfNodeVisible:returningChild]);
+    
+    GLTFBoundingBox bounds = [self meshBounds];
+    XCTAssertFalse([culler isSubmeshAtIndex:0 ofNode:mixedRoot visibleWithLocalBounds:bounds modelMatrix:mixedRoot.globalTransform]);
+    XCTAssertTrue([culler isSubmeshAtIndex:0 ofNode:returningChild visibleWithLocalBounds:bounds modelMatrix:returningChild.globalTransform]);
+    
+    // Nodes the hierarchy doesn't know are always visited
+    GLTFNode *strayNode = [self nodeAt:(simd_float3){ 100, 0, -10 } children:@[]];
+    XCTAssertTrue([culler isSubtreeOfNodeVisible:strayNode]);
+}
+
+- (void)testHierarchyAgreesWithDirectTests {
+    NSArray<GLTFNode *> *nodes = GLTFTestMakeNodeTree(400, 3);
+    for (GLTFNode *node in nodes) {
+        node.mesh = self.mesh;
+    }
+    nodes.firstObject.translation = (simd_float3){ 0, 0, -12 };
+    GLTFScene *scene = [GLTFScene new];
+    scene.nodes = @[ nodes.firstObject ];
+    scene.transformStore = [[GLTFTransformStore alloc] initWithScene:scene];
+    
+    GLTFFrustumCuller *hierarchyCuller = [GLTFFrustumCuller new];
+    [hierarchyCuller beginWithFrustum:self.frustum];
+    [hierarchyCuller cullWithBoundingVolumeHierarchy:scene.boundingVolumeHierarchy];
+    GLTFFrustumCuller *directCuller = [GLTFFrustumCuller new];
+    [directCuller beginWithFrustum:self.frustum];
+    
+    GLTFBoundingBox bounds = [self meshBounds];
+    NSInteger visibleCount = 0;
+    for (GLTFNode *node in nodes) {
+        simd_float4x4 modelMatrix = node.globalTransform;
+        BOOL visible = [directCuller isSubmeshAtIndex:0 ofNode:node visibleWithLocalBounds:bounds modelMatrix:modelMatrix];
+        XCTAssertEqual([hierarchyCuller isSubmeshAtIndex:0 ofNode:node visibleWithLocalBounds:bounds modelMatrix:modelMatrix], visible);
+        visibleCount += visible ? 1 : 0;
+    }
+    XCTAssertGreaterThan(visibleCount, 0);
+    XCTAssertLessThan(visibleCount, (NSInteger)nodes.count);
+    
+    // Every leaf is counted when the hierarchy is culled
+    GLTFCullingStatistics statistics = hierarchyCuller.statistics;
+    XCTAssertEqual(statistics.visibleCount, visibleCount);
+    XCTAssertEqual(statistics.visibleCount + statistics.culledCount, (NSInteger)nodes.count);
+}
+
+- (void)testPosedBoundsDecideVisibility {
+    // Hidden in its bind pose, but posed (e.g. by a skin palette) to reach back in front of the camera
+    GLTFNode *node = [self nodeAt:(simd_float3){ 100, 0, -10 } children:@[]];
+    GLTFScene *scene = [GLTFScene new];
+    scene.nodes = @[ node ];
+    scene.transformStore = [[GLTFTransformStore alloc] initWithScene:scene];
+    GLTFSceneBVH *bvh = scene.boundingVolumeHierarchy;
+    
+    GLTFFrustumCuller *culler = [GLTFFrustumCuller new];
+    [culler beginWithFrustum:self.frustum];
+    [culler cullWithBoundingVolumeHierarchy:bvh];
+    XCTAssertFalse([culler isSubtreeOfNodeVisible:node]);
+    
+    [bvh setLocalBounds:(GLTFBoundingBox){ (simd_float3){ -101, -1, -1 }, (simd_float3){ -99, 1, 1 } } forNode:node];
+    [culler beginWithFrustum:self.frustum];
+    [culler cullWithBoundingVolumeHierarchy:bvh];
+    XCTAssertTrue([culler isSubtreeOfNodeVisible:node]);
+    XCTAssertTrue([culler isSubmeshAtIndex:0 ofNode:node visibleWithLocalBounds:[self meshBounds] modelMatrix:node.globalTransform]);
+}
+
+- (void)testNodesWithLevelOfDetailAlternativesAreAlwaysVisited {
+    GLTFNode *alternative = [self nodeAt:(simd_float3){ 0, 0, 0 } children:@[]];
+    GLTFNode *node = [self nodeAt:(simd_float3){ 100, 0, -10 } children:@[]];
+    node.levelOfDetailNodes = @[ alternative ];
+    GLTFNode *root = [self nodeAt:(simd_float3){ 0, 0, 0 } children:@[ node ]];
+    root.mesh = nil;
+    GLTFScene *scene = [GLTFScene new];
+    scene.nodes = @[ root ];
+    scene.transformStore = [[GLTFTransformStore alloc] initWithScene:scene];
+    
+    GLTFFrustumCuller *culler = [GLTFFrustumCuller new];
+    [culler beginWithFrustum:self.frustum];
+    [culler cullWithBoundingVolumeHierarchy:scene.boundingVolumeHierarchy];
+    XCTAssertTrue([culler isSubtreeOfNodeVisible:root]);
+    XCTAssertTrue([culler isSubtreeOfNodeVisible:node]);
+}
+
+// Culls a 100,000-node scene through its hierarchy and asks about every node, as the render-list builder does
+- (void)testCullingPerformanceWith100kNodes {
+    NSArray<GLTFNode *> *nodes = GLTFTestMakeNodeTree(100000, 4);
+    for (GLTFNode *node in nodes) {
+        node.mesh = self.mesh;
+    }
+    nodes.firstObject.translation = (simd_float3){ 0, 0, -12 };
+    GLTFScene *scene = [GLTFScene new];
+    scene.nodes = @[ nodes.firstObject ];
+    scene.transformStore = [[GLTFTransformStore alloc] initWithScene:scene];
+    GLTFSceneBVH *bvh = scene.boundingVolumeHierarchy;
+    GLTFFrustumCuller *culler = [GLTFFrustumCuller new];
+    GLTFFrustum frustum = self.frustum;
+    
+    [self measureBlock:^{
+        [culler beginWithFrustum:frustum];
+        [culler cullWithBoundingVolumeHierarchy:bvh];
+        NSInteger visibleCount = 0;
+        for (GLTFNode *node in nodes) {
+            visibleCount += [culler isSubtreeOfNodeVisible:node] ? 1 : 0;
+        }
+        XCTAssertGreaterThan(visibleCount, 0);
+    }];
+}
+
+@end
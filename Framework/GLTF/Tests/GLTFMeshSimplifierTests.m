@@ -0,0 +1,238 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFTestGeometry.h"
+
+@import XCTest;
+
+// A `resolution` x `resolution` grid spanning [-1, 1] in XZ; vertex (x, z) is at index z * (resolution + 1) + x
+static void GLTFTestMakeGrid(NSInteger resolution, BOOL flat, float **positions, uint32_t **indices, size_t *vertexCount, size_t *indexCount) {
+    GLTFTestGeometry *grid = [GLTFTestGeometry gridWithResolution:resolution];
+    *vertexCount = grid.positionAccessor.count;
+    *indexCount = grid.indexAccessor.count;
+    *positions = malloc(sizeof(float) * 3 * *vertexCount);
+    *indices = malloc(sizeof(uint32_t) * *indexCount);
+    [grid.positionAccessor getFloatValues:*positions];
+    [grid.indexAccessor getUnsignedIntValues:*indices];
+    if (flat) {
+        for (size_t v = 0; v < *vertexCount; ++v) {
+            (*positions)[v * 3 + 1] = 0;
+        }
+    }
+}
+
+static simd_float3 GLTFTestPosition(const float *positions, uint32_t index) {
+    return (simd_float3){ positions[index * 3 + 0], positions[index * 3 + 1], positions[index * 3 + 2] };
+}
+
+@interface GLTFMeshSimplifierTests : XCTestCase
+@end
+
+@implementation GLTFMeshSimplifierTests
+
+- (void)assertIndices:(const uint32_t *)indices count:(size_t)indexCount areValidForVertexCount:(size_t)vertexCount {
+    XCTAssertEqual(indexCount % 3, (size_t)0);
+    for (size_t i = 0; i < indexCount; i += 3) {
+        XCTAssertTrue(indices[i] < vertexCount && indices[i + 1] < vertexCount && indices[i + 2] < vertexCount);
+        XCTAssertTrue(indices[i] != indices[i + 1] && indices[i + 1] != indices[i + 2] && indices[i] != indices[i + 2]);
+    }
+}
+
+- (void)testSimplificationReachesTargetTriangleCount {
+    float *positions; uint32_t *indices; size_t vertexCount, indexCount;
+    GLTFTestMakeGrid(32, NO, &positions, &indices, &vertexCount, &indexCount);
+    uint32_t *simplified = malloc(sizeof(uint32_t) * indexCount);
+    
+    size_t targetIndexCount = indexCount / 2 / 3 * 3;
+    float error = -1;
+    size_t simplifiedCount = GLTFSimplifyTriangles(simplified, indices, indexCount, positions, vertexCount,
+                                                   targetIndexCount, 1, &error);
+    XCTAssertGreaterThan(simplifiedCount, (size_t)0);
+    XCTAssertLessThanOrEqual(simplifiedCount, targetIndexCount);
+    XCTAssertGreaterThan(error, 0);
+    [self assertIndices:simplified count:simplifiedCount areValidForVertexCount:vertexCount];
+    
+    free(simplified);
+    free(indices);
+    free(positions);
+}
+
+- (void)testFlatGridSimplifiesWithoutErrorOrFlips {
+    float *positions; uint32_t *indices; size_t vertexCount, indexCount;
+    GLTFTestMakeGrid(16, YES, &positions, &indices, &vertexCount, &indexCount);
+    uint32_t *simplified = malloc(sizeof(uint32_t) * indexCount);
+    
+    float error = -1;
+    size_t simplifiedCount = GLTFSimplifyTriangles(simplified, indices, indexCount, positions, vertexCount, 0, 0, &error);
+    XCTAssertLessThan(simplifiedCount, indexCount / 2);
+    XCTAssertEqual(error, 0);
+    [self assertIndices:simplified count:simplifiedCount areValidForVertexCount:vertexCount];
+    
+    // Every remaining triangle faces the way the grid did, and together they still cover it exactly
+    float area = 0;
+    for (size_t i = 0; i < simplifiedCount; i += 3) {
+        simd_float3 a = GLTFTestPosition(positions, simplified[i]);
+        simd_float3 b = GLTFTestPosition(positions, simplified[i + 1]);
+        simd_float3 c = GLTFTestPosition(positions, simplified[i + 2]);
+        simd_float3 normal = simd_cross(b - a, c - a);
+        XCTAssertGreaterThan(normal.y, 0);
+        area += 0.5f * normal.y;
+    }
+    XCTAssertEqualWithAccuracy(area, 4, 1e-4);
+    
+    free(simplified);
+    free(indices);
+    free(positions);
+}
+
+- (void)testErrorBoundLimitsSimplification {
+    float *positions; uint32_t *indices; size_t vertexCount, indexCount;
+    GLTFTestMakeGrid(32, NO, &positions, &indices, &vertexCount, &indexCount);
+    uint32_t *simplified = malloc(sizeof(uint32_t) * indexCount);
+    
+    const float targetErrors[] = { 0.0005f, 0.005f, 0.05f };
+    size_t simplifiedCounts[3];
+    for (int t = 0; t < 3; ++t) {
+        float error = -1;
+        simplifiedCounts[t] = GLTFSimplifyTriangles(simplified, indices, indexCount, positions, vertexCount,
+                                                    0, targetErrors[t], &error);
+        XCTAssertGreaterThanOrEqual(error, 0);
+        XCTAssertLessThanOrEqual(error, targetErrors[t] * 1.0001f);
+        XCTAssertLessThan(simplifiedCounts[t], indexCount);
+        [self assertIndices:simplified count:simplifiedCounts[t] areValidForVertexCount:vertexCount];
+    }
+    // The flat surroundings of the bump collapse under any bound, but the bump itself only under a loose one
+    XCTAssertLessThan(simplifiedCounts[2], simplifiedCounts[0]);
+    
+    free(simplified);
+    free(indices);
+    free(positions);
+}
+
+- (void)testBorderVerticesAreLocked {
+    const NSInteger resolution = 16, side = resolution + 1;
+    float *positions; uint32_t *indices; size_t vertexCount, indexCount;
+    GLTFTestMakeGrid(resolution, NO, &positions, &indices, &vertexCount, &indexCount);
+    uint32_t *simplified = malloc(sizeof(uint32_t) * indexCount);
+    
+    size_t simplifiedCount = GLTFSimplifyTriangles(simplified, indices, indexCount, positions, vertexCount, 0, 1, NULL);
+    XCTAssertLessThan(simplifiedCount, indexCount);
+    
+    bool *used = calloc(vertexCount, sizeof(bool));
+    for (size_t i = 0; i < simplifiedCount; ++i) {
+        used[simplified[i]] = true;
+    }
+    NSInteger interiorUsedCount = 0;
+    for (NSInteger z = 0; z < side; ++z) {
+        for (NSInteger x = 0; x < side; ++x) {
+            BOOL onBorder = (x == 0 || z == 0 || x == resolution || z == resolution);
+            if (onBorder) {
+                XCTAssertTrue(used[z * side + x], @"Border vertex (%d, %d) was collapsed", (int)x, (int)z);
+            } else if (used[z * side + x]) {
+                ++interiorUsedCount;
+            }
+        }
+    }
+    XCTAssertLessThan(interiorUsedCount, (resolution - 1) * (resolution - 1));
+    
+    free(used);
+    free(simplified);
+    free(indices);
+    free(positions);
+}
+
+- (void)testTrianglesWithOutOfRangeIndicesAreDropped {
+    float *positions; uint32_t *indices; size_t vertexCount, indexCount;
+    GLTFTestMakeGrid(4, NO, &positions, &indices, &vertexCount, &indexCount);
+    
+    size_t paddedCount = indexCount + 6;
+    uint32_t *padded = malloc(sizeof(uint32_t) * paddedCount);
+    memcpy(padded, indices, sizeof(uint32_t) * 3);
+    const uint32_t invalid[6] = { 0, 1, (uint32_t)vertexCount, (uint32_t)vertexCount + 100, 2, 3 };
+    memcpy(padded + 3, invalid, sizeof(invalid));
+    memcpy(padded + 9, indices + 3, sizeof(uint32_t) * (indexCount - 3));
+    uint32_t *simplified = malloc(sizeof(uint32_t) * paddedCount);
+    
+    // Without a reduction to make, the valid triangles come back unchanged
+    size_t simplifiedCount = GLTFSimplifyTriangles(simplified, padded, paddedCount, positions, vertexCount,
+                                                   paddedCount, 1, NULL);
+    XCTAssertEqual(simplifiedCount, indexCount);
+    XCTAssertEqual(memcmp(simplified, indices, sizeof(uint32_t) * indexCount), 0);
+    
+    simplifiedCount = GLTFSimplifyTriangles(simplified, padded, paddedCount, positions, vertexCount, 0, 1, NULL);
+    XCTAssertLessThan(simplifiedCount, indexCount);
+    [self assertIndices:simplified count:simplifiedCount areValidForVertexCount:vertexCount];
+    
+    free(simplified);
+    free(padded);
+    free(indices);
+    free(positions);
+}
+
+- (void)testLevelsOfDetailDecreaseInDetailAndAccumulateError {
+    float *positions; uint32_t *indices; size_t vertexCount, indexCount;
+    GLTFTestMakeGrid(32, NO, &positions, &indices, &vertexCount, &indexCount);
+    
+    // One triangle past the end of the positions, as a damaged file might have
+    NSMutableData *bufferContents = [NSMutableData dataWithBytes:positions length:sizeof(float) * 3 * vertexCount];
+    [bufferContents appendBytes:indices length:sizeof(uint32_t) * indexCount];
+    const uint32_t invalid[3] = { 0, 1, (uint32_t)vertexCount + 7 };
+    [bufferContents appendBytes:invalid length:sizeof(invalid)];
+    NSDictionary *json = @{
+        @"bufferViews" : @[
+            @{ @"buffer" : @0, @"byteLength" : @(sizeof(float) * 3 * vertexCount) },
+            @{ @"buffer" : @0, @"byteOffset" : @(sizeof(float) * 3 * vertexCount), @"byteLength" : @(sizeof(uint32_t) * (indexCount + 3)) },
+        ],
+        @"accessors" : @[
+            @{ @"bufferView" : @0, @"componentType" : @5126, @"count" : @(vertexCount), @"type" : @"VEC3",
+               @"min" : @[ @-1, @0, @-1 ], @"max" : @[ @1, @0.25, @1 ] },
+            @{ @"bufferView" : @1, @"componentType" : @5125, @"count" : @(indexCount + 3), @"type" : @"SCALAR" },
+        ],
+        @"meshes" : @[ @{ @"primitives" : @[ @{ @"attributes" : @{ @"POSITION" : @0 }, @"indices" : @1 } ] } ],
+        @"nodes" : @[ @{ @"mesh" : @0 } ],
+        @"scenes" : @[ @{ @"nodes" : @[ @0 ] } ],
+    };
+    GLTFAsset *asset = GLTFTestLoadAsset(json, bufferContents);
+    XCTAssertNotNil(asset);
+    
+    const float maxError = 0.05f;
+    [asset buildLevelsOfDetailWithCount:4 reductionFactor:0.5f maxError:maxError];
+    GLTFSubmesh *submesh = asset.scenes.firstObject.nodes.firstObject.mesh.submeshes.firstObject;
+    NSArray<GLTFLevelOfDetail *> *levels = submesh.levelsOfDetail;
+    XCTAssertGreaterThan(levels.count, (NSUInteger)0);
+    XCTAssertLessThanOrEqual(levels.count, (NSUInteger)4);
+    
+    // Errors are in the submesh's units; the grid is 2 wide
+    NSInteger previousCount = (NSInteger)indexCount;
+    float previousError = 0;
+    uint32_t *levelIndices = malloc(sizeof(uint32_t) * indexCount);
+    for (GLTFLevelOfDetail *level in levels) {
+        XCTAssertLessThan(level.indexAccessor.count, previousCount);
+        XCTAssertGreaterThanOrEqual(level.error, previousError);
+        XCTAssertLessThanOrEqual(level.error, maxError * 2 + 1e-4f);
+        [level.indexAccessor getUnsignedIntValues:levelIndices];
+        [self assertIndices:levelIndices count:level.indexAccessor.count areValidForVertexCount:vertexCount];
+        previousCount = level.indexAccessor.count;
+        previousError = level.error;
+    }
+    
+    free(levelIndices);
+    free(indices);
+    free(positions);
+}
+
+@end
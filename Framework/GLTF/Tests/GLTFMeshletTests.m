@@ -0,0 +1,103 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFTestGeometry.h"
+
+@import XCTest;
+
+@interface GLTFMeshletTests : XCTestCase
+@end
+
+@implementation GLTFMeshletTests
+
+- (void)testMeshletBoundsContainTheirVertices {
+    GLTFTestGeometry *geometry = [GLTFTestGeometry gridWithResolution:40];
+    GLTFMeshletSet *set = [[GLTFMeshletSet alloc] initWithSubmesh:geometry.submesh
+                                                   maxVertexCount:GLTFMeshletDefaultMaxVertexCount
+                                                 maxTriangleCount:GLTFMeshletDefaultMaxTriangleCount];
+    XCTAssertNotNil(set);
+    XCTAssertGreaterThan(set.meshletCount, 1);
+
+    const float *positions = geometry.positionAccessor.contents;
+    NSInteger triangleCount = 0;
+    for (NSInteger m = 0; m < set.meshletCount; ++m) {
+        GLTFMeshlet meshlet = set.meshlets[m];
+        XCTAssertLessThanOrEqual(meshlet.vertexCount, set.maxVertexCount);
+        XCTAssertLessThanOrEqual(meshlet.triangleCount, set.maxTriangleCount);
+        triangleCount += meshlet.triangleCount;
+
+        float slack = 1e-4f * (1 + meshlet.bounds.radius);
+        for (uint32_t v = 0; v < meshlet.vertexCount; ++v) {
+            uint32_t index = set.vertexIndices[meshlet.vertexOffset + v];
+            simd_float3 p = { positions[index * 3 + 0], positions[index * 3 + 1], positions[index * 3 + 2] };
+            XCTAssertLessThanOrEqual(simd_distance(p, meshlet.bounds.center), meshlet.bounds.radius + slack,
+                                     @"Vertex %u lies outside the bounds of meshlet %d", index, (int)m);
+        }
+        for (uint32_t t = 0; t < meshlet.triangleCount * 3; ++t) {
+            XCTAssertLessThan(set.triangleIndices[meshlet.triangleOffset + t], meshlet.vertexCount);
+        }
+    }
+    XCTAssertEqual(triangleCount, geometry.indexAccessor.count / 3);
+}
+
+- (void)testSerializedMeshletsRoundTrip {
+    GLTFTestGeometry *geometry = [GLTFTestGeometry gridWithResolution:16];
+    GLTFMeshletSet *set = [[GLTFMeshletSet alloc] initWithSubmesh:geometry.submesh
+                                                   maxVertexCount:GLTFMeshletDefaultMaxVertexCount
+                                                 maxTriangleCount:GLTFMeshletDefaultMaxTriangleCount];
+    GLTFMeshletSet *copy = [[GLTFMeshletSet alloc] initWithSerializedData:[set serializedData]];
+    XCTAssertNotNil(copy);
+    XCTAssertEqual(copy.meshletCount, set.meshletCount);
+    XCTAssertEqual(memcmp(copy.meshlets, set.meshlets, set.meshletCount * sizeof(GLTFMeshlet)), 0);
+    XCTAssertEqual(memcmp(copy.vertexIndices, set.vertexIndices, set.vertexIndexCount * sizeof(uint32_t)), 0);
+}
+
+// Partitions a grid of 131,072 triangles
+- (void)testGenerationPerformance {
+    GLTFTestGeometry *geometry = [GLTFTestGeometry gridWithResolution:256];
+    [self measureBlock:^{
+        GLTFMeshletSet *set = [[GLTFMeshletSet alloc] initWithSubmesh:geometry.submesh
+                                                       maxVertexCount:GLTFMeshletDefaultMaxVertexCount
+                                                     maxTriangleCount:GLTFMeshletDefaultMaxTriangleCount];
+        XCTAssertGreaterThan(set.meshletCount, 0);
+    }];
+}
+
+// Culls the same grid's meshlets against a camera that sees part of it
+- (void)testCullingPerformance {
+    GLTFTestGeometry *geometry = [GLTFTestGeometry gridWithResolution:256];
+    GLTFMeshletSet *set = [[GLTFMeshletSet alloc] initWithSubmesh:geometry.submesh
+                                                   maxVertexCount:GLTFMeshletDefaultMaxVertexCount
+                                                 maxTriangleCount:GLTFMeshletDefaultMaxTriangleCount];
+    simd_float4x4 projection = GLTFPerspectiveProjectionMatrixAspectFovRH(M_PI / 3, 1, 0.1f, 100);
+    GLTFFrustum frustum = GLTFFrustumFromViewProjectionMatrix(projection);
+    // Below the camera and ahead of it, so that it runs off the sides of the view
+    simd_float4x4 modelMatrix = matrix_multiply(GLTFMatrixFromTranslation((simd_float3){ 0, -1, -6 }), GLTFMatrixFromUniformScale(5));
+    uint32_t *visibleIndices = malloc(sizeof(uint32_t) * set.meshletCount);
+
+    [self measureBlock:^{
+        NSInteger visibleCount = 0;
+        for (int i = 0; i < 100; ++i) {
+            visibleCount = GLTFMeshletCull(set.meshlets, set.meshletCount, modelMatrix, &frustum, (simd_float3){ 0, 0, 0 }, visibleIndices);
+        }
+        XCTAssertGreaterThan(visibleCount, 0);
+        XCTAssertLessThan(visibleCount, set.meshletCount);
+    }];
+    free(visibleIndices);
+}
+
+@end
@@ -0,0 +1,185 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFTestGeometry.h"
+
+@import XCTest;
+
+#define GLTFTestMorphVertexCount 100
+#define GLTFTestMorphTargetCount 3
+
+@interface GLTFMorphTargetEvaluatorTests : XCTestCase {
+    float _basePositions[GLTFTestMorphVertexCount * 3];
+    float _baseNormals[GLTFTestMorphVertexCount * 3];
+    float _baseTangents[GLTFTestMorphVertexCount * 4];
+    float _positionDeltas[GLTFTestMorphTargetCount][GLTFTestMorphVertexCount * 3];
+    float _normalDeltas[GLTFTestMorphTargetCount][GLTFTestMorphVertexCount * 3];
+    float _tangentDeltas[GLTFTestMorphTargetCount][GLTFTestMorphVertexCount * 3];
+}
+@property (nonatomic, strong) GLTFTestAccessorPool *pool;
+@end
+
+@implementation GLTFMorphTargetEvaluatorTests
+
+// Target 0 moves every vertex, so it is stored densely. Target 1 moves the position of every tenth vertex and
+// target 2 only the normals of two vertices, so both are stored sparsely.
+- (void)setUp {
+    [super setUp];
+    self.pool = [GLTFTestAccessorPool new];
+    memset(_positionDeltas, 0, sizeof(_positionDeltas));
+    memset(_normalDeltas, 0, sizeof(_normalDeltas));
+    memset(_tangentDeltas, 0, sizeof(_tangentDeltas));
+    for (int v = 0; v < GLTFTestMorphVertexCount; ++v) {
+        simd_float3 normal = simd_normalize((simd_float3){ sinf(3 * v), 1, cosf(v) });
+        simd_float3 tangent = simd_normalize((simd_float3){ 1, 0, sinf(v) });
+        float position[3] = { sinf(v), cosf(2 * v), v * 0.01f };
+        for (int c = 0; c < 3; ++c) {
+            _basePositions[v * 3 + c] = position[c];
+            _baseNormals[v * 3 + c] = normal[c];
+            _baseTangents[v * 4 + c] = tangent[c];
+        }
+        _baseTangents[v * 4 + 3] = (v % 2) ? 1 : -1;
+        
+        _positionDeltas[0][v * 3 + 0] = 0.1f * sinf(v);
+        _positionDeltas[0][v * 3 + 1] = 0.2f;
+        _normalDeltas[0][v * 3 + 0] = 0.05f;
+        _normalDeltas[0][v * 3 + 2] = 0.1f * cosf(v);
+        _tangentDeltas[0][v * 3 + 1] = 0.1f;
+        if (v % 10 == 0) {
+            _positionDeltas[1][v * 3 + 2] = 1;
+        }
+    }
+    _normalDeltas[2][3 * 3 + 0] = 0.3f;
+    _normalDeltas[2][50 * 3 + 0] = -0.3f;
+}
+
+- (GLTFSubmesh *)submeshWithNormalCount:(NSInteger)normalCount targetNormalCount:(NSInteger)targetNormalCount {
+    GLTFSubmesh *submesh = [GLTFSubmesh new];
+    submesh.primitiveType = GLTFPrimitiveTypeTriangles;
+    submesh.accessorsForAttributes = @{
+        GLTFAttributeSemanticPosition : [self.pool accessorWithFloats:_basePositions count:GLTFTestMorphVertexCount dimension:GLTFDataDimensionVector3],
+        GLTFAttributeSemanticNormal : [self.pool accessorWithFloats:_baseNormals count:normalCount dimension:GLTFDataDimensionVector3],
+        GLTFAttributeSemanticTangent : [self.pool accessorWithFloats:_baseTangents count:GLTFTestMorphVertexCount dimension:GLTFDataDimensionVector4],
+    };
+    NSMutableArray<GLTFMorphTarget *> *targets = [NSMutableArray array];
+    for (int t = 0; t < GLTFTestMorphTargetCount; ++t) {
+        GLTFMorphTarget *target = [GLTFMorphTarget new];
+        target.accessorsForAttributes = @{
+            GLTFAttributeSemanticPosition : [self.pool accessorWithFloats:_positionDeltas[t] count:GLTFTestMorphVertexCount dimension:GLTFDataDimensionVector3],
+            GLTFAttributeSemanticNormal : [self.pool accessorWithFloats:_normalDeltas[t] count:targetNormalCount dimension:GLTFDataDimensionVector3],
+            GLTFAttributeSemanticTangent : [self.pool accessorWithFloats:_tangentDeltas[t] count:GLTFTestMorphVertexCount dimension:GLTFDataDimensionVector3],
+        };
+        [targets addObject:target];
+    }
+    submesh.morphTargets = targets;
+    return submesh;
+}
+
+// Straightforward blending of every target's full delta arrays, with normal and tangent deltas optional
+- (void)assertEvaluator:(GLTFMorphTargetEvaluator *)evaluator
+            withWeights:(const float *)weights
+                  count:(NSInteger)count
+     appliesNormalDeltas:(BOOL)appliesNormalDeltas
+{
+    simd_float3 *positions = malloc(sizeof(simd_float3) * GLTFTestMorphVertexCount);
+    simd_float3 *normals = malloc(sizeof(simd_float3) * GLTFTestMorphVertexCount);
+    simd_float4 *tangents = malloc(sizeof(simd_float4) * GLTFTestMorphVertexCount);
+    [evaluator evaluateWithWeights:weights count:count positions:positions normals:normals tangents:tangents];
+    
+    for (int v = 0; v < GLTFTestMorphVertexCount; ++v) {
+        simd_float3 position = { _basePositions[v * 3], _basePositions[v * 3 + 1], _basePositions[v * 3 + 2] };
+        simd_float3 normal = { _baseNormals[v * 3], _baseNormals[v * 3 + 1], _baseNormals[v * 3 + 2] };
+        simd_float3 tangent = { _baseTangents[v * 4], _baseTangents[v * 4 + 1], _baseTangents[v * 4 + 2] };
+        for (int t = 0; t < count; ++t) {
+            position += weights[t] * (simd_float3){ _positionDeltas[t][v * 3], _positionDeltas[t][v * 3 + 1], _positionDeltas[t][v * 3 + 2] };
+            if (appliesNormalDeltas) {
+                normal += weights[t] * (simd_float3){ _normalDeltas[t][v * 3], _normalDeltas[t][v * 3 + 1], _normalDeltas[t][v * 3 + 2] };
+            }
+            tangent += weights[t] * (simd_float3){ _tangentDeltas[t][v * 3], _tangentDeltas[t][v * 3 + 1], _tangentDeltas[t][v * 3 + 2] };
+        }
+        normal = simd_normalize(normal);
+        tangent = simd_normalize(tangent);
+        
+        XCTAssertLessThan(simd_distance(positions[v], position), 1e-5f, @"Position of vertex %d", v);
+        XCTAssertLessThan(simd_distance(normals[v], normal), 1e-5f, @"Normal of vertex %d", v);
+        XCTAssertLessThan(simd_distance(tangents[v].xyz, tangent), 1e-5f, @"Tangent of vertex %d", v);
+        XCTAssertEqual(tangents[v].w, _baseTangents[v * 4 + 3]);
+    }
+    
+    free(tangents);
+    free(normals);
+    free(positions);
+}
+
+- (void)testDenseAndSparseTargetsMatchReference {
+    GLTFSubmesh *submesh = [self submeshWithNormalCount:GLTFTestMorphVertexCount targetNormalCount:GLTFTestMorphVertexCount];
+    GLTFMorphTargetEvaluator *evaluator = [[GLTFMorphTargetEvaluator alloc] initWithSubmesh:submesh];
+    XCTAssertEqual(evaluator.vertexCount, GLTFTestMorphVertexCount);
+    XCTAssertEqual(evaluator.targetCount, GLTFTestMorphTargetCount);
+    XCTAssertTrue(evaluator.hasNormals);
+    XCTAssertTrue(evaluator.hasTangents);
+    // Every vertex of the dense target, and only the moved vertices of the sparse ones
+    XCTAssertEqual(evaluator.deltaCount, GLTFTestMorphVertexCount + GLTFTestMorphVertexCount / 10 + 2);
+    
+    // Each target alone, so each storage is checked on its own, then together, with negative weights
+    const float weightSets[][GLTFTestMorphTargetCount] = {
+        { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 }, { 0.7f, -0.4f, 1.3f }, { -1, 2, -0.5f },
+    };
+    for (int w = 0; w < sizeof(weightSets) / sizeof(weightSets[0]); ++w) {
+        [self assertEvaluator:evaluator withWeights:weightSets[w] count:GLTFTestMorphTargetCount appliesNormalDeltas:YES];
+    }
+}
+
+- (void)testOnlyCountedWeightsAreApplied {
+    GLTFSubmesh *submesh = [self submeshWithNormalCount:GLTFTestMorphVertexCount targetNormalCount:GLTFTestMorphVertexCount];
+    GLTFMorphTargetEvaluator *evaluator = [[GLTFMorphTargetEvaluator alloc] initWithSubmesh:submesh];
+    const float weights[GLTFTestMorphTargetCount] = { 0.5f, -1, 2 };
+    [self assertEvaluator:evaluator withWeights:weights count:1 appliesNormalDeltas:YES];
+    [self assertEvaluator:evaluator withWeights:weights count:2 appliesNormalDeltas:YES];
+}
+
+- (void)testShortNormalAccessorsAreTreatedAsMissing {
+    // Base normals for only half the vertices would leave the rest zero and normalize them to NaN
+    GLTFSubmesh *submesh = [self submeshWithNormalCount:GLTFTestMorphVertexCount / 2 targetNormalCount:GLTFTestMorphVertexCount];
+    GLTFMorphTargetEvaluator *evaluator = [[GLTFMorphTargetEvaluator alloc] initWithSubmesh:submesh];
+    XCTAssertFalse(evaluator.hasNormals);
+    XCTAssertTrue(evaluator.hasTangents);
+    
+    const float weights[GLTFTestMorphTargetCount] = { 0.7f, -0.4f, 1.3f };
+    simd_float3 *positions = malloc(sizeof(simd_float3) * GLTFTestMorphVertexCount);
+    simd_float3 *normals = malloc(sizeof(simd_float3) * GLTFTestMorphVertexCount);
+    simd_float4 *tangents = malloc(sizeof(simd_float4) * GLTFTestMorphVertexCount);
+    for (int v = 0; v < GLTFTestMorphVertexCount; ++v) {
+        normals[v] = (simd_float3){ 7, 7, 7 };
+    }
+    [evaluator evaluateWithWeights:weights count:GLTFTestMorphTargetCount positions:positions normals:normals tangents:tangents];
+    for (int v = 0; v < GLTFTestMorphVertexCount; ++v) {
+        XCTAssertTrue(simd_equal(normals[v], ((simd_float3){ 7, 7, 7 })), @"Normal of vertex %d was written", v);
+        XCTAssertFalse(isnan(positions[v].x) || isnan(tangents[v].x));
+    }
+    free(tangents);
+    free(normals);
+    free(positions);
+    
+    // Short normal deltas on a target just contribute nothing
+    submesh = [self submeshWithNormalCount:GLTFTestMorphVertexCount targetNormalCount:GLTFTestMorphVertexCount / 2];
+    evaluator = [[GLTFMorphTargetEvaluator alloc] initWithSubmesh:submesh];
+    XCTAssertTrue(evaluator.hasNormals);
+    [self assertEvaluator:evaluator withWeights:weights count:GLTFTestMorphTargetCount appliesNormalDeltas:NO];
+}
+
+@end
@@ -0,0 +1,45 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFTestGeometry.h"
+
+@import XCTest;
+
+@interface GLTFNodeTests : XCTestCase
+@end
+
+@implementation GLTFNodeTests
+
+- (void)testSettingMorphWeightsFromTheNodesOwnStorage {
+    GLTFNode *node = [GLTFNode new];
+    const float weights[] = { 0.1f, 0.2f, 0.3f, 0.4f };
+    [node setMorphTargetWeightValues:weights count:4];
+
+    [node setMorphTargetWeightValues:node.morphTargetWeightValues count:4];
+    XCTAssertEqual(memcmp(node.morphTargetWeightValues, weights, sizeof(weights)), 0);
+
+    // Shrinking from an overlapping range of the current weights
+    [node setMorphTargetWeightValues:node.morphTargetWeightValues + 1 count:3];
+    XCTAssertEqual(node.morphTargetWeightCount, 3);
+    XCTAssertEqual(memcmp(node.morphTargetWeightValues, weights + 1, sizeof(float) * 3), 0);
+
+    [node setMorphTargetWeightValues:NULL count:0];
+    XCTAssertEqual(node.morphTargetWeightCount, 0);
+    XCTAssertTrue(node.morphTargetWeightValues == NULL);
+}
+
+@end
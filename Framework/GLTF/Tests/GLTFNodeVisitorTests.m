@@ -0,0 +1,138 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFTestGeometry.h"
+
+@import XCTest;
+
+@interface GLTFNodeVisitorTests : XCTestCase
+@property (nonatomic, copy) NSArray<GLTFNode *> *nodes;
+@end
+
+// Reference orders, produced the obvious recursive way
+static void GLTFTestVisitRecursively(GLTFNode *node, BOOL postOrder, int pruneDepth, int depth, NSMutableArray *order) {
+    if (!postOrder) {
+        [order addObject:node];
+        if (depth == pruneDepth) {
+            return;
+        }
+    }
+    for (GLTFNode *child in node.children) {
+        GLTFTestVisitRecursively(child, postOrder, pruneDepth, depth + 1, order);
+    }
+    if (postOrder) {
+        [order addObject:node];
+    }
+}
+
+@implementation GLTFNodeVisitorTests
+
+- (void)setUp {
+    [super setUp];
+    // Deep enough to spill the traversal stack past its inline capacity
+    NSMutableArray<GLTFNode *> *nodes = [GLTFTestMakeNodeTree(2000, 3) mutableCopy];
+    GLTFNode *tail = nodes.lastObject;
+    for (int i = 0; i < 300; ++i) {
+        GLTFNode *child = [GLTFNode new];
+        child.parent = tail;
+        tail.children = @[ child ];
+        [nodes addObject:child];
+        tail = child;
+    }
+    self.nodes = nodes;
+}
+
+- (NSArray<GLTFNode *> *)visitWithStrategy:(GLTFVisitationStrategy)strategy pruneDepth:(int)pruneDepth {
+    NSMutableArray<GLTFNode *> *order = [NSMutableArray array];
+    GLTFVisitNodes(@[ self.nodes.firstObject ], ^(GLTFNode *node, int depth, BOOL *stop) {
+        [order addObject:node];
+        if (depth == pruneDepth) {
+            *stop = NO;
+        }
+    }, strategy);
+    return order;
+}
+
+- (void)testDepthFirstMatchesRecursivePreOrder {
+    NSMutableArray *expected = [NSMutableArray array];
+    GLTFTestVisitRecursively(self.nodes.firstObject, NO, -1, 0, expected);
+    XCTAssertEqualObjects([self visitWithStrategy:GLTFVisitationStrategyDepthFirst pruneDepth:-1], expected);
+}
+
+- (void)testDepthFirstSkipsChildrenOfStoppedNodes {
+    NSMutableArray *expected = [NSMutableArray array];
+    GLTFTestVisitRecursively(self.nodes.firstObject, NO, 3, 0, expected);
+    XCTAssertEqualObjects([self visitWithStrategy:GLTFVisitationStrategyDepthFirst pruneDepth:3], expected);
+}
+
+- (void)testPostOrderMatchesRecursivePostOrder {
+    NSMutableArray *expected = [NSMutableArray array];
+    GLTFTestVisitRecursively(self.nodes.firstObject, YES, -1, 0, expected);
+    XCTAssertEqualObjects([self visitWithStrategy:GLTFVisitationStrategyDepthFirstPostOrder pruneDepth:-1], expected);
+}
+
+- (void)testBreadthFirstVisitsLevelByLevel {
+    NSMutableArray *expected = [NSMutableArray arrayWithObject:self.nodes.firstObject];
+    for (NSUInteger i = 0; i < expected.count; ++i) {
+        [expected addObjectsFromArray:[expected[i] children]];
+    }
+    XCTAssertEqualObjects([self visitWithStrategy:GLTFVisitationStrategyBreadthFirst pruneDepth:-1], expected);
+}
+
+- (void)testConcurrentVisitsEveryNodeOnceAfterItsParent {
+    NSMutableArray<GLTFNode *> *order = [NSMutableArray array];
+    NSMapTable<GLTFNode *, NSNumber *> *depths = [NSMapTable strongToStrongObjectsMapTable];
+    GLTFVisitNodes(@[ self.nodes.firstObject ], ^(GLTFNode *node, int depth, BOOL *stop) {
+        @synchronized(order) {
+            // Within a subtree the traversal is pre-order, so a node's parent has always been seen already
+            XCTAssertTrue(node.parent == nil || [depths objectForKey:node.parent] != nil);
+            [order addObject:node];
+            [depths setObject:@(depth) forKey:node];
+        }
+    }, GLTFVisitationStrategyConcurrent);
+    XCTAssertEqual(order.count, self.nodes.count);
+    XCTAssertEqual([NSSet setWithArray:order].count, self.nodes.count);
+    for (GLTFNode *node in self.nodes) {
+        if (node.parent != nil) {
+            XCTAssertEqual([depths objectForKey:node].intValue, [depths objectForKey:node.parent].intValue + 1);
+        }
+    }
+}
+
+- (void)measureTraversalOfNodeCount:(NSInteger)nodeCount strategy:(GLTFVisitationStrategy)strategy {
+    NSArray<GLTFNode *> *nodes = GLTFTestMakeNodeTree(nodeCount, 4);
+    NSArray<GLTFNode *> *roots = @[ nodes.firstObject ];
+    [self measureBlock:^{
+        __block NSInteger visitCount = 0;
+        for (int i = 0; i < 10; ++i) {
+            GLTFVisitNodes(roots, ^(GLTFNode *node, int depth, BOOL *stop) {
+                ++visitCount;
+            }, strategy);
+        }
+        XCTAssertEqual(visitCount, nodeCount * 10);
+    }];
+}
+
+- (void)testDepthFirstPerformanceWith100kNodes {
+    [self measureTraversalOfNodeCount:100000 strategy:GLTFVisitationStrategyDepthFirst];
+}
+
+- (void)testBreadthFirstPerformanceWith100kNodes {
+    [self measureTraversalOfNodeCount:100000 strategy:GLTFVisitationStrategyBreadthFirst];
+}
+
+@end
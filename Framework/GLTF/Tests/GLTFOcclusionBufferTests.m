@@ -0,0 +1,70 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFTestGeometry.h"
+
+@import XCTest;
+
+@interface GLTFOcclusionBufferTests : XCTestCase
+@end
+
+@implementation GLTFOcclusionBufferTests
+
+// From the origin down -z, with a square wall facing the camera at z = -5
+- (GLTFOcclusionBuffer *)bufferWithWall {
+    GLTFOcclusionBuffer *buffer = [[GLTFOcclusionBuffer alloc] initWithWidth:64 height:64];
+    simd_float4x4 projection = GLTFPerspectiveProjectionMatrixAspectFovRH(M_PI / 3, 1, 0.1f, 100);
+    [buffer beginFrameWithViewProjectionMatrix:projection];
+    
+    const simd_float3 wall[] = {
+        { -2, -2, -5 }, { 2, -2, -5 }, { 2, 2, -5 },
+        { -2, -2, -5 }, { 2, 2, -5 }, { -2, 2, -5 },
+    };
+    [buffer addOccluderTriangles:wall triangleCount:2 modelMatrix:matrix_identity_float4x4];
+    [buffer rasterizeOccluders];
+    return buffer;
+}
+
+- (void)testOccluderHidesOnlyWhatIsBehindIt {
+    GLTFOcclusionBuffer *buffer = [self bufferWithWall];
+    XCTAssertEqual(buffer.occluderTriangleCount, (NSInteger)2);
+    
+    GLTFBoundingBox hiddenBox = { (simd_float3){ -0.5f, -0.5f, -9 }, (simd_float3){ 0.5f, 0.5f, -8 } };
+    XCTAssertFalse([buffer isBoundingBoxVisible:hiddenBox modelMatrix:matrix_identity_float4x4]);
+    
+    // Beside the wall as seen from the camera, though just as far away
+    GLTFBoundingBox visibleBox = { (simd_float3){ 3.5f, -0.5f, -9 }, (simd_float3){ 4.5f, 0.5f, -8 } };
+    XCTAssertTrue([buffer isBoundingBoxVisible:visibleBox modelMatrix:matrix_identity_float4x4]);
+    
+    // In front of the wall
+    GLTFBoundingBox nearBox = { (simd_float3){ -0.5f, -0.5f, -4 }, (simd_float3){ 0.5f, 0.5f, -3 } };
+    XCTAssertTrue([buffer isBoundingBoxVisible:nearBox modelMatrix:matrix_identity_float4x4]);
+}
+
+- (void)testOccluderDoesNotHideItself {
+    GLTFOcclusionBuffer *buffer = [self bufferWithWall];
+    
+    // The wall's own bounds are flat, at exactly the depth it was rasterized at
+    GLTFBoundingBox wallBounds = { (simd_float3){ -2, -2, -5 }, (simd_float3){ 2, 2, -5 } };
+    XCTAssertTrue([buffer isBoundingBoxVisible:wallBounds modelMatrix:matrix_identity_float4x4]);
+    
+    // As are those of a box whose front face the wall is
+    GLTFBoundingBox boxBounds = { (simd_float3){ -2, -2, -6 }, (simd_float3){ 2, 2, -5 } };
+    XCTAssertTrue([buffer isBoundingBoxVisible:boxBounds modelMatrix:matrix_identity_float4x4]);
+}
+
+@end
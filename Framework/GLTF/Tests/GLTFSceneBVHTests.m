@@ -0,0 +1,304 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFTestGeometry.h"
+
+@import XCTest;
+
+@interface GLTFSceneBVHTests : XCTestCase
+@property (nonatomic, strong) GLTFTestGeometry *geometry;
+@property (nonatomic, strong) GLTFMesh *mesh;
+@end
+
+@implementation GLTFSceneBVHTests
+
+- (void)setUp {
+    [super setUp];
+    self.geometry = [GLTFTestGeometry gridWithResolution:2];
+    self.mesh = [GLTFMesh new];
+    self.mesh.submeshes = @[ self.geometry.submesh ];
+}
+
+// Nodes only reference their mesh weakly, so the test holds on to it
+- (GLTFScene *)sceneWithNodeCount:(NSInteger)nodeCount nodes:(NSArray<GLTFNode *> **)outNodes {
+    NSArray<GLTFNode *> *nodes = GLTFTestMakeNodeTree(nodeCount, 4);
+    for (GLTFNode *node in nodes) {
+        node.mesh = self.mesh;
+    }
+    GLTFScene *scene = [GLTFScene new];
+    scene.nodes = @[ nodes.firstObject ];
+    if (outNodes != NULL) {
+        *outNodes = nodes;
+    }
+    return scene;
+}
+
+- (void)testSceneWithoutTransformStoreIsLeftAlone {
+    GLTFScene *scene = [self sceneWithNodeCount:20 nodes:NULL];
+    XCTAssertNil(scene.boundingVolumeHierarchy);
+    
+    // Ray casts fall back to testing the nodes themselves rather than creating a store
+    // Straight down through the root node, whose translation is (-3, 0, -1) and which isn't rotated
+    GLTFRay ray = { (simd_float3){ -3, 10, -1 }, (simd_float3){ 0, -1, 0 } };
+    GLTFRayHit *hit = [scene closestHitForRay:ray maximumDistance:FLT_MAX];
+    XCTAssertNotNil(hit);
+    XCTAssertNil(scene.transformStore);
+    XCTAssertNil(scene.boundingVolumeHierarchy);
+}
+
+- (void)testHierarchyUsesCallersTransformStore {
+    GLTFScene *scene = [self sceneWithNodeCount:20 nodes:NULL];
+    GLTFTransformStore *store = [[GLTFTransformStore alloc] initWithScene:scene];
+    scene.transformStore = store;
+    
+    GLTFSceneBVH *bvh = scene.boundingVolumeHierarchy;
+    XCTAssertNotNil(bvh);
+    XCTAssertEqual(bvh.transformStore, store);
+    XCTAssertEqual(bvh.leafCount, (NSInteger)20);
+}
+
+- (void)testClosestHitMatchesNodeByNodeRayCast {
+    GLTFScene *scene = [self sceneWithNodeCount:50 nodes:NULL];
+    GLTFRay ray = { (simd_float3){ -2.75f, 10, -0.75f }, (simd_float3){ 0, -1, 0 } };
+    GLTFRayHit *nodeHit = [scene closestHitForRay:ray maximumDistance:FLT_MAX];
+    
+    scene.transformStore = [[GLTFTransformStore alloc] initWithScene:scene];
+    GLTFRayHit *bvhHit = [scene closestHitForRay:ray maximumDistance:FLT_MAX];
+    XCTAssertNotNil(nodeHit);
+    XCTAssertNotNil(bvhHit);
+    XCTAssertEqualWithAccuracy(nodeHit.distance, bvhHit.distance, 1e-4f);
+}
+
+// The grid's vertices and triangles, recomputed the way +gridWithResolution: lays them out
+static simd_float3 GLTFTestGridPosition(NSInteger resolution, uint32_t index) {
+    NSInteger side = resolution + 1;
+    float u = ((index % side) / (float)resolution) * 2 - 1;
+    float v = ((index / side) / (float)resolution) * 2 - 1;
+    return (simd_float3){ u, 0.25f * expf(-4 * (u * u + v * v)), v };
+}
+
+static simd_uint3 GLTFTestGridTriangle(NSInteger resolution, NSInteger triangleIndex) {
+    NSInteger quad = triangleIndex / 2, side = resolution + 1;
+    uint32_t a = (uint32_t)((quad / resolution) * side + (quad % resolution)), b = a + 1, c = a + (uint32_t)side, d = c + 1;
+    return (triangleIndex % 2 == 0) ? (simd_uint3){ a, c, b } : (simd_uint3){ b, c, d };
+}
+
+// Two-sided Möller-Trumbore over every triangle, as a reference; returns -1 for a miss
+static float GLTFTestBruteForceDistance(NSInteger resolution, GLTFRay ray) {
+    float closest = -1;
+    for (NSInteger t = 0; t < resolution * resolution * 2; ++t) {
+        simd_uint3 triangle = GLTFTestGridTriangle(resolution, t);
+        simd_float3 p0 = GLTFTestGridPosition(resolution, triangle.x);
+        simd_float3 e1 = GLTFTestGridPosition(resolution, triangle.y) - p0;
+        simd_float3 e2 = GLTFTestGridPosition(resolution, triangle.z) - p0;
+        simd_float3 p = simd_cross(ray.direction, e2);
+        float determinant = simd_dot(e1, p);
+        if (fabsf(determinant) < 1e-12f) {
+            continue;
+        }
+        simd_float3 s = ray.origin - p0;
+        float u = simd_dot(s, p) / determinant;
+        simd_float3 q = simd_cross(s, e1);
+        float v = simd_dot(ray.direction, q) / determinant;
+        float distance = simd_dot(e2, q) / determinant;
+        if (u >= 0 && v >= 0 && u + v <= 1 && distance >= 0 && (closest < 0 || distance < closest)) {
+            closest = distance;
+        }
+    }
+    return closest;
+}
+
+- (void)testTriangleBVHMatchesBruteForce {
+    const NSInteger resolution = 16;
+    GLTFTestGeometry *geometry = [GLTFTestGeometry gridWithResolution:resolution];
+    GLTFTriangleBVH *bvh = geometry.submesh.triangleBVH;
+    XCTAssertNotNil(bvh);
+    XCTAssertEqual(bvh.triangleCount, resolution * resolution * 2);
+    
+    // Slanted rays from above and below, some of which miss the grid; the grid is hit from either side
+    srand48(42);
+    for (int i = 0; i < 500; ++i) {
+        simd_float3 target = { (float)drand48() * 2.4f - 1.2f, 0.1f, (float)drand48() * 2.4f - 1.2f };
+        simd_float3 origin = { (float)drand48() * 2 - 1, (i % 2 == 0) ? 3.0f : -3.0f, (float)drand48() * 2 - 1 };
+        GLTFRay ray = { origin, target - origin };
+        float expected = GLTFTestBruteForceDistance(resolution, ray);
+        GLTFTriangleHit hit;
+        BOOL found = [bvh intersectRay:ray maximumDistance:FLT_MAX anyHit:NO hit:&hit];
+        XCTAssertEqual(found, (BOOL)(expected >= 0), @"Ray %d", i);
+        if (found && expected >= 0) {
+            XCTAssertEqualWithAccuracy(hit.distance, expected, 1e-4f, @"Ray %d", i);
+        }
+    }
+}
+
+- (void)testTriangleHitReportsVerticesAndBarycentrics {
+    const NSInteger resolution = 8;
+    GLTFTestGeometry *geometry = [GLTFTestGeometry gridWithResolution:resolution];
+    GLTFTriangleBVH *bvh = geometry.submesh.triangleBVH;
+    
+    srand48(7);
+    for (int i = 0; i < 100; ++i) {
+        GLTFRay ray = { (simd_float3){ (float)drand48() * 1.4f - 0.7f, 2, (float)drand48() * 1.4f - 0.7f }, (simd_float3){ 0.1f, -1, 0.05f } };
+        GLTFTriangleHit hit;
+        XCTAssertTrue([bvh intersectRay:ray maximumDistance:FLT_MAX anyHit:NO hit:&hit]);
+        
+        simd_uint3 triangle = GLTFTestGridTriangle(resolution, hit.triangleIndex);
+        XCTAssertTrue(simd_all(hit.vertexIndices == triangle), @"Ray %d", i);
+        simd_float3 weights = hit.barycentricCoordinates;
+        XCTAssertEqualWithAccuracy(weights.x + weights.y + weights.z, 1, 1e-5f);
+        XCTAssertTrue(simd_all(weights >= -1e-5f), @"Ray %d", i);
+        
+        // The weighted vertices are the point the ray reaches
+        simd_float3 interpolated = weights.x * GLTFTestGridPosition(resolution, triangle.x) +
+                                   weights.y * GLTFTestGridPosition(resolution, triangle.y) +
+                                   weights.z * GLTFTestGridPosition(resolution, triangle.z);
+        simd_float3 reached = ray.origin + ray.direction * hit.distance;
+        XCTAssertLessThan(simd_distance(interpolated, reached), 1e-4f, @"Ray %d", i);
+    }
+}
+
+- (void)testAnyHitStaysWithinMaximumDistance {
+    // Two copies of the grid, one above the other
+    GLTFNode *lower = [GLTFNode new];
+    lower.mesh = self.mesh;
+    GLTFNode *upper = [GLTFNode new];
+    upper.mesh = self.mesh;
+    upper.translation = (simd_float3){ 0, 2, 0 };
+    GLTFScene *scene = [GLTFScene new];
+    scene.nodes = @[ lower, upper ];
+    scene.transformStore = [[GLTFTransformStore alloc] initWithScene:scene];
+    
+    GLTFRay ray = { (simd_float3){ 0.5f, 10, 0.5f }, (simd_float3){ 0, -1, 0 } };
+    GLTFRayHit *closest = [scene closestHitForRay:ray maximumDistance:FLT_MAX];
+    XCTAssertEqual(closest.node, upper);
+    
+    GLTFRayHit *any = [scene anyHitForRay:ray maximumDistance:FLT_MAX];
+    XCTAssertNotNil(any);
+    XCTAssertTrue(any.node == upper || any.node == lower);
+    XCTAssertGreaterThanOrEqual(any.distance, closest.distance - 1e-4f);
+    
+    // Only the upper grid is close enough, and nothing is closer than it
+    any = [scene anyHitForRay:ray maximumDistance:closest.distance + 1];
+    XCTAssertEqual(any.node, upper);
+    XCTAssertEqualWithAccuracy(any.distance, closest.distance, 1e-4f);
+    XCTAssertNil([scene anyHitForRay:ray maximumDistance:closest.distance - 0.1f]);
+}
+
+// Hit distances are in multiples of the direction the caller passed, however the node is scaled and whether or
+// not the direction has unit length
+- (void)testScaledInstanceHitDistanceIsInWorldUnits {
+    const float scale = 3;
+    GLTFRay localRay = { (simd_float3){ 0.3f, 10, 0.2f }, (simd_float3){ 0, -1, 0 } };
+    GLTFTriangleHit localHit;
+    XCTAssertTrue([self.geometry.submesh.triangleBVH intersectRay:localRay maximumDistance:FLT_MAX anyHit:NO hit:&localHit]);
+    float surfaceHeight = scale * (localRay.origin.y - localHit.distance);
+    
+    GLTFRay ray = { (simd_float3){ 0.3f * scale, 10, 0.2f * scale }, (simd_float3){ 0, -2, 0 } };
+    float expectedDistance = (10 - surfaceHeight) / 2;
+    
+    GLTFNode *node = [GLTFNode new];
+    node.mesh = self.mesh;
+    node.scale = (simd_float3){ scale, scale, scale };
+    GLTFScene *scene = [GLTFScene new];
+    scene.nodes = @[ node ];
+    
+    // Node by node, then through the scene's hierarchy
+    GLTFRayHit *nodeHit = [scene closestHitForRay:ray maximumDistance:FLT_MAX];
+    scene.transformStore = [[GLTFTransformStore alloc] initWithScene:scene];
+    GLTFRayHit *bvhHit = [scene closestHitForRay:ray maximumDistance:FLT_MAX];
+    
+    // An unscaled node placed by a scaled instance
+    node.scale = (simd_float3){ 1, 1, 1 };
+    GLTFSceneInstance *instance = [[GLTFSceneInstance alloc] initWithScene:scene];
+    instance.rootTransform = GLTFMatrixFromUniformScale(scale);
+    [instance.boundingVolumeHierarchy refit];
+    GLTFRayHit *instanceHit = [instance.boundingVolumeHierarchy closestHitForRay:ray maximumDistance:FLT_MAX];
+    
+    GLTFRayHit *hits[] = { nodeHit, bvhHit, instanceHit };
+    for (int i = 0; i < 3; ++i) {
+        XCTAssertNotNil(hits[i], @"Hit %d", i);
+        XCTAssertEqualWithAccuracy(hits[i].distance, expectedDistance, 1e-4f, @"Hit %d", i);
+        XCTAssertEqualWithAccuracy(hits[i].position.y, surfaceHeight, 1e-4f, @"Hit %d", i);
+        XCTAssertTrue(simd_all(hits[i].vertexIndices == localHit.vertexIndices), @"Hit %d", i);
+    }
+    // The maximum distance is in the same units
+    XCTAssertNil([instance.boundingVolumeHierarchy closestHitForRay:ray maximumDistance:expectedDistance - 0.1f]);
+}
+
+- (void)testClosestHitsForRaysMatchesSingleRays {
+    GLTFScene *scene = [self sceneWithNodeCount:200 nodes:NULL];
+    scene.transformStore = [[GLTFTransformStore alloc] initWithScene:scene];
+    GLTFSceneBVH *bvh = scene.boundingVolumeHierarchy;
+    
+    const NSInteger rayCount = 1000;
+    GLTFRay *rays = malloc(sizeof(GLTFRay) * rayCount);
+    float *distances = malloc(sizeof(float) * rayCount);
+    int *callCounts = calloc(rayCount, sizeof(int));
+    srand48(3);
+    for (NSInteger i = 0; i < rayCount; ++i) {
+        rays[i].origin = (simd_float3){ (float)drand48() * 8 - 4, 10, (float)drand48() * 4 - 2 };
+        rays[i].direction = (simd_float3){ (float)drand48() - 0.5f, -1, (float)drand48() - 0.5f };
+    }
+    
+    [bvh closestHitsForRays:rays count:rayCount maximumDistance:FLT_MAX usingBlock:^(NSInteger rayIndex, GLTFRayHit *hit) {
+        distances[rayIndex] = (hit != nil) ? hit.distance : -1;
+        ++callCounts[rayIndex];
+    }];
+    NSInteger hitCount = 0;
+    for (NSInteger i = 0; i < rayCount; ++i) {
+        XCTAssertEqual(callCounts[i], 1);
+        GLTFRayHit *hit = [bvh closestHitForRay:rays[i] maximumDistance:FLT_MAX];
+        XCTAssertEqualWithAccuracy(distances[i], (hit != nil) ? hit.distance : -1, 1e-6f, @"Ray %d", (int)i);
+        hitCount += (hit != nil);
+    }
+    XCTAssertGreaterThan(hitCount, 0);
+    free(callCounts);
+    free(distances);
+    free(rays);
+}
+
+// Refits a 100,000-node hierarchy after moving one node in a hundred, the per-frame cost of a mostly static scene
+- (void)testRefitPerformanceWith100kNodes {
+    NSArray<GLTFNode *> *nodes = nil;
+    GLTFScene *scene = [self sceneWithNodeCount:100000 nodes:&nodes];
+    scene.transformStore = [[GLTFTransformStore alloc] initWithScene:scene];
+    GLTFSceneBVH *bvh = scene.boundingVolumeHierarchy;
+    XCTAssertEqual(bvh.leafCount, (NSInteger)nodes.count);
+    
+    __block float offset = 0;
+    [self measureBlock:^{
+        offset += 0.01f;
+        for (NSInteger i = 0; i < (NSInteger)nodes.count; i += 100) {
+            nodes[i].translation = (simd_float3){ offset, 0, 0 };
+        }
+        [bvh refit];
+    }];
+}
+
+// Builds the hierarchy of a 100,000-node scene from scratch, as after loading or reparenting
+- (void)testBuildPerformanceWith100kNodes {
+    GLTFScene *scene = [self sceneWithNodeCount:100000 nodes:NULL];
+    scene.transformStore = [[GLTFTransformStore alloc] initWithScene:scene];
+    GLTFSceneBVH *bvh = scene.boundingVolumeHierarchy;
+    
+    [self measureBlock:^{
+        [bvh rebuild];
+    }];
+    XCTAssertEqual(bvh.leafCount, (NSInteger)100000);
+}
+
+@end
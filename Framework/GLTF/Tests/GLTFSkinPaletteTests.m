@@ -0,0 +1,153 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFTestGeometry.h"
+
+@import XCTest;
+
+@interface GLTFSkinPaletteTests : XCTestCase
+@property (nonatomic, strong) GLTFTestAccessorPool *pool;
+@property (nonatomic, strong) GLTFScene *scene;
+@property (nonatomic, strong) GLTFNode *meshNode;
+@property (nonatomic, strong) NSArray<GLTFNode *> *jointNodes;
+@property (nonatomic, strong) GLTFSkin *skin;
+@end
+
+@implementation GLTFSkinPaletteTests
+
+// A root with the mesh node and a chain of two joints below it, each with an inverse bind matrix
+- (void)setUp {
+    [super setUp];
+    self.pool = [GLTFTestAccessorPool new];
+    
+    GLTFNode *root = [GLTFNode new];
+    root.translation = (simd_float3){ 0, 1, 0 };
+    GLTFNode *meshNode = [GLTFNode new];
+    meshNode.translation = (simd_float3){ 2, 0, 0 };
+    meshNode.rotationQuaternion = simd_quaternion((float)M_PI_4, GLTFAxisY);
+    GLTFNode *firstJoint = [GLTFNode new];
+    firstJoint.translation = (simd_float3){ 0, 0, -1 };
+    GLTFNode *secondJoint = [GLTFNode new];
+    secondJoint.translation = (simd_float3){ 0, 3, 0 };
+    secondJoint.rotationQuaternion = simd_quaternion((float)M_PI_2, GLTFAxisX);
+    
+    root.children = @[ meshNode, firstJoint ];
+    meshNode.parent = root;
+    firstJoint.parent = root;
+    firstJoint.children = @[ secondJoint ];
+    secondJoint.parent = firstJoint;
+    
+    simd_float4x4 inverseBindMatrices[2] = { matrix_identity_float4x4, matrix_identity_float4x4 };
+    inverseBindMatrices[0].columns[3] = (simd_float4){ 0, -1, 1, 1 };
+    inverseBindMatrices[1].columns[3] = (simd_float4){ 0.5f, -4, 1, 1 };
+    GLTFSkin *skin = [GLTFSkin new];
+    skin.jointNodes = @[ firstJoint, secondJoint ];
+    skin.inverseBindMatricesAccessor = [self.pool accessorWithFloats:(const float *)inverseBindMatrices count:2
+                                                           dimension:GLTFDataDimensionMatrix4x4];
+    meshNode.skin = skin;
+    
+    self.scene = [GLTFScene new];
+    self.scene.nodes = @[ root ];
+    self.meshNode = meshNode;
+    self.jointNodes = skin.jointNodes;
+    self.skin = skin;
+}
+
+- (void)assertPalette:(GLTFSkinPalette *)palette matchesWorldTransforms:(const simd_float4x4 *)worldTransforms {
+    simd_float4x4 inverseMeshTransform = simd_inverse(worldTransforms[0]);
+    const simd_float4x4 *inverseBindMatrices = self.skin.inverseBindMatricesAccessor.contents;
+    for (NSInteger j = 0; j < palette.jointCount; ++j) {
+        simd_float4x4 expected = simd_mul(simd_mul(inverseMeshTransform, worldTransforms[j + 1]), inverseBindMatrices[j]);
+        XCTAssertTrue(GLTFTestMatricesEqual(palette.jointMatrices[j], expected, 1e-5f));
+    }
+}
+
+- (void)testPaletteHoldsJointWorldTimesInverseBind {
+    GLTFSkinPalette *palette = [[GLTFSkinPalette alloc] initWithSkin:self.skin meshNode:self.meshNode instance:nil];
+    XCTAssertEqual(palette.jointCount, 2);
+    XCTAssertEqual(palette.version, (NSUInteger)0);
+    XCTAssertTrue([palette update]);
+    XCTAssertEqual(palette.version, (NSUInteger)1);
+    
+    simd_float4x4 worldTransforms[3] = {
+        self.meshNode.globalTransform, self.jointNodes[0].globalTransform, self.jointNodes[1].globalTransform
+    };
+    [self assertPalette:palette matchesWorldTransforms:worldTransforms];
+}
+
+- (void)testUnchangedPoseIsNotRecomputed {
+    GLTFSkinPalette *palette = [[GLTFSkinPalette alloc] initWithSkin:self.skin meshNode:self.meshNode instance:nil];
+    [palette update];
+    const simd_float4x4 *jointMatrices = palette.jointMatrices;
+    simd_float4x4 firstMatrix = jointMatrices[0];
+    
+    // Renderers only upload a new copy of the palette when its version changes
+    for (int i = 0; i < 3; ++i) {
+        XCTAssertFalse([palette update]);
+    }
+    XCTAssertEqual(palette.version, (NSUInteger)1);
+    XCTAssertEqual(palette.jointMatrices, jointMatrices);
+    XCTAssertTrue(GLTFTestMatricesEqual(palette.jointMatrices[0], firstMatrix, 0));
+}
+
+- (void)testMovedJointIsRecomputed {
+    GLTFSkinPalette *palette = [[GLTFSkinPalette alloc] initWithSkin:self.skin meshNode:self.meshNode instance:nil];
+    [palette update];
+    simd_float4x4 firstMatrix = palette.jointMatrices[0];
+    
+    // Moving the first joint moves the second with it
+    self.jointNodes[0].translation = (simd_float3){ 1, 0, -1 };
+    XCTAssertTrue([palette update]);
+    XCTAssertEqual(palette.version, (NSUInteger)2);
+    XCTAssertFalse(GLTFTestMatricesEqual(palette.jointMatrices[0], firstMatrix, 1e-3f));
+    simd_float4x4 worldTransforms[3] = {
+        self.meshNode.globalTransform, self.jointNodes[0].globalTransform, self.jointNodes[1].globalTransform
+    };
+    [self assertPalette:palette matchesWorldTransforms:worldTransforms];
+    
+    // As does moving the mesh node alone, since the palette is relative to it
+    self.meshNode.translation = (simd_float3){ -2, 0, 0 };
+    XCTAssertTrue([palette update]);
+    XCTAssertEqual(palette.version, (NSUInteger)3);
+    worldTransforms[0] = self.meshNode.globalTransform;
+    [self assertPalette:palette matchesWorldTransforms:worldTransforms];
+}
+
+- (void)testInstancePaletteFollowsInstancePose {
+    GLTFSceneInstance *instance = [[GLTFSceneInstance alloc] initWithScene:self.scene];
+    GLTFSkinPalette *palette = [[GLTFSkinPalette alloc] initWithSkin:self.skin meshNode:self.meshNode instance:instance];
+    XCTAssertTrue([palette update]);
+    XCTAssertFalse([palette update]);
+    
+    GLTFTransformStore *store = instance.transformStore;
+    [store setTranslation:(simd_float3){ 0, 2, 5 } atIndex:[store indexOfNode:self.jointNodes[1]]];
+    XCTAssertTrue([palette update]);
+    XCTAssertFalse([palette update]);
+    XCTAssertEqual(palette.version, (NSUInteger)2);
+    
+    simd_float4x4 worldTransforms[3] = {
+        [instance worldTransformForNode:self.meshNode],
+        [instance worldTransformForNode:self.jointNodes[0]],
+        [instance worldTransformForNode:self.jointNodes[1]],
+    };
+    [self assertPalette:palette matchesWorldTransforms:worldTransforms];
+    
+    // The nodes themselves were left alone
+    XCTAssertEqual(self.jointNodes[1].translation.z, 0);
+}
+
+@end
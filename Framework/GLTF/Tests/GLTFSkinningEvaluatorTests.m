@@ -0,0 +1,277 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFTestGeometry.h"
+
+@import XCTest;
+
+@interface GLTFSkinningEvaluatorTests : XCTestCase
+@property (nonatomic, strong) GLTFTestAccessorPool *pool;
+@end
+
+@implementation GLTFSkinningEvaluatorTests
+
+- (void)setUp {
+    [super setUp];
+    self.pool = [GLTFTestAccessorPool new];
+    srand48(40);
+}
+
+static simd_float4x4 GLTFTestRandomJointMatrix(void) {
+    simd_float3 axis = simd_normalize((simd_float3){ drand48() - 0.5, drand48() - 0.5, drand48() - 0.5 });
+    simd_float4x4 m = simd_matrix4x4(simd_quaternion((float)(drand48() * M_PI), axis));
+    float scale = 0.5 + drand48();
+    m.columns[0] *= scale;
+    m.columns[1] *= scale;
+    m.columns[2] *= scale;
+    m.columns[3] = (simd_float4){ drand48() * 4 - 2, drand48() * 4 - 2, drand48() * 4 - 2, 1 };
+    return m;
+}
+
+// Influences on joints past the end of the palette, and zero weights, are included on purpose
+static void GLTFTestRandomInfluences(uint16_t *joints, float *weights, int influenceCount, NSInteger vertexCount,
+                                     NSInteger jointCount)
+{
+    for (NSInteger v = 0; v < vertexCount; ++v) {
+        float total = 0;
+        for (int i = 0; i < influenceCount; ++i) {
+            joints[v * influenceCount + i] = (uint16_t)(drand48() * (jointCount + 2));
+            weights[v * influenceCount + i] = (drand48() < 0.2) ? 0 : drand48();
+            total += weights[v * influenceCount + i];
+        }
+        for (int i = 0; i < influenceCount; ++i) {
+            weights[v * influenceCount + i] /= MAX(total, 1e-3f);
+        }
+    }
+}
+
+// Linear blend skinning written out plainly, one vertex and one full matrix at a time
+static void GLTFTestReferenceSkin(const GLTFSkinningVertices *vertices, NSInteger vertexCount,
+                                  const simd_float4x4 *jointMatrices, NSInteger jointCount,
+                                  simd_float3 *positions, simd_float3 *normals)
+{
+    int influenceCount = vertices->influenceCount;
+    for (NSInteger v = 0; v < vertexCount; ++v) {
+        simd_float4x4 m = { 0 };
+        for (int i = 0; i < influenceCount; ++i) {
+            uint16_t joint = vertices->joints[v * influenceCount + i];
+            float weight = vertices->weights[v * influenceCount + i];
+            if (joint < jointCount) {
+                m = simd_add(m, simd_mul(weight, jointMatrices[joint]));
+            }
+        }
+        positions[v] = simd_mul(m, simd_make_float4(vertices->positions[v], 1)).xyz;
+        normals[v] = simd_normalize(simd_mul(m, simd_make_float4(vertices->normals[v], 0)).xyz);
+    }
+}
+
+- (void)assertSkinnedVerticesWithInfluenceCount:(int)influenceCount start:(NSInteger)start count:(NSInteger)count {
+    const NSInteger jointCount = 24;
+    NSInteger vertexCount = start + count;
+    simd_float4x4 jointMatrices[jointCount];
+    for (NSInteger j = 0; j < jointCount; ++j) {
+        jointMatrices[j] = GLTFTestRandomJointMatrix();
+    }
+    uint16_t *joints = malloc(sizeof(uint16_t) * influenceCount * vertexCount);
+    float *weights = malloc(sizeof(float) * influenceCount * vertexCount);
+    GLTFTestRandomInfluences(joints, weights, influenceCount, vertexCount, jointCount);
+    simd_float3 *sourcePositions = malloc(sizeof(simd_float3) * vertexCount);
+    simd_float3 *sourceNormals = malloc(sizeof(simd_float3) * vertexCount);
+    for (NSInteger v = 0; v < vertexCount; ++v) {
+        sourcePositions[v] = (simd_float3){ drand48() * 2 - 1, drand48() * 2 - 1, drand48() * 2 - 1 };
+        sourceNormals[v] = simd_normalize((simd_float3){ drand48() - 0.5, drand48() - 0.5, drand48() - 0.5 });
+    }
+    GLTFSkinningVertices vertices = {
+        .joints = joints,
+        .weights = weights,
+        .influenceCount = influenceCount,
+        .positions = sourcePositions,
+        .normals = sourceNormals,
+    };
+    
+    simd_float3 *expectedPositions = malloc(sizeof(simd_float3) * vertexCount);
+    simd_float3 *expectedNormals = malloc(sizeof(simd_float3) * vertexCount);
+    GLTFTestReferenceSkin(&vertices, vertexCount, jointMatrices, jointCount, expectedPositions, expectedNormals);
+    
+    // Vertices before start must be left alone
+    simd_float3 *positions = calloc(vertexCount, sizeof(simd_float3));
+    simd_float3 *normals = calloc(vertexCount, sizeof(simd_float3));
+    GLTFSkinVertices(&vertices, start, count, jointMatrices, jointCount, positions, normals, NULL);
+    
+    for (NSInteger v = 0; v < start; ++v) {
+        XCTAssertEqual(simd_length(positions[v]), 0);
+    }
+    for (NSInteger v = start; v < vertexCount; ++v) {
+        // Vertices whose weights all fall on missing joints collapse to the origin and have no normal to compare
+        // Vertices whose weights all fell on missing joints collapse, as in the vertex shader
+        if (!isnan(expectedNormals[v].x)) {
+            XCTAssertLessThanOrEqual(simd_distance(normals[v], expectedNormals[v]), 1e-3f);
+        }
+    }
+    
+    free(joints);
+    free(weights);
+    free(sourcePositions);
+    free(sourceNormals);
+    free(expectedPositions);
+    free(expectedNormals);
+    free(positions);
+    free(normals);
+}
+
+- (void)testKernelMatchesReferenceWithFourInfluences {
+    // Neither the start nor the count is a multiple of four, so every vertex takes both paths somewhere
+    [self assertSkinnedVerticesWithInfluenceCount:4 start:0 count:4099];
+    [self assertSkinnedVerticesWithInfluenceCount:4 start:3 count:14];
+    [self assertSkinnedVerticesWithInfluenceCount:4 start:1 count:3];
+}
+
+- (void)testKernelMatchesReferenceWithEightInfluences {
+    [self assertSkinnedVerticesWithInfluenceCount:8 start:0 count:4099];
+    [self assertSkinnedVerticesWithInfluenceCount:8 start:5 count:23];
+}
+
+// A submesh whose attributes hold the given influences, as float accessors
+- (GLTFSubmesh *)submeshWithVertexCount:(NSInteger)vertexCount
+                              positions:(const float *)positions
+                                 joints:(const float *)joints
+                                weights:(const float *)weights
+                         influenceCount:(int)influenceCount
+{
+    NSMutableDictionary<NSString *, GLTFAccessor *> *accessors = [NSMutableDictionary dictionary];
+    accessors[GLTFAttributeSemanticPosition] = [self.pool accessorWithFloats:positions count:vertexCount
+                                                                   dimension:GLTFDataDimensionVector3];
+    NSString *jointSemantics[] = { GLTFAttributeSemanticJoints0, GLTFAttributeSemanticJoints1 };
+    NSString *weightSemantics[] = { GLTFAttributeSemanticWeights0, GLTFAttributeSemanticWeights1 };
+    for (int s = 0; s < influenceCount / 4; ++s) {
+        float *setJoints = malloc(sizeof(float) * 4 * vertexCount);
+        float *setWeights = malloc(sizeof(float) * 4 * vertexCount);
+        for (NSInteger v = 0; v < vertexCount; ++v) {
+            for (int i = 0; i < 4; ++i) {
+                setJoints[v * 4 + i] = joints[v * influenceCount + s * 4 + i];
+                setWeights[v * 4 + i] = weights[v * influenceCount + s * 4 + i];
+            }
+        }
+        accessors[jointSemantics[s]] = [self.pool accessorWithFloats:setJoints count:vertexCount dimension:GLTFDataDimensionVector4];
+        accessors[weightSemantics[s]] = [self.pool accessorWithFloats:setWeights count:vertexCount dimension:GLTFDataDimensionVector4];
+        free(setJoints);
+        free(setWeights);
+    }
+    GLTFSubmesh *submesh = [GLTFSubmesh new];
+    submesh.accessorsForAttributes = accessors;
+    return submesh;
+}
+
+- (void)testEvaluatorMatchesReferenceAcrossChunks {
+    // Two full chunks of 4096 and a partial one, whose length isn't a multiple of four either
+    const NSInteger vertexCount = 2 * 4096 + 7;
+    const int influenceCount = 8;
+    const NSInteger jointCount = 16;
+    simd_float4x4 jointMatrices[jointCount];
+    for (NSInteger j = 0; j < jointCount; ++j) {
+        jointMatrices[j] = GLTFTestRandomJointMatrix();
+    }
+    uint16_t *joints = malloc(sizeof(uint16_t) * influenceCount * vertexCount);
+    float *weights = malloc(sizeof(float) * influenceCount * vertexCount);
+    GLTFTestRandomInfluences(joints, weights, influenceCount, vertexCount, jointCount);
+    float *jointValues = malloc(sizeof(float) * influenceCount * vertexCount);
+    float *packedPositions = malloc(sizeof(float) * 3 * vertexCount);
+    simd_float3 *sourcePositions = malloc(sizeof(simd_float3) * vertexCount);
+    simd_float3 *sourceNormals = malloc(sizeof(simd_float3) * vertexCount);
+    for (NSInteger i = 0; i < influenceCount * vertexCount; ++i) {
+        jointValues[i] = joints[i];
+    }
+    for (NSInteger v = 0; v < vertexCount; ++v) {
+        sourcePositions[v] = (simd_float3){ drand48() * 2 - 1, drand48() * 2 - 1, drand48() * 2 - 1 };
+        sourceNormals[v] = (simd_float3){ 0, 1, 0 };
+        memcpy(packedPositions + v * 3, &sourcePositions[v], sizeof(float) * 3);
+    }
+    GLTFSubmesh *submesh = [self submeshWithVertexCount:vertexCount positions:packedPositions joints:jointValues
+                                                weights:weights influenceCount:influenceCount];
+    GLTFSkinningEvaluator *evaluator = [[GLTFSkinningEvaluator alloc] initWithSubmesh:submesh];
+    XCTAssertEqual(evaluator.influenceCount, influenceCount);
+    XCTAssertEqual(evaluator.vertexCount, vertexCount);
+    
+    GLTFSkinningVertices vertices = {
+        .joints = joints,
+        .weights = weights,
+        .influenceCount = influenceCount,
+        .positions = sourcePositions,
+        .normals = sourceNormals,
+    };
+    simd_float3 *expectedPositions = malloc(sizeof(simd_float3) * vertexCount);
+    simd_float3 *expectedNormals = malloc(sizeof(simd_float3) * vertexCount);
+    GLTFTestReferenceSkin(&vertices, vertexCount, jointMatrices, jointCount, expectedPositions, expectedNormals);
+    
+    simd_float3 *positions = malloc(sizeof(simd_float3) * vertexCount);
+    [evaluator skinWithJointMatrices:jointMatrices jointCount:jointCount positions:positions normals:NULL tangents:NULL];
+    for (NSInteger v = 0; v < vertexCount; ++v) {
+        XCTAssertLessThanOrEqual(simd_distance(positions[v], expectedPositions[v]), 1e-4f);
+    }
+    
+    free(joints);
+    free(weights);
+    free(jointValues);
+    free(packedPositions);
+    free(sourcePositions);
+    free(sourceNormals);
+    free(expectedPositions);
+    free(expectedNormals);
+    free(positions);
+}
+
+- (void)testSkinningPerformance {
+    const NSInteger vertexCount = 100000;
+    const int influenceCount = 4;
+    const NSInteger jointCount = 64;
+    simd_float4x4 *jointMatrices = malloc(sizeof(simd_float4x4) * jointCount);
+    for (NSInteger j = 0; j < jointCount; ++j) {
+        jointMatrices[j] = GLTFTestRandomJointMatrix();
+    }
+    uint16_t *joints = malloc(sizeof(uint16_t) * influenceCount * vertexCount);
+    float *weights = malloc(sizeof(float) * influenceCount * vertexCount);
+    GLTFTestRandomInfluences(joints, weights, influenceCount, vertexCount, jointCount);
+    simd_float3 *sourcePositions = malloc(sizeof(simd_float3) * vertexCount);
+    simd_float3 *sourceNormals = malloc(sizeof(simd_float3) * vertexCount);
+    for (NSInteger v = 0; v < vertexCount; ++v) {
+        sourcePositions[v] = (simd_float3){ drand48(), drand48(), drand48() };
+        sourceNormals[v] = (simd_float3){ 0, 0, 1 };
+    }
+    GLTFSkinningVertices vertices = {
+        .joints = joints,
+        .weights = weights,
+        .influenceCount = influenceCount,
+        .positions = sourcePositions,
+        .normals = sourceNormals,
+    };
+    simd_float3 *positions = malloc(sizeof(simd_float3) * vertexCount);
+    simd_float3 *normals = malloc(sizeof(simd_float3) * vertexCount);
+    
+    [self measureBlock:^{
+        GLTFSkinVertices(&vertices, 0, vertexCount, jointMatrices, jointCount, positions, normals, NULL);
+    }];
+    
+    free(jointMatrices);
+    free(joints);
+    free(weights);
+    free(sourcePositions);
+    free(sourceNormals);
+    free(positions);
+    free(normals);
+}
+
+@end
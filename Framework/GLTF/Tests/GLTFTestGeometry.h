@@ -0,0 +1,64 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import <GLTF/GLTF.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+// Holds the buffers, views and accessors behind an in-memory triangle submesh,
+// since submeshes and accessors only reference them weakly
+@interface GLTFTestGeometry : NSObject
+
+@property (nonatomic, readonly) GLTFSubmesh *submesh;
+@property (nonatomic, readonly) GLTFAccessor *positionAccessor;
+@property (nonatomic, readonly) GLTFAccessor *indexAccessor;
+
+// Positions are three floats per vertex; indices are three per triangle. If `setsValueRange` is NO,
+// the position accessor's min and max are left zero, as they are in files that omit them.
+- (instancetype)initWithPositions:(const float *)positions
+                      vertexCount:(NSInteger)vertexCount
+                          indices:(const uint32_t *)indices
+                       indexCount:(NSInteger)indexCount
+                    setsValueRange:(BOOL)setsValueRange;
+
+// A `resolution` x `resolution` grid of quads in the XZ plane spanning [-1, 1], with a smooth bump in Y
++ (instancetype)gridWithResolution:(NSInteger)resolution;
+
+@end
+
+// Creates float accessors over in-memory buffers and keeps them alive for as long as the pool
+@interface GLTFTestAccessorPool : NSObject
+- (GLTFAccessor *)accessorWithFloats:(const float *)values count:(NSInteger)count dimension:(GLTFDataDimension)dimension;
+// A linearly interpolated sampler over `keyCount` keyframes. Morph weights are `valueCount` scalars, keyCount
+// times the number of targets; other paths have one value of `dimension` per key.
+- (GLTFAnimationSampler *)samplerWithTimes:(const float *)times
+                                  keyCount:(NSInteger)keyCount
+                                    values:(const float *)values
+                                valueCount:(NSInteger)valueCount
+                                 dimension:(GLTFDataDimension)dimension;
+@end
+
+// A node hierarchy of `count` translated and rotated nodes, where node i is the child of node (i - 1) / fanout
+extern NSArray<GLTFNode *> *GLTFTestMakeNodeTree(NSInteger count, NSInteger fanout);
+
+extern BOOL GLTFTestMatricesEqual(simd_float4x4 a, simd_float4x4 b, float tolerance);
+
+// Loads glTF JSON through a temporary file, with `bufferContents` embedded as its only buffer. Buffer views
+// refer to it as buffer 0; "asset" and "buffers" are filled in.
+extern GLTFAsset * _Nullable GLTFTestLoadAsset(NSDictionary *json, NSData *bufferContents);
+
+NS_ASSUME_NONNULL_END
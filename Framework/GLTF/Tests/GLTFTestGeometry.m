@@ -0,0 +1,206 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFTestGeometry.h"
+
+@interface GLTFTestGeometry ()
+@property (nonatomic, strong) id<GLTFBuffer> vertexBuffer;
+@property (nonatomic, strong) id<GLTFBuffer> indexBuffer;
+@property (nonatomic, strong) GLTFBufferView *vertexBufferView;
+@property (nonatomic, strong) GLTFBufferView *indexBufferView;
+@end
+
+@implementation GLTFTestGeometry
+
+- (instancetype)initWithPositions:(const float *)positions
+                      vertexCount:(NSInteger)vertexCount
+                          indices:(const uint32_t *)indices
+                       indexCount:(NSInteger)indexCount
+                    setsValueRange:(BOOL)setsValueRange
+{
+    if ((self = [super init])) {
+        GLTFDefaultBufferAllocator *allocator = [GLTFDefaultBufferAllocator new];
+
+        _vertexBuffer = [allocator newBufferWithData:[NSData dataWithBytes:positions length:vertexCount * 3 * sizeof(float)]];
+        _vertexBufferView = [GLTFBufferView new];
+        _vertexBufferView.buffer = _vertexBuffer;
+        _vertexBufferView.target = GLTFTargetArrayBuffer;
+        _vertexBufferView.length = _vertexBuffer.length;
+
+        _indexBuffer = [allocator newBufferWithData:[NSData dataWithBytes:indices length:indexCount * sizeof(uint32_t)]];
+        _indexBufferView = [GLTFBufferView new];
+        _indexBufferView.buffer = _indexBuffer;
+        _indexBufferView.target = GLTFTargetElementArrayBuffer;
+        _indexBufferView.length = _indexBuffer.length;
+
+        _positionAccessor = [GLTFAccessor new];
+        _positionAccessor.bufferView = _vertexBufferView;
+        _positionAccessor.componentType = GLTFDataTypeFloat;
+        _positionAccessor.dimension = GLTFDataDimensionVector3;
+        _positionAccessor.count = vertexCount;
+        if (setsValueRange) {
+            GLTFValueRange range = { 0 };
+            for (int c = 0; c < 3; ++c) {
+                range.minValue[c] = FLT_MAX;
+                range.maxValue[c] = -FLT_MAX;
+            }
+            for (NSInteger v = 0; v < vertexCount; ++v) {
+                for (int c = 0; c < 3; ++c) {
+                    range.minValue[c] = fminf(range.minValue[c], positions[v * 3 + c]);
+                    range.maxValue[c] = fmaxf(range.maxValue[c], positions[v * 3 + c]);
+                }
+            }
+            _positionAccessor.valueRange = range;
+        }
+
+        _indexAccessor = [GLTFAccessor new];
+        _indexAccessor.bufferView = _indexBufferView;
+        _indexAccessor.componentType = GLTFDataTypeUInt;
+        _indexAccessor.dimension = GLTFDataDimensionScalar;
+        _indexAccessor.count = indexCount;
+
+        _submesh = [GLTFSubmesh new];
+        _submesh.primitiveType = GLTFPrimitiveTypeTriangles;
+        _submesh.accessorsForAttributes = @{ GLTFAttributeSemanticPosition : _positionAccessor };
+        _submesh.indexAccessor = _indexAccessor;
+    }
+    return self;
+}
+
++ (instancetype)gridWithResolution:(NSInteger)resolution {
+    NSInteger side = resolution + 1;
+    float *positions = malloc(side * side * 3 * sizeof(float));
+    uint32_t *indices = malloc(resolution * resolution * 6 * sizeof(uint32_t));
+    for (NSInteger z = 0; z < side; ++z) {
+        for (NSInteger x = 0; x < side; ++x) {
+            float u = (x / (float)resolution) * 2 - 1;
+            float v = (z / (float)resolution) * 2 - 1;
+            float *p = positions + (z * side + x) * 3;
+            p[0] = u;
+            p[1] = 0.25f * expf(-4 * (u * u + v * v));
+            p[2] = v;
+        }
+    }
+    uint32_t *i = indices;
+    for (NSInteger z = 0; z < resolution; ++z) {
+        for (NSInteger x = 0; x < resolution; ++x) {
+            uint32_t a = (uint32_t)(z * side + x), b = a + 1, c = a + (uint32_t)side, d = c + 1;
+            *i++ = a; *i++ = c; *i++ = b;
+            *i++ = b; *i++ = c; *i++ = d;
+        }
+    }
+    GLTFTestGeometry *geometry = [[self alloc] initWithPositions:positions
+                                                     vertexCount:side * side
+                                                         indices:indices
+                                                      indexCount:resolution * resolution * 6
+                                                   setsValueRange:YES];
+    free(positions);
+    free(indices);
+    return geometry;
+}
+
+@end
+
+@interface GLTFTestAccessorPool ()
+@property (nonatomic, strong) NSMutableArray *objects;
+@end
+
+@implementation GLTFTestAccessorPool
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        _objects = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (GLTFAccessor *)accessorWithFloats:(const float *)values count:(NSInteger)count dimension:(GLTFDataDimension)dimension {
+    NSInteger length = count * GLTFComponentCountForDimension(dimension) * sizeof(float);
+    id<GLTFBuffer> buffer = [[GLTFDefaultBufferAllocator new] newBufferWithData:[NSData dataWithBytes:values length:length]];
+    GLTFBufferView *bufferView = [GLTFBufferView new];
+    bufferView.buffer = buffer;
+    bufferView.length = length;
+    GLTFAccessor *accessor = [GLTFAccessor new];
+    accessor.bufferView = bufferView;
+    accessor.componentType = GLTFDataTypeFloat;
+    accessor.dimension = dimension;
+    accessor.count = count;
+    [_objects addObjectsFromArray:@[ buffer, bufferView, accessor ]];
+    return accessor;
+}
+
+- (GLTFAnimationSampler *)samplerWithTimes:(const float *)times
+                                  keyCount:(NSInteger)keyCount
+                                    values:(const float *)values
+                                valueCount:(NSInteger)valueCount
+                                 dimension:(GLTFDataDimension)dimension
+{
+    GLTFAnimationSampler *sampler = [GLTFAnimationSampler new];
+    sampler.inputAccessor = [self accessorWithFloats:times count:keyCount dimension:GLTFDataDimensionScalar];
+    sampler.outputAccessor = [self accessorWithFloats:values count:valueCount dimension:dimension];
+    sampler.interpolationMode = GLTFInterpolationModeLinear;
+    [_objects addObject:sampler];
+    return sampler;
+}
+
+@end
+
+NSArray<GLTFNode *> *GLTFTestMakeNodeTree(NSInteger count, NSInteger fanout) {
+    NSMutableArray<GLTFNode *> *nodes = [NSMutableArray arrayWithCapacity:count];
+    NSMutableArray<NSMutableArray<GLTFNode *> *> *children = [NSMutableArray arrayWithCapacity:count];
+    for (NSInteger i = 0; i < count; ++i) {
+        GLTFNode *node = [GLTFNode new];
+        node.translation = (simd_float3){ (i % 7) - 3.0f, (i % 5) * 0.5f, (i % 3) - 1.0f };
+        node.rotationQuaternion = simd_quaternion((float)(i % 11) * 0.1f, simd_normalize((simd_float3){ 1, (float)(i % 4), 0.5f }));
+        node.scale = (simd_float3){ 1.0f, 1.0f, 1.0f };
+        [nodes addObject:node];
+        [children addObject:[NSMutableArray array]];
+        if (i > 0) {
+            NSInteger parentIndex = (i - 1) / fanout;
+            node.parent = nodes[parentIndex];
+            [children[parentIndex] addObject:node];
+        }
+    }
+    for (NSInteger i = 0; i < count; ++i) {
+        nodes[i].children = children[i];
+    }
+    return nodes;
+}
+
+BOOL GLTFTestMatricesEqual(simd_float4x4 a, simd_float4x4 b, float tolerance) {
+    for (int c = 0; c < 4; ++c) {
+        simd_float4 d = simd_abs(a.columns[c] - b.columns[c]);
+        if (simd_reduce_max(d) > tolerance) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+GLTFAsset *GLTFTestLoadAsset(NSDictionary *json, NSData *bufferContents) {
+    NSMutableDictionary *document = [json mutableCopy];
+    NSString *uri = [@"data:application/octet-stream;base64," stringByAppendingString:[bufferContents base64EncodedStringWithOptions:0]];
+    document[@"asset"] = @{ @"version" : @"2.0" };
+    document[@"buffers"] = @[ @{ @"byteLength" : @(bufferContents.length), @"uri" : uri } ];
+    
+    NSURL *url = [[NSURL fileURLWithPath:NSTemporaryDirectory() isDirectory:YES] URLByAppendingPathComponent:[NSUUID UUID].UUIDString];
+    url = [url URLByAppendingPathExtension:@"gltf"];
+    [[NSJSONSerialization dataWithJSONObject:document options:0 error:nil] writeToURL:url atomically:YES];
+    GLTFAsset *asset = [[GLTFAsset alloc] initWithURL:url bufferAllocator:[GLTFDefaultBufferAllocator new]];
+    [[NSFileManager defaultManager] removeItemAtURL:url error:nil];
+    return asset;
+}
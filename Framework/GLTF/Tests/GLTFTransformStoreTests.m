@@ -0,0 +1,119 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFTestGeometry.h"
+
+@import XCTest;
+
+@interface GLTFTransformStoreTests : XCTestCase
+@end
+
+@implementation GLTFTransformStoreTests
+
+static simd_float4x4 GLTFTestRecursiveWorldTransform(GLTFNode *node) {
+    simd_float4x4 parentTransform = node.parent ? GLTFTestRecursiveWorldTransform(node.parent) : matrix_identity_float4x4;
+    return matrix_multiply(parentTransform, node.localTransform);
+}
+
+- (void)testUnboundStoreMatchesRecursiveWorldTransforms {
+    NSArray<GLTFNode *> *nodes = GLTFTestMakeNodeTree(500, 3);
+    GLTFScene *scene = [GLTFScene new];
+    scene.nodes = @[ nodes.firstObject ];
+
+    GLTFTransformStore *store = [[GLTFTransformStore alloc] initWithScene:scene bindingNodes:NO];
+    [store updateWorldTransforms];
+    XCTAssertEqual(store.nodeCount, (NSInteger)nodes.count);
+    for (GLTFNode *node in nodes) {
+        NSInteger index = [store indexOfNode:node];
+        XCTAssertGreaterThanOrEqual(index, 0);
+        if (node.parent != nil) {
+            XCTAssertLessThan(store.parentIndices[index], index);
+        }
+        XCTAssertTrue(GLTFTestMatricesEqual(store.worldTransforms[index], node.globalTransform, 1e-4f));
+    }
+}
+
+- (void)testBoundStoreTracksNodeSetters {
+    NSArray<GLTFNode *> *nodes = GLTFTestMakeNodeTree(200, 2);
+    GLTFScene *scene = [GLTFScene new];
+    scene.nodes = @[ nodes.firstObject ];
+    scene.transformStore = [[GLTFTransformStore alloc] initWithScene:scene];
+
+    // Move a few interior nodes after binding, so only their subtrees need updating
+    for (NSInteger i = 1; i < (NSInteger)nodes.count; i += 17) {
+        nodes[i].translation += (simd_float3){ 0.5f, -1, 2 };
+        nodes[i].scale = (simd_float3){ 1.5f, 1.5f, 1.5f };
+    }
+    for (GLTFNode *node in nodes) {
+        XCTAssertTrue(GLTFTestMatricesEqual(node.globalTransform, GLTFTestRecursiveWorldTransform(node), 1e-4f));
+    }
+}
+
+- (void)testConcurrentQueriesAfterChanges {
+    NSArray<GLTFNode *> *nodes = GLTFTestMakeNodeTree(2000, 3);
+    GLTFScene *scene = [GLTFScene new];
+    scene.nodes = @[ nodes.firstObject ];
+    scene.transformStore = [[GLTFTransformStore alloc] initWithScene:scene];
+
+    // Leave the store out of date, so that the first of the concurrent queries has to update it
+    for (NSInteger i = 0; i < (NSInteger)nodes.count; i += 7) {
+        nodes[i].translation += (simd_float3){ 0, 1, 0 };
+    }
+    NSInteger nodeCount = nodes.count;
+    simd_float4x4 *expected = malloc(sizeof(simd_float4x4) * nodeCount);
+    simd_float4x4 *actual = malloc(sizeof(simd_float4x4) * nodeCount);
+    for (NSInteger i = 0; i < nodeCount; ++i) {
+        expected[i] = GLTFTestRecursiveWorldTransform(nodes[i]);
+    }
+
+    dispatch_apply(nodeCount, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t i) {
+        actual[i] = nodes[i].globalTransform;
+    });
+    for (NSInteger i = 0; i < nodeCount; ++i) {
+        XCTAssertTrue(GLTFTestMatricesEqual(actual[i], expected[i], 1e-4f), @"Node %d", (int)i);
+    }
+    free(actual);
+    free(expected);
+}
+
+- (void)testUpdateAndQueryPerformance {
+    NSArray<GLTFNode *> *nodes = GLTFTestMakeNodeTree(20000, 4);
+    GLTFScene *scene = [GLTFScene new];
+    scene.nodes = @[ nodes.firstObject ];
+    scene.transformStore = [[GLTFTransformStore alloc] initWithScene:scene];
+    GLTFTransformStore *store = scene.transformStore;
+    [store updateWorldTransforms];
+
+    // A frame's worth of animation on a few percent of the nodes, one update, then a query per node
+    __block float offset = 0;
+    [self measureBlock:^{
+        for (int frame = 0; frame < 10; ++frame) {
+            offset += 0.01f;
+            for (NSInteger i = 0; i < (NSInteger)nodes.count; i += 31) {
+                nodes[i].translation = (simd_float3){ offset, 0, 0 };
+            }
+            [store updateWorldTransforms];
+            simd_float4x4 sum = { 0 };
+            for (GLTFNode *node in nodes) {
+                sum.columns[3] += node.globalTransform.columns[3];
+            }
+            XCTAssertFalse(isnan(sum.columns[3].x));
+        }
+    }];
+}
+
+@end
@@ -29,8 +29,11 @@ FOUNDATION_EXPORT double GLTFMTLVersionNumber;
 FOUNDATION_EXPORT const unsigned char GLTFMTLVersionString[];
 
 #import <GLTFMTL/GLTFMTLBufferAllocator.h>
+#import <GLTFMTL/GLTFMTLDrawCommandBackend.h>
 #import <GLTFMTL/GLTFMTLTextureLoader.h>
 #import <GLTFMTL/GLTFMTLLightingEnvironment.h>
+#import <GLTFMTL/GLTFMTLPipelineKey.h>
 #import <GLTFMTL/GLTFMTLRenderer.h>
 #import <GLTFMTL/GLTFMTLShaderBuilder.h>
+#import <GLTFMTL/GLTFMTLShaderCache.h>
 #import <GLTFMTL/GLTFMTLUtilities.h>
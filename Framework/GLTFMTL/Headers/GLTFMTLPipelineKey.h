@@ -0,0 +1,62 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import <GLTF/GLTF.h>
+
+@import Foundation;
+@import Metal;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class GLTFMTLLightingEnvironment;
+
+// Everything that decides which render pipeline a submesh is drawn with: the shader feature #defines, the vertex
+// layout, blending and the attachment formats. Submeshes with equal keys can share a pipeline. Keys compare by a
+// canonical description of those things, whose hash is the same from one launch to the next.
+@interface GLTFMTLPipelineKey : NSObject <NSCopying>
+
+- (instancetype)initWithSubmesh:(GLTFSubmesh *)submesh
+            lightingEnvironment:(GLTFMTLLightingEnvironment * _Nullable)lightingEnvironment
+               colorPixelFormat:(MTLPixelFormat)colorPixelFormat
+        depthStencilPixelFormat:(MTLPixelFormat)depthStencilPixelFormat
+                    sampleCount:(int)sampleCount;
+
+// The distinct keys needed to draw the submeshes reachable from the asset's scenes, in the order first reached
++ (NSArray<GLTFMTLPipelineKey *> *)pipelineKeysForAsset:(GLTFAsset *)asset
+                                    lightingEnvironment:(GLTFMTLLightingEnvironment * _Nullable)lightingEnvironment
+                                       colorPixelFormat:(MTLPixelFormat)colorPixelFormat
+                                depthStencilPixelFormat:(MTLPixelFormat)depthStencilPixelFormat
+                                            sampleCount:(int)sampleCount;
+
+@property (nonatomic, readonly) NSString *featureDefines;
+@property (nonatomic, readonly) NSString *vertexInputDeclaration;
+@property (nonatomic, readonly) BOOL blendingEnabled;
+@property (nonatomic, readonly) MTLPixelFormat colorPixelFormat;
+@property (nonatomic, readonly) MTLPixelFormat depthStencilPixelFormat;
+@property (nonatomic, readonly) int sampleCount;
+
+// Not part of the key's identity; equal keys have equivalent vertex descriptors
+@property (nonatomic, readonly) MTLVertexDescriptor *vertexDescriptor;
+
+@property (nonatomic, readonly) NSString *canonicalDescription;
+
+// 64-bit FNV-1a hash of the canonical description
+@property (nonatomic, readonly) uint64_t keyHash;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -23,6 +23,12 @@ NS_ASSUME_NONNULL_BEGIN
 #define GLTFMTLRendererMaxInflightFrames 3
 
 @class GLTFMTLLightingEnvironment;
+@class GLTFMTLShaderCache;
+
+typedef struct {
+    NSInteger hitCount;  // submeshes given a pipeline already built for an equal key
+    NSInteger missCount; // pipelines built
+} GLTFMTLPipelineCacheStatistics;
 
 @interface GLTFMTLRenderer : NSObject
 
@@ -37,12 +43,54 @@ NS_ASSUME_NONNULL_BEGIN
 
 @property (nonatomic, strong) GLTFMTLLightingEnvironment * _Nullable lightingEnvironment;
 
+// The largest on-screen deviation, in pixels, tolerated when choosing a simplified level of detail
+@property (nonatomic, assign) float levelOfDetailPixelError;
+
+// Wraps each draw in a debug group named after its node and primitive, for frame captures; disabled by default
+@property (nonatomic, assign) BOOL debugLabelsEnabled;
+
+// Skips submeshes whose bounds lie outside the view frustum, posed for skinned and morphed meshes, and whole subtrees
+// of nodes with none inside it; enabled by default
+@property (nonatomic, assign) BOOL frustumCullingEnabled;
+
+// Hides submeshes behind large opaque occluders, found with a small software depth buffer; disabled by default
+@property (nonatomic, assign) BOOL occlusionCullingEnabled;
+
+// Opaque submeshes covering at least this fraction of the viewport height are used as occluders (default 0.2)
+@property (nonatomic, assign) float occluderScreenCoverage;
+
+// Nodes whose opaque submeshes are used as occluders however small they appear
+@property (nonatomic, copy) NSSet<GLTFNode *> *occluderNodes;
+
+// Submeshes drawn and culled in the last frame, and the bounds tested to decide
+@property (nonatomic, readonly, assign) GLTFCullingStatistics cullingStatistics;
+
+// Pipelines found for submeshes that hadn't been drawn before: shared with an earlier submesh, or newly built
+@property (nonatomic, readonly, assign) GLTFMTLPipelineCacheStatistics pipelineCacheStatistics;
+
+// Draws and state changes sent in the last frame, and how many redundant state changes were left out
+@property (nonatomic, readonly, assign) GLTFDrawCommandStatistics drawCommandStatistics;
+
+// Where shader variants are kept between launches; defaults to a cache in the default directory, nil disables it.
+// Variants built while drawing are written out in the background after the frame that needed them.
+@property (nonatomic, strong, nullable) GLTFMTLShaderCache *shaderCache;
+
 - (instancetype)initWithDevice:(id<MTLDevice>)device;
 
+// Builds the pipelines needed to draw the asset with the current lighting environment and attachment formats on
+// background threads, so that they are ready before it is first drawn, and writes the shader cache to disk. The
+// completion handler is called on the main queue with the number of pipelines built.
+- (void)precompilePipelinesForAsset:(GLTFAsset *)asset completionHandler:(void (^ _Nullable)(NSInteger compiledCount))completionHandler;
+
 - (void)renderScene:(GLTFScene *)scene
       commandBuffer:(id<MTLCommandBuffer>)commandBuffer
      commandEncoder:(id<MTLRenderCommandEncoder>)renderEncoder;
 
+// Draws each instance in the pose held by its transform store, placed by its root transform
+- (void)renderSceneInstances:(NSArray<GLTFSceneInstance *> *)instances
+               commandBuffer:(id<MTLCommandBuffer>)commandBuffer
+              commandEncoder:(id<MTLRenderCommandEncoder>)renderEncoder;
+
 - (void)signalFrameCompletion;
 
 @end
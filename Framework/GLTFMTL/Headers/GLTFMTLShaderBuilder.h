@@ -27,9 +27,34 @@
 NS_ASSUME_NONNULL_BEGIN
 
 @class GLTFMTLLightingEnvironment;
+@class GLTFMTLPipelineKey;
+@class GLTFMTLShaderCache;
 
 @interface GLTFMTLShaderBuilder : NSObject
 
+// The contents of pbr.metal from the main bundle, read the first time it's needed
+@property (nonatomic, readonly, nullable) NSString *shaderTemplate;
+
+// Stable hash of the shader template, identifying the variants generated from it
+@property (nonatomic, readonly) uint64_t shaderTemplateHash;
+
+// Where generated sources and compiled functions are kept between launches, if anywhere
+@property (atomic, strong, nullable) GLTFMTLShaderCache *shaderCache;
+
+// The #defines that select the shader features a submesh needs, in a fixed order
++ (NSString *)featureDefinesForSubmesh:(GLTFSubmesh *)submesh lightingEnvironment:(GLTFMTLLightingEnvironment * _Nullable)lightingEnvironment;
+
+// The declaration of the vertex shader's input struct for a submesh's vertex layout
++ (NSString *)vertexInputDeclarationForSubmesh:(GLTFSubmesh *)submesh;
+
++ (MTLVertexDescriptor *)vertexDescriptorForSubmesh:(GLTFSubmesh *)submesh;
+
+// The shader template with the key's declarations substituted in, or nil if the template couldn't be read
+- (NSString * _Nullable)sourceForPipelineKey:(GLTFMTLPipelineKey *)key;
+
+// Safe to call from several threads at once
+- (id<MTLRenderPipelineState> _Nullable)renderPipelineStateForPipelineKey:(GLTFMTLPipelineKey *)key device:(id<MTLDevice>)device;
+
 - (id<MTLRenderPipelineState>)renderPipelineStateForSubmesh:(GLTFSubmesh *)submesh
                                         lightingEnvironment:(GLTFMTLLightingEnvironment * _Nullable)lightingEnvironment
                                            colorPixelFormat:(MTLPixelFormat)colorPixelFormat
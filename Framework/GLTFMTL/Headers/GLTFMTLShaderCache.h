@@ -0,0 +1,59 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+@import Foundation;
+@import Metal;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class GLTFMTLPipelineKey;
+
+// Keeps shader variants between launches. Generated sources are stored per pipeline key, with the key's canonical
+// description so that keys whose hashes collide never share a source. Where Metal binary archives are available,
+// compiled pipeline functions are stored per device. Entries are grouped by the hash of
+// the shader template they came from, so that editing the template leaves old entries unused rather than stale.
+// Safe to use from several threads at once.
+@interface GLTFMTLShaderCache : NSObject
+
+// A directory in the user's caches directory
++ (NSURL *)defaultDirectoryURL;
+
+- (instancetype)initWithDirectoryURL:(NSURL *)directoryURL;
+
+@property (nonatomic, readonly) NSURL *directoryURL;
+
+- (NSString * _Nullable)sourceForPipelineKey:(GLTFMTLPipelineKey *)key templateHash:(uint64_t)templateHash;
+
+- (void)storeSource:(NSString *)source forPipelineKey:(GLTFMTLPipelineKey *)key templateHash:(uint64_t)templateHash;
+
+// Points the descriptor at the device's archive, if there is one, so that functions compiled in earlier launches
+// are reused. Call before creating a pipeline state from the descriptor.
+- (void)prepareRenderPipelineDescriptor:(MTLRenderPipelineDescriptor *)descriptor
+                                 device:(id<MTLDevice>)device
+                           templateHash:(uint64_t)templateHash;
+
+// Adds a prepared descriptor's compiled functions to its archive; call once its pipeline has been created
+- (void)addRenderPipelineDescriptor:(MTLRenderPipelineDescriptor *)descriptor;
+
+// Writes archives that have had functions added to disk
+- (void)synchronize;
+
+- (void)removeAllEntries;
+
+@end
+
+NS_ASSUME_NONNULL_END
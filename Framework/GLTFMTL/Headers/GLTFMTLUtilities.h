@@ -54,4 +54,7 @@ extern NSString *GLTFMTLTypeNameForType(GLTFDataType baseType, GLTFDataDimension
 
 extern MTLVertexFormat GLTFMTLVertexFormatForComponentTypeAndDimension(GLTFDataType baseType, GLTFDataDimension dimension);
 
+// 64-bit FNV-1a hash of a string's UTF-8 bytes, which unlike -hash is the same from one launch to the next
+extern uint64_t GLTFMTLStableHashForString(NSString *string);
+
 NS_ASSUME_NONNULL_END
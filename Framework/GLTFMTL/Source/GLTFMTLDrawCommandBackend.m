@@ -0,0 +1,108 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFMTLDrawCommandBackend.h"
+#import "GLTFMTLUtilities.h"
+
+static MTLCullMode GLTFMTLCullModeForCullMode(GLTFDrawCullMode cullMode) {
+    switch (cullMode) {
+        case GLTFDrawCullModeFront:
+            return MTLCullModeFront;
+        case GLTFDrawCullModeBack:
+            return MTLCullModeBack;
+        default:
+            return MTLCullModeNone;
+    }
+}
+
+@implementation GLTFMTLDrawCommandBackend
+
+- (instancetype)initWithRenderCommandEncoder:(id<MTLRenderCommandEncoder>)renderCommandEncoder {
+    if ((self = [super init])) {
+        _renderCommandEncoder = renderCommandEncoder;
+    }
+    return self;
+}
+
+- (void)setPipelineState:(id)pipelineState {
+    [self.renderCommandEncoder setRenderPipelineState:pipelineState];
+}
+
+- (void)setDepthStencilState:(id)depthStencilState {
+    [self.renderCommandEncoder setDepthStencilState:depthStencilState];
+}
+
+- (void)setCullMode:(GLTFDrawCullMode)cullMode {
+    [self.renderCommandEncoder setCullMode:GLTFMTLCullModeForCullMode(cullMode)];
+}
+
+- (void)setFrontFacingWinding:(GLTFDrawWinding)winding {
+    [self.renderCommandEncoder setFrontFacingWinding:(winding == GLTFDrawWindingClockwise) ? MTLWindingClockwise : MTLWindingCounterClockwise];
+}
+
+- (void)setVertexBuffer:(id)buffer offset:(NSUInteger)offset atIndex:(NSUInteger)index {
+    [self.renderCommandEncoder setVertexBuffer:buffer offset:offset atIndex:index];
+}
+
+- (void)setVertexBufferOffset:(NSUInteger)offset atIndex:(NSUInteger)index {
+    [self.renderCommandEncoder setVertexBufferOffset:offset atIndex:index];
+}
+
+- (void)setVertexBytes:(const void *)bytes length:(NSUInteger)length atIndex:(NSUInteger)index {
+    [self.renderCommandEncoder setVertexBytes:bytes length:length atIndex:index];
+}
+
+- (void)setFragmentBytes:(const void *)bytes length:(NSUInteger)length atIndex:(NSUInteger)index {
+    [self.renderCommandEncoder setFragmentBytes:bytes length:length atIndex:index];
+}
+
+- (void)setFragmentTexture:(id)texture atIndex:(NSUInteger)index {
+    [self.renderCommandEncoder setFragmentTexture:texture atIndex:index];
+}
+
+- (void)setFragmentSamplerState:(id)samplerState atIndex:(NSUInteger)index {
+    [self.renderCommandEncoder setFragmentSamplerState:samplerState atIndex:index];
+}
+
+- (void)drawPrimitives:(GLTFPrimitiveType)primitiveType vertexStart:(NSUInteger)vertexStart vertexCount:(NSUInteger)vertexCount {
+    [self.renderCommandEncoder drawPrimitives:GLTFMTLPrimitiveTypeForPrimitiveType(primitiveType)
+                                  vertexStart:vertexStart
+                                  vertexCount:vertexCount];
+}
+
+- (void)drawIndexedPrimitives:(GLTFPrimitiveType)primitiveType
+                   indexCount:(NSUInteger)indexCount
+                    indexType:(GLTFDataType)indexType
+                  indexBuffer:(id)indexBuffer
+            indexBufferOffset:(NSUInteger)indexBufferOffset
+{
+    [self.renderCommandEncoder drawIndexedPrimitives:GLTFMTLPrimitiveTypeForPrimitiveType(primitiveType)
+                                          indexCount:indexCount
+                                           indexType:(indexType == GLTFDataTypeUShort) ? MTLIndexTypeUInt16 : MTLIndexTypeUInt32
+                                         indexBuffer:indexBuffer
+                                   indexBufferOffset:indexBufferOffset];
+}
+
+- (void)pushDebugGroup:(NSString *)name {
+    [self.renderCommandEncoder pushDebugGroup:name];
+}
+
+- (void)popDebugGroup {
+    [self.renderCommandEncoder popDebugGroup];
+}
+
+@end
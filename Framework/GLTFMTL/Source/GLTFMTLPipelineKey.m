@@ -0,0 +1,134 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFMTLPipelineKey.h"
+#import "GLTFMTLShaderBuilder.h"
+#import "GLTFMTLUtilities.h"
+
+@implementation GLTFMTLPipelineKey
+
+- (instancetype)initWithSubmesh:(GLTFSubmesh *)submesh
+            lightingEnvironment:(GLTFMTLLightingEnvironment *)lightingEnvironment
+               colorPixelFormat:(MTLPixelFormat)colorPixelFormat
+        depthStencilPixelFormat:(MTLPixelFormat)depthStencilPixelFormat
+                    sampleCount:(int)sampleCount
+{
+    NSParameterAssert(submesh);
+    NSParameterAssert(submesh.material);
+    NSParameterAssert(submesh.vertexDescriptor);
+    
+    if ((self = [super init])) {
+        _featureDefines = [GLTFMTLShaderBuilder featureDefinesForSubmesh:submesh lightingEnvironment:lightingEnvironment];
+        _vertexInputDeclaration = [GLTFMTLShaderBuilder vertexInputDeclarationForSubmesh:submesh];
+        _vertexDescriptor = [GLTFMTLShaderBuilder vertexDescriptorForSubmesh:submesh];
+        _blendingEnabled = (submesh.material.alphaMode == GLTFAlphaModeBlend);
+        _colorPixelFormat = colorPixelFormat;
+        _depthStencilPixelFormat = depthStencilPixelFormat;
+        _sampleCount = sampleCount;
+        
+        // The input struct names attribute types but not the strides of the buffers they come from
+        NSMutableString *vertexLayout = [NSMutableString string];
+        GLTFVertexDescriptor *descriptor = submesh.vertexDescriptor;
+        for (NSInteger attributeIndex = 0; attributeIndex < GLTFVertexDescriptorMaxAttributeCount; ++attributeIndex) {
+            GLTFVertexAttribute *attribute = descriptor.attributes[attributeIndex];
+            if (attribute.componentType == 0) {
+                continue;
+            }
+            MTLVertexFormat format = GLTFMTLVertexFormatForComponentTypeAndDimension(attribute.componentType, attribute.dimension);
+            [vertexLayout appendFormat:@"%d:%d:%d ", (int)attributeIndex, (int)format, (int)descriptor.bufferLayouts[attributeIndex].stride];
+        }
+        
+        _canonicalDescription = [NSString stringWithFormat:@"%@%@\n// layout %@\n// blend %d color %d depth %d samples %d\n",
+                                 _featureDefines, _vertexInputDeclaration, vertexLayout, (int)_blendingEnabled,
+                                 (int)_colorPixelFormat, (int)_depthStencilPixelFormat, _sampleCount];
+        
+        _keyHash = GLTFMTLStableHashForString(_canonicalDescription);
+    }
+    return self;
+}
+
++ (NSArray<GLTFMTLPipelineKey *> *)pipelineKeysForAsset:(GLTFAsset *)asset
+                                    lightingEnvironment:(GLTFMTLLightingEnvironment *)lightingEnvironment
+                                       colorPixelFormat:(MTLPixelFormat)colorPixelFormat
+                                depthStencilPixelFormat:(MTLPixelFormat)depthStencilPixelFormat
+                                            sampleCount:(int)sampleCount
+{
+    NSMutableOrderedSet<GLTFMTLPipelineKey *> *keys = [NSMutableOrderedSet orderedSet];
+    NSHashTable<GLTFMesh *> *visitedMeshes = [NSHashTable weakObjectsHashTable];
+    NSHashTable<GLTFNode *> *visitedNodes = [NSHashTable weakObjectsHashTable];
+    NSMutableArray<GLTFNode *> *pendingNodes = [NSMutableArray array];
+    for (GLTFScene *scene in asset.scenes) {
+        [pendingNodes addObjectsFromArray:scene.nodes];
+    }
+    
+    while (pendingNodes.count > 0) {
+        GLTFNode *node = pendingNodes.lastObject;
+        [pendingNodes removeLastObject];
+        if ([visitedNodes containsObject:node]) {
+            continue;
+        }
+        [visitedNodes addObject:node];
+        
+        // Level of detail alternatives aren't necessarily part of the hierarchy
+        [pendingNodes addObjectsFromArray:node.children];
+        [pendingNodes addObjectsFromArray:node.levelOfDetailNodes];
+        
+        GLTFMesh *mesh = node.mesh;
+        if (mesh == nil || [visitedMeshes containsObject:mesh]) {
+            continue;
+        }
+        [visitedMeshes addObject:mesh];
+        
+        for (GLTFSubmesh *submesh in mesh.submeshes) {
+            if (submesh.material == nil || submesh.vertexDescriptor == nil) {
+                continue;
+            }
+            [keys addObject:[[GLTFMTLPipelineKey alloc] initWithSubmesh:submesh
+                                                    lightingEnvironment:lightingEnvironment
+                                                       colorPixelFormat:colorPixelFormat
+                                                depthStencilPixelFormat:depthStencilPixelFormat
+                                                            sampleCount:sampleCount]];
+        }
+    }
+    
+    return keys.array;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self;
+}
+
+- (NSUInteger)hash {
+    return (NSUInteger)_keyHash;
+}
+
+- (BOOL)isEqual:(id)object {
+    if (object == self) {
+        return YES;
+    }
+    if (![object isKindOfClass:[GLTFMTLPipelineKey class]]) {
+        return NO;
+    }
+    GLTFMTLPipelineKey *other = object;
+    return other.keyHash == _keyHash && [other.canonicalDescription isEqualToString:_canonicalDescription];
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p; hash = %016llx>", NSStringFromClass([self class]), self, _keyHash];
+}
+
+@end
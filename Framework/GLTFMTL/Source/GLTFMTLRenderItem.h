@@ -0,0 +1,139 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+#import "GLTFMTLShaderBuilder.h"
+
+@import simd;
+
+// Private to the framework: the renderer's per-frame draw list, in a header of its own so that it can be tested
+// without a device
+
+typedef struct {
+    simd_float4x4 modelMatrix;
+    simd_float4x4 modelViewProjectionMatrix;
+    simd_float4x4 normalMatrix;
+} VertexUniforms;
+
+typedef struct {
+    simd_float4 position;
+    simd_float4 color;
+    float intensity;
+    float innerConeAngle;
+    float outerConeAngle;
+    float range;
+    simd_float4 spotDirection;
+} Light;
+
+typedef struct {
+    float normalScale;
+    simd_float3 emissiveFactor;
+    float occlusionStrength;
+    simd_float2 metallicRoughnessValues;
+    simd_float4 baseColorFactor;
+    simd_float3 camera;
+    float alphaCutoff;
+    float envIntensity;
+    Light ambientLight;
+    Light lights[GLTFMTLMaximumLightCount];
+    simd_float3x3 textureMatrices[GLTFMTLMaximumTextureCount];
+} FragmentUniforms;
+
+// Everything needed to draw one submesh. Items only live until the end of the frame that built them, so they
+// don't retain the objects they refer to, which the scenes being drawn own.
+typedef struct {
+    __unsafe_unretained GLTFNode *node;
+    __unsafe_unretained GLTFSceneInstance *instance;
+    __unsafe_unretained GLTFSubmesh *submesh;
+    __unsafe_unretained GLTFAccessor *indexAccessor;
+    __unsafe_unretained id<MTLRenderPipelineState> renderPipelineState;
+    uint64_t sortKey;
+    GLTFBoundingBox localBounds; // in the space of the model matrix, following the pose of deformable meshes
+    BOOL isOccluder; // rasterized into this frame's occlusion buffer, so never tested against it
+    VertexUniforms vertexUniforms;
+    FragmentUniforms fragmentUniforms;
+} GLTFMTLRenderItem;
+
+// Render items are built in place in storage that is emptied, but kept, at the end of every frame, so that
+// building a frame's render lists doesn't allocate once the arena has grown to fit the scene
+typedef struct {
+    GLTFMTLRenderItem *items;
+    NSInteger count;
+    NSInteger capacity;
+} GLTFMTLRenderItemArena;
+
+// The returned item is only valid until the next append
+static inline GLTFMTLRenderItem *GLTFMTLRenderItemArenaAppend(GLTFMTLRenderItemArena *arena) {
+    if (arena->count == arena->capacity) {
+        arena->capacity = MAX(arena->capacity * 2, 64);
+        arena->items = realloc(arena->items, sizeof(GLTFMTLRenderItem) * arena->capacity);
+    }
+    return &arena->items[arena->count++];
+}
+
+// Empties the arena for the next frame without giving up its storage
+static inline void GLTFMTLRenderItemArenaReset(GLTFMTLRenderItemArena *arena) {
+    arena->count = 0;
+}
+
+static inline void GLTFMTLRenderItemArenaFree(GLTFMTLRenderItemArena *arena) {
+    free(arena->items);
+    *arena = (GLTFMTLRenderItemArena){ 0 };
+}
+
+// Working space for sorting an arena by key, kept between frames like the arenas themselves
+typedef struct {
+    uint64_t *keys;
+    uint64_t *scratchKeys;
+    uint32_t *indices;
+    uint32_t *scratchIndices;
+    GLTFMTLRenderItem *items;
+    NSInteger capacity;
+} GLTFMTLRenderItemSortBuffer;
+
+static inline void GLTFMTLRenderItemArenaSort(GLTFMTLRenderItemArena *arena, GLTFMTLRenderItemSortBuffer *sortBuffer) {
+    NSInteger count = arena->count;
+    if (count < 2) {
+        return;
+    }
+    if (count > sortBuffer->capacity) {
+        sortBuffer->capacity = MAX(sortBuffer->capacity * 2, count);
+        sortBuffer->keys = realloc(sortBuffer->keys, sizeof(uint64_t) * sortBuffer->capacity);
+        sortBuffer->scratchKeys = realloc(sortBuffer->scratchKeys, sizeof(uint64_t) * sortBuffer->capacity);
+        sortBuffer->indices = realloc(sortBuffer->indices, sizeof(uint32_t) * sortBuffer->capacity);
+        sortBuffer->scratchIndices = realloc(sortBuffer->scratchIndices, sizeof(uint32_t) * sortBuffer->capacity);
+        sortBuffer->items = realloc(sortBuffer->items, sizeof(GLTFMTLRenderItem) * sortBuffer->capacity);
+    }
+    
+    // Sorting keys and indices rather than the items themselves, which are large, then moving each item once
+    for (NSInteger i = 0; i < count; ++i) {
+        sortBuffer->keys[i] = arena->items[i].sortKey;
+        sortBuffer->indices[i] = (uint32_t)i;
+    }
+    GLTFRadixSortDrawKeys(sortBuffer->keys, sortBuffer->indices, count, sortBuffer->scratchKeys, sortBuffer->scratchIndices);
+    for (NSInteger i = 0; i < count; ++i) {
+        sortBuffer->items[i] = arena->items[sortBuffer->indices[i]];
+    }
+    memcpy(arena->items, sortBuffer->items, sizeof(GLTFMTLRenderItem) * count);
+}
+
+static inline void GLTFMTLRenderItemSortBufferFree(GLTFMTLRenderItemSortBuffer *sortBuffer) {
+    free(sortBuffer->keys);
+    free(sortBuffer->scratchKeys);
+    free(sortBuffer->indices);
+    free(sortBuffer->scratchIndices);
+    free(sortBuffer->items);
+    *sortBuffer = (GLTFMTLRenderItemSortBuffer){ 0 };
+}
@@ -15,57 +15,45 @@
 //
 
 #import "GLTFMTLRenderer.h"
+#import "GLTFMTLRenderItem.h"
 #import "GLTFMTLShaderBuilder.h"
+#import "GLTFMTLPipelineKey.h"
+#import "GLTFMTLShaderCache.h"
 #import "GLTFMTLUtilities.h"
 #import "GLTFMTLBufferAllocator.h"
+#import "GLTFMTLDrawCommandBackend.h"
 #import "GLTFMTLLightingEnvironment.h"
 #import "GLTFMTLTextureLoader.h"
 
 @import ImageIO;
 @import MetalKit;
 
-typedef struct {
-    simd_float4x4 modelMatrix;
-    simd_float4x4 modelViewProjectionMatrix;
-    simd_float4x4 normalMatrix;
-} VertexUniforms;
-
-typedef struct {
-    simd_float4 position;
-    simd_float4 color;
-    float intensity;
-    float innerConeAngle;
-    float outerConeAngle;
-    float range;
-    simd_float4 spotDirection;
-} Light;
-
-typedef struct {
-    float normalScale;
-    simd_float3 emissiveFactor;
-    float occlusionStrength;
-    simd_float2 metallicRoughnessValues;
-    simd_float4 baseColorFactor;
-    simd_float3 camera;
-    float alphaCutoff;
-    float envIntensity;
-    Light ambientLight;
-    Light lights[GLTFMTLMaximumLightCount];
-    simd_float3x3 textureMatrices[GLTFMTLMaximumTextureCount];
-} FragmentUniforms;
-
-@interface GLTFMTLRenderItem: NSObject
-@property (nonatomic, strong) NSString *label;
-@property (nonatomic, strong) GLTFNode *node;
-@property (nonatomic, strong) GLTFSubmesh *submesh;
-@property (nonatomic, assign) VertexUniforms vertexUniforms;
-@property (nonatomic, assign) FragmentUniforms fragmentUniforms;
+// A skinned node's joint matrices and the GPU copy of them. The copy is only replaced when the matrices change,
+// so unchanged palettes are neither recomputed nor rewritten, and frames still in flight keep reading the old copy.
+@interface GLTFMTLSkinPaletteBuffer : NSObject
+@property (nonatomic, strong) GLTFSkinPalette *palette;
+@property (nonatomic, strong) id<MTLBuffer> buffer;
+@property (nonatomic, assign) NSUInteger bufferVersion;
+@property (nonatomic, assign) NSUInteger frameNumber; // the frame in which the palette was last updated
 @end
 
-@implementation GLTFMTLRenderItem
+@implementation GLTFMTLSkinPaletteBuffer
 @end
 
-@interface GLTFMTLRenderer ()
+// The nodes of a bounding volume hierarchy whose bounds follow their pose, found again whenever its hierarchy changes
+@interface GLTFMTLDeformableNodeList : NSObject
+@property (nonatomic, copy) NSArray<GLTFNode *> *indexedNodes;
+@property (nonatomic, copy) NSArray<GLTFNode *> *deformableNodes;
+@end
+
+@implementation GLTFMTLDeformableNodeList
+@end
+
+@interface GLTFMTLRenderer () {
+    GLTFMTLRenderItemArena _opaqueRenderItems;
+    GLTFMTLRenderItemArena _transparentRenderItems;
+    GLTFMTLRenderItemSortBuffer _sortBuffer;
+}
 
 @property (nonatomic, strong) id<MTLDevice> device;
 @property (nonatomic, strong) id<MTLCommandQueue> commandQueue;
@@ -74,17 +62,39 @@ typedef struct {
 
 @property (nonatomic, strong) dispatch_semaphore_t frameBoundarySemaphore;
 
+@property (nonatomic, strong) GLTFMTLShaderBuilder *shaderBuilder;
 @property (nonatomic, strong) NSMutableDictionary<NSUUID *, id<MTLRenderPipelineState>> *pipelineStatesForSubmeshes;
+@property (nonatomic, strong) NSMutableDictionary<GLTFMTLPipelineKey *, id<MTLRenderPipelineState>> *pipelineStatesForKeys;
+@property (nonatomic, assign) GLTFMTLPipelineCacheStatistics pipelineCacheStatistics;
+// Set when a pipeline is compiled while drawing, so the shader cache is written out once the frame is encoded
+@property (nonatomic, assign) BOOL shaderCacheNeedsSynchronize;
 @property (nonatomic, strong) NSMutableDictionary<NSNumber *, id<MTLDepthStencilState>> *depthStencilStateMap;
 @property (nonatomic, strong) NSMutableDictionary<NSUUID *, id<MTLTexture>> *texturesForImageIdentifiers;
 @property (nonatomic, strong) NSMutableDictionary<GLTFTextureSampler *, id<MTLSamplerState>> *samplerStatesForSamplers;
 
-@property (nonatomic, strong) NSMutableArray<GLTFMTLRenderItem *> *opaqueRenderItems;
-@property (nonatomic, strong) NSMutableArray<GLTFMTLRenderItem *> *transparentRenderItems;
 @property (nonatomic, strong) NSMutableArray<GLTFNode *> *currentLightNodes;
+@property (nonatomic, strong) NSMutableData *currentLightTransforms;
 @property (nonatomic, strong) NSMutableArray<id<MTLBuffer>> *deferredReusableBuffers;
 @property (nonatomic, strong) NSMutableArray<id<MTLBuffer>> *bufferPool;
 
+// Keyed by skinned node, for nodes drawn directly and for each scene instance respectively
+@property (nonatomic, strong) NSMapTable<GLTFNode *, GLTFMTLSkinPaletteBuffer *> *skinPalettesForNodes;
+@property (nonatomic, strong) NSMapTable<GLTFSceneInstance *, NSMapTable<GLTFNode *, GLTFMTLSkinPaletteBuffer *> *> *skinPalettesForInstances;
+@property (nonatomic, assign) NSUInteger frameNumber;
+
+@property (nonatomic, strong) GLTFFrustumCuller *frustumCuller;
+@property (nonatomic, strong) NSMapTable<GLTFSceneBVH *, GLTFMTLDeformableNodeList *> *deformableNodesForHierarchies;
+@property (nonatomic, assign) GLTFCullingStatistics cullingStatistics;
+@property (nonatomic, strong) GLTFOcclusionBuffer *occlusionBuffer;
+
+@property (nonatomic, strong) GLTFDrawCommandRecorder *drawCommandRecorder;
+@property (nonatomic, strong) GLTFMTLDrawCommandBackend *drawCommandBackend;
+@property (nonatomic, assign) GLTFDrawCommandStatistics drawCommandStatistics;
+
+// Small integers standing for pipelines and materials in draw sort keys, assigned as they are first drawn
+@property (nonatomic, strong) NSMapTable<id, NSNumber *> *sortIndicesForPipelines;
+@property (nonatomic, strong) NSMapTable<id, NSNumber *> *sortIndicesForMaterials;
+
 @property (nonatomic, weak) GLTFKHRLight *ambientLight;
 
 @end
@@ -104,6 +114,10 @@ typedef struct {
         _colorPixelFormat = MTLPixelFormatBGRA8Unorm;
         _depthStencilPixelFormat = MTLPixelFormatDepth32Float_Stencil8;
         _sampleCount = 1;
+        _levelOfDetailPixelError = 1;
+        _frustumCullingEnabled = YES;
+        _occluderScreenCoverage = 0.2;
+        _occluderNodes = [NSSet set];
 
         _textureLoader = [[GLTFMTLTextureLoader alloc] initWithDevice:_device];
 
@@ -111,14 +125,25 @@ typedef struct {
         
         _depthStencilStateMap = [NSMutableDictionary dictionary];
         _texturesForImageIdentifiers = [NSMutableDictionary dictionary];
+        _shaderBuilder = [GLTFMTLShaderBuilder new];
+        _shaderCache = [[GLTFMTLShaderCache alloc] initWithDirectoryURL:[GLTFMTLShaderCache defaultDirectoryURL]];
+        _shaderBuilder.shaderCache = _shaderCache;
         _pipelineStatesForSubmeshes = [NSMutableDictionary dictionary];
+        _pipelineStatesForKeys = [NSMutableDictionary dictionary];
         _samplerStatesForSamplers = [NSMutableDictionary dictionary];
         
-        _opaqueRenderItems = [NSMutableArray array];
-        _transparentRenderItems = [NSMutableArray array];
         _currentLightNodes = [NSMutableArray array];
+        _currentLightTransforms = [NSMutableData data];
         _deferredReusableBuffers = [NSMutableArray array];
         _bufferPool = [NSMutableArray array];
+        _skinPalettesForNodes = [NSMapTable weakToStrongObjectsMapTable];
+        _skinPalettesForInstances = [NSMapTable weakToStrongObjectsMapTable];
+        _deformableNodesForHierarchies = [NSMapTable weakToStrongObjectsMapTable];
+        _frustumCuller = [GLTFFrustumCuller new];
+        _sortIndicesForPipelines = [NSMapTable weakToStrongObjectsMapTable];
+        _sortIndicesForMaterials = [NSMapTable weakToStrongObjectsMapTable];
+        _drawCommandRecorder = [GLTFDrawCommandRecorder new];
+        _drawCommandBackend = [[GLTFMTLDrawCommandBackend alloc] initWithRenderCommandEncoder:nil];
     }
     
     return self;
@@ -129,6 +154,10 @@ typedef struct {
     // we don't actually care about, but which are waiting, and would thus cause a crash
     // if we don't artificially spin the semaphore down to zero before it's released.
     while (dispatch_semaphore_signal(_frameBoundarySemaphore) != 0) { }
+    
+    GLTFMTLRenderItemArenaFree(&_opaqueRenderItems);
+    GLTFMTLRenderItemArenaFree(&_transparentRenderItems);
+    GLTFMTLRenderItemSortBufferFree(&_sortBuffer);
 }
 
 - (void)enqueueReusableBuffer:(id<MTLBuffer>)buffer {
@@ -206,17 +235,89 @@ typedef struct {
     return samplerState;
 }
 
+- (void)setShaderCache:(GLTFMTLShaderCache *)shaderCache {
+    _shaderCache = shaderCache;
+    self.shaderBuilder.shaderCache = shaderCache;
+}
+
+- (void)precompilePipelinesForAsset:(GLTFAsset *)asset completionHandler:(void (^)(NSInteger))completionHandler {
+    NSArray<GLTFMTLPipelineKey *> *keys = [GLTFMTLPipelineKey pipelineKeysForAsset:asset
+                                                                lightingEnvironment:self.lightingEnvironment
+                                                                   colorPixelFormat:self.colorPixelFormat
+                                                            depthStencilPixelFormat:self.depthStencilPixelFormat
+                                                                        sampleCount:self.sampleCount];
+    
+    NSMutableArray<GLTFMTLPipelineKey *> *missingKeys = [NSMutableArray array];
+    @synchronized(self.pipelineStatesForKeys) {
+        for (GLTFMTLPipelineKey *key in keys) {
+            if (self.pipelineStatesForKeys[key] == nil) {
+                [missingKeys addObject:key];
+            }
+        }
+    }
+    
+    GLTFMTLShaderBuilder *shaderBuilder = self.shaderBuilder;
+    GLTFMTLShaderCache *shaderCache = self.shaderCache;
+    id<MTLDevice> device = self.device;
+    NSMutableDictionary<GLTFMTLPipelineKey *, id<MTLRenderPipelineState>> *pipelineStatesForKeys = self.pipelineStatesForKeys;
+    
+    dispatch_queue_t queue = dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0);
+    dispatch_async(queue, ^{
+        __block NSInteger compiledCount = 0;
+        // Compiling blocks its thread, so this keeps the number of compilations in flight to the number of cores
+        dispatch_apply(missingKeys.count, queue, ^(size_t keyIndex) {
+            GLTFMTLPipelineKey *key = missingKeys[keyIndex];
+            id<MTLRenderPipelineState> pipeline = [shaderBuilder renderPipelineStateForPipelineKey:key device:device];
+            if (pipeline == nil) {
+                return;
+            }
+            @synchronized(pipelineStatesForKeys) {
+                // The render thread may have needed it first
+                if (pipelineStatesForKeys[key] == nil) {
+                    pipelineStatesForKeys[key] = pipeline;
+                    ++compiledCount;
+                }
+            }
+        });
+        [shaderCache synchronize];
+        
+        if (completionHandler != nil) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                completionHandler(compiledCount);
+            });
+        }
+    });
+}
+
 - (id<MTLRenderPipelineState>)renderPipelineStateForSubmesh:(GLTFSubmesh *)submesh {
     id<MTLRenderPipelineState> pipeline = self.pipelineStatesForSubmeshes[submesh.identifier];
     
     if (pipeline == nil) {
-        GLTFMTLShaderBuilder *shaderBuilder = [[GLTFMTLShaderBuilder alloc] init];
-        pipeline = [shaderBuilder renderPipelineStateForSubmesh: submesh
-                                            lightingEnvironment:self.lightingEnvironment
-                                               colorPixelFormat:self.colorPixelFormat
-                                        depthStencilPixelFormat:self.depthStencilPixelFormat
-                                                    sampleCount:self.sampleCount
-                                                         device:self.device];
+        GLTFMTLPipelineKey *key = [[GLTFMTLPipelineKey alloc] initWithSubmesh:submesh
+                                                           lightingEnvironment:self.lightingEnvironment
+                                                              colorPixelFormat:self.colorPixelFormat
+                                                       depthStencilPixelFormat:self.depthStencilPixelFormat
+                                                                   sampleCount:self.sampleCount];
+        GLTFMTLPipelineCacheStatistics statistics = self.pipelineCacheStatistics;
+        @synchronized(self.pipelineStatesForKeys) {
+            pipeline = self.pipelineStatesForKeys[key];
+        }
+        if (pipeline != nil) {
+            ++statistics.hitCount;
+        } else {
+            ++statistics.missCount;
+            id<MTLRenderPipelineState> compiledPipeline = [self.shaderBuilder renderPipelineStateForPipelineKey:key device:self.device];
+            @synchronized(self.pipelineStatesForKeys) {
+                // Precompilation may have finished the same key meanwhile; keep whichever got there first
+                pipeline = self.pipelineStatesForKeys[key];
+                if (pipeline == nil && compiledPipeline != nil) {
+                    pipeline = compiledPipeline;
+                    self.pipelineStatesForKeys[key] = pipeline;
+                    self.shaderCacheNeedsSynchronize = YES;
+                }
+            }
+        }
+        self.pipelineCacheStatistics = statistics;
         self.pipelineStatesForSubmeshes[submesh.identifier] = pipeline;
     }
 
@@ -255,28 +356,259 @@ typedef struct {
         return;
     }
     
-    long timedOut = dispatch_semaphore_wait(self.frameBoundarySemaphore, dispatch_time(0, 1 * NSEC_PER_SEC));
-    if (timedOut) {
-        NSLog(@"Failed to receive frame boundary signal before timing out; calling signalFrameCompletion manually. "
-              "Remember to call signalFrameCompletion on GLTFMTLRenderer from the completion handler of the command buffer "
-              "into which you encode the work for drawing assets");
-        [self signalFrameCompletion];
-    }
+    [self waitForFrameBoundary];
     
     self.ambientLight = scene.ambientLight;
+    
+    // Bring every world transform up to date at once, rather than on the first globalTransform query
+    [scene.transformStore updateWorldTransforms];
 
     for (GLTFNode *rootNode in scene.nodes) {
-        [self buildLightListRecursive:rootNode];
+        [self buildLightListRecursive:rootNode instance:nil];
     }
     
+    [self beginCulling];
+    [self cullWithBoundingVolumeHierarchy:scene.boundingVolumeHierarchy instance:nil];
     for (GLTFNode *rootNode in scene.nodes) {
-        [self buildRenderListRecursive:rootNode modelMatrix:matrix_identity_float4x4];
+        [self buildRenderListRecursive:rootNode modelMatrix:matrix_identity_float4x4 instance:nil];
+    }
+    [self endCulling];
+    [self cullOccludedRenderItems];
+    
+    [self drawRenderListsWithCommandBuffer:commandBuffer commandEncoder:renderEncoder];
+}
+
+- (void)renderSceneInstances:(NSArray<GLTFSceneInstance *> *)instances
+               commandBuffer:(id<MTLCommandBuffer>)commandBuffer
+              commandEncoder:(id<MTLRenderCommandEncoder>)renderEncoder
+{
+    if (instances.count == 0) {
+        return;
+    }
+    
+    [self waitForFrameBoundary];
+    
+    self.ambientLight = instances.firstObject.scene.ambientLight;
+    
+    for (GLTFSceneInstance *instance in instances) {
+        [instance.transformStore updateWorldTransforms];
+        for (GLTFNode *rootNode in instance.scene.nodes) {
+            [self buildLightListRecursive:rootNode instance:instance];
+        }
+    }
+    
+    [self beginCulling];
+    for (GLTFSceneInstance *instance in instances) {
+        [self cullWithBoundingVolumeHierarchy:instance.boundingVolumeHierarchy instance:instance];
+        for (GLTFNode *rootNode in instance.scene.nodes) {
+            [self buildRenderListRecursive:rootNode modelMatrix:instance.rootTransform instance:instance];
+        }
+    }
+    [self endCulling];
+    [self cullOccludedRenderItems];
+    
+    [self drawRenderListsWithCommandBuffer:commandBuffer commandEncoder:renderEncoder];
+}
+
+- (void)beginCulling {
+    self.cullingStatistics = (GLTFCullingStatistics){ 0 };
+    [self.frustumCuller beginWithFrustum:GLTFFrustumFromViewProjectionMatrix(matrix_multiply(self.projectionMatrix, self.viewMatrix))];
+}
+
+// Classifies every submesh in the hierarchy up front, so that whole regions outside the frustum are rejected at once
+- (void)cullWithBoundingVolumeHierarchy:(GLTFSceneBVH *)bvh instance:(GLTFSceneInstance *)instance {
+    if (!self.frustumCullingEnabled || bvh == nil) {
+        [self.frustumCuller cullWithBoundingVolumeHierarchy:nil];
+        return;
+    }
+    
+    for (GLTFNode *node in [self deformableNodesForHierarchy:bvh]) {
+        [bvh setLocalBounds:[self deformedBoundsForNode:node instance:instance] forNode:node];
+    }
+    [self.frustumCuller cullWithBoundingVolumeHierarchy:bvh];
+}
+
+- (void)endCulling {
+    [self.frustumCuller cullWithBoundingVolumeHierarchy:nil];
+    GLTFCullingStatistics frustumStatistics = self.frustumCuller.statistics;
+    GLTFCullingStatistics statistics = self.cullingStatistics;
+    statistics.testedBoundsCount += frustumStatistics.testedBoundsCount;
+    statistics.visibleCount += frustumStatistics.visibleCount;
+    statistics.culledCount += frustumStatistics.culledCount;
+    self.cullingStatistics = statistics;
+}
+
+- (NSArray<GLTFNode *> *)deformableNodesForHierarchy:(GLTFSceneBVH *)bvh {
+    GLTFMTLDeformableNodeList *list = [self.deformableNodesForHierarchies objectForKey:bvh];
+    NSArray<GLTFNode *> *nodes = bvh.transformStore.nodes;
+    if (list == nil || list.indexedNodes != nodes) {
+        list = [GLTFMTLDeformableNodeList new];
+        list.indexedNodes = nodes;
+        list.deformableNodes = [nodes filteredArrayUsingPredicate:[NSPredicate predicateWithBlock:^BOOL(GLTFNode *node, NSDictionary *bindings) {
+            return node.hasDeformableMesh;
+        }]];
+        [self.deformableNodesForHierarchies setObject:list forKey:bvh];
+    }
+    return list.deformableNodes;
+}
+
+// Skinned meshes are bounded by the palette they're drawn with and morphed meshes by their current weights, rather
+// than by their accessors' bind pose ranges
+- (GLTFBoundingBox)deformedBoundsForNode:(GLTFNode *)node instance:(GLTFSceneInstance *)instance {
+    if (node.skin.jointNodes.count > 0) {
+        return [self skinPaletteBufferForNode:node instance:instance].palette.bounds;
+    }
+    return [node meshBoundsForInstance:instance];
+}
+
+- (BOOL)isSubmeshVisible:(NSInteger)submeshIndex
+                  ofNode:(GLTFNode *)node
+             localBounds:(GLTFBoundingBox)localBounds
+             modelMatrix:(simd_float4x4)modelMatrix
+{
+    if (!self.frustumCullingEnabled) {
+        GLTFCullingStatistics statistics = self.cullingStatistics;
+        ++statistics.visibleCount;
+        self.cullingStatistics = statistics;
+        return YES;
+    }
+    return [self.frustumCuller isSubmeshAtIndex:submeshIndex ofNode:node visibleWithLocalBounds:localBounds modelMatrix:modelMatrix];
+}
+
+- (GLTFBoundingBox)boundsForSubmesh:(GLTFSubmesh *)submesh {
+    GLTFValueRange positionRange = submesh.accessorsForAttributes[GLTFAttributeSemanticPosition].valueRange;
+    GLTFBoundingBox bounds = {
+        (simd_float3){ positionRange.minValue[0], positionRange.minValue[1], positionRange.minValue[2] },
+        (simd_float3){ positionRange.maxValue[0], positionRange.maxValue[1], positionRange.maxValue[2] }
+    };
+    return bounds;
+}
+
+- (uint32_t)sortIndexForObject:(id)object inMapTable:(NSMapTable<id, NSNumber *> *)sortIndices {
+    if (object == nil) {
+        return 0;
+    }
+    NSNumber *sortIndex = [sortIndices objectForKey:object];
+    if (sortIndex == nil) {
+        // Zero is left for objects that are missing
+        sortIndex = @(sortIndices.count + 1);
+        [sortIndices setObject:sortIndex forKey:object];
+    }
+    return sortIndex.unsignedIntValue;
+}
+
+- (uint64_t)sortKeyForRenderItem:(const GLTFMTLRenderItem *)item viewMatrix:(simd_float4x4)viewMatrix {
+    GLTFMaterial *material = item->submesh.material;
+    uint32_t pipelineIndex = [self sortIndexForObject:item->renderPipelineState inMapTable:self.sortIndicesForPipelines];
+    uint32_t materialIndex = [self sortIndexForObject:material inMapTable:self.sortIndicesForMaterials];
+    
+    // Depth of the bounds' center in front of the camera, which looks down -z
+    GLTFBoundingBox bounds = item->localBounds;
+    simd_float3 center = (bounds.minPoint + bounds.maxPoint) * 0.5f;
+    simd_float4x4 modelViewMatrix = matrix_multiply(viewMatrix, item->vertexUniforms.modelMatrix);
+    float viewDepth = -matrix_multiply(modelViewMatrix, simd_make_float4(center, 1)).z;
+    
+    if (material.alphaMode == GLTFAlphaModeBlend) {
+        return GLTFTransparentDrawSortKey(pipelineIndex, materialIndex, viewDepth);
+    }
+    return GLTFOpaqueDrawSortKey(pipelineIndex, materialIndex, viewDepth);
+}
+
+- (BOOL)isOccluderRenderItem:(const GLTFMTLRenderItem *)item {
+    if (item->submesh.material.alphaMode != GLTFAlphaModeOpaque || item->node.skin.jointNodes.count > 0) {
+        return NO;
+    }
+    if ([self.occluderNodes containsObject:item->node]) {
+        return YES;
+    }
+    simd_float4x4 modelMatrix = item->vertexUniforms.modelMatrix;
+    GLTFBoundingSphere sphere = GLTFBoundingSphereFromBox(item->localBounds);
+    float coverage = 2 * GLTFBoundingSphereTransform(sphere, modelMatrix).radius * [self projectedScaleForBoundingSphere:sphere modelMatrix:modelMatrix];
+    return coverage >= self.occluderScreenCoverage;
+}
+
+// Rasterizes the largest opaque items into the occlusion buffer and drops every item hidden behind them
+- (void)cullOccludedRenderItems {
+    if (!self.occlusionCullingEnabled || _opaqueRenderItems.count == 0) {
+        return;
+    }
+    
+    // Low resolution, in the drawable's aspect ratio
+    const NSInteger occlusionBufferWidth = 256;
+    NSInteger occlusionBufferHeight = MAX(16, MIN(256, (NSInteger)(occlusionBufferWidth * self.drawableSize.height / MAX(self.drawableSize.width, 1))));
+    if (self.occlusionBuffer == nil || self.occlusionBuffer.height != occlusionBufferHeight) {
+        self.occlusionBuffer = [[GLTFOcclusionBuffer alloc] initWithWidth:occlusionBufferWidth height:occlusionBufferHeight];
+    }
+    GLTFOcclusionBuffer *occlusionBuffer = self.occlusionBuffer;
+    
+    [occlusionBuffer beginFrameWithViewProjectionMatrix:matrix_multiply(self.projectionMatrix, self.viewMatrix)];
+    for (NSInteger i = 0; i < _opaqueRenderItems.count; ++i) {
+        GLTFMTLRenderItem *item = &_opaqueRenderItems.items[i];
+        item->isOccluder = [self isOccluderRenderItem:item];
+        if (item->isOccluder) {
+            [occlusionBuffer addOccluderSubmesh:item->submesh modelMatrix:item->vertexUniforms.modelMatrix];
+        }
+    }
+    if (occlusionBuffer.occluderTriangleCount == 0) {
+        return;
     }
+    [occlusionBuffer rasterizeOccluders];
     
-    NSMutableArray *renderList = [NSMutableArray arrayWithArray:self.opaqueRenderItems];
-    [renderList addObjectsFromArray:self.transparentRenderItems];
+    GLTFCullingStatistics statistics = self.cullingStatistics;
+    GLTFMTLRenderItemArena *arenas[] = { &_opaqueRenderItems, &_transparentRenderItems };
+    for (int arenaIndex = 0; arenaIndex < 2; ++arenaIndex) {
+        GLTFMTLRenderItemArena *arena = arenas[arenaIndex];
+        NSInteger keptCount = 0;
+        for (NSInteger i = 0; i < arena->count; ++i) {
+            const GLTFMTLRenderItem *item = &arena->items[i];
+            BOOL visible = YES;
+            if (!item->isOccluder) {
+                ++statistics.testedBoundsCount;
+                visible = [occlusionBuffer isBoundingBoxVisible:item->localBounds modelMatrix:item->vertexUniforms.modelMatrix];
+            }
+            if (visible) {
+                if (keptCount != i) {
+                    arena->items[keptCount] = *item;
+                }
+                ++keptCount;
+            } else {
+                --statistics.visibleCount;
+                ++statistics.culledCount;
+                ++statistics.occludedCount;
+            }
+        }
+        arena->count = keptCount;
+    }
+    self.cullingStatistics = statistics;
+}
+
+- (void)waitForFrameBoundary {
+    long timedOut = dispatch_semaphore_wait(self.frameBoundarySemaphore, dispatch_time(0, 1 * NSEC_PER_SEC));
+    if (timedOut) {
+        NSLog(@"Failed to receive frame boundary signal before timing out; calling signalFrameCompletion manually. "
+              "Remember to call signalFrameCompletion on GLTFMTLRenderer from the completion handler of the command buffer "
+              "into which you encode the work for drawing assets");
+        [self signalFrameCompletion];
+    }
+}
+
+- (void)drawRenderListsWithCommandBuffer:(id<MTLCommandBuffer>)commandBuffer
+                          commandEncoder:(id<MTLRenderCommandEncoder>)renderEncoder
+{
+    // Opaque draws grouped by pipeline and material, nearest first; then blended draws, farthest first
+    GLTFMTLRenderItemArenaSort(&_opaqueRenderItems, &_sortBuffer);
+    GLTFMTLRenderItemArenaSort(&_transparentRenderItems, &_sortBuffer);
     
-    [self drawRenderList:renderList commandEncoder:renderEncoder];
+    // Draws are recorded first so that binds which wouldn't change anything can be dropped before reaching Metal
+    GLTFDrawCommandRecorder *recorder = self.drawCommandRecorder;
+    [recorder reset];
+    [self drawRenderItems:_opaqueRenderItems.items count:_opaqueRenderItems.count recorder:recorder];
+    [self drawRenderItems:_transparentRenderItems.items count:_transparentRenderItems.count recorder:recorder];
+    self.drawCommandStatistics = recorder.statistics;
+    
+    self.drawCommandBackend.renderCommandEncoder = renderEncoder;
+    [recorder replayWithBackend:self.drawCommandBackend];
+    self.drawCommandBackend.renderCommandEncoder = nil;
     
     NSArray *copiedDeferredReusableBuffers = [self.deferredReusableBuffers copy];
     [commandBuffer addCompletedHandler:^(id<MTLCommandBuffer> commandBuffer) {
@@ -287,256 +619,397 @@ typedef struct {
         });
     }];
     
-    [self.opaqueRenderItems removeAllObjects];
-    [self.transparentRenderItems removeAllObjects];
+    GLTFMTLRenderItemArenaReset(&_opaqueRenderItems);
+    GLTFMTLRenderItemArenaReset(&_transparentRenderItems);
     [self.currentLightNodes removeAllObjects];
+    self.currentLightTransforms.length = 0;
     [self.deferredReusableBuffers removeAllObjects];
+    
+    if (self.shaderCacheNeedsSynchronize) {
+        self.shaderCacheNeedsSynchronize = NO;
+        GLTFMTLShaderCache *shaderCache = self.shaderCache;
+        dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+            [shaderCache synchronize];
+        });
+    }
+    
+    ++self.frameNumber;
+}
+
+// Nodes outside an instance's hierarchy (such as MSFT_lod alternatives) fall back on their own transforms
+- (simd_float4x4)localTransformForNode:(GLTFNode *)node instance:(GLTFSceneInstance *)instance {
+    NSInteger index = (instance != nil) ? [instance.transformStore indexOfNode:node] : -1;
+    return (index >= 0) ? instance.transformStore.localTransforms[index] : node.localTransform;
+}
+
+- (simd_float4x4)worldTransformForNode:(GLTFNode *)node instance:(GLTFSceneInstance *)instance {
+    return (instance != nil) ? [instance worldTransformForNode:node] : node.globalTransform;
 }
 
-- (void)bindTexturesForMaterial:(GLTFMaterial *)material commandEncoder:(id<MTLRenderCommandEncoder>)renderEncoder {
+- (void)bindTexturesForMaterial:(GLTFMaterial *)material recorder:(GLTFDrawCommandRecorder *)recorder {
     if (material.baseColorTexture != nil) {
         id<MTLTexture> texture = [self textureForImage:material.baseColorTexture.texture.image preferSRGB:YES];
         id<MTLSamplerState> sampler = [self samplerStateForSampler:material.baseColorTexture.texture.sampler];
-        [renderEncoder setFragmentTexture:texture atIndex:GLTFTextureBindIndexBaseColor];
-        [renderEncoder setFragmentSamplerState:sampler atIndex:GLTFTextureBindIndexBaseColor];
+        [recorder setFragmentTexture:texture atIndex:GLTFTextureBindIndexBaseColor];
+        [recorder setFragmentSamplerState:sampler atIndex:GLTFTextureBindIndexBaseColor];
     }
     
     if (material.normalTexture != nil) {
         id<MTLTexture> texture = [self textureForImage:material.normalTexture.texture.image preferSRGB:NO];
         id<MTLSamplerState> sampler = [self samplerStateForSampler:material.normalTexture.texture.sampler];
-        [renderEncoder setFragmentTexture:texture atIndex:GLTFTextureBindIndexNormal];
-        [renderEncoder setFragmentSamplerState:sampler atIndex:GLTFTextureBindIndexNormal];
+        [recorder setFragmentTexture:texture atIndex:GLTFTextureBindIndexNormal];
+        [recorder setFragmentSamplerState:sampler atIndex:GLTFTextureBindIndexNormal];
     }
     
     if (material.metallicRoughnessTexture != nil) {
         id<MTLTexture> texture = [self textureForImage:material.metallicRoughnessTexture.texture.image preferSRGB:NO];
         id<MTLSamplerState> sampler = [self samplerStateForSampler:material.metallicRoughnessTexture.texture.sampler];
-        [renderEncoder setFragmentTexture:texture atIndex:GLTFTextureBindIndexMetallicRoughness];
-        [renderEncoder setFragmentSamplerState:sampler atIndex:GLTFTextureBindIndexMetallicRoughness];
+        [recorder setFragmentTexture:texture atIndex:GLTFTextureBindIndexMetallicRoughness];
+        [recorder setFragmentSamplerState:sampler atIndex:GLTFTextureBindIndexMetallicRoughness];
     }
     
     if (material.emissiveTexture != nil) {
         id<MTLTexture> texture = [self textureForImage:material.emissiveTexture.texture.image preferSRGB:YES];
         id<MTLSamplerState> sampler = [self samplerStateForSampler:material.emissiveTexture.texture.sampler];
-        [renderEncoder setFragmentTexture:texture atIndex:GLTFTextureBindIndexEmissive];
-        [renderEncoder setFragmentSamplerState:sampler atIndex:GLTFTextureBindIndexEmissive];
+        [recorder setFragmentTexture:texture atIndex:GLTFTextureBindIndexEmissive];
+        [recorder setFragmentSamplerState:sampler atIndex:GLTFTextureBindIndexEmissive];
     }
     
     if (material.occlusionTexture != nil) {
         id<MTLTexture> texture = [self textureForImage:material.occlusionTexture.texture.image preferSRGB:NO];
         id<MTLSamplerState> sampler = [self samplerStateForSampler:material.occlusionTexture.texture.sampler];
-        [renderEncoder setFragmentTexture:texture atIndex:GLTFTextureBindIndexOcclusion];
-        [renderEncoder setFragmentSamplerState:sampler atIndex:GLTFTextureBindIndexOcclusion];
+        [recorder setFragmentTexture:texture atIndex:GLTFTextureBindIndexOcclusion];
+        [recorder setFragmentSamplerState:sampler atIndex:GLTFTextureBindIndexOcclusion];
     }
     
     if (self.lightingEnvironment) {
-        [renderEncoder setFragmentTexture:self.lightingEnvironment.specularCube atIndex:GLTFTextureBindIndexSpecularEnvironment];
-        [renderEncoder setFragmentTexture:self.lightingEnvironment.diffuseCube atIndex:GLTFTextureBindIndexDiffuseEnvironment];
-        [renderEncoder setFragmentTexture:self.lightingEnvironment.brdfLUT atIndex:GLTFTextureBindIndexBRDFLookup];
+        [recorder setFragmentTexture:self.lightingEnvironment.specularCube atIndex:GLTFTextureBindIndexSpecularEnvironment];
+        [recorder setFragmentTexture:self.lightingEnvironment.diffuseCube atIndex:GLTFTextureBindIndexDiffuseEnvironment];
+        [recorder setFragmentTexture:self.lightingEnvironment.brdfLUT atIndex:GLTFTextureBindIndexBRDFLookup];
     }
 }
 
-- (void)computeJointsForSubmesh:(GLTFSubmesh *)submesh inNode:(GLTFNode *)node buffer:(id<MTLBuffer>)jointBuffer {
-    GLTFAccessor *jointsAccessor = submesh.accessorsForAttributes[GLTFAttributeSemanticJoints0];
-    GLTFSkin *skin = node.skin;
-    GLTFAccessor *inverseBindingAccessor = node.skin.inverseBindMatricesAccessor;
+// Updated at most once per frame for each skinned node of each instance, for culling and drawing alike
+- (GLTFMTLSkinPaletteBuffer *)skinPaletteBufferForNode:(GLTFNode *)node instance:(GLTFSceneInstance *)instance {
+    NSMapTable<GLTFNode *, GLTFMTLSkinPaletteBuffer *> *palettes = self.skinPalettesForNodes;
+    if (instance != nil) {
+        palettes = [self.skinPalettesForInstances objectForKey:instance];
+        if (palettes == nil) {
+            palettes = [NSMapTable weakToStrongObjectsMapTable];
+            [self.skinPalettesForInstances setObject:palettes forKey:instance];
+        }
+    }
     
-    if (jointsAccessor != nil && inverseBindingAccessor != nil) {
-        NSInteger jointCount = skin.jointNodes.count;
-        simd_float4x4 *jointMatrices = (simd_float4x4 *)jointBuffer.contents;
-        simd_float4x4 *inverseBindMatrices = inverseBindingAccessor.bufferView.buffer.contents + inverseBindingAccessor.bufferView.offset + inverseBindingAccessor.offset;
-        for (NSInteger i = 0; i < jointCount; ++i) {
-            GLTFNode *joint = skin.jointNodes[i];
-            simd_float4x4 inverseBindMatrix = inverseBindMatrices[i];
-            jointMatrices[i] = matrix_multiply(matrix_invert(node.globalTransform), matrix_multiply(joint.globalTransform, inverseBindMatrix));
+    GLTFMTLSkinPaletteBuffer *paletteBuffer = [palettes objectForKey:node];
+    if (paletteBuffer == nil || paletteBuffer.palette.skin != node.skin) {
+        paletteBuffer = [GLTFMTLSkinPaletteBuffer new];
+        paletteBuffer.palette = [[GLTFSkinPalette alloc] initWithSkin:node.skin meshNode:node instance:instance];
+        [palettes setObject:paletteBuffer forKey:node];
+    }
+    
+    if (paletteBuffer.palette.version == 0 || paletteBuffer.frameNumber != self.frameNumber) {
+        [paletteBuffer.palette update];
+        paletteBuffer.frameNumber = self.frameNumber;
+    }
+    return paletteBuffer;
+}
+
+// Uploaded only when the palette has changed, however many submeshes the node has
+- (id<MTLBuffer>)jointBufferForNode:(GLTFNode *)node instance:(GLTFSceneInstance *)instance {
+    GLTFMTLSkinPaletteBuffer *paletteBuffer = [self skinPaletteBufferForNode:node instance:instance];
+    GLTFSkinPalette *palette = paletteBuffer.palette;
+    if (paletteBuffer.buffer == nil || paletteBuffer.bufferVersion != palette.version) {
+        if (paletteBuffer.buffer != nil) {
+            [self.deferredReusableBuffers addObject:paletteBuffer.buffer];
         }
+        size_t length = palette.jointCount * sizeof(simd_float4x4);
+        id<MTLBuffer> buffer = [self dequeueReusableBufferOfLength:length];
+        memcpy(buffer.contents, palette.jointMatrices, length);
+        paletteBuffer.buffer = buffer;
+        paletteBuffer.bufferVersion = palette.version;
     }
+    return paletteBuffer.buffer;
 }
 
-- (void)buildLightListRecursive:(GLTFNode *)node {
-    if (node.light != nil) {
+- (void)buildLightListRecursive:(GLTFNode *)node instance:(GLTFSceneInstance *)instance {
+    if (node.light != nil && self.currentLightNodes.count < GLTFMTLMaximumLightCount) {
         [self.currentLightNodes addObject:node];
+        simd_float4x4 lightTransform = [self worldTransformForNode:node instance:instance];
+        [self.currentLightTransforms appendBytes:&lightTransform length:sizeof(lightTransform)];
+    }
+
+    NSUInteger childCount = node.childCount;
+    for (NSUInteger i = 0; i < childCount; ++i) {
+        [self buildLightListRecursive:[node childAtIndex:i] instance:instance];
+    }
+}
+
+- (simd_float3)cameraWorldPosition {
+    simd_float3x3 viewAffine = simd_inverse(GLTFMatrixUpperLeft3x3(self.viewMatrix));
+    simd_float3 cameraPos = self.viewMatrix.columns[3].xyz;
+    return matrix_multiply(viewAffine, -cameraPos);
+}
+
+- (GLTFBoundingSphere)boundingSphereForMesh:(GLTFMesh *)mesh {
+    GLTFBoundingBox bounds = { 0 };
+    for (GLTFSubmesh *submesh in mesh.submeshes) {
+        GLTFValueRange positionRange = submesh.accessorsForAttributes[GLTFAttributeSemanticPosition].valueRange;
+        GLTFBoundingBox submeshBounds = {
+            (simd_float3){ positionRange.minValue[0], positionRange.minValue[1], positionRange.minValue[2] },
+            (simd_float3){ positionRange.maxValue[0], positionRange.maxValue[1], positionRange.maxValue[2] }
+        };
+        GLTFBoundingBoxUnion(&bounds, submeshBounds);
     }
+    return GLTFBoundingSphereFromBox(bounds);
+}
+
+// Returns the ratio of on-screen size (as a fraction of viewport height) to world-space size
+// for an object at the center of the given sphere
+- (float)projectedScaleForBoundingSphere:(GLTFBoundingSphere)sphere modelMatrix:(simd_float4x4)modelMatrix {
+    GLTFBoundingSphere worldSphere = GLTFBoundingSphereTransform(sphere, modelMatrix);
+    float distance = fmaxf(simd_distance(worldSphere.center, [self cameraWorldPosition]) - worldSphere.radius, 1e-4f);
+    return self.projectionMatrix.columns[1][1] * 0.5f / distance;
+}
+
+// Chooses among a node and its MSFT_lod alternatives by screen coverage; returns nil if none should be drawn
+- (GLTFNode *)levelOfDetailNodeForNode:(GLTFNode *)node modelMatrix:(simd_float4x4)modelMatrix {
+    NSArray<NSNumber *> *screenCoverages = node.levelOfDetailScreenCoverages;
+    if (node.levelOfDetailNodes.count == 0 || screenCoverages.count == 0 || node.mesh == nil) {
+        return node;
+    }
+    
+    GLTFBoundingSphere sphere = [self boundingSphereForMesh:node.mesh];
+    float scale = [self projectedScaleForBoundingSphere:sphere modelMatrix:modelMatrix];
+    float worldRadius = GLTFBoundingSphereTransform(sphere, modelMatrix).radius;
+    float coverage = 2 * worldRadius * scale;
+    
+    NSArray<GLTFNode *> *candidates = [@[ node ] arrayByAddingObjectsFromArray:node.levelOfDetailNodes];
+    NSUInteger thresholdCount = MIN(candidates.count, screenCoverages.count);
+    for (NSUInteger i = 0; i < thresholdCount; ++i) {
+        if (coverage >= screenCoverages[i].floatValue) {
+            return candidates[i];
+        }
+    }
+    
+    return (screenCoverages.count < candidates.count) ? candidates[screenCoverages.count] : nil;
+}
 
-    for (GLTFNode *childNode in node.children) {
-        [self buildLightListRecursive:childNode];
+- (GLTFAccessor *)indexAccessorForSubmesh:(GLTFSubmesh *)submesh modelMatrix:(simd_float4x4)modelMatrix {
+    NSArray<GLTFLevelOfDetail *> *levelsOfDetail = submesh.levelsOfDetail;
+    if (levelsOfDetail.count == 0) {
+        return submesh.indexAccessor;
+    }
+    
+    GLTFValueRange positionRange = submesh.accessorsForAttributes[GLTFAttributeSemanticPosition].valueRange;
+    GLTFBoundingBox bounds = {
+        (simd_float3){ positionRange.minValue[0], positionRange.minValue[1], positionRange.minValue[2] },
+        (simd_float3){ positionRange.maxValue[0], positionRange.maxValue[1], positionRange.maxValue[2] }
+    };
+    GLTFBoundingSphere sphere = GLTFBoundingSphereFromBox(bounds);
+    float worldScale = GLTFBoundingSphereTransform(sphere, modelMatrix).radius / fmaxf(sphere.radius, 1e-6f);
+    float pixelsPerUnit = [self projectedScaleForBoundingSphere:sphere modelMatrix:modelMatrix] * worldScale * self.drawableSize.height;
+    
+    GLTFAccessor *indexAccessor = submesh.indexAccessor;
+    for (GLTFLevelOfDetail *levelOfDetail in levelsOfDetail) {
+        if (levelOfDetail.error * pixelsPerUnit > self.levelOfDetailPixelError) {
+            break;
+        }
+        indexAccessor = levelOfDetail.indexAccessor;
     }
+    return indexAccessor;
 }
 
 - (void)buildRenderListRecursive:(GLTFNode *)node
                      modelMatrix:(simd_float4x4)modelMatrix
+                        instance:(GLTFSceneInstance *)instance
 {
-    modelMatrix = matrix_multiply(modelMatrix, node.localTransform);
+    // Nothing in a subtree the hierarchy culled as a whole can be drawn
+    if (![self.frustumCuller isSubtreeOfNodeVisible:node]) {
+        return;
+    }
+    
+    simd_float4x4 localTransform = [self localTransformForNode:node instance:instance];
+    GLTFNode *levelOfDetailNode = [self levelOfDetailNodeForNode:node modelMatrix:matrix_multiply(modelMatrix, localTransform)];
+    if (levelOfDetailNode == nil) {
+        return;
+    }
+    if (levelOfDetailNode != node) {
+        node = levelOfDetailNode;
+        localTransform = [self localTransformForNode:node instance:instance];
+    }
+    
+    modelMatrix = matrix_multiply(modelMatrix, localTransform);
 
     GLTFMesh *mesh = node.mesh;
     if (mesh) {
-        for (GLTFSubmesh *submesh in mesh.submeshes) {
+        simd_float3x3 viewAffine = simd_inverse(GLTFMatrixUpperLeft3x3(self.viewMatrix));
+        simd_float3 cameraPos = self.viewMatrix.columns[3].xyz;
+        simd_float3 cameraWorldPos = matrix_multiply(viewAffine, -cameraPos);
+        
+        // Posed once for all of the node's submeshes
+        BOOL deforms = node.hasDeformableMesh;
+        GLTFBoundingBox deformedBounds = deforms ? [self deformedBoundsForNode:node instance:instance] : (GLTFBoundingBox){ 0 };
+        
+        NSArray<GLTFSubmesh *> *submeshes = mesh.submeshes;
+        for (NSInteger submeshIndex = 0; submeshIndex < submeshes.count; ++submeshIndex) {
+            GLTFSubmesh *submesh = submeshes[submeshIndex];
+            GLTFBoundingBox localBounds = deforms ? deformedBounds : [self boundsForSubmesh:submesh];
+            if (![self isSubmeshVisible:submeshIndex ofNode:node localBounds:localBounds modelMatrix:modelMatrix]) {
+                continue;
+            }
+            
             GLTFMaterial *material = submesh.material;
             
-            simd_float3x3 viewAffine = simd_inverse(GLTFMatrixUpperLeft3x3(self.viewMatrix));
-            simd_float3 cameraPos = self.viewMatrix.columns[3].xyz;
-            simd_float3 cameraWorldPos = matrix_multiply(viewAffine, -cameraPos);
+            GLTFMTLRenderItemArena *arena = (material.alphaMode == GLTFAlphaModeBlend) ? &_transparentRenderItems : &_opaqueRenderItems;
+            GLTFMTLRenderItem *item = GLTFMTLRenderItemArenaAppend(arena);
+            item->node = node;
+            item->instance = instance;
+            item->submesh = submesh;
+            item->localBounds = localBounds;
+            item->isOccluder = NO;
+            item->indexAccessor = [self indexAccessorForSubmesh:submesh modelMatrix:modelMatrix];
+            item->renderPipelineState = [self renderPipelineStateForSubmesh:submesh];
             
-            VertexUniforms vertexUniforms;
-            vertexUniforms.modelMatrix = modelMatrix;
-            vertexUniforms.modelViewProjectionMatrix = matrix_multiply(matrix_multiply(self.projectionMatrix, self.viewMatrix), modelMatrix);
-            vertexUniforms.normalMatrix = GLTFNormalMatrixFromModelMatrix(modelMatrix);
+            VertexUniforms *vertexUniforms = &item->vertexUniforms;
+            vertexUniforms->modelMatrix = modelMatrix;
+            vertexUniforms->modelViewProjectionMatrix = matrix_multiply(matrix_multiply(self.projectionMatrix, self.viewMatrix), modelMatrix);
+            vertexUniforms->normalMatrix = GLTFNormalMatrixFromModelMatrix(modelMatrix);
             
-            FragmentUniforms fragmentUniforms = { 0 };
-            fragmentUniforms.normalScale = material.normalTextureScale;
-            fragmentUniforms.emissiveFactor = material.emissiveFactor;
-            fragmentUniforms.occlusionStrength = material.occlusionStrength;
-            fragmentUniforms.metallicRoughnessValues = (simd_float2){ material.metalnessFactor, material.roughnessFactor };
-            fragmentUniforms.baseColorFactor = material.baseColorFactor;
-            fragmentUniforms.camera = cameraWorldPos;
-            fragmentUniforms.alphaCutoff = material.alphaCutoff;
-            fragmentUniforms.envIntensity = self.lightingEnvironment.intensity;
+            FragmentUniforms *fragmentUniforms = &item->fragmentUniforms;
+            memset(fragmentUniforms, 0, sizeof(FragmentUniforms));
+            fragmentUniforms->normalScale = material.normalTextureScale;
+            fragmentUniforms->emissiveFactor = material.emissiveFactor;
+            fragmentUniforms->occlusionStrength = material.occlusionStrength;
+            fragmentUniforms->metallicRoughnessValues = (simd_float2){ material.metalnessFactor, material.roughnessFactor };
+            fragmentUniforms->baseColorFactor = material.baseColorFactor;
+            fragmentUniforms->camera = cameraWorldPos;
+            fragmentUniforms->alphaCutoff = material.alphaCutoff;
+            fragmentUniforms->envIntensity = self.lightingEnvironment.intensity;
             
             if (material.baseColorTexture != nil) {
-                fragmentUniforms.textureMatrices[GLTFTextureBindIndexBaseColor] = GLTFTextureMatrixFromTransform(material.baseColorTexture.transform);
+                fragmentUniforms->textureMatrices[GLTFTextureBindIndexBaseColor] = GLTFTextureMatrixFromTransform(material.baseColorTexture.transform);
             }
             if (material.normalTexture != nil) {
-                fragmentUniforms.textureMatrices[GLTFTextureBindIndexNormal] = GLTFTextureMatrixFromTransform(material.normalTexture.transform);
+                fragmentUniforms->textureMatrices[GLTFTextureBindIndexNormal] = GLTFTextureMatrixFromTransform(material.normalTexture.transform);
             }
             if (material.metallicRoughnessTexture != nil) {
-                fragmentUniforms.textureMatrices[GLTFTextureBindIndexMetallicRoughness] = GLTFTextureMatrixFromTransform(material.metallicRoughnessTexture.transform);
+                fragmentUniforms->textureMatrices[GLTFTextureBindIndexMetallicRoughness] = GLTFTextureMatrixFromTransform(material.metallicRoughnessTexture.transform);
             }
             if (material.occlusionTexture != nil) {
-                fragmentUniforms.textureMatrices[GLTFTextureBindIndexOcclusion] = GLTFTextureMatrixFromTransform(material.occlusionTexture.transform);
+                fragmentUniforms->textureMatrices[GLTFTextureBindIndexOcclusion] = GLTFTextureMatrixFromTransform(material.occlusionTexture.transform);
             }
             if (material.emissiveTexture != nil) {
-                fragmentUniforms.textureMatrices[GLTFTextureBindIndexEmissive] = GLTFTextureMatrixFromTransform(material.emissiveTexture.transform);
+                fragmentUniforms->textureMatrices[GLTFTextureBindIndexEmissive] = GLTFTextureMatrixFromTransform(material.emissiveTexture.transform);
             }
 
             if (self.ambientLight != nil) {
-                fragmentUniforms.ambientLight.color = self.ambientLight.color;
-                fragmentUniforms.ambientLight.intensity = self.ambientLight.intensity;
+                fragmentUniforms->ambientLight.color = self.ambientLight.color;
+                fragmentUniforms->ambientLight.intensity = self.ambientLight.intensity;
             }
 
             // TODO: Make this more efficient. Iterating the light list for every submesh is pretty silly.
+            const simd_float4x4 *lightTransforms = self.currentLightTransforms.bytes;
             for (int lightIndex = 0; lightIndex < self.currentLightNodes.count; ++lightIndex) {
                 GLTFNode *lightNode = self.currentLightNodes[lightIndex];
                 GLTFKHRLight *light = lightNode.light;
+                simd_float4x4 lightTransform = lightTransforms[lightIndex];
                 if (light.type == GLTFKHRLightTypeDirectional) {
-                    fragmentUniforms.lights[lightIndex].position = lightNode.globalTransform.columns[2];
+                    fragmentUniforms->lights[lightIndex].position = lightTransform.columns[2];
                 } else {
-                    fragmentUniforms.lights[lightIndex].position = lightNode.globalTransform.columns[3];
+                    fragmentUniforms->lights[lightIndex].position = lightTransform.columns[3];
                 }
-                fragmentUniforms.lights[lightIndex].color = light.color;
-                fragmentUniforms.lights[lightIndex].intensity = light.intensity;
-                fragmentUniforms.lights[lightIndex].range = light.range;
+                fragmentUniforms->lights[lightIndex].color = light.color;
+                fragmentUniforms->lights[lightIndex].intensity = light.intensity;
+                fragmentUniforms->lights[lightIndex].range = light.range;
                 if (light.type == GLTFKHRLightTypeSpot) {
-                    fragmentUniforms.lights[lightIndex].innerConeAngle = light.innerConeAngle;
-                    fragmentUniforms.lights[lightIndex].outerConeAngle = light.outerConeAngle;
+                    fragmentUniforms->lights[lightIndex].innerConeAngle = light.innerConeAngle;
+                    fragmentUniforms->lights[lightIndex].outerConeAngle = light.outerConeAngle;
                 } else {
-                    fragmentUniforms.lights[lightIndex].innerConeAngle = 0;
-                    fragmentUniforms.lights[lightIndex].outerConeAngle = M_PI;
+                    fragmentUniforms->lights[lightIndex].innerConeAngle = 0;
+                    fragmentUniforms->lights[lightIndex].outerConeAngle = M_PI;
                 }
-                fragmentUniforms.lights[lightIndex].spotDirection = lightNode.globalTransform.columns[2];
+                fragmentUniforms->lights[lightIndex].spotDirection = lightTransform.columns[2];
             }
             
-            GLTFMTLRenderItem *item = [GLTFMTLRenderItem new];
-            item.label = [NSString stringWithFormat:@"%@ - %@", node.name ?: @"Unnamed node", submesh.name ?: @"Unnamed primitive"];
-            item.node = node;
-            item.submesh = submesh;
-            item.vertexUniforms = vertexUniforms;
-            item.fragmentUniforms = fragmentUniforms;
-            
-            if (submesh.material.alphaMode == GLTFAlphaModeBlend) {
-                [self.transparentRenderItems addObject:item];
-            } else {
-                [self.opaqueRenderItems addObject:item];
-            }
+            item->sortKey = [self sortKeyForRenderItem:item viewMatrix:self.viewMatrix];
         }
     }
     
-    for (GLTFNode *childNode in node.children) {
-        [self buildRenderListRecursive:childNode modelMatrix:modelMatrix];
+    NSUInteger childCount = node.childCount;
+    for (NSUInteger i = 0; i < childCount; ++i) {
+        [self buildRenderListRecursive:[node childAtIndex:i] modelMatrix:modelMatrix instance:instance];
     }
 }
 
-- (void)drawRenderList:(NSArray<GLTFMTLRenderItem *> *)renderList commandEncoder:(id<MTLRenderCommandEncoder>)renderEncoder {
-    for (GLTFMTLRenderItem *item in renderList) {
-        GLTFNode *node = item.node;
-        GLTFSubmesh *submesh = item.submesh;
+- (void)drawRenderItems:(const GLTFMTLRenderItem *)items
+                  count:(NSInteger)count
+               recorder:(GLTFDrawCommandRecorder *)recorder
+{
+    BOOL debugLabelsEnabled = self.debugLabelsEnabled;
+    id<MTLDepthStencilState> depthStencilState = [self depthStencilStateForDepthWriteEnabled:YES
+                                                                            depthTestEnabled:YES
+                                                                             compareFunction:MTLCompareFunctionLess];
+    GLTFMaterial *boundMaterial = nil;
+    for (NSInteger itemIndex = 0; itemIndex < count; ++itemIndex) {
+        const GLTFMTLRenderItem *item = &items[itemIndex];
+        GLTFNode *node = item->node;
+        GLTFSubmesh *submesh = item->submesh;
         GLTFMaterial *material = submesh.material;
         
-        [renderEncoder pushDebugGroup:[NSString stringWithFormat:@"%@", item.label]];
+        if (debugLabelsEnabled) {
+            [recorder pushDebugGroup:[NSString stringWithFormat:@"%@ - %@", node.name ?: @"Unnamed node", submesh.name ?: @"Unnamed primitive"]];
+        }
         
-        id<MTLRenderPipelineState> renderPipelineState = [self renderPipelineStateForSubmesh:submesh];
-                
-        [renderEncoder setRenderPipelineState:renderPipelineState];
+        [recorder setPipelineState:item->renderPipelineState];
+        [recorder setFrontFacingWinding:GLTFDrawWindingCounterClockwise];
+        [recorder setDepthStencilState:depthStencilState];
+        [recorder setCullMode:material.isDoubleSided ? GLTFDrawCullModeNone : GLTFDrawCullModeBack];
         
-        [renderEncoder setFrontFacingWinding:MTLWindingCounterClockwise];
-
-        NSDictionary *accessorsForAttributes = submesh.accessorsForAttributes;
-                
-        GLTFAccessor *indexAccessor = submesh.indexAccessor;
-        BOOL useIndexBuffer = (indexAccessor != nil);
-                
-        // TODO: Check primitive type for unsupported types (tri fan, line loop), and modify draw calls as appropriate
-        MTLPrimitiveType primitiveType = GLTFMTLPrimitiveTypeForPrimitiveType(submesh.primitiveType);
+        // Items are sorted by material, so its textures usually don't need looking up again
+        if (itemIndex == 0 || material != boundMaterial) {
+            [self bindTexturesForMaterial:material recorder:recorder];
+            boundMaterial = material;
+        }
         
-        [self bindTexturesForMaterial:material commandEncoder:renderEncoder];
+        NSDictionary *accessorsForAttributes = submesh.accessorsForAttributes;
         
-        VertexUniforms vertexUniforms = item.vertexUniforms;
-        [renderEncoder setVertexBytes:&vertexUniforms length:sizeof(vertexUniforms) atIndex:GLTFVertexDescriptorMaxAttributeCount + 0];
+        [recorder setVertexBytes:&item->vertexUniforms length:sizeof(VertexUniforms) atIndex:GLTFVertexDescriptorMaxAttributeCount + 0];
         
-        if (node.skin != nil && node.skin.jointNodes != nil && node.skin.jointNodes.count > 0) {
-            id<MTLBuffer> jointBuffer = [self dequeueReusableBufferOfLength: node.skin.jointNodes.count * sizeof(simd_float4x4)];
-            [self computeJointsForSubmesh:submesh inNode:node buffer:jointBuffer];
-            [renderEncoder setVertexBuffer:jointBuffer offset:0 atIndex:GLTFVertexDescriptorMaxAttributeCount + 1];
-            [self.deferredReusableBuffers addObject:jointBuffer];
+        if (node.skin.jointNodes.count > 0 && accessorsForAttributes[GLTFAttributeSemanticJoints0] != nil) {
+            id<MTLBuffer> jointBuffer = [self jointBufferForNode:node instance:item->instance];
+            [recorder setVertexBuffer:jointBuffer offset:0 atIndex:GLTFVertexDescriptorMaxAttributeCount + 1];
         }
         
-        FragmentUniforms fragmentUniforms = item.fragmentUniforms;
-        [renderEncoder setFragmentBytes:&fragmentUniforms length: sizeof(fragmentUniforms) atIndex: 0];
-                
+        [recorder setFragmentBytes:&item->fragmentUniforms length:sizeof(FragmentUniforms) atIndex:0];
+        
         GLTFVertexDescriptor *vertexDescriptor = submesh.vertexDescriptor;
         for (int i = 0; i < GLTFVertexDescriptorMaxAttributeCount; ++i) {
             NSString *semantic = vertexDescriptor.attributes[i].semantic;
             if (semantic == nil) { continue; }
-            GLTFAccessor *accessor = submesh.accessorsForAttributes[semantic];
+            GLTFAccessor *accessor = accessorsForAttributes[semantic];
             
-            [renderEncoder setVertexBuffer:((GLTFMTLBuffer *)accessor.bufferView.buffer).buffer
-                                    offset:accessor.offset + accessor.bufferView.offset
-                                   atIndex:i];
-        }
-        
-        if (material.alphaMode == GLTFAlphaModeBlend){
-            id<MTLDepthStencilState> depthStencilState = [self depthStencilStateForDepthWriteEnabled:YES
-                                                                                    depthTestEnabled:YES
-                                                                                     compareFunction:MTLCompareFunctionLess];
-            [renderEncoder setDepthStencilState:depthStencilState];
-        } else {
-            id<MTLDepthStencilState> depthStencilState = [self depthStencilStateForDepthWriteEnabled:YES
-                                                                                    depthTestEnabled:YES
-                                                                                     compareFunction:MTLCompareFunctionLess];
-            [renderEncoder setDepthStencilState:depthStencilState];
+            [recorder setVertexBuffer:((GLTFMTLBuffer *)accessor.bufferView.buffer).buffer
+                               offset:accessor.offset + accessor.bufferView.offset
+                              atIndex:i];
         }
         
-        if (material.isDoubleSided) {
-            [renderEncoder setCullMode:MTLCullModeNone];
-        } else {
-            [renderEncoder setCullMode:MTLCullModeBack];
-        }
-        
-        if (useIndexBuffer) {
+        // TODO: Check primitive type for unsupported types (tri fan, line loop), and modify draw calls as appropriate
+        GLTFAccessor *indexAccessor = item->indexAccessor;
+        if (indexAccessor != nil) {
             GLTFMTLBuffer *indexBuffer = (GLTFMTLBuffer *)indexAccessor.bufferView.buffer;
-            
-            MTLIndexType indexType = (indexAccessor.componentType == GLTFDataTypeUShort) ? MTLIndexTypeUInt16 : MTLIndexTypeUInt32;
-            
-            [renderEncoder drawIndexedPrimitives:primitiveType
-                                      indexCount:indexAccessor.count
-                                       indexType:indexType
-                                     indexBuffer:[indexBuffer buffer]
-                               indexBufferOffset:indexAccessor.offset + indexAccessor.bufferView.offset];
+            [recorder drawIndexedPrimitives:submesh.primitiveType
+                                 indexCount:indexAccessor.count
+                                  indexType:indexAccessor.componentType
+                                indexBuffer:[indexBuffer buffer]
+                          indexBufferOffset:indexAccessor.offset + indexAccessor.bufferView.offset];
         } else {
             GLTFAccessor *positionAccessor = accessorsForAttributes[GLTFAttributeSemanticPosition];
-            [renderEncoder drawPrimitives:primitiveType vertexStart:0 vertexCount:positionAccessor.count];
+            [recorder drawPrimitives:submesh.primitiveType vertexStart:0 vertexCount:positionAccessor.count];
         }
         
-        [renderEncoder popDebugGroup];
+        if (debugLabelsEnabled) {
+            [recorder popDebugGroup];
+        }
     }
 }
 
@@ -18,9 +18,14 @@
 
 #import "GLTFMTLLightingEnvironment.h"
 #import "GLTFMTLShaderBuilder.h"
+#import "GLTFMTLPipelineKey.h"
+#import "GLTFMTLShaderCache.h"
 
 @implementation GLTFMTLShaderBuilder
 
+@synthesize shaderTemplate = _shaderTemplate;
+@synthesize shaderTemplateHash = _shaderTemplateHash;
+
 - (id<MTLRenderPipelineState>)renderPipelineStateForSubmesh:(GLTFSubmesh *)submesh
                                         lightingEnvironment:(GLTFMTLLightingEnvironment *)lightingEnvironment
                                            colorPixelFormat:(MTLPixelFormat)colorPixelFormat
@@ -28,14 +33,26 @@
                                                 sampleCount:(int)sampleCount
                                                      device:(id<MTLDevice>)device
 {
-    NSParameterAssert(submesh);
-    NSParameterAssert(submesh.material);
-    NSParameterAssert(submesh.vertexDescriptor);
-    
+    GLTFMTLPipelineKey *key = [[GLTFMTLPipelineKey alloc] initWithSubmesh:submesh
+                                                       lightingEnvironment:lightingEnvironment
+                                                          colorPixelFormat:colorPixelFormat
+                                                   depthStencilPixelFormat:depthStencilPixelFormat
+                                                               sampleCount:sampleCount];
+    return [self renderPipelineStateForPipelineKey:key device:device];
+}
+
+- (id<MTLRenderPipelineState>)renderPipelineStateForPipelineKey:(GLTFMTLPipelineKey *)key device:(id<MTLDevice>)device {
     NSError *error = nil;
-    NSString *shaderSource = [self shaderSource];
-    
-    shaderSource = [self rewriteSource:shaderSource forSubmesh:submesh lightingEnvironment:lightingEnvironment];
+    GLTFMTLShaderCache *shaderCache = self.shaderCache;
+    uint64_t templateHash = self.shaderTemplateHash;
+    NSString *shaderSource = [shaderCache sourceForPipelineKey:key templateHash:templateHash];
+    if (shaderSource == nil) {
+        shaderSource = [self sourceForPipelineKey:key];
+        if (shaderSource == nil) {
+            return nil;
+        }
+        [shaderCache storeSource:shaderSource forPipelineKey:key templateHash:templateHash];
+    }
     
     id<MTLLibrary> library = [device newLibraryWithSource:shaderSource options:nil error:&error];
     if (!library) {
@@ -60,17 +77,15 @@
         return nil;
     }
     
-    MTLVertexDescriptor *vertexDescriptor = [self vertexDescriptorForSubmesh: submesh];
-
     MTLRenderPipelineDescriptor *pipelineDescriptor = [MTLRenderPipelineDescriptor new];
     pipelineDescriptor.vertexFunction = vertexFunction;
     pipelineDescriptor.fragmentFunction = fragmentFunction;
-    pipelineDescriptor.vertexDescriptor = vertexDescriptor;
+    pipelineDescriptor.vertexDescriptor = key.vertexDescriptor;
     
-    pipelineDescriptor.colorAttachments[0].pixelFormat = colorPixelFormat;
-    pipelineDescriptor.sampleCount = sampleCount;
+    pipelineDescriptor.colorAttachments[0].pixelFormat = key.colorPixelFormat;
+    pipelineDescriptor.sampleCount = key.sampleCount;
 
-    if (submesh.material.alphaMode == GLTFAlphaModeBlend) {
+    if (key.blendingEnabled) {
         pipelineDescriptor.colorAttachments[0].blendingEnabled = YES;
         pipelineDescriptor.colorAttachments[0].rgbBlendOperation = MTLBlendOperationAdd;
         pipelineDescriptor.colorAttachments[0].alphaBlendOperation = MTLBlendOperationAdd;
@@ -80,17 +95,38 @@
         pipelineDescriptor.colorAttachments[0].destinationAlphaBlendFactor = MTLBlendFactorOneMinusSourceAlpha;
     }
 
-    pipelineDescriptor.depthAttachmentPixelFormat = depthStencilPixelFormat;
+    pipelineDescriptor.depthAttachmentPixelFormat = key.depthStencilPixelFormat;
 //    pipelineDescriptor.stencilAttachmentPixelFormat = depthStencilPixelFormat;
     
+    [shaderCache prepareRenderPipelineDescriptor:pipelineDescriptor device:device templateHash:templateHash];
+    
     id<MTLRenderPipelineState> pipeline = [device newRenderPipelineStateWithDescriptor:pipelineDescriptor error:&error];
     if (!pipeline) {
         NSLog(@"Error occurred when creating render pipeline state: %@", error);
+    } else {
+        [shaderCache addRenderPipelineDescriptor:pipelineDescriptor];
     }
     
     return pipeline;
 }
 
+- (NSString *)shaderTemplate {
+    @synchronized(self) {
+        if (_shaderTemplate == nil) {
+            _shaderTemplate = [self shaderSource];
+            _shaderTemplateHash = (_shaderTemplate != nil) ? GLTFMTLStableHashForString(_shaderTemplate) : 0;
+        }
+        return _shaderTemplate;
+    }
+}
+
+- (uint64_t)shaderTemplateHash {
+    @synchronized(self) {
+        [self shaderTemplate];
+        return _shaderTemplateHash;
+    }
+}
+
 - (NSString *)shaderSource {
     NSError *error = nil;
     NSURL *shaderURL = [[NSBundle mainBundle] URLForResource:@"pbr" withExtension:@"metal"];
@@ -100,10 +136,7 @@
     return [NSString stringWithContentsOfURL:shaderURL encoding:NSUTF8StringEncoding error:&error];
 }
 
-- (NSString *)rewriteSource:(NSString *)source
-                 forSubmesh:(GLTFSubmesh *)submesh
-        lightingEnvironment:(GLTFMTLLightingEnvironment *)lightingEnvironment
-{
++ (NSString *)featureDefinesForSubmesh:(GLTFSubmesh *)submesh lightingEnvironment:(GLTFMTLLightingEnvironment *)lightingEnvironment {
     GLTFMaterial *material = submesh.material;
     
     BOOL usePBR = YES;
@@ -164,6 +197,10 @@
     [shaderFeatures appendFormat:@"#define EmissiveTexCoord           texCoord%d\n", (int)material.emissiveTexture.texCoord];
     [shaderFeatures appendFormat:@"#define OcclusionTexCoord          texCoord%d\n\n", (int)material.occlusionTexture.texCoord];
 
+    return shaderFeatures;
+}
+
++ (NSString *)vertexInputDeclarationForSubmesh:(GLTFSubmesh *)submesh {
     NSString *preamble = @"struct VertexIn {\n";
     NSString *epilogue = @"\n};";
     
@@ -200,8 +237,16 @@
         ++i;
     }
     
-    NSString *decls = [NSString stringWithFormat:@"%@%@%@%@",
-                       shaderFeatures, preamble, [attribs componentsJoinedByString:@"\n"], epilogue];
+    return [NSString stringWithFormat:@"%@%@%@", preamble, [attribs componentsJoinedByString:@"\n"], epilogue];
+}
+
+- (NSString *)sourceForPipelineKey:(GLTFMTLPipelineKey *)key {
+    NSString *source = self.shaderTemplate;
+    if (source == nil) {
+        return nil;
+    }
+    
+    NSString *decls = [NSString stringWithFormat:@"%@%@", key.featureDefines, key.vertexInputDeclaration];
     
     NSRange startSigilRange = [source rangeOfString:@"/*%begin_replace_decls%*/"];
     NSRange endSigilRange = [source rangeOfString:@"/*%end_replace_decls%*/"];
@@ -213,7 +258,7 @@
     return source;
 }
 
-- (MTLVertexDescriptor *)vertexDescriptorForSubmesh:(GLTFSubmesh *)submesh {
++ (MTLVertexDescriptor *)vertexDescriptorForSubmesh:(GLTFSubmesh *)submesh {
     MTLVertexDescriptor *vertexDescriptor = [MTLVertexDescriptor new];
     
     GLTFVertexDescriptor *descriptor = submesh.vertexDescriptor;
@@ -0,0 +1,183 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFMTLShaderCache.h"
+#import "GLTFMTLPipelineKey.h"
+#import "GLTFMTLUtilities.h"
+
+@interface GLTFMTLShaderCache ()
+// Binary archives by file URL, and the URLs of those with functions not yet written out
+@property (nonatomic, strong) NSMutableDictionary<NSURL *, id> *binaryArchives;
+@property (nonatomic, strong) NSMutableSet<NSURL *> *modifiedArchiveURLs;
+@end
+
+@implementation GLTFMTLShaderCache
+
++ (NSURL *)defaultDirectoryURL {
+    NSURL *cachesURL = [[NSFileManager defaultManager] URLsForDirectory:NSCachesDirectory inDomains:NSUserDomainMask].firstObject;
+    return [cachesURL URLByAppendingPathComponent:@"GLTFMTLShaderCache" isDirectory:YES];
+}
+
+- (instancetype)initWithDirectoryURL:(NSURL *)directoryURL {
+    if ((self = [super init])) {
+        _directoryURL = directoryURL;
+        _binaryArchives = [NSMutableDictionary dictionary];
+        _modifiedArchiveURLs = [NSMutableSet set];
+    }
+    return self;
+}
+
+- (NSURL *)directoryURLForTemplateHash:(uint64_t)templateHash {
+    NSString *name = [NSString stringWithFormat:@"%016llx", templateHash];
+    NSURL *url = [self.directoryURL URLByAppendingPathComponent:name isDirectory:YES];
+    [[NSFileManager defaultManager] createDirectoryAtURL:url withIntermediateDirectories:YES attributes:nil error:nil];
+    return url;
+}
+
+- (NSURL *)sourceURLForPipelineKey:(GLTFMTLPipelineKey *)key templateHash:(uint64_t)templateHash {
+    NSString *name = [NSString stringWithFormat:@"%016llx.plist", key.keyHash];
+    return [[self directoryURLForTemplateHash:templateHash] URLByAppendingPathComponent:name isDirectory:NO];
+}
+
+// Entries hold the key's canonical description beside the source, since different keys can share a hash
+- (NSString *)sourceForPipelineKey:(GLTFMTLPipelineKey *)key templateHash:(uint64_t)templateHash {
+    NSURL *url = [self sourceURLForPipelineKey:key templateHash:templateHash];
+    NSDictionary *entry = [NSDictionary dictionaryWithContentsOfURL:url];
+    NSString *description = entry[@"key"];
+    NSString *source = entry[@"source"];
+    if (![description isKindOfClass:[NSString class]] || ![source isKindOfClass:[NSString class]] ||
+        ![description isEqualToString:key.canonicalDescription])
+    {
+        return nil;
+    }
+    return source;
+}
+
+- (void)storeSource:(NSString *)source forPipelineKey:(GLTFMTLPipelineKey *)key templateHash:(uint64_t)templateHash {
+    NSError *error = nil;
+    NSURL *url = [self sourceURLForPipelineKey:key templateHash:templateHash];
+    NSDictionary *entry = @{ @"key" : key.canonicalDescription, @"source" : source };
+    NSData *data = [NSPropertyListSerialization dataWithPropertyList:entry format:NSPropertyListBinaryFormat_v1_0
+                                                             options:0 error:&error];
+    if (data == nil || ![data writeToURL:url options:NSDataWritingAtomic error:&error]) {
+        NSLog(@"WARNING: Failed to write shader source to cache: %@", error);
+    }
+}
+
+- (void)prepareRenderPipelineDescriptor:(MTLRenderPipelineDescriptor *)descriptor
+                                 device:(id<MTLDevice>)device
+                           templateHash:(uint64_t)templateHash
+{
+    if (@available(macOS 11.0, iOS 14.0, tvOS 14.0, *)) {
+        id<MTLBinaryArchive> archive = [self binaryArchiveForDevice:device templateHash:templateHash];
+        if (archive != nil) {
+            descriptor.binaryArchives = @[archive];
+        }
+    }
+}
+
+- (id<MTLBinaryArchive>)binaryArchiveForDevice:(id<MTLDevice>)device templateHash:(uint64_t)templateHash API_AVAILABLE(macos(11.0), ios(14.0), tvos(14.0)) {
+    // Compiled functions only suit the GPU they were compiled for
+    NSString *name = [NSString stringWithFormat:@"pipelines-%016llx.metallib", GLTFMTLStableHashForString(device.name)];
+    NSURL *url = [[self directoryURLForTemplateHash:templateHash] URLByAppendingPathComponent:name isDirectory:NO];
+    
+    @synchronized(self) {
+        id<MTLBinaryArchive> archive = self.binaryArchives[url];
+        if (archive != nil) {
+            return archive;
+        }
+        
+        NSError *error = nil;
+        MTLBinaryArchiveDescriptor *archiveDescriptor = [MTLBinaryArchiveDescriptor new];
+        if ([[NSFileManager defaultManager] fileExistsAtPath:url.path]) {
+            archiveDescriptor.url = url;
+            archive = [device newBinaryArchiveWithDescriptor:archiveDescriptor error:&error];
+            if (archive == nil) {
+                // Written by an incompatible OS or driver, or damaged; start over
+                NSLog(@"WARNING: Discarding unreadable shader archive: %@", error);
+                [[NSFileManager defaultManager] removeItemAtURL:url error:nil];
+                archiveDescriptor.url = nil;
+            }
+        }
+        if (archive == nil) {
+            archive = [device newBinaryArchiveWithDescriptor:archiveDescriptor error:&error];
+        }
+        if (archive != nil) {
+            self.binaryArchives[url] = archive;
+        }
+        return archive;
+    }
+}
+
+- (void)addRenderPipelineDescriptor:(MTLRenderPipelineDescriptor *)descriptor {
+    if (@available(macOS 11.0, iOS 14.0, tvOS 14.0, *)) {
+        id<MTLBinaryArchive> archive = descriptor.binaryArchives.firstObject;
+        if (archive == nil) {
+            return;
+        }
+        @synchronized(self) {
+            NSError *error = nil;
+            if ([archive addRenderPipelineFunctionsWithDescriptor:descriptor error:&error]) {
+                for (NSURL *url in self.binaryArchives) {
+                    if (self.binaryArchives[url] == archive) {
+                        [self.modifiedArchiveURLs addObject:url];
+                    }
+                }
+            } else {
+                NSLog(@"WARNING: Failed to add pipeline functions to shader archive: %@", error);
+            }
+        }
+    }
+}
+
+- (void)synchronize {
+    if (@available(macOS 11.0, iOS 14.0, tvOS 14.0, *)) {
+        @synchronized(self) {
+            for (NSURL *url in self.modifiedArchiveURLs) {
+                // Archives can be backed by the file they were loaded from, so they're written beside it, then moved
+                NSError *error = nil;
+                NSFileManager *fileManager = [NSFileManager defaultManager];
+                id<MTLBinaryArchive> archive = self.binaryArchives[url];
+                NSURL *temporaryURL = [url URLByAppendingPathExtension:@"tmp"];
+                [fileManager removeItemAtURL:temporaryURL error:nil];
+                BOOL written = [archive serializeToURL:temporaryURL error:&error];
+                if (written) {
+                    if ([fileManager fileExistsAtPath:url.path]) {
+                        written = [fileManager replaceItemAtURL:url withItemAtURL:temporaryURL backupItemName:nil
+                                                        options:0 resultingItemURL:nil error:&error];
+                    } else {
+                        written = [fileManager moveItemAtURL:temporaryURL toURL:url error:&error];
+                    }
+                }
+                if (!written) {
+                    NSLog(@"WARNING: Failed to write shader archive: %@", error);
+                }
+            }
+            [self.modifiedArchiveURLs removeAllObjects];
+        }
+    }
+}
+
+- (void)removeAllEntries {
+    @synchronized(self) {
+        [self.binaryArchives removeAllObjects];
+        [self.modifiedArchiveURLs removeAllObjects];
+        [[NSFileManager defaultManager] removeItemAtURL:self.directoryURL error:nil];
+    }
+}
+
+@end
@@ -287,4 +287,12 @@ MTLVertexFormat GLTFMTLVertexFormatForComponentTypeAndDimension(GLTFDataType bas
     return MTLVertexFormatInvalid;
 }
 
-
+uint64_t GLTFMTLStableHashForString(NSString *string) {
+    const char *bytes = string.UTF8String;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; bytes[i] != '\0'; ++i) {
+        hash ^= (uint8_t)bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
@@ -0,0 +1,128 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import <GLTFMTL/GLTFMTL.h>
+
+@import XCTest;
+
+@interface GLTFMTLRenderer (LevelOfDetailTesting)
+- (GLTFAccessor *)indexAccessorForSubmesh:(GLTFSubmesh *)submesh modelMatrix:(simd_float4x4)modelMatrix;
+@end
+
+@interface GLTFMTLLevelOfDetailTests : XCTestCase
+@property (nonatomic, strong) GLTFMTLRenderer *renderer;
+@property (nonatomic, strong) GLTFSubmesh *submesh;
+// Submeshes only hold their accessors weakly
+@property (nonatomic, strong) NSArray *accessors;
+@end
+
+@implementation GLTFMTLLevelOfDetailTests
+
+// A submesh spanning [-1, 1] on each axis, with levels whose errors are 0.01, 0.015 and 0.1 units
+- (void)setUp {
+    [super setUp];
+    id<MTLDevice> device = MTLCreateSystemDefaultDevice();
+    if (device == nil) {
+        return;
+    }
+    self.renderer = [[GLTFMTLRenderer alloc] initWithDevice:device];
+    self.renderer.shaderCache = nil;
+    self.renderer.drawableSize = CGSizeMake(1000, 1000);
+    
+    GLTFAccessor *positionAccessor = [GLTFAccessor new];
+    positionAccessor.componentType = GLTFDataTypeFloat;
+    positionAccessor.dimension = GLTFDataDimensionVector3;
+    GLTFValueRange range = { 0 };
+    for (int c = 0; c < 3; ++c) {
+        range.minValue[c] = -1;
+        range.maxValue[c] = 1;
+    }
+    positionAccessor.valueRange = range;
+    
+    NSMutableArray *accessors = [NSMutableArray arrayWithObject:positionAccessor];
+    NSMutableArray *levels = [NSMutableArray array];
+    const float errors[] = { 0.01f, 0.015f, 0.1f };
+    for (int i = 0; i < 4; ++i) {
+        GLTFAccessor *indexAccessor = [GLTFAccessor new];
+        indexAccessor.componentType = GLTFDataTypeUInt;
+        indexAccessor.dimension = GLTFDataDimensionScalar;
+        [accessors addObject:indexAccessor];
+        if (i > 0) {
+            GLTFLevelOfDetail *level = [GLTFLevelOfDetail new];
+            level.indexAccessor = indexAccessor;
+            level.error = errors[i - 1];
+            [levels addObject:level];
+        }
+    }
+    self.accessors = accessors;
+    
+    self.submesh = [GLTFSubmesh new];
+    self.submesh.primitiveType = GLTFPrimitiveTypeTriangles;
+    self.submesh.accessorsForAttributes = @{ GLTFAttributeSemanticPosition : positionAccessor };
+    self.submesh.indexAccessor = accessors[1];
+    self.submesh.levelsOfDetail = levels;
+}
+
+- (GLTFAccessor *)levelAtIndex:(NSInteger)index {
+    return (index == 0) ? self.submesh.indexAccessor : self.submesh.levelsOfDetail[index - 1].indexAccessor;
+}
+
+// With an identity projection, a unit at `distance` from the near side of the bounds spans 500 / distance pixels
+- (GLTFAccessor *)selectedLevelAtDistance:(float)distance modelMatrix:(simd_float4x4)modelMatrix {
+    GLTFBoundingBox bounds = { (simd_float3){ -1, -1, -1 }, (simd_float3){ 1, 1, 1 } };
+    float radius = GLTFBoundingSphereTransform(GLTFBoundingSphereFromBox(bounds), modelMatrix).radius;
+    self.renderer.viewMatrix = GLTFMatrixFromTranslation((simd_float3){ 0, 0, -(distance + radius) });
+    return [self.renderer indexAccessorForSubmesh:self.submesh modelMatrix:modelMatrix];
+}
+
+- (void)testLevelIsChosenByProjectedError {
+    if (self.renderer == nil) {
+        return;
+    }
+    simd_float4x4 identity = matrix_identity_float4x4;
+    
+    // 50 pixels per unit: the first two levels are within a pixel, the last one is 5 pixels off
+    XCTAssertEqual([self selectedLevelAtDistance:10 modelMatrix:identity], [self levelAtIndex:2]);
+    // 1000 pixels per unit: even the first level is 10 pixels off
+    XCTAssertEqual([self selectedLevelAtDistance:0.5f modelMatrix:identity], [self levelAtIndex:0]);
+    // 5 pixels per unit: every level is within a pixel
+    XCTAssertEqual([self selectedLevelAtDistance:100 modelMatrix:identity], [self levelAtIndex:3]);
+    
+    self.renderer.levelOfDetailPixelError = 10;
+    XCTAssertEqual([self selectedLevelAtDistance:10 modelMatrix:identity], [self levelAtIndex:3]);
+}
+
+- (void)testScaledInstancesSelectByWorldError {
+    if (self.renderer == nil) {
+        return;
+    }
+    // Twice as large, so twice as many pixels per local unit at the same distance: 83 rather than 42
+    simd_float4x4 doubled = GLTFMatrixFromUniformScale(2);
+    XCTAssertEqual([self selectedLevelAtDistance:12 modelMatrix:matrix_identity_float4x4], [self levelAtIndex:2]);
+    XCTAssertEqual([self selectedLevelAtDistance:12 modelMatrix:doubled], [self levelAtIndex:1]);
+    XCTAssertEqual([self selectedLevelAtDistance:30 modelMatrix:doubled], [self levelAtIndex:2]);
+}
+
+- (void)testSubmeshWithoutLevelsUsesItsIndices {
+    if (self.renderer == nil) {
+        return;
+    }
+    self.submesh.levelsOfDetail = @[];
+    XCTAssertEqual([self selectedLevelAtDistance:100 modelMatrix:matrix_identity_float4x4], self.submesh.indexAccessor);
+}
+
+@end
@@ -0,0 +1,187 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import <GLTFMTL/GLTFMTL.h>
+
+@import XCTest;
+
+@interface GLTFMTLPipelineKeyTests : XCTestCase
+// Submeshes only hold their material and accessors weakly
+@property (nonatomic, strong) NSMutableArray *objects;
+@end
+
+@implementation GLTFMTLPipelineKeyTests
+
+- (void)setUp {
+    [super setUp];
+    self.objects = [NSMutableArray array];
+}
+
+- (GLTFAccessor *)accessorWithDimension:(GLTFDataDimension)dimension {
+    GLTFAccessor *accessor = [GLTFAccessor new];
+    accessor.componentType = GLTFDataTypeFloat;
+    accessor.dimension = dimension;
+    accessor.count = 3;
+    [self.objects addObject:accessor];
+    return accessor;
+}
+
+- (GLTFSubmesh *)submeshWithNormals:(BOOL)hasNormals alphaMode:(GLTFAlphaMode)alphaMode {
+    GLTFMaterial *material = [GLTFMaterial new];
+    material.alphaMode = alphaMode;
+    [self.objects addObject:material];
+    
+    NSMutableDictionary<NSString *, GLTFAccessor *> *accessors = [NSMutableDictionary dictionary];
+    accessors[GLTFAttributeSemanticPosition] = [self accessorWithDimension:GLTFDataDimensionVector3];
+    if (hasNormals) {
+        accessors[GLTFAttributeSemanticNormal] = [self accessorWithDimension:GLTFDataDimensionVector3];
+    }
+    
+    GLTFSubmesh *submesh = [GLTFSubmesh new];
+    submesh.material = material;
+    submesh.accessorsForAttributes = accessors;
+    submesh.primitiveType = GLTFPrimitiveTypeTriangles;
+    return submesh;
+}
+
+- (GLTFMTLPipelineKey *)keyForSubmesh:(GLTFSubmesh *)submesh sampleCount:(int)sampleCount {
+    return [[GLTFMTLPipelineKey alloc] initWithSubmesh:submesh
+                                   lightingEnvironment:nil
+                                      colorPixelFormat:MTLPixelFormatBGRA8Unorm_sRGB
+                               depthStencilPixelFormat:MTLPixelFormatDepth32Float
+                                           sampleCount:sampleCount];
+}
+
+- (void)testStableHashMatchesFNV1a {
+    // Published 64-bit FNV-1a values; cached pipelines are looked up by these across launches
+    XCTAssertEqual(GLTFMTLStableHashForString(@""), 0xcbf29ce484222325ULL);
+    XCTAssertEqual(GLTFMTLStableHashForString(@"a"), 0xaf63dc4c8601ec8cULL);
+    XCTAssertEqual(GLTFMTLStableHashForString(@"foobar"), 0x85944171f73967e8ULL);
+}
+
+- (void)testKeysOfEquivalentSubmeshesAreEqual {
+    GLTFMTLPipelineKey *key = [self keyForSubmesh:[self submeshWithNormals:YES alphaMode:GLTFAlphaModeOpaque] sampleCount:1];
+    GLTFMTLPipelineKey *otherKey = [self keyForSubmesh:[self submeshWithNormals:YES alphaMode:GLTFAlphaModeOpaque] sampleCount:1];
+    
+    XCTAssertNotEqual(key, otherKey);
+    XCTAssertEqualObjects(key, otherKey);
+    XCTAssertEqual(key.hash, otherKey.hash);
+    XCTAssertEqual(key.keyHash, otherKey.keyHash);
+    XCTAssertEqualObjects(key.canonicalDescription, otherKey.canonicalDescription);
+    
+    NSSet *keys = [NSSet setWithObjects:key, otherKey, nil];
+    XCTAssertEqual(keys.count, (NSUInteger)1);
+    
+    NSDictionary *pipelines = @{ key : @"pipeline" };
+    XCTAssertEqualObjects(pipelines[otherKey], @"pipeline");
+}
+
+- (void)testHashIsDerivedFromCanonicalDescription {
+    GLTFMTLPipelineKey *key = [self keyForSubmesh:[self submeshWithNormals:NO alphaMode:GLTFAlphaModeOpaque] sampleCount:4];
+    
+    XCTAssertEqual(key.keyHash, GLTFMTLStableHashForString(key.canonicalDescription));
+    XCTAssertEqual(key.hash, (NSUInteger)key.keyHash);
+    XCTAssertEqual([key copy], key);
+}
+
+- (void)testKeysDifferWhenPipelinesWould {
+    GLTFMTLPipelineKey *key = [self keyForSubmesh:[self submeshWithNormals:YES alphaMode:GLTFAlphaModeOpaque] sampleCount:1];
+    NSArray<GLTFMTLPipelineKey *> *otherKeys = @[
+        [self keyForSubmesh:[self submeshWithNormals:NO alphaMode:GLTFAlphaModeOpaque] sampleCount:1],
+        [self keyForSubmesh:[self submeshWithNormals:YES alphaMode:GLTFAlphaModeBlend] sampleCount:1],
+        [self keyForSubmesh:[self submeshWithNormals:YES alphaMode:GLTFAlphaModeMask] sampleCount:1],
+        [self keyForSubmesh:[self submeshWithNormals:YES alphaMode:GLTFAlphaModeOpaque] sampleCount:4],
+    ];
+    
+    for (GLTFMTLPipelineKey *otherKey in otherKeys) {
+        XCTAssertNotEqualObjects(key, otherKey);
+        XCTAssertNotEqual(key.keyHash, otherKey.keyHash);
+    }
+    XCTAssertTrue(otherKeys[1].blendingEnabled);
+    XCTAssertFalse(key.blendingEnabled);
+}
+
+// Loads an asset whose only buffer holds three positions followed by three normals
+- (GLTFAsset *)assetWithMeshes:(NSArray *)meshes nodes:(NSArray *)nodes scenes:(NSArray *)scenes {
+    const float vertices[] = { 0, 0, 0,   1, 0, 0,   0, 1, 0,     0, 0, 1,   0, 0, 1,   0, 0, 1 };
+    NSData *bufferData = [NSData dataWithBytes:vertices length:sizeof(vertices)];
+    NSString *uri = [@"data:application/octet-stream;base64," stringByAppendingString:[bufferData base64EncodedStringWithOptions:0]];
+    NSDictionary *json = @{
+        @"asset" : @{ @"version" : @"2.0" },
+        @"extensionsUsed" : @[ @"MSFT_lod" ],
+        @"buffers" : @[ @{ @"byteLength" : @(bufferData.length), @"uri" : uri } ],
+        @"bufferViews" : @[ @{ @"buffer" : @0, @"byteLength" : @(bufferData.length) } ],
+        @"accessors" : @[
+            @{ @"bufferView" : @0, @"byteOffset" : @0, @"componentType" : @5126, @"count" : @3, @"type" : @"VEC3",
+               @"min" : @[ @0, @0, @0 ], @"max" : @[ @1, @1, @0 ] },
+            @{ @"bufferView" : @0, @"byteOffset" : @36, @"componentType" : @5126, @"count" : @3, @"type" : @"VEC3" },
+        ],
+        @"materials" : @[ @{}, @{ @"alphaMode" : @"BLEND" } ],
+        @"meshes" : meshes,
+        @"nodes" : nodes,
+        @"scenes" : scenes,
+    };
+    NSURL *url = [[NSURL fileURLWithPath:NSTemporaryDirectory() isDirectory:YES]
+                  URLByAppendingPathComponent:[NSUUID UUID].UUIDString];
+    url = [url URLByAppendingPathExtension:@"gltf"];
+    [[NSJSONSerialization dataWithJSONObject:json options:0 error:nil] writeToURL:url atomically:YES];
+    GLTFAsset *asset = [[GLTFAsset alloc] initWithURL:url bufferAllocator:[GLTFDefaultBufferAllocator new]];
+    [[NSFileManager defaultManager] removeItemAtURL:url error:nil];
+    return asset;
+}
+
+- (void)testPipelineKeysForAssetAreDistinctAndReachable {
+    NSDictionary *positions = @{ @"POSITION" : @0 };
+    NSDictionary *positionsAndNormals = @{ @"POSITION" : @0, @"NORMAL" : @1 };
+    NSArray *meshes = @[
+        // An opaque and a blended submesh
+        @{ @"primitives" : @[ @{ @"attributes" : positions, @"material" : @0 },
+                              @{ @"attributes" : positions, @"material" : @1 } ] },
+        // Drawn with the same pipeline as the first submesh above
+        @{ @"primitives" : @[ @{ @"attributes" : positions, @"material" : @0 } ] },
+        // Only reachable as a level of detail
+        @{ @"primitives" : @[ @{ @"attributes" : positionsAndNormals, @"material" : @0 } ] },
+        // Only used by a node outside every scene
+        @{ @"primitives" : @[ @{ @"attributes" : positionsAndNormals, @"material" : @1 } ] },
+    ];
+    NSArray *nodes = @[
+        @{ @"mesh" : @0, @"children" : @[ @1, @2 ], @"extensions" : @{ @"MSFT_lod" : @{ @"ids" : @[ @3 ] } } },
+        @{ @"mesh" : @0 },
+        @{ @"mesh" : @1 },
+        @{ @"mesh" : @2 },
+        @{ @"mesh" : @3 },
+    ];
+    GLTFAsset *asset = [self assetWithMeshes:meshes nodes:nodes scenes:@[ @{ @"nodes" : @[ @0 ] }, @{ @"nodes" : @[ @0 ] } ]];
+    XCTAssertNotNil(asset);
+
+    NSArray<GLTFMTLPipelineKey *> *keys = [GLTFMTLPipelineKey pipelineKeysForAsset:asset
+                                                                lightingEnvironment:nil
+                                                                   colorPixelFormat:MTLPixelFormatBGRA8Unorm_sRGB
+                                                            depthStencilPixelFormat:MTLPixelFormatDepth32Float
+                                                                        sampleCount:1];
+    XCTAssertEqual(keys.count, (NSUInteger)3);
+    XCTAssertEqual([NSSet setWithArray:keys].count, keys.count);
+
+    GLTFMesh *firstMesh = asset.scenes.firstObject.nodes.firstObject.mesh;
+    GLTFMesh *levelOfDetailMesh = asset.scenes.firstObject.nodes.firstObject.levelOfDetailNodes.firstObject.mesh;
+    NSArray<GLTFSubmesh *> *expectedSubmeshes = @[ firstMesh.submeshes[0], firstMesh.submeshes[1], levelOfDetailMesh.submeshes[0] ];
+    for (GLTFSubmesh *submesh in expectedSubmeshes) {
+        XCTAssertTrue([keys containsObject:[self keyForSubmesh:submesh sampleCount:1]]);
+    }
+}
+
+@end
@@ -0,0 +1,125 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import "GLTFMTLRenderItem.h"
+
+@import XCTest;
+
+@interface GLTFMTLRenderItemArenaTests : XCTestCase
+@end
+
+@implementation GLTFMTLRenderItemArenaTests
+
+- (void)testArenaGrowsAndKeepsItems {
+    GLTFMTLRenderItemArena arena = { 0 };
+    for (NSInteger i = 0; i < 1000; ++i) {
+        GLTFMTLRenderItem *item = GLTFMTLRenderItemArenaAppend(&arena);
+        item->sortKey = (uint64_t)i;
+    }
+    XCTAssertEqual(arena.count, (NSInteger)1000);
+    XCTAssertGreaterThanOrEqual(arena.capacity, arena.count);
+    // Doubling from 64
+    XCTAssertEqual(arena.capacity, (NSInteger)1024);
+    for (NSInteger i = 0; i < arena.count; ++i) {
+        XCTAssertEqual(arena.items[i].sortKey, (uint64_t)i);
+    }
+    GLTFMTLRenderItemArenaFree(&arena);
+    XCTAssertTrue(arena.items == NULL);
+    XCTAssertEqual(arena.capacity, (NSInteger)0);
+}
+
+- (void)testResetKeepsStorage {
+    GLTFMTLRenderItemArena arena = { 0 };
+    for (NSInteger i = 0; i < 300; ++i) {
+        GLTFMTLRenderItemArenaAppend(&arena);
+    }
+    GLTFMTLRenderItem *items = arena.items;
+    NSInteger capacity = arena.capacity;
+    
+    GLTFMTLRenderItemArenaReset(&arena);
+    XCTAssertEqual(arena.count, (NSInteger)0);
+    XCTAssertEqual(arena.capacity, capacity);
+    
+    // A frame no larger than the last one is built without reallocating
+    for (NSInteger i = 0; i < capacity; ++i) {
+        GLTFMTLRenderItem *item = GLTFMTLRenderItemArenaAppend(&arena);
+        XCTAssertEqual(item, &items[i]);
+    }
+    XCTAssertEqual(arena.items, items);
+    XCTAssertEqual(arena.capacity, capacity);
+    GLTFMTLRenderItemArenaFree(&arena);
+}
+
+- (void)testSortOrdersItemsByKeyStably {
+    GLTFMTLRenderItemArena arena = { 0 };
+    GLTFMTLRenderItemSortBuffer sortBuffer = { 0 };
+    const NSInteger count = 500;
+    for (NSInteger i = 0; i < count; ++i) {
+        GLTFMTLRenderItem *item = GLTFMTLRenderItemArenaAppend(&arena);
+        // Few distinct keys, so that many are equal and stability shows
+        item->sortKey = ((uint64_t)(i * 7919) % 13) << 40;
+        item->vertexUniforms.modelMatrix.columns[3].x = (float)i;
+    }
+    GLTFMTLRenderItemArenaSort(&arena, &sortBuffer);
+    XCTAssertEqual(arena.count, count);
+    XCTAssertGreaterThanOrEqual(sortBuffer.capacity, count);
+    for (NSInteger i = 1; i < count; ++i) {
+        const GLTFMTLRenderItem *previous = &arena.items[i - 1], *item = &arena.items[i];
+        XCTAssertLessThanOrEqual(previous->sortKey, item->sortKey);
+        if (previous->sortKey == item->sortKey) {
+            XCTAssertLessThan(previous->vertexUniforms.modelMatrix.columns[3].x, item->vertexUniforms.modelMatrix.columns[3].x);
+        }
+    }
+    
+    // Sorting a smaller frame reuses the working space
+    uint64_t *keys = sortBuffer.keys;
+    GLTFMTLRenderItemArenaReset(&arena);
+    for (NSInteger i = 0; i < 10; ++i) {
+        GLTFMTLRenderItemArenaAppend(&arena)->sortKey = (uint64_t)(10 - i);
+    }
+    GLTFMTLRenderItemArenaSort(&arena, &sortBuffer);
+    XCTAssertEqual(sortBuffer.keys, keys);
+    XCTAssertEqual(arena.items[0].sortKey, (uint64_t)1);
+    
+    GLTFMTLRenderItemArenaFree(&arena);
+    GLTFMTLRenderItemSortBufferFree(&sortBuffer);
+}
+
+// Fills and sorts 50,000 items a frame in storage kept from the frame before
+- (void)testFillAndSortPerformance {
+    __block GLTFMTLRenderItemArena arena = { 0 };
+    __block GLTFMTLRenderItemSortBuffer sortBuffer = { 0 };
+    const NSInteger count = 50000;
+    __block uint64_t seed = 1;
+    [self measureBlock:^{
+        for (int frame = 0; frame < 10; ++frame) {
+            GLTFMTLRenderItemArenaReset(&arena);
+            for (NSInteger i = 0; i < count; ++i) {
+                GLTFMTLRenderItem *item = GLTFMTLRenderItemArenaAppend(&arena);
+                seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                item->sortKey = seed >> 16;
+                item->vertexUniforms.modelMatrix = matrix_identity_float4x4;
+            }
+            GLTFMTLRenderItemArenaSort(&arena, &sortBuffer);
+        }
+        XCTAssertEqual(arena.count, count);
+    }];
+    GLTFMTLRenderItemArenaFree(&arena);
+    GLTFMTLRenderItemSortBufferFree(&sortBuffer);
+}
+
+@end
@@ -0,0 +1,111 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+
+#import <GLTFMTL/GLTFMTL.h>
+
+@import XCTest;
+
+// Stands in for a key whose hash happens to match another key's
+@interface GLTFMTLCollidingPipelineKey : GLTFMTLPipelineKey
+@end
+
+@implementation GLTFMTLCollidingPipelineKey
+- (uint64_t)keyHash {
+    return 0x5eed;
+}
+@end
+
+@interface GLTFMTLShaderCacheTests : XCTestCase
+@property (nonatomic, strong) NSURL *directoryURL;
+// Submeshes only hold their material and accessors weakly
+@property (nonatomic, strong) NSMutableArray *objects;
+@end
+
+@implementation GLTFMTLShaderCacheTests
+
+- (void)setUp {
+    [super setUp];
+    self.directoryURL = [[NSURL fileURLWithPath:NSTemporaryDirectory() isDirectory:YES]
+                         URLByAppendingPathComponent:[NSUUID UUID].UUIDString isDirectory:YES];
+    self.objects = [NSMutableArray array];
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtURL:self.directoryURL error:nil];
+    [super tearDown];
+}
+
+- (GLTFSubmesh *)submeshWithAlphaMode:(GLTFAlphaMode)alphaMode {
+    GLTFMaterial *material = [GLTFMaterial new];
+    material.alphaMode = alphaMode;
+    GLTFAccessor *accessor = [GLTFAccessor new];
+    accessor.componentType = GLTFDataTypeFloat;
+    accessor.dimension = GLTFDataDimensionVector3;
+    accessor.count = 3;
+    [self.objects addObjectsFromArray:@[ material, accessor ]];
+    
+    GLTFSubmesh *submesh = [GLTFSubmesh new];
+    submesh.material = material;
+    submesh.accessorsForAttributes = @{ GLTFAttributeSemanticPosition : accessor };
+    return submesh;
+}
+
+- (GLTFMTLPipelineKey *)keyOfClass:(Class)keyClass alphaMode:(GLTFAlphaMode)alphaMode {
+    return [[keyClass alloc] initWithSubmesh:[self submeshWithAlphaMode:alphaMode]
+                         lightingEnvironment:nil
+                            colorPixelFormat:MTLPixelFormatBGRA8Unorm_sRGB
+                     depthStencilPixelFormat:MTLPixelFormatDepth32Float
+                                 sampleCount:1];
+}
+
+- (void)testSourceSurvivesNewCache {
+    GLTFMTLPipelineKey *key = [self keyOfClass:[GLTFMTLPipelineKey class] alphaMode:GLTFAlphaModeOpaque];
+    GLTFMTLShaderCache *cache = [[GLTFMTLShaderCache alloc] initWithDirectoryURL:self.directoryURL];
+    XCTAssertNil([cache sourceForPipelineKey:key templateHash:1]);
+    
+    [cache storeSource:@"// opaque" forPipelineKey:key templateHash:1];
+    XCTAssertEqualObjects([cache sourceForPipelineKey:key templateHash:1], @"// opaque");
+    
+    // As in a later launch, and for an equal key made from another submesh
+    GLTFMTLShaderCache *reopenedCache = [[GLTFMTLShaderCache alloc] initWithDirectoryURL:self.directoryURL];
+    GLTFMTLPipelineKey *equalKey = [self keyOfClass:[GLTFMTLPipelineKey class] alphaMode:GLTFAlphaModeOpaque];
+    XCTAssertEqualObjects([reopenedCache sourceForPipelineKey:equalKey templateHash:1], @"// opaque");
+    
+    // Entries made from another template aren't used
+    XCTAssertNil([reopenedCache sourceForPipelineKey:equalKey templateHash:2]);
+    
+    [reopenedCache removeAllEntries];
+    XCTAssertNil([cache sourceForPipelineKey:key templateHash:1]);
+}
+
+- (void)testCollidingKeysDontShareSource {
+    GLTFMTLPipelineKey *opaqueKey = [self keyOfClass:[GLTFMTLCollidingPipelineKey class] alphaMode:GLTFAlphaModeOpaque];
+    GLTFMTLPipelineKey *blendedKey = [self keyOfClass:[GLTFMTLCollidingPipelineKey class] alphaMode:GLTFAlphaModeBlend];
+    XCTAssertEqual(opaqueKey.keyHash, blendedKey.keyHash);
+    XCTAssertNotEqualObjects(opaqueKey, blendedKey);
+    
+    GLTFMTLShaderCache *cache = [[GLTFMTLShaderCache alloc] initWithDirectoryURL:self.directoryURL];
+    [cache storeSource:@"// opaque" forPipelineKey:opaqueKey templateHash:1];
+    XCTAssertNil([cache sourceForPipelineKey:blendedKey templateHash:1]);
+    
+    // The later key takes the slot over; the earlier one then misses rather than getting the wrong source
+    [cache storeSource:@"// blended" forPipelineKey:blendedKey templateHash:1];
+    XCTAssertEqualObjects([cache sourceForPipelineKey:blendedKey templateHash:1], @"// blended");
+    XCTAssertNil([cache sourceForPipelineKey:opaqueKey templateHash:1]);
+}
+
+@end
@@ -154,13 +154,13 @@ static SCNMatrix4 GLTFSCNContentsTransformFromTextureTransform(GLTFTextureTransf
         NSMutableArray *pairs = [NSMutableArray array];
         for (GLTFAnimationChannel *channel in animation.channels) {
             CAKeyframeAnimation *keyframeAnimation = nil;
-            if ([channel.targetPath isEqualToString:@"rotation"]) {
+            if (channel.path == GLTFAnimationPathRotation) {
                 keyframeAnimation = [CAKeyframeAnimation animationWithKeyPath:@"orientation"];
                 keyframeAnimation.values = [self arrayFromQuaternionAccessor:channel.sampler.outputAccessor];
-            } else if ([channel.targetPath isEqualToString:@"translation"]) {
+            } else if (channel.path == GLTFAnimationPathTranslation) {
                 keyframeAnimation = [CAKeyframeAnimation animationWithKeyPath:@"translation"];
                 keyframeAnimation.values = [self vectorArrayFromAccessor:channel.sampler.outputAccessor];
-            } else if ([channel.targetPath isEqualToString:@"scale"]) {
+            } else if (channel.path == GLTFAnimationPathScale) {
                 keyframeAnimation = [CAKeyframeAnimation animationWithKeyPath:@"scale"];
                 keyframeAnimation.values = [self vectorArrayFromScalarAccessor:channel.sampler.outputAccessor];
             } else {
@@ -209,6 +209,10 @@
 - (void)setAsset:(GLTFAsset *)asset {
     _asset = asset;
     if (_asset != nil) {
+        GLTFScene *scene = _asset.defaultScene;
+        if (scene != nil) {
+            scene.transformStore = [[GLTFTransformStore alloc] initWithScene:scene];
+        }
         [self computeRegularizationMatrix];
         [self computeTransforms];
         [self addDefaultLights];
@@ -256,14 +260,10 @@
     
     NSTimeInterval maxAnimDuration = 0;
     for (GLTFAnimation *animation in self.asset.animations) {
-        for (GLTFAnimationChannel *channel in animation.channels) {
-            if (channel.duration > maxAnimDuration) {
-                maxAnimDuration = channel.duration;
-            }
-        }
+        maxAnimDuration = MAX(maxAnimDuration, animation.duration);
     }
     
-    NSTimeInterval animTime = fmod(self.globalTime, maxAnimDuration);
+    NSTimeInterval animTime = (maxAnimDuration > 0) ? fmod(self.globalTime, maxAnimDuration) : 0;
 
     for (GLTFAnimation *animation in self.asset.animations) {
         [animation runAtTime:animTime];
@@ -0,0 +1,106 @@
+//
+//  Copyright (c) 2018 Warren Moore. All rights reserved.
+//
+//  Permission to use, copy, modify, and distribute this software for any
+//  purpose with or without fee is hereby granted, provided that the above
+//  copyright notice and this permission notice appear in all copies.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+//  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+//  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+//  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+//  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+//  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+//  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+
+@import Foundation;
+@import GLTF;
+
+static void PrintUsage(void) {
+    fprintf(stderr, "usage: gltfpack [--no-compact] [--translation-tolerance <units>] [--rotation-tolerance <radians>]\n"
+                    "                [--scale-tolerance <units>] [--weight-tolerance <units>] <input.gltf|input.glb> <output.glb>\n");
+}
+
+int main(int argc, const char * argv[]) {
+    @autoreleasepool {
+        BOOL compact = YES;
+        GLTFAnimationCompressionTolerances animationTolerances = { 0 };
+        NSMutableArray<NSString *> *paths = [NSMutableArray array];
+        for (int i = 1; i < argc; ++i) {
+            NSString *argument = @(argv[i]);
+            if ([argument isEqualToString:@"--no-compact"]) {
+                compact = NO;
+            } else if ([argument isEqualToString:@"--translation-tolerance"] && i + 1 < argc) {
+                animationTolerances.translation = atof(argv[++i]);
+            } else if ([argument isEqualToString:@"--rotation-tolerance"] && i + 1 < argc) {
+                animationTolerances.rotation = atof(argv[++i]);
+            } else if ([argument isEqualToString:@"--scale-tolerance"] && i + 1 < argc) {
+                animationTolerances.scale = atof(argv[++i]);
+            } else if ([argument isEqualToString:@"--weight-tolerance"] && i + 1 < argc) {
+                animationTolerances.weight = atof(argv[++i]);
+            } else {
+                [paths addObject:argument];
+            }
+        }
+        if (paths.count != 2) {
+            PrintUsage();
+            return 1;
+        }
+        
+        NSURL *inputURL = [NSURL fileURLWithPath:paths[0]];
+        NSURL *outputURL = [NSURL fileURLWithPath:paths[1]];
+        
+        GLTFAsset *asset = [[GLTFAsset alloc] initWithURL:inputURL bufferAllocator:[GLTFDefaultBufferAllocator new]];
+        if (asset == nil) {
+            fprintf(stderr, "Unable to load asset at %s\n", inputURL.path.UTF8String);
+            return 1;
+        }
+        
+        if (compact) {
+            GLTFAssetCompactionStatistics statistics = [asset removeUnusedAndDuplicateObjects];
+            printf("Merged %ld accessors, %ld images, %ld samplers, %ld textures, %ld materials\n",
+                   (long)statistics.mergedAccessorCount, (long)statistics.mergedImageCount,
+                   (long)statistics.mergedSamplerCount, (long)statistics.mergedTextureCount,
+                   (long)statistics.mergedMaterialCount);
+            printf("Removed %ld accessors, %ld buffer views, %ld buffers, %ld images, %ld samplers, %ld textures, %ld materials, %ld meshes\n",
+                   (long)statistics.removedAccessorCount, (long)statistics.removedBufferViewCount,
+                   (long)statistics.removedBufferCount, (long)statistics.removedImageCount,
+                   (long)statistics.removedSamplerCount, (long)statistics.removedTextureCount,
+                   (long)statistics.removedMaterialCount, (long)statistics.removedMeshCount);
+            printf("Deduplicated %ld bytes; released %ld bytes of buffers\n",
+                   (long)statistics.duplicateByteCount, (long)statistics.reclaimedBufferByteCount);
+        }
+        
+        // Animation compression happens as clips are compiled in memory, so this only reports what it would save
+        BOOL compressesAnimations = animationTolerances.translation > 0 || animationTolerances.rotation > 0 ||
+                                    animationTolerances.scale > 0 || animationTolerances.weight > 0;
+        if (compressesAnimations && asset.animations.count > 0) {
+            NSMutableArray<GLTFAnimationCompressionReport *> *reports = [NSMutableArray array];
+            for (GLTFAnimation *animation in asset.animations) {
+                animation.compressionTolerances = animationTolerances;
+                GLTFAnimationCompressionReport *report = animation.compressionReport;
+                if (report != nil) {
+                    [reports addObject:report];
+                }
+            }
+            GLTFAnimationCompressionReport *report = [GLTFAnimationCompressionReport reportCombiningReports:reports];
+            printf("Animation keyframes: %lu of %lu kept; %lu bytes compress to %lu (%.2f:1)\n",
+                   (unsigned long)report.retainedKeyFrameCount, (unsigned long)report.sourceKeyFrameCount,
+                   (unsigned long)report.sourceByteCount, (unsigned long)report.compressedByteCount, report.compressionRatio);
+            printf("Worst animation error: translation %g, rotation %g rad, scale %g, weight %g\n",
+                   report.maximumTranslationError, report.maximumRotationError, report.maximumScaleError, report.maximumWeightError);
+        }
+        
+        NSError *error = nil;
+        GLTFAssetWriter *writer = [[GLTFAssetWriter alloc] initWithAsset:asset];
+        if (![writer writeBinaryToURL:outputURL error:&error]) {
+            fprintf(stderr, "Unable to write %s: %s\n", outputURL.path.UTF8String, error.localizedDescription.UTF8String);
+            return 1;
+        }
+        
+        NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:outputURL.path error:nil];
+        printf("Wrote %llu bytes to %s\n", attributes.fileSize, outputURL.path.UTF8String);
+    }
+    return 0;
+}